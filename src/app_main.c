@@ -5,11 +5,25 @@
 #include "esp_bsp.h"
 #include "esp_psram.h"
 #include "esp_log.h"
+#include "nvs_flash.h"
 #include "pincfg.h"
 #include "display.h"
 #include "lv_port.h"
+#include "pst_dir_cache.h"
+#include "pst_dir_prefetch.h"
+#include "pst_dir_scan.h"
+#include "pst_dir_search.h"
 #include "pst_file_browser.h"
+#include "pst_font.h"
+#include "pst_fs.h"
+#include "pst_gesture.h"
+#include "pst_img_cache.h"
 #include "pst_keyboard.h"
+#include "pst_latency.h"
+#include "pst_screen.h"
+#include "pst_thumb.h"
+#include "pst_touch_rec.h"
+#include "pst_trace.h"
 
 static const char *TAG = "EXPLORER_TEST";
 
@@ -27,10 +41,28 @@ void my_file_picker_callback(const char *full_path)
     }
 }
 
+// Edit mode: the file browser, reopened in the last folder if the screen was evicted
+static void edit_screen_build(lv_obj_t *scr, void *user_data)
+{
+    pst_file_browser_attach(scr, NULL, my_file_picker_callback);
+}
+
 void app_main(void)
 {
     ESP_LOGI(TAG, "Initializing System...");
 
+    // NVS holds the touch calibration, read when the touch is created
+    esp_err_t nvs_ret = nvs_flash_init();
+    if (nvs_ret == ESP_ERR_NVS_NO_FREE_PAGES || nvs_ret == ESP_ERR_NVS_NEW_VERSION_FOUND)
+    {
+        ESP_ERROR_CHECK(nvs_flash_erase());
+        nvs_ret = nvs_flash_init();
+    }
+    if (nvs_ret != ESP_OK)
+    {
+        ESP_LOGW(TAG, "NVS unavailable (%s), touch calibration disabled", esp_err_to_name(nvs_ret));
+    }
+
     // 1. Initialize the Display
     // Using default BSP config, adjust rotation if your screen is upside down
     bsp_display_cfg_t cfg = {
@@ -41,6 +73,31 @@ void app_main(void)
     bsp_display_start_with_config(&cfg);
     bsp_display_backlight_on();
 
+    // LVGL reads the SD card ("S:") through a block cache with read-ahead
+    pst_fs_init(NULL);
+    // Decoded images from the SD card are kept in PSRAM
+    pst_img_cache_init(NULL);
+    // Glyphs of compressed SD fonts (S:/fonts) are kept in PSRAM
+    pst_font_init(NULL);
+    // Pinch, two-finger pan and flicks are recognized in the touch task
+    pst_gesture_init(NULL);
+    // Folder listings are kept in PSRAM and checked against the card on reuse
+    pst_dir_cache_init(NULL);
+    // Folders are read by a worker task and streamed to the browser
+    pst_dir_scan_cfg_t scan_cfg = PST_DIR_SCAN_DEFAULT_CONFIG();
+#if CONFIG_PST_DIR_INDEX
+    scan_cfg.index_min_entries = CONFIG_PST_DIR_INDEX_MIN_ENTRIES;
+#else
+    scan_cfg.index_min_entries = 0;
+#endif
+    pst_dir_scan_init(&scan_cfg);
+    // Long press on the browser header searches the whole card in the background
+    pst_dir_search_init(NULL);
+    // Folders are read into the cache as their row is pressed, recent ones at boot
+    pst_dir_prefetch_init(NULL);
+    // Image rows get thumbnails, decoded once and kept on the card
+    pst_thumb_init(NULL);
+
     // 2. Initialize the SD Card (CRITICAL)
     // The File Explorer will show an empty list if the SD isn't mounted
     ESP_LOGI(TAG, "Mounting SD Card...");
@@ -49,11 +106,57 @@ void app_main(void)
     {
         ESP_LOGE(TAG, "Failed to mount SD card! Check your wiring/card.");
     }
+    else
+    {
+        pst_dir_prefetch_warm();
+    }
+
+    // Hot-path traces are formatted by a low-priority task (CONFIG_PST_TRACE)
+    pst_trace_cfg_t trace_cfg = PST_TRACE_DEFAULT_CONFIG();
+#if CONFIG_PST_TRACE_TO_FILE
+    if (ret == ESP_OK)
+    {
+        trace_cfg.sink = PST_TRACE_SINK_FILE;
+        trace_cfg.path = CONFIG_PST_TRACE_FILE;
+    }
+#endif
+    pst_trace_init(&trace_cfg);
 
     // 3. Launch the Browser
-    // "S:" is the drive letter we set in lv_conf.h
+    // The browser starts at "S:", the drive letter registered by pst_fs
     ESP_LOGI(TAG, "Launching File Browser...");
-    pst_file_browser_create("S:", my_file_picker_callback);
+    pst_screen_init(NULL);
+    const pst_screen_desc_t edit_screen = {
+        .name = "Edit",
+        .build = edit_screen_build,
+    };
+    pst_screen_register(PST_SCREEN_EDIT, &edit_screen);
+    pst_screen_show(PST_SCREEN_EDIT);
+
+    // Touch-to-photon latency overlay (CONFIG_PST_LATENCY_TRACE)
+    if (pst_latency_init(lv_disp_get_default(), bsp_display_get_input_dev()) == ESP_OK)
+    {
+        pst_latency_overlay_show(true);
+#if CONFIG_PST_LATENCY_SYNTHETIC_TAPS
+        pst_latency_synthetic_start(200, CONFIG_PST_LATENCY_SYNTHETIC_TAPS);
+#endif
+    }
+
+    // Benchmark input: record a scenario, or replay one (CONFIG_PST_TOUCH_REC)
+#if CONFIG_PST_TOUCH_REC_BOOT_SECONDS
+    const pst_touch_rec_cfg_t rec_cfg = {
+        .max_records = 16384,
+        .duration_ms = CONFIG_PST_TOUCH_REC_BOOT_SECONDS * 1000,
+        .path = CONFIG_PST_TOUCH_REC_BOOT_FILE,
+    };
+    pst_touch_rec_start(&rec_cfg);
+#elif CONFIG_PST_TOUCH_REPLAY_BOOT
+#if CONFIG_PST_TOUCH_REPLAY_BOOT_FAST
+    pst_touch_replay_start(CONFIG_PST_TOUCH_REC_BOOT_FILE, PST_TOUCH_REPLAY_FAST, 1000, NULL, NULL);
+#else
+    pst_touch_replay_start(CONFIG_PST_TOUCH_REC_BOOT_FILE, PST_TOUCH_REPLAY_ORIGINAL, 1000, NULL, NULL);
+#endif
+#endif
 
     // 4. Main Loop
     while (1)
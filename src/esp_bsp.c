@@ -8,7 +8,7 @@
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 #include "driver/gpio.h"
-#include "driver/i2c.h"
+#include "driver/i2c_master.h"
 #include "driver/spi_master.h"
 #include "esp_timer.h"
 #include "esp_lcd_panel_io.h"
@@ -25,11 +25,18 @@
 #include "esp_lcd_axs15231b.h"
 #include "bsp_err_check.h"
 #include "pincfg.h"
+#include "pst_latency.h"
+#include "pst_perf.h"
+#include "pst_trace.h"
+#include "pst_touch.h"
+#include "pst_touch_cal.h"
 
 #include "lv_port.h"
 #include "display.h"
 #include "esp_bsp.h"
 #include "esp_vfs_fat.h"
+#include "diskio_impl.h"
+#include "diskio_sdmmc.h"
 #include "driver/sdmmc_host.h"
 #include "sdmmc_cmd.h"
 
@@ -80,7 +87,9 @@ typedef struct {
 
 typedef struct {
     SemaphoreHandle_t tp_intr_event;    /*!< Semaphore for tp interrupt */
-    lv_disp_rot_t rotate;               /*!< Rotation configuration for the display */
+    pst_touch_orient_t orient;          /*!< Rotation, mirror and swap of the controller */
+    pst_touch_xform_t xform[2];         /*!< Active transform and the one being rebuilt */
+    volatile uint8_t xform_act;         /*!< Index of the active transform */
 } bsp_touch_int_t;
 
 static lv_disp_t *disp;
@@ -88,38 +97,41 @@ static lv_indev_t *disp_indev = NULL;
 static esp_lcd_touch_handle_t tp = NULL;   // LCD touch handle
 static esp_lcd_panel_handle_t panel_handle = NULL;
 
-static bool i2c_initialized = false;
+static i2c_master_bus_handle_t i2c_handle = NULL;
 
 esp_err_t bsp_i2c_init(void)
 {
     /* I2C was initialized before */
-    if (i2c_initialized) {
+    if (i2c_handle) {
         return ESP_OK;
     }
 
-    const i2c_config_t i2c_conf = {
-        .mode = I2C_MODE_MASTER,
+    const i2c_master_bus_config_t i2c_bus_conf = {
+        .i2c_port = BSP_I2C_NUM,
         .sda_io_num = EXAMPLE_PIN_NUM_QSPI_TOUCH_SDA,
-        .sda_pullup_en = GPIO_PULLUP_DISABLE,
         .scl_io_num = EXAMPLE_PIN_NUM_QSPI_TOUCH_SCL,
-        .scl_pullup_en = GPIO_PULLUP_DISABLE,
-        .master.clk_speed = BSP_I2C_CLK_SPEED_HZ
+        .clk_source = I2C_CLK_SRC_DEFAULT,
+        .glitch_ignore_cnt = 7,
+        .trans_queue_depth = BSP_I2C_TRANS_QUEUE_DEPTH,
+        .flags.enable_internal_pullup = false,
     };
-    BSP_ERROR_CHECK_RETURN_ERR(i2c_param_config(BSP_I2C_NUM, &i2c_conf));
-    BSP_ERROR_CHECK_RETURN_ERR(i2c_driver_install(BSP_I2C_NUM, i2c_conf.mode, 0, 0, 0));
-
-    i2c_initialized = true;
+    BSP_ERROR_CHECK_RETURN_ERR(i2c_new_master_bus(&i2c_bus_conf, &i2c_handle));
 
     return ESP_OK;
 }
 
 esp_err_t bsp_i2c_deinit(void)
 {
-    BSP_ERROR_CHECK_RETURN_ERR(i2c_driver_delete(BSP_I2C_NUM));
-    i2c_initialized = false;
+    BSP_ERROR_CHECK_RETURN_ERR(i2c_del_master_bus(i2c_handle));
+    i2c_handle = NULL;
     return ESP_OK;
 }
 
+i2c_master_bus_handle_t bsp_i2c_get_handle(void)
+{
+    return i2c_handle;
+}
+
 // Bit number used to represent command and parameter
 #define LCD_LEDC_CH            1
 
@@ -158,7 +170,7 @@ esp_err_t bsp_display_brightness_set(int brightness_percent)
         brightness_percent = 0;
     }
 
-    ESP_LOGI(TAG, "Setting LCD backlight: %d%%", brightness_percent);
+    PST_TRACE("Setting LCD backlight: %d%%", brightness_percent);
     uint32_t duty_cycle = (1023 * brightness_percent) / 100; // LEDC resolution set to 10bits, thus: 100% = 1023
     BSP_ERROR_CHECK_RETURN_ERR(ledc_set_duty(LEDC_LOW_SPEED_MODE, LCD_LEDC_CH, duty_cycle));
     BSP_ERROR_CHECK_RETURN_ERR(ledc_update_duty(LEDC_LOW_SPEED_MODE, LCD_LEDC_CH));
@@ -176,7 +188,7 @@ esp_err_t bsp_display_backlight_on(void)
     return bsp_display_brightness_set(100);
 }
 
-static bool bsp_display_sync_cb(void *arg)
+static PST_IRAM_ATTR bool bsp_display_sync_cb(void *arg)
 {
     assert(arg);
     bsp_lcd_tear_t *tear_handle = (bsp_lcd_tear_t *)arg;
@@ -205,7 +217,7 @@ static void bsp_display_sync_task(void *arg)
     vTaskDelete(NULL);
 }
 
-static void bsp_display_tear_interrupt(void *arg)
+static PST_IRAM_ATTR void bsp_display_tear_interrupt(void *arg)
 {
     assert(arg);
     bsp_lcd_tear_t *tear_handle = (bsp_lcd_tear_t *)arg;
@@ -379,7 +391,7 @@ static lv_disp_t *bsp_display_lcd_init(const bsp_display_cfg_t *cfg)
     return lvgl_port_add_disp(&disp_cfg);
 }
 
-static bool bsp_touch_sync_cb(void *arg)
+static PST_IRAM_ATTR bool bsp_touch_sync_cb(void *arg)
 {
     assert(arg);
     bool touch_interrupt = false;
@@ -396,11 +408,12 @@ static bool bsp_touch_sync_cb(void *arg)
     return touch_interrupt;
 }
 
-static void bsp_touch_interrupt_cb(esp_lcd_touch_handle_t tp)
+static PST_IRAM_ATTR void bsp_touch_interrupt_cb(esp_lcd_touch_handle_t tp)
 {
     BaseType_t xHigherPriorityTaskWoken = pdFALSE;
     bsp_touch_int_t *touch_handle = (bsp_touch_int_t *)tp->config.user_data;
 
+    pst_latency_mark_irq();
     xSemaphoreGiveFromISR(touch_handle->tp_intr_event, &xHigherPriorityTaskWoken);
 
     if (xHigherPriorityTaskWoken) {
@@ -408,26 +421,26 @@ static void bsp_touch_interrupt_cb(esp_lcd_touch_handle_t tp)
     }
 }
 
-static void bsp_touch_process_points_cb(esp_lcd_touch_handle_t tp, uint16_t *x, uint16_t *y, uint16_t *strength, uint8_t *point_num, uint8_t max_point_num)
+static PST_IRAM_ATTR void bsp_touch_process_points_cb(esp_lcd_touch_handle_t tp, uint16_t *x, uint16_t *y, uint16_t *strength, uint8_t *point_num, uint8_t max_point_num)
 {
-    uint16_t tmp;
     bsp_touch_int_t *touch_handle = (bsp_touch_int_t *)tp->config.user_data;
 
-    for (int i = 0; i < *point_num; i++) {
-        if (LV_DISP_ROT_270 == touch_handle->rotate) {
-            tmp = x[i];
-            x[i] = tp->config.y_max - y[i];
-            y[i] = tmp;
-        } else if (LV_DISP_ROT_180 == touch_handle->rotate) {
-            tmp = x[i];
-            x[i] = tp->config.x_max - x[i];
-            y[i] = tp->config.y_max - y[i];
-        } else if (LV_DISP_ROT_90 == touch_handle->rotate) {
-            tmp = x[i];
-            x[i] = y[i];
-            y[i] = tp->config.x_max - tmp;
-        }
+    pst_touch_xform_apply(&touch_handle->xform[touch_handle->xform_act], x, y, *point_num);
+}
+
+esp_err_t bsp_touch_set_calibration(const pst_touch_cal_t *cal, bool save)
+{
+    if (!tp) {
+        return ESP_ERR_INVALID_STATE;
     }
+    bsp_touch_int_t *touch_ctx = (bsp_touch_int_t *)tp->config.user_data;
+
+    /* Build in the spare slot so a concurrent read never sees a half-written matrix */
+    uint8_t next = touch_ctx->xform_act ^ 1;
+    pst_touch_xform_build(&touch_ctx->xform[next], &touch_ctx->orient, cal);
+    touch_ctx->xform_act = next;
+
+    return save ? pst_touch_cal_save(cal) : ESP_OK;
 }
 
 esp_err_t bsp_touch_new(const bsp_display_cfg_t *config, esp_lcd_touch_handle_t *ret_touch)
@@ -458,12 +471,11 @@ esp_err_t bsp_touch_new(const bsp_display_cfg_t *config, esp_lcd_touch_handle_t
         },
     };
 
-    esp_lcd_panel_io_handle_t tp_io_handle = NULL;
     esp_lcd_touch_handle_t tp_handle = NULL;
-    const esp_lcd_panel_io_i2c_config_t tp_io_config = ESP_LCD_TOUCH_IO_I2C_AXS15231B_CONFIG();
+    esp_lcd_touch_axs15231b_i2c_config_t tp_i2c_config = ESP_LCD_TOUCH_I2C_MASTER_AXS15231B_CONFIG(BSP_I2C_CLK_SPEED_HZ);
+    tp_i2c_config.flags.async = (BSP_I2C_TRANS_QUEUE_DEPTH > 0);
 
-    ESP_RETURN_ON_ERROR(esp_lcd_new_panel_io_i2c((esp_lcd_i2c_bus_handle_t)BSP_I2C_NUM, &tp_io_config, &tp_io_handle), TAG, "");
-    ESP_RETURN_ON_ERROR(esp_lcd_touch_new_i2c_axs15231b(tp_io_handle, &tp_cfg, &tp_handle), TAG, "New axs15231b failed");
+    ESP_RETURN_ON_ERROR(esp_lcd_touch_new_i2c_master_axs15231b(i2c_handle, &tp_i2c_config, &tp_cfg, &tp_handle), TAG, "New axs15231b failed");
 
     touch_ctx = malloc(sizeof(bsp_touch_int_t));
     ESP_GOTO_ON_FALSE(touch_ctx, ESP_ERR_NO_MEM, err, TAG, "Not enough memory for touch_ctx allocation!");
@@ -477,7 +489,32 @@ esp_err_t bsp_touch_new(const bsp_display_cfg_t *config, esp_lcd_touch_handle_t
     } else {
         touch_ctx->tp_intr_event = NULL;
     }
-    touch_ctx->rotate = config->rotate;
+    /* Rotation, software mirror/swap and the stored calibration are applied as one matrix */
+    touch_ctx->orient = (pst_touch_orient_t) {
+        .x_max = tp_cfg.x_max,
+        .y_max = tp_cfg.y_max,
+        .rotate = config->rotate,
+        .mirror_x = tp_cfg.flags.mirror_x && !tp_handle->set_mirror_x,
+        .mirror_y = tp_cfg.flags.mirror_y && !tp_handle->set_mirror_y,
+        .swap_xy = tp_cfg.flags.swap_xy && !tp_handle->set_swap_xy,
+    };
+    if (touch_ctx->orient.mirror_x) {
+        tp_handle->config.flags.mirror_x = 0;
+    }
+    if (touch_ctx->orient.mirror_y) {
+        tp_handle->config.flags.mirror_y = 0;
+    }
+    if (touch_ctx->orient.swap_xy) {
+        tp_handle->config.flags.swap_xy = 0;
+    }
+
+    pst_touch_cal_t cal;
+    bool has_cal = pst_touch_cal_load(&cal) == ESP_OK;
+    if (has_cal) {
+        ESP_LOGI(TAG, "Using stored touch calibration");
+    }
+    touch_ctx->xform_act = 0;
+    pst_touch_xform_build(&touch_ctx->xform[0], &touch_ctx->orient, has_cal ? &cal : NULL);
     tp_handle->config.user_data = touch_ctx;
 
     *ret_touch = tp_handle;
@@ -493,9 +530,6 @@ err:
     if (tp_handle) {
         esp_lcd_touch_del(tp_handle);
     }
-    if (tp_io_handle) {
-        esp_lcd_panel_io_del(tp_io_handle);
-    }
     return ret;
 }
 
@@ -505,12 +539,47 @@ static lv_indev_t *bsp_display_indev_init(const bsp_display_cfg_t *config, lv_di
     assert(tp);
 
     /* Add touch input (for selected screen) */
-    const lvgl_port_touch_cfg_t touch_cfg = {
+    lvgl_port_touch_cfg_t touch_cfg = {
         .disp = disp,
         .handle = tp,
         .touch_wait_cb = bsp_touch_sync_cb,
     };
 
+#if CONFIG_PST_TOUCH_TASK
+    /* Read the controller from a dedicated task woken by INT, LVGL only drains its ring */
+    bsp_touch_int_t *touch_ctx = (bsp_touch_int_t *)tp->config.user_data;
+    if (touch_ctx->tp_intr_event) {
+        pst_touch_cfg_t pst_touch_cfg = PST_TOUCH_DEFAULT_CONFIG();
+#if CONFIG_PST_TOUCH_I2C_ASYNC
+        /* The task queues each read and sleeps until the I2C interrupt completes it */
+        pst_touch_cfg.async_read = (esp_lcd_touch_axs15231b_set_read_done_cb(tp, pst_touch_read_done_isr, NULL) == ESP_OK);
+#endif
+#if CONFIG_PST_TOUCH_FILTER
+        /* Jitter of a resting finger on this panel stays within a few pixels */
+        pst_touch_cfg.filter = true;
+        pst_touch_cfg.filter_cfg.dead_zone_px = CONFIG_PST_TOUCH_FILTER_DEAD_ZONE_PX;
+#if CONFIG_PST_TOUCH_FILTER_SMOOTH
+        pst_touch_cfg.filter_cfg.euro_min_cutoff = 1.0f;
+#endif
+#endif
+        if (pst_touch_start(tp, touch_ctx->tp_intr_event, &pst_touch_cfg) == ESP_OK) {
+            touch_cfg.touch_wait_cb = NULL;
+            touch_cfg.touch_read_cb = pst_touch_lvgl_read;
+#if CONFIG_PST_TOUCH_PREDICT
+            pst_touch_predict_cfg_t predict_cfg = PST_TOUCH_PREDICT_DEFAULT_CONFIG();
+            predict_cfg.aggressiveness = CONFIG_PST_TOUCH_PREDICT_PERCENT;
+            predict_cfg.lead_us = CONFIG_PST_TOUCH_PREDICT_LEAD_MS * 1000;
+            pst_touch_set_predict(&predict_cfg);
+#endif
+        } else {
+            if (pst_touch_cfg.async_read) {
+                esp_lcd_touch_axs15231b_set_read_done_cb(tp, NULL, NULL);
+            }
+            ESP_LOGW(TAG, "Touch task not started, polling from LVGL");
+        }
+    }
+#endif
+
     return lvgl_port_add_touch(&touch_cfg);
 }
 
@@ -545,6 +614,7 @@ void bsp_display_unlock(void)
 typedef struct {
     bool mounted;
     char mount_point[16];
+    char fatfs_drive[3];    // FatFs logical drive of the card, e.g. "0:"
 } bsp_sd_ctx_t;
 
 static bsp_sd_ctx_t sd_ctx = { .mounted = false, .mount_point = "/sd" };
@@ -586,6 +656,11 @@ esp_err_t bsp_sd_init(void)
         return ret;
     }
 
+    BYTE pdrv = ff_diskio_get_pdrv_card(card);
+    sd_ctx.fatfs_drive[0] = (char)('0' + pdrv);
+    sd_ctx.fatfs_drive[1] = ':';
+    sd_ctx.fatfs_drive[2] = '\0';
+
     sd_ctx.mounted = true;
     ESP_LOGI(TAG, "✓ SD card mounted at %s", sd_ctx.mount_point);
     ESP_LOGI(TAG, "Card size: %llu MB", card ? ((uint64_t)card->csd.capacity * card->csd.sector_size / (1024 * 1024)) : 0);
@@ -619,3 +694,8 @@ const char *bsp_sd_get_mount_point(void)
 {
     return sd_ctx.mount_point;
 }
+
+const char *bsp_sd_get_fatfs_drive(void)
+{
+    return sd_ctx.mounted ? sd_ctx.fatfs_drive : NULL;
+}
@@ -13,15 +13,21 @@
 
 #include "sdkconfig.h"
 #include "driver/gpio.h"
-#include "driver/i2c.h"
+#include "driver/i2c_master.h"
 #include "lvgl.h"
 #include "lv_port.h"
 #include "pincfg.h"
+#include "pst_touch_xform.h"
 /**************************************************************************************************
  *  pinout
  **************************************************************************************************/
 #define BSP_I2C_NUM                     (I2C_NUM_0)
 #define BSP_I2C_CLK_SPEED_HZ            400000
+#if CONFIG_PST_TOUCH_I2C_ASYNC
+#define BSP_I2C_TRANS_QUEUE_DEPTH       4
+#else
+#define BSP_I2C_TRANS_QUEUE_DEPTH       0
+#endif
 
 #define EXAMPLE_LCD_QSPI_HOST           (SPI2_HOST)
 
@@ -85,6 +91,15 @@ esp_err_t bsp_i2c_init(void);
  */
 esp_err_t bsp_i2c_deinit(void);
 
+/**
+ * @brief Get the I2C master bus handle
+ *
+ * @note The bus is asynchronous (transactions are queued) when BSP_I2C_TRANS_QUEUE_DEPTH > 0.
+ *
+ * @return I2C bus handle or NULL when bsp_i2c_init() was not called
+ */
+i2c_master_bus_handle_t bsp_i2c_get_handle(void);
+
 /**
  * @brief Initialize display
  *
@@ -106,6 +121,22 @@ lv_disp_t *bsp_display_start_with_config(const bsp_display_cfg_t *cfg);
  */
 lv_indev_t *bsp_display_get_input_dev(void);
 
+/**
+ * @brief Replace the touch calibration
+ *
+ * The transform is rebuilt from the display rotation and the new calibration and
+ * takes effect with the next touch report.
+ *
+ * @param cal  Calibration, NULL to measure uncalibrated points
+ * @param save Also store it in NVS (NULL erases the stored one)
+ *
+ * @return
+ *      - ESP_OK                On success
+ *      - ESP_ERR_INVALID_STATE Touch is not initialized
+ *      - other                 NVS error while saving
+ */
+esp_err_t bsp_touch_set_calibration(const pst_touch_cal_t *cal, bool save);
+
 /**
  * @brief Take LVGL mutex
  *
@@ -160,6 +191,15 @@ bool bsp_sd_is_mounted(void);
  */
 const char *bsp_sd_get_mount_point(void);
 
+/**
+ * @brief Get the FatFs logical drive of the SD card, for direct FatFs calls (f_readdir etc.)
+ *
+ * @return
+ *      - const char*         Drive prefix, e.g. "0:"
+ *      - NULL                 SD card is not mounted
+ */
+const char *bsp_sd_get_fatfs_drive(void);
+
 #ifdef __cplusplus
 }
 #endif
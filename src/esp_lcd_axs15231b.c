@@ -17,11 +17,15 @@
 #include "esp_log.h"
 #include "esp_check.h"
 #include "esp_lcd_touch.h"
+#include "esp_timer.h"
 
 #include "esp_lcd_axs15231b.h"
+#include "pst_perf.h"
 
 /*max point num*/
-#define AXS_MAX_TOUCH_NUMBER                (1)
+#define AXS_MAX_TOUCH_NUMBER                (2)
+#define AXS_TOUCH_DATA_LEN                  (AXS_MAX_TOUCH_NUMBER * 6 + 2) /*1 Point:8;  2 Point: 14 */
+#define AXS_I2C_TIMEOUT_MS                  (20)
 
 #define LCD_OPCODE_WRITE_CMD                (0x02ULL)
 #define LCD_OPCODE_READ_CMD                 (0x0BULL)
@@ -43,10 +47,29 @@ static esp_err_t touch_axs15231b_read_data(esp_lcd_touch_handle_t tp);
 static bool touch_axs15231b_get_xy(esp_lcd_touch_handle_t tp, uint16_t *x, uint16_t *y, uint16_t *strength, uint8_t *point_num, uint8_t max_point_num);
 static esp_err_t touch_axs15231b_del(esp_lcd_touch_handle_t tp);
 static esp_err_t touch_axs15231b_reset(esp_lcd_touch_handle_t tp);
+static bool touch_axs15231b_i2c_done(i2c_master_dev_handle_t i2c_dev, const i2c_master_event_data_t *evt_data, void *arg);
 
 static esp_err_t i2c_read_bytes(esp_lcd_touch_handle_t tp, int reg, uint8_t *data, uint8_t len);
 static esp_err_t i2c_write_bytes(esp_lcd_touch_handle_t tp, int reg, const uint8_t *data, uint8_t len);
 
+/* Read command: the controller answers with AXS_TOUCH_DATA_LEN bytes */
+static const uint8_t touch_read_cmd[11] = {0xb5, 0xab, 0xa5, 0x5a, 0x00, 0x00, AXS_TOUCH_DATA_LEN >> 8, AXS_TOUCH_DATA_LEN & 0xff, 0x00, 0x00, 0x00};
+
+typedef struct {
+    esp_lcd_touch_t base;
+    i2c_master_dev_handle_t i2c_dev;        /* NULL when created on a panel IO */
+    SemaphoreHandle_t done_sem;             /* Given on completion when no read_done_cb is set */
+    esp_lcd_touch_axs15231b_read_done_cb_t read_done_cb;
+    void *read_done_arg;
+    volatile bool busy;                     /* A read is queued on the bus */
+    volatile bool last_ok;
+    int64_t t_start;
+    uint8_t rx_buf[AXS_TOUCH_DATA_LEN];     /* Filled by the bus, must outlive the call */
+    portMUX_TYPE stats_lock;
+    esp_lcd_touch_axs15231b_stats_t stats;
+    uint64_t bus_us_sum;
+} axs15231b_touch_t;
+
 typedef struct {
     esp_lcd_panel_t base;
     esp_lcd_panel_io_handle_t io;
@@ -284,7 +307,7 @@ static esp_err_t panel_axs15231b_init(esp_lcd_panel_t *panel)
     return ESP_OK;
 }
 
-static esp_err_t panel_axs15231b_draw_bitmap(esp_lcd_panel_t *panel, int x_start, int y_start, int x_end, int y_end, const void *color_data)
+static PST_IRAM_ATTR esp_err_t panel_axs15231b_draw_bitmap(esp_lcd_panel_t *panel, int x_start, int y_start, int x_end, int y_end, const void *color_data)
 {
     axs15231b_panel_t *axs15231b = (axs15231b_panel_t *)panel;
     assert((x_start < x_end) && (y_start < y_end) && "start position must be smaller than end position");
@@ -398,19 +421,8 @@ static esp_err_t panel_axs15231b_disp_off(esp_lcd_panel_t *panel, bool off)
     return ESP_OK;
 }
 
-esp_err_t esp_lcd_touch_new_i2c_axs15231b(const esp_lcd_panel_io_handle_t io, const esp_lcd_touch_config_t *config, esp_lcd_touch_handle_t *tp)
+static esp_err_t touch_axs15231b_setup(esp_lcd_touch_handle_t axs15231b, const esp_lcd_touch_config_t *config)
 {
-    ESP_RETURN_ON_FALSE(io, ESP_ERR_INVALID_ARG, TAG, "Invalid io");
-    ESP_RETURN_ON_FALSE(config, ESP_ERR_INVALID_ARG, TAG, "Invalid config");
-    ESP_RETURN_ON_FALSE(tp, ESP_ERR_INVALID_ARG, TAG, "Invalid touch handle");
-
-    /* Prepare main structure */
-    esp_err_t ret = ESP_OK;
-    esp_lcd_touch_handle_t axs15231b = calloc(1, sizeof(esp_lcd_touch_t));
-    ESP_GOTO_ON_FALSE(axs15231b, ESP_ERR_NO_MEM, err, TAG, "Touch handle malloc failed");
-
-    /* Communication interface */
-    axs15231b->io = io;
     /* Only supported callbacks are set */
     axs15231b->read_data = touch_axs15231b_read_data;
     axs15231b->get_xy = touch_axs15231b_get_xy;
@@ -427,7 +439,7 @@ esp_err_t esp_lcd_touch_new_i2c_axs15231b(const esp_lcd_panel_io_handle_t io, co
             .intr_type = GPIO_INTR_NEGEDGE,
             .pin_bit_mask = BIT64(axs15231b->config.int_gpio_num)
         };
-        ESP_GOTO_ON_ERROR(gpio_config(&int_gpio_config), err, TAG, "GPIO intr config failed");
+        ESP_RETURN_ON_ERROR(gpio_config(&int_gpio_config), TAG, "GPIO intr config failed");
 
         /* Register interrupt callback */
         if (axs15231b->config.interrupt_callback) {
@@ -440,26 +452,122 @@ esp_err_t esp_lcd_touch_new_i2c_axs15231b(const esp_lcd_panel_io_handle_t io, co
             .mode = GPIO_MODE_OUTPUT,
             .pin_bit_mask = BIT64(axs15231b->config.rst_gpio_num)
         };
-        ESP_GOTO_ON_ERROR(gpio_config(&rst_gpio_config), err, TAG, "GPIO reset config failed");
+        ESP_RETURN_ON_ERROR(gpio_config(&rst_gpio_config), TAG, "GPIO reset config failed");
     }
     /* Reset controller */
-    ESP_GOTO_ON_ERROR(touch_axs15231b_reset(axs15231b), err, TAG, "Reset failed");
-    *tp = axs15231b;
+    ESP_RETURN_ON_ERROR(touch_axs15231b_reset(axs15231b), TAG, "Reset failed");
+
+    return ESP_OK;
+}
+
+esp_err_t esp_lcd_touch_new_i2c_axs15231b(const esp_lcd_panel_io_handle_t io, const esp_lcd_touch_config_t *config, esp_lcd_touch_handle_t *tp)
+{
+    ESP_RETURN_ON_FALSE(io, ESP_ERR_INVALID_ARG, TAG, "Invalid io");
+    ESP_RETURN_ON_FALSE(config, ESP_ERR_INVALID_ARG, TAG, "Invalid config");
+    ESP_RETURN_ON_FALSE(tp, ESP_ERR_INVALID_ARG, TAG, "Invalid touch handle");
+
+    /* Prepare main structure */
+    esp_err_t ret = ESP_OK;
+    axs15231b_touch_t *axs = calloc(1, sizeof(axs15231b_touch_t));
+    ESP_RETURN_ON_FALSE(axs, ESP_ERR_NO_MEM, TAG, "Touch handle malloc failed");
+    axs->stats_lock = (portMUX_TYPE)portMUX_INITIALIZER_UNLOCKED;
+
+    /* Communication interface */
+    axs->base.io = io;
+    ESP_GOTO_ON_ERROR(touch_axs15231b_setup(&axs->base, config), err, TAG, "Setup failed");
+    *tp = &axs->base;
 
     return ESP_OK;
 err:
-    if (axs15231b) {
-        touch_axs15231b_del(axs15231b);
+    touch_axs15231b_del(&axs->base);
+    ESP_LOGE(TAG, "Initialization failed!");
+    return ret;
+}
+
+esp_err_t esp_lcd_touch_new_i2c_master_axs15231b(i2c_master_bus_handle_t bus, const esp_lcd_touch_axs15231b_i2c_config_t *i2c_config,
+                                                 const esp_lcd_touch_config_t *config, esp_lcd_touch_handle_t *tp)
+{
+    ESP_RETURN_ON_FALSE(bus && i2c_config, ESP_ERR_INVALID_ARG, TAG, "Invalid bus");
+    ESP_RETURN_ON_FALSE(config, ESP_ERR_INVALID_ARG, TAG, "Invalid config");
+    ESP_RETURN_ON_FALSE(tp, ESP_ERR_INVALID_ARG, TAG, "Invalid touch handle");
+
+    /* Prepare main structure */
+    esp_err_t ret = ESP_OK;
+    axs15231b_touch_t *axs = calloc(1, sizeof(axs15231b_touch_t));
+    ESP_RETURN_ON_FALSE(axs, ESP_ERR_NO_MEM, TAG, "Touch handle malloc failed");
+    axs->stats_lock = (portMUX_TYPE)portMUX_INITIALIZER_UNLOCKED;
+
+    /* Communication interface: a device of its own on the bus */
+    const i2c_device_config_t dev_config = {
+        .dev_addr_length = I2C_ADDR_BIT_LEN_7,
+        .device_address = i2c_config->dev_addr,
+        .scl_speed_hz = i2c_config->scl_speed_hz,
+    };
+    ESP_GOTO_ON_ERROR(i2c_master_bus_add_device(bus, &dev_config, &axs->i2c_dev), err, TAG, "Add I2C device failed");
+    if (i2c_config->flags.async) {
+        axs->done_sem = xSemaphoreCreateBinary();
+        ESP_GOTO_ON_FALSE(axs->done_sem, ESP_ERR_NO_MEM, err, TAG, "Semaphore create failed");
+        const i2c_master_event_callbacks_t cbs = {
+            .on_trans_done = touch_axs15231b_i2c_done,
+        };
+        ESP_GOTO_ON_ERROR(i2c_master_register_event_callbacks(axs->i2c_dev, &cbs, axs), err, TAG, "I2C callback register failed");
     }
+    ESP_GOTO_ON_ERROR(touch_axs15231b_setup(&axs->base, config), err, TAG, "Setup failed");
+    *tp = &axs->base;
+
+    return ESP_OK;
+err:
+    touch_axs15231b_del(&axs->base);
     ESP_LOGE(TAG, "Initialization failed!");
     return ret;
 }
 
-static esp_err_t touch_axs15231b_read_data(esp_lcd_touch_handle_t tp)
+esp_err_t esp_lcd_touch_axs15231b_set_read_done_cb(esp_lcd_touch_handle_t tp, esp_lcd_touch_axs15231b_read_done_cb_t cb, void *arg)
+{
+    ESP_RETURN_ON_FALSE(tp, ESP_ERR_INVALID_ARG, TAG, "Invalid touch handle");
+    axs15231b_touch_t *axs = __containerof(tp, axs15231b_touch_t, base);
+    ESP_RETURN_ON_FALSE(axs->done_sem, ESP_ERR_NOT_SUPPORTED, TAG, "Not created on an asynchronous bus");
+    ESP_RETURN_ON_FALSE(!axs->busy, ESP_ERR_INVALID_STATE, TAG, "Read in progress");
+
+    axs->read_done_cb = NULL;
+    axs->read_done_arg = arg;
+    axs->read_done_cb = cb;
+
+    return ESP_OK;
+}
+
+void esp_lcd_touch_axs15231b_get_stats(esp_lcd_touch_handle_t tp, esp_lcd_touch_axs15231b_stats_t *out)
+{
+    axs15231b_touch_t *axs = __containerof(tp, axs15231b_touch_t, base);
+
+    portENTER_CRITICAL(&axs->stats_lock);
+    *out = axs->stats;
+    portEXIT_CRITICAL(&axs->stats_lock);
+}
+
+static void touch_axs15231b_account(axs15231b_touch_t *axs, int64_t bus_us, bool ok)
+{
+    portENTER_CRITICAL_SAFE(&axs->stats_lock);
+    axs->stats.reads++;
+    if (!ok) {
+        axs->stats.errors++;
+    }
+    axs->bus_us_sum += bus_us;
+    axs->stats.bus_us_avg = (uint32_t)(axs->bus_us_sum / axs->stats.reads);
+    if (bus_us > axs->stats.bus_us_max) {
+        axs->stats.bus_us_max = (uint32_t)bus_us;
+    }
+    portEXIT_CRITICAL_SAFE(&axs->stats_lock);
+}
+
+static void touch_axs15231b_parse(esp_lcd_touch_handle_t tp, const uint8_t *data)
 {
     typedef struct {
         uint8_t gesture;    //AXS_TOUCH_GESTURE_POS:0
         uint8_t num;        //AXS_TOUCH_POINT_NUM:1
+    } __attribute__((packed)) touch_header_struct_t;
+
+    typedef struct {
         uint8_t x_h : 4;    //AXS_TOUCH_X_H_POS:2
         uint8_t : 2;
         uint8_t event : 2;  //AXS_TOUCH_EVENT_POS:2
@@ -467,32 +575,96 @@ static esp_err_t touch_axs15231b_read_data(esp_lcd_touch_handle_t tp)
         uint8_t y_h : 4;    //AXS_TOUCH_Y_H_POS:4
         uint8_t : 4;
         uint8_t y_l;        //AXS_TOUCH_Y_L_POS:5
+        uint8_t weight;
+        uint8_t area;
     } __attribute__((packed)) touch_record_struct_t;
 
-    touch_record_struct_t *p_touch_data = NULL;
+    const touch_header_struct_t *p_touch_header = (const touch_header_struct_t *) data;
+    const touch_record_struct_t *p_touch_data = (const touch_record_struct_t *) &data[sizeof(touch_header_struct_t)];
 
-    uint8_t data[AXS_MAX_TOUCH_NUMBER * 6 + 2] = {0}; /*1 Point:8;  2 Point: 14 */
-    const uint8_t read_cmd[11] = {0xb5, 0xab, 0xa5, 0x5a, 0x00, 0x00, (AXS_MAX_TOUCH_NUMBER * 6 + 2) >> 8, (AXS_MAX_TOUCH_NUMBER * 6 + 2) & 0xff, 0x00, 0x00, 0x00};
+    if (p_touch_header->num && (AXS_MAX_TOUCH_NUMBER >= p_touch_header->num)) {
+        /* Also called from the I2C completion interrupt */
+        portENTER_CRITICAL_SAFE(&tp->data.lock);
+        tp->data.points = p_touch_header->num;
+        /* Fill all coordinates, one 6-byte record per point */
+        for (int i = 0; i < tp->data.points; i++) {
+            tp->data.coords[i].x = ((p_touch_data[i].x_h & 0x0F) << 8) | p_touch_data[i].x_l;
+            tp->data.coords[i].y = ((p_touch_data[i].y_h & 0x0F) << 8) | p_touch_data[i].y_l;
+            tp->data.coords[i].strength = p_touch_data[i].weight;
+        }
+        portEXIT_CRITICAL_SAFE(&tp->data.lock);
+    }
+}
 
-    ESP_RETURN_ON_ERROR(i2c_write_bytes(tp, -1, read_cmd, sizeof(read_cmd)), TAG, "I2C write failed");
-    ESP_RETURN_ON_ERROR(i2c_read_bytes(tp, -1, data, sizeof(data)), TAG, "I2C read failed");
+static bool touch_axs15231b_i2c_done(i2c_master_dev_handle_t i2c_dev, const i2c_master_event_data_t *evt_data, void *arg)
+{
+    axs15231b_touch_t *axs = (axs15231b_touch_t *)arg;
+    bool ok = (evt_data->event == I2C_EVENT_DONE);
 
-    p_touch_data = (touch_record_struct_t *) data;
-    if (p_touch_data->num && (AXS_MAX_TOUCH_NUMBER >= p_touch_data->num)) {
-        portENTER_CRITICAL(&tp->data.lock);
-        tp->data.points = p_touch_data->num;
-        /* Fill all coordinates */
-        for (int i = 0; i < tp->data.points; i++) {
-            tp->data.coords[i].x = ((p_touch_data->x_h & 0x0F) << 8) | p_touch_data->x_l;
-            tp->data.coords[i].y = ((p_touch_data->y_h & 0x0F) << 8) | p_touch_data->y_l;
+    touch_axs15231b_account(axs, esp_timer_get_time() - axs->t_start, ok);
+    if (ok) {
+        touch_axs15231b_parse(&axs->base, axs->rx_buf);
+    }
+    axs->last_ok = ok;
+    axs->busy = false;
+
+    if (axs->read_done_cb) {
+        return axs->read_done_cb(&axs->base, ok, axs->read_done_arg);
+    }
+    BaseType_t need_yield = pdFALSE;
+    xSemaphoreGiveFromISR(axs->done_sem, &need_yield);
+    return need_yield == pdTRUE;
+}
+
+static esp_err_t touch_axs15231b_read_data(esp_lcd_touch_handle_t tp)
+{
+    axs15231b_touch_t *axs = __containerof(tp, axs15231b_touch_t, base);
+    esp_err_t ret;
+
+    if (!axs->i2c_dev) {
+        /* Panel IO: command write and data read are two separate transfers */
+        int64_t t_start = esp_timer_get_time();
+        ret = i2c_write_bytes(tp, -1, touch_read_cmd, sizeof(touch_read_cmd));
+        if (ret == ESP_OK) {
+            ret = i2c_read_bytes(tp, -1, axs->rx_buf, sizeof(axs->rx_buf));
         }
-        portEXIT_CRITICAL(&tp->data.lock);
+        touch_axs15231b_account(axs, esp_timer_get_time() - t_start, ret == ESP_OK);
+        ESP_RETURN_ON_ERROR(ret, TAG, "I2C read failed");
+        touch_axs15231b_parse(tp, axs->rx_buf);
+        return ESP_OK;
     }
 
-    return ESP_OK;
+    if (!axs->done_sem) {
+        /* Command and data in one transaction, joined by a repeated start */
+        int64_t t_start = esp_timer_get_time();
+        ret = i2c_master_transmit_receive(axs->i2c_dev, touch_read_cmd, sizeof(touch_read_cmd),
+                                          axs->rx_buf, sizeof(axs->rx_buf), AXS_I2C_TIMEOUT_MS);
+        touch_axs15231b_account(axs, esp_timer_get_time() - t_start, ret == ESP_OK);
+        ESP_RETURN_ON_ERROR(ret, TAG, "I2C read failed");
+        touch_axs15231b_parse(tp, axs->rx_buf);
+        return ESP_OK;
+    }
+
+    /* Asynchronous bus: queue the transaction, touch_axs15231b_i2c_done() completes it */
+    ESP_RETURN_ON_FALSE(!axs->busy, ESP_ERR_INVALID_STATE, TAG, "Read in progress");
+    axs->busy = true;
+    axs->t_start = esp_timer_get_time();
+    ret = i2c_master_transmit_receive(axs->i2c_dev, touch_read_cmd, sizeof(touch_read_cmd),
+                                      axs->rx_buf, sizeof(axs->rx_buf), AXS_I2C_TIMEOUT_MS);
+    if (ret != ESP_OK) {
+        axs->busy = false;
+        touch_axs15231b_account(axs, 0, false);
+        ESP_LOGE(TAG, "I2C read failed");
+        return ret;
+    }
+    if (axs->read_done_cb) {
+        return ESP_OK;
+    }
+    ESP_RETURN_ON_FALSE(xSemaphoreTake(axs->done_sem, pdMS_TO_TICKS(AXS_I2C_TIMEOUT_MS)) == pdTRUE, ESP_ERR_TIMEOUT, TAG, "I2C read timeout");
+    return axs->last_ok ? ESP_OK : ESP_FAIL;
 }
 
-static bool touch_axs15231b_get_xy(esp_lcd_touch_handle_t tp, uint16_t *x, uint16_t *y, uint16_t *strength, uint8_t *point_num, uint8_t max_point_num)
+static PST_IRAM_ATTR bool touch_axs15231b_get_xy(esp_lcd_touch_handle_t tp, uint16_t *x, uint16_t *y, uint16_t *strength, uint8_t *point_num, uint8_t max_point_num)
 {
     portENTER_CRITICAL(&tp->data.lock);
     /* Count of points */
@@ -514,6 +686,8 @@ static bool touch_axs15231b_get_xy(esp_lcd_touch_handle_t tp, uint16_t *x, uint1
 
 static esp_err_t touch_axs15231b_del(esp_lcd_touch_handle_t tp)
 {
+    axs15231b_touch_t *axs = __containerof(tp, axs15231b_touch_t, base);
+
     /* Reset GPIO pin settings */
     if (tp->config.int_gpio_num != GPIO_NUM_NC) {
         gpio_reset_pin(tp->config.int_gpio_num);
@@ -521,8 +695,18 @@ static esp_err_t touch_axs15231b_del(esp_lcd_touch_handle_t tp)
     if (tp->config.rst_gpio_num != GPIO_NUM_NC) {
         gpio_reset_pin(tp->config.rst_gpio_num);
     }
+    /* Release the bus device, waiting for a queued read */
+    if (axs->i2c_dev) {
+        if (axs->busy) {
+            vTaskDelay(pdMS_TO_TICKS(AXS_I2C_TIMEOUT_MS));
+        }
+        i2c_master_bus_rm_device(axs->i2c_dev);
+    }
+    if (axs->done_sem) {
+        vSemaphoreDelete(axs->done_sem);
+    }
     /* Release memory */
-    free(tp);
+    free(axs);
 
     return ESP_OK;
 }
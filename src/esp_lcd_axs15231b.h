@@ -11,6 +11,7 @@
 #pragma once
 
 #include "hal/spi_ll.h"
+#include "driver/i2c_master.h"
 #include "esp_lcd_touch.h"
 #include "esp_lcd_panel_vendor.h"
 
@@ -176,6 +177,91 @@ esp_err_t esp_lcd_touch_new_i2c_axs15231b(const esp_lcd_panel_io_handle_t io, co
  */
 #define ESP_LCD_TOUCH_IO_I2C_AXS15231B_ADDRESS    (0x3B)
 
+/**
+ * @brief I2C master device configuration of the touch controller
+ *
+ */
+typedef struct {
+    uint16_t dev_addr;          /*!< 7-bit I2C address */
+    uint32_t scl_speed_hz;      /*!< SCL frequency */
+    struct {
+        unsigned int async: 1;  /*!< The bus was created with `trans_queue_depth` > 0: reads are queued and complete from the I2C interrupt */
+    } flags;
+} esp_lcd_touch_axs15231b_i2c_config_t;
+
+#define ESP_LCD_TOUCH_I2C_MASTER_AXS15231B_CONFIG(speed_hz)    \
+    {                                                       \
+        .dev_addr = ESP_LCD_TOUCH_IO_I2C_AXS15231B_ADDRESS, \
+        .scl_speed_hz = speed_hz,                           \
+    }
+
+/**
+ * @brief Completion callback of an asynchronous read, called from the I2C interrupt
+ *
+ * The points are already stored in the handle: `esp_lcd_touch_get_coordinates()` returns them.
+ *
+ * @param tp Touch panel handle
+ * @param ok false if the transaction failed (NACK or timeout)
+ * @param arg User argument
+ * @return Whether a higher priority task has been woken up
+ */
+typedef bool (*esp_lcd_touch_axs15231b_read_done_cb_t)(esp_lcd_touch_handle_t tp, bool ok, void *arg);
+
+/**
+ * @brief Controller read timing since creation
+ *
+ */
+typedef struct {
+    uint32_t reads;             /*!< Reads completed, failed ones included */
+    uint32_t errors;            /*!< Failed reads */
+    uint32_t bus_us_avg;        /*!< Average time from queuing the read to its completion */
+    uint32_t bus_us_max;        /*!< Worst read time */
+} esp_lcd_touch_axs15231b_stats_t;
+
+/**
+ * @brief Create a new AXS15231B touch driver on an I2C master bus
+ *
+ * Each read is one transaction: the read command and the point data are joined by a
+ * repeated start, instead of the two transfers of a panel IO.
+ *
+ * @param bus I2C master bus handle, created by `i2c_new_master_bus()`
+ * @param i2c_config Device configuration, see ESP_LCD_TOUCH_I2C_MASTER_AXS15231B_CONFIG()
+ * @param config Touch panel configuration
+ * @param tp Touch panel handle
+ * @return
+ *      - ESP_OK: on success
+ *      - ESP_ERR_INVALID_ARG: if a parameter is NULL
+ *      - ESP_ERR_NO_MEM: if out of memory
+ */
+esp_err_t esp_lcd_touch_new_i2c_master_axs15231b(i2c_master_bus_handle_t bus, const esp_lcd_touch_axs15231b_i2c_config_t *i2c_config,
+                                                 const esp_lcd_touch_config_t *config, esp_lcd_touch_handle_t *tp);
+
+/**
+ * @brief Complete reads asynchronously
+ *
+ * With a callback set, `esp_lcd_touch_read_data()` returns once the read is queued on the bus
+ * and `cb` is called when the points are available. With NULL it waits for the read again.
+ *
+ * @note  Only for drivers created with `flags.async`; change it while no read is queued.
+ *
+ * @param tp Touch panel handle
+ * @param cb Completion callback, NULL to wait in `esp_lcd_touch_read_data()`
+ * @param arg User argument of `cb`
+ * @return
+ *      - ESP_OK: on success
+ *      - ESP_ERR_NOT_SUPPORTED: if the driver is not on an asynchronous bus
+ *      - ESP_ERR_INVALID_STATE: if a read is queued
+ */
+esp_err_t esp_lcd_touch_axs15231b_set_read_done_cb(esp_lcd_touch_handle_t tp, esp_lcd_touch_axs15231b_read_done_cb_t cb, void *arg);
+
+/**
+ * @brief Copy the read timing counters
+ *
+ * @param tp Touch panel handle
+ * @param out Counters
+ */
+void esp_lcd_touch_axs15231b_get_stats(esp_lcd_touch_handle_t tp, esp_lcd_touch_axs15231b_stats_t *out);
+
 /**
  * @brief Touch IO configuration structure
  *
@@ -18,6 +18,8 @@
 #define LV_CONF_H
 #include <ff.h>
 #include <stdint.h>
+#include "sdkconfig.h"
+#include "esp_attr.h"
 
 /*====================
    COLOR SETTINGS
@@ -324,7 +326,11 @@
 #define LV_ATTRIBUTE_TICK_INC
 
 /*Define a custom attribute to `lv_timer_handler` function*/
-#define LV_ATTRIBUTE_TIMER_HANDLER
+#if CONFIG_PST_FAST_MEM_PROFILE
+    #define LV_ATTRIBUTE_TIMER_HANDLER IRAM_ATTR
+#else
+    #define LV_ATTRIBUTE_TIMER_HANDLER
+#endif
 
 /*Define a custom attribute to `lv_disp_flush_ready` function*/
 #define LV_ATTRIBUTE_FLUSH_READY
@@ -340,10 +346,16 @@
 #define LV_ATTRIBUTE_LARGE_CONST
 
 /*Compiler prefix for a big array declaration in RAM*/
+/*Left empty on purpose: .bss already lives in internal DRAM, DRAM_ATTR would only copy the zeroes into the flash image*/
 #define LV_ATTRIBUTE_LARGE_RAM_ARRAY
 
 /*Place performance critical functions into a faster memory (e.g RAM)*/
-#define LV_ATTRIBUTE_FAST_MEM
+/*PST: part of the hot-path placement profile, see pst_perf.h*/
+#if CONFIG_PST_FAST_MEM_PROFILE
+    #define LV_ATTRIBUTE_FAST_MEM IRAM_ATTR
+#else
+    #define LV_ATTRIBUTE_FAST_MEM
+#endif
 
 /*Prefix variables that are used in GPU accelerated operations, often these need to be placed in RAM sections that are DMA accessible*/
 #define LV_ATTRIBUTE_DMA
@@ -406,8 +418,9 @@
  *Compiler error will be triggered if a font needs it.*/
 #define LV_FONT_FMT_TXT_LARGE 0
 
-/*Enables/disables support for compressed fonts.*/
-#define LV_USE_FONT_COMPRESSED 0
+/*Enables/disables support for compressed fonts.
+ *Needed by compressed binary fonts loaded from the SD card (pst_font.h caches their glyphs)*/
+#define LV_USE_FONT_COMPRESSED 1
 
 /*Enable subpixel rendering*/
 #define LV_USE_FONT_SUBPX 0
@@ -624,7 +637,8 @@
 #endif
 
 /*API for open, read, etc*/
-#define LV_USE_FS_POSIX 1
+/*Off: the 'S' drive is registered by pst_fs (block cache with read-ahead)*/
+#define LV_USE_FS_POSIX 0
 #if LV_USE_FS_POSIX
     #define LV_FS_POSIX_LETTER 'S'     /*Set an upper cased letter on which the drive will accessible (e.g. 'A')*/
     #define LV_FS_POSIX_PATH "/sd"         /*Set the working directory. File/directory paths will be appended to it.*/
@@ -18,6 +18,10 @@
 
 #include "lv_port.h"
 #include "lvgl.h"
+#include "pst_latency.h"
+#include "pst_perf.h"
+#include "pst_touch_rec.h"
+#include "pst_trace.h"
 
 #ifdef ESP_LVGL_PORT_TOUCH_COMPONENT
 #include "esp_lcd_touch.h"
@@ -62,6 +66,7 @@ typedef struct {
     esp_lcd_touch_handle_t  handle;        /* LCD touch IO handle */
     lv_indev_drv_t          indev_drv;     /* LVGL input device driver */
     lvgl_port_wait_cb       touch_wait_cb;  /* Callback function for touch */
+    lvgl_port_touch_read_cb touch_read_cb;  /* Custom read, replaces the controller read */
 } lvgl_port_touch_ctx_t;
 #endif
 
@@ -317,6 +322,7 @@ lv_indev_t *lvgl_port_add_touch(const lvgl_port_touch_cfg_t *touch_cfg)
     }
     touch_ctx->handle = touch_cfg->handle;
     touch_ctx->touch_wait_cb = touch_cfg->touch_wait_cb;
+    touch_ctx->touch_read_cb = touch_cfg->touch_read_cb;
 
     /* Register a touchpad input device */
     lv_indev_drv_init(&touch_ctx->indev_drv);
@@ -378,7 +384,9 @@ static void lvgl_port_task(void *arg)
     lvgl_port_ctx.running = true;
     while (lvgl_port_ctx.running) {
         if (lvgl_port_lock(0)) {
+            pst_perf_frame_begin();
             task_delay_ms = lv_timer_handler();
+            pst_perf_frame_end();
             lvgl_port_unlock();
         }
         if ((task_delay_ms > lvgl_port_ctx.task_max_sleep_ms) || (1 == task_delay_ms)) {
@@ -408,7 +416,7 @@ static void lvgl_port_task_deinit(void)
 }
 
 #if LVGL_PORT_HANDLE_FLUSH_READY
-static bool lvgl_port_flush_ready_callback(esp_lcd_panel_io_handle_t panel_io, esp_lcd_panel_io_event_data_t *edata, void *user_ctx)
+static PST_IRAM_ATTR bool lvgl_port_flush_ready_callback(esp_lcd_panel_io_handle_t panel_io, esp_lcd_panel_io_event_data_t *edata, void *user_ctx)
 {
     BaseType_t taskAwake = pdFALSE;
 
@@ -417,6 +425,8 @@ static bool lvgl_port_flush_ready_callback(esp_lcd_panel_io_handle_t panel_io, e
     lvgl_port_display_ctx_t *disp_ctx = disp_drv->user_data;
     assert(disp_ctx != NULL);
 
+    pst_latency_flush_done();
+
     if (disp_ctx->trans_done_sem) {
         xSemaphoreGiveFromISR(disp_ctx->trans_done_sem, &taskAwake);
     }
@@ -425,12 +435,14 @@ static bool lvgl_port_flush_ready_callback(esp_lcd_panel_io_handle_t panel_io, e
 }
 #endif
 
-static void lvgl_port_flush_callback(lv_disp_drv_t *drv, const lv_area_t *area, lv_color_t *color_map)
+static PST_IRAM_ATTR void lvgl_port_flush_callback(lv_disp_drv_t *drv, const lv_area_t *area, lv_color_t *color_map)
 {
     assert(drv != NULL);
     lvgl_port_display_ctx_t *disp_ctx = (lvgl_port_display_ctx_t *)drv->user_data;
     assert(disp_ctx != NULL);
 
+    pst_perf_flush_begin();
+
     const int x_start = area->x1;
     const int x_end = area->x2;
     const int y_start = area->y1;
@@ -553,6 +565,7 @@ static void lvgl_port_flush_callback(lv_disp_drv_t *drv, const lv_area_t *area,
             }
 
             xSemaphoreTake(disp_ctx->trans_done_sem, portMAX_DELAY);
+            pst_latency_flush_queue(i == trans_count - 1 && lv_disp_flush_is_last(drv));
             esp_lcd_panel_draw_bitmap(disp_ctx->panel_handle, x_draw_start, y_draw_start, x_draw_end + 1, y_draw_end + 1, to);
 
             if (LV_DISP_ROT_90 == rotate) {
@@ -566,18 +579,26 @@ static void lvgl_port_flush_callback(lv_disp_drv_t *drv, const lv_area_t *area,
             }
         }
     } else {
+        pst_latency_flush_queue(lv_disp_flush_is_last(drv));
         esp_lcd_panel_draw_bitmap(disp_ctx->panel_handle, x_start, y_start, x_end + 1, y_end + 1, color_map);
     }
+    pst_perf_flush_end();
     lv_disp_flush_ready(drv);
 }
 
 #ifdef ESP_LVGL_PORT_TOUCH_COMPONENT
-static void lvgl_port_touchpad_read(lv_indev_drv_t *indev_drv, lv_indev_data_t *data)
+static PST_IRAM_ATTR void lvgl_port_touchpad_read(lv_indev_drv_t *indev_drv, lv_indev_data_t *data)
 {
     assert(indev_drv);
     lvgl_port_touch_ctx_t *touch_ctx = (lvgl_port_touch_ctx_t *)indev_drv->user_data;
     assert(touch_ctx->handle);
 
+    if (touch_ctx->touch_read_cb) {
+        touch_ctx->touch_read_cb(touch_ctx->handle, data);
+        pst_touch_rec_feed(data);
+        return;
+    }
+
     uint16_t touchpad_x[1] = {0};
     uint16_t touchpad_y[1] = {0};
     uint8_t touchpad_cnt = 0;
@@ -596,11 +617,12 @@ static void lvgl_port_touchpad_read(lv_indev_drv_t *indev_drv, lv_indev_data_t *
             data->point.x = touchpad_x[0];
             data->point.y = touchpad_y[0];
             data->state = LV_INDEV_STATE_PRESSED;
-            esp_rom_printf("Touchpad pressed: x=%d, y=%d\n", data->point.x, data->point.y);
+            PST_TRACE("Touchpad pressed: x=%d, y=%d", data->point.x, data->point.y);
         } else {
             data->state = LV_INDEV_STATE_RELEASED;
         }
     }
+    pst_touch_rec_feed(data);
 }
 #endif
 
@@ -55,11 +55,14 @@ typedef struct {
 /**
  * @brief Configuration touch structure
  */
+typedef void (*lvgl_port_touch_read_cb)(esp_lcd_touch_handle_t handle, lv_indev_data_t *data);
+
 typedef struct {
     lv_disp_t *disp;    /*!< LVGL display handle (returned from lvgl_port_add_disp) */
     esp_lcd_touch_handle_t   handle;   /*!< LCD touch IO handle */
 
     lvgl_port_wait_cb touch_wait_cb;
+    lvgl_port_touch_read_cb touch_read_cb;  /*!< Optional: fills LVGL input data instead of reading the controller (touch_wait_cb is then unused) */
 } lvgl_port_touch_cfg_t;
 #endif
 
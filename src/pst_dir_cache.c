@@ -0,0 +1,369 @@
+#include <string.h>
+#include "esp_heap_caps.h"
+#include "esp_log.h"
+#include "pst_dir_cache.h"
+
+static const char *TAG = "PST_DIR_CACHE";
+
+#define GROW_MIN_ENTRIES 64
+#define GROW_MIN_NAMES 1024
+
+static pst_dir_cache_cfg_t s_cfg;
+static pst_dir_listing_t **s_slots = NULL;  // max_dirs listings, NULL = free
+static uint32_t s_tick = 0;                 // LRU clock
+static pst_dir_cache_stats_t s_stats;
+
+static bool grow(void **buf, uint32_t *cap, uint32_t need, size_t elem_size, uint32_t min_cap)
+{
+    if (need <= *cap)
+        return true;
+
+    uint32_t new_cap = *cap ? *cap : min_cap;
+    while (new_cap < need)
+        new_cap *= 2;
+    void *p = heap_caps_realloc(*buf, (size_t)new_cap * elem_size, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+    if (!p)
+        return false;
+    *buf = p;
+    *cap = new_cap;
+    return true;
+}
+
+pst_dir_listing_t *pst_dir_listing_new(const char *path)
+{
+    if (strlen(path) >= PST_DIR_PATH_MAX)
+        return NULL;
+
+    pst_dir_listing_t *l = heap_caps_calloc(1, sizeof(*l), MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+    if (l)
+        strcpy(l->path, path);
+    return l;
+}
+
+void pst_dir_listing_clear(pst_dir_listing_t *listing)
+{
+    listing->count = 0;
+    listing->names_len = 0;
+    listing->dir_mtime = 0;
+    listing->from_index = false;
+}
+
+// Natural order compares names as if every run of digits were written '0', the
+// run's length without leading zeros, then its digits, and letters in lower case:
+// "a2" -> "a0\x012", "a10" -> "a0\x0210", so plain byte order puts "a2" first.
+// The key is the first 4 bytes of that form, most names differ within them.
+typedef struct {
+    const char *p;      // next byte of the name
+    uint32_t digits;    // digits of the current run still to produce
+    int len;            // length byte to produce next, -1 if none
+} nat_iter_t;
+
+static int nat_next(nat_iter_t *it)
+{
+    if (it->len >= 0)
+    {
+        int b = it->len;
+        it->len = -1;
+        return b;
+    }
+    if (it->digits)
+    {
+        it->digits--;
+        return (uint8_t)*it->p++;
+    }
+
+    uint8_t c = (uint8_t)*it->p;
+    if (c == '\0')
+        return -1;
+    if (c >= '0' && c <= '9')
+    {
+        while (it->p[0] == '0' && it->p[1] >= '0' && it->p[1] <= '9')
+            it->p++;
+        const char *end = it->p;
+        while (*end >= '0' && *end <= '9')
+            end++;
+        it->digits = end - it->p;
+        it->len = it->digits < 255 ? it->digits : 255;
+        return '0';
+    }
+    it->p++;
+    return (c >= 'A' && c <= 'Z') ? c + 32 : c;
+}
+
+static uint32_t nat_key(const char *name)
+{
+    nat_iter_t it = { .p = name, .len = -1 };
+    uint32_t key = 0;
+
+    for (int i = 0; i < 4; i++)
+    {
+        int b = nat_next(&it);
+        key = key << 8 | (b < 0 ? 0 : b);
+    }
+    return key;
+}
+
+static int nat_cmp(const char *a, const char *b)
+{
+    nat_iter_t ia = { .p = a, .len = -1 };
+    nat_iter_t ib = { .p = b, .len = -1 };
+
+    for (;;)
+    {
+        int ca = nat_next(&ia);
+        int cb = nat_next(&ib);
+        if (ca != cb)
+            return ca - cb;
+        if (ca < 0)
+            break;
+    }
+    // Same up to case and leading zeros
+    return strcmp(a, b);
+}
+
+bool pst_dir_listing_add(pst_dir_listing_t *listing, const char *name, bool is_dir, uint32_t size, uint32_t mtime)
+{
+    uint32_t len = strlen(name) + 1;
+
+    if (!grow((void **)&listing->entries, &listing->entries_cap, listing->count + 1, sizeof(pst_dir_entry_t), GROW_MIN_ENTRIES) ||
+        !grow((void **)&listing->names, &listing->names_cap, listing->names_len + len, 1, GROW_MIN_NAMES))
+        return false;
+
+    memcpy(listing->names + listing->names_len, name, len);
+    listing->entries[listing->count++] = (pst_dir_entry_t) {
+        .name = listing->names_len,
+        .size = size,
+        .mtime = mtime,
+        .key = nat_key(name),
+        .is_dir = is_dir,
+    };
+    listing->names_len += len;
+    return true;
+}
+
+static int entry_cmp(const char *names, const pst_dir_entry_t *a, const pst_dir_entry_t *b, pst_dir_sort_t order)
+{
+    if (a->is_dir != b->is_dir)
+        return a->is_dir ? -1 : 1;
+    if (order == PST_DIR_SORT_SIZE && a->size != b->size)
+        return a->size > b->size ? -1 : 1;
+    if (order == PST_DIR_SORT_MTIME && a->mtime != b->mtime)
+        return a->mtime > b->mtime ? -1 : 1;
+    if (a->key != b->key)
+        return a->key < b->key ? -1 : 1;
+    return nat_cmp(names + a->name, names + b->name);
+}
+
+bool pst_dir_listing_sort(pst_dir_listing_t *listing, pst_dir_sort_t order)
+{
+    pst_dir_entry_t *e = listing->entries;
+    uint32_t n = listing->count;
+    uint32_t i;
+
+    // Listings from the cache or an index are sorted already
+    for (i = 1; i < n && entry_cmp(listing->names, &e[i - 1], &e[i], order) <= 0; i++)
+        ;
+    if (i >= n)
+        return true;
+
+    // Bottom-up merge sort: no recursion on the caller's stack, n log n on large folders
+    pst_dir_entry_t *tmp = heap_caps_malloc(n * sizeof(pst_dir_entry_t), MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+    if (!tmp)
+        return false;
+    pst_dir_entry_t *src = e, *dst = tmp;
+    for (uint32_t width = 1; width < n; width *= 2)
+    {
+        for (uint32_t lo = 0; lo < n; lo += 2 * width)
+        {
+            uint32_t mid = lo + width < n ? lo + width : n;
+            uint32_t hi = lo + 2 * width < n ? lo + 2 * width : n;
+            uint32_t a = lo, b = mid, k = lo;
+            while (a < mid && b < hi)
+                dst[k++] = entry_cmp(listing->names, &src[b], &src[a], order) < 0 ? src[b++] : src[a++];
+            while (a < mid)
+                dst[k++] = src[a++];
+            while (b < hi)
+                dst[k++] = src[b++];
+        }
+        pst_dir_entry_t *t = src;
+        src = dst;
+        dst = t;
+    }
+    if (src != e)
+        memcpy(e, src, n * sizeof(pst_dir_entry_t));
+    heap_caps_free(tmp);
+    return true;
+}
+
+bool pst_dir_listing_equal(const pst_dir_listing_t *a, const pst_dir_listing_t *b)
+{
+    if (a->count != b->count || a->names_len != b->names_len)
+        return false;
+    for (uint32_t i = 0; i < a->count; i++)
+    {
+        const pst_dir_entry_t *ea = &a->entries[i];
+        const pst_dir_entry_t *eb = &b->entries[i];
+        if (ea->is_dir != eb->is_dir || ea->size != eb->size || ea->mtime != eb->mtime ||
+            strcmp(pst_dir_listing_name(a, i), pst_dir_listing_name(b, i)) != 0)
+            return false;
+    }
+    return true;
+}
+
+size_t pst_dir_listing_bytes(const pst_dir_listing_t *listing)
+{
+    return sizeof(*listing) + (size_t)listing->entries_cap * sizeof(pst_dir_entry_t) + listing->names_cap;
+}
+
+void pst_dir_listing_free(pst_dir_listing_t *listing)
+{
+    if (!listing)
+        return;
+    heap_caps_free(listing->entries);
+    heap_caps_free(listing->names);
+    heap_caps_free(listing);
+}
+
+static int find(const char *path)
+{
+    for (int i = 0; i < s_cfg.max_dirs; i++)
+    {
+        if (s_slots[i] && strcmp(s_slots[i]->path, path) == 0)
+            return i;
+    }
+    return -1;
+}
+
+static void drop(int slot)
+{
+    if (s_slots[slot]->prefetched)
+        s_stats.prefetch_unused++;
+    s_stats.bytes_used -= pst_dir_listing_bytes(s_slots[slot]);
+    s_stats.dirs--;
+    pst_dir_listing_free(s_slots[slot]);
+    s_slots[slot] = NULL;
+}
+
+static int lru_slot(void)
+{
+    int lru = -1;
+    for (int i = 0; i < s_cfg.max_dirs; i++)
+    {
+        if (s_slots[i] && (lru < 0 || s_tick - s_slots[i]->last_use > s_tick - s_slots[lru]->last_use))
+            lru = i;
+    }
+    return lru;
+}
+
+esp_err_t pst_dir_cache_init(const pst_dir_cache_cfg_t *cfg)
+{
+    const pst_dir_cache_cfg_t def_cfg = PST_DIR_CACHE_DEFAULT_CONFIG();
+
+    if (s_slots)
+        return ESP_ERR_INVALID_STATE;
+
+    s_cfg = cfg ? *cfg : def_cfg;
+    s_slots = heap_caps_calloc(s_cfg.max_dirs, sizeof(pst_dir_listing_t *), MALLOC_CAP_DEFAULT);
+    if (!s_slots)
+        return ESP_ERR_NO_MEM;
+    memset(&s_stats, 0, sizeof(s_stats));
+    ESP_LOGI(TAG, "Caching %u folders, %u KB", s_cfg.max_dirs, (unsigned)(s_cfg.budget_bytes / 1024));
+    return ESP_OK;
+}
+
+const pst_dir_listing_t *pst_dir_cache_get(const char *path)
+{
+    int slot = s_slots ? find(path) : -1;
+
+    if (slot < 0)
+    {
+        s_stats.misses++;
+        return NULL;
+    }
+    s_stats.hits++;
+    if (s_slots[slot]->prefetched)
+    {
+        s_slots[slot]->prefetched = false;
+        s_stats.prefetch_hits++;
+    }
+    s_slots[slot]->last_use = ++s_tick;
+    return s_slots[slot];
+}
+
+bool pst_dir_cache_is_current(const char *path, uint32_t dir_mtime)
+{
+    int slot = s_slots ? find(path) : -1;
+    return slot >= 0 && (!dir_mtime || s_slots[slot]->dir_mtime == dir_mtime);
+}
+
+pst_dir_listing_t *pst_dir_cache_dup(const char *path)
+{
+    int slot = s_slots ? find(path) : -1;
+    if (slot < 0)
+        return NULL;
+
+    const pst_dir_listing_t *src = s_slots[slot];
+    pst_dir_listing_t *l = pst_dir_listing_new(path);
+    if (!l || !grow((void **)&l->entries, &l->entries_cap, src->count, sizeof(pst_dir_entry_t), GROW_MIN_ENTRIES) ||
+        !grow((void **)&l->names, &l->names_cap, src->names_len, 1, GROW_MIN_NAMES))
+    {
+        pst_dir_listing_free(l);
+        return NULL;
+    }
+    memcpy(l->entries, src->entries, src->count * sizeof(pst_dir_entry_t));
+    memcpy(l->names, src->names, src->names_len);
+    l->count = src->count;
+    l->names_len = src->names_len;
+    l->dir_mtime = src->dir_mtime;
+    l->from_index = src->from_index;
+    return l;
+}
+
+void pst_dir_cache_put(pst_dir_listing_t *listing)
+{
+    size_t bytes = pst_dir_listing_bytes(listing);
+
+    if (!s_slots || bytes > s_cfg.budget_bytes)
+    {
+        pst_dir_listing_free(listing);
+        return;
+    }
+
+    int slot = find(listing->path);
+    if (slot >= 0)
+        drop(slot);
+
+    // Make room: a free slot and enough bytes
+    while (s_stats.dirs >= s_cfg.max_dirs || s_stats.bytes_used + bytes > s_cfg.budget_bytes)
+    {
+        drop(lru_slot());
+        s_stats.evictions++;
+    }
+    for (slot = 0; s_slots[slot]; slot++)
+        ;
+
+    listing->last_use = ++s_tick;
+    s_slots[slot] = listing;
+    s_stats.dirs++;
+    s_stats.bytes_used += bytes;
+}
+
+void pst_dir_cache_invalidate(const char *path)
+{
+    if (!s_slots)
+        return;
+
+    for (int i = 0; i < s_cfg.max_dirs; i++)
+    {
+        if (s_slots[i] && (!path || strcmp(s_slots[i]->path, path) == 0))
+        {
+            drop(i);
+            s_stats.invalidations++;
+        }
+    }
+}
+
+void pst_dir_cache_get_stats(pst_dir_cache_stats_t *out)
+{
+    *out = s_stats;
+}
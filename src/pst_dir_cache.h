@@ -0,0 +1,207 @@
+/**
+ * Directory listing cache for PST.
+ *
+ * Responsibilities:
+ *  - Hold directory listings (names, types, sizes, modification times) in PSRAM,
+ *    keyed by LVGL path, so revisiting a folder is served from memory
+ *  - Bound the cache by folder count and bytes, evicting the least recently used
+ *  - Keep each listing's directory timestamp so it can be checked against the card
+ *    (pst_dir_scan revalidates every hit in the background)
+ *  - Count hits, misses and evictions
+ *
+ * A listing is one PSRAM block of entries plus one of names; it is also the
+ * container the browser builds its filtered view in and pst_dir_index saves.
+ * Listings are sorted with directories first, then by name ignoring case.
+ *
+ * FAT only updates a directory's own timestamp on some hosts and never from
+ * FatFs: code writing to the card from this firmware calls pst_dir_cache_invalidate().
+ *
+ * Requirements:
+ *  - pst_dir_cache_*() must be called with the LVGL lock held (listings are read
+ *    from the LVGL task); pst_dir_listing_*() only need the listing not to be
+ *    shared with another task
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Longest directory path, drive letter included (e.g. "S:/music").
+ */
+#define PST_DIR_PATH_MAX 256
+
+/**
+ * @brief One directory entry.
+ */
+typedef struct {
+    uint32_t name;              /*!< Offset of the name in the listing's names */
+    uint32_t size;              /*!< Bytes (0 for directories) */
+    uint32_t mtime;             /*!< FAT timestamp: date << 16 | time, 0 if unknown */
+    uint32_t key;               /*!< Sort key of the name, set by pst_dir_listing_add() */
+    bool is_dir;
+} pst_dir_entry_t;
+
+/**
+ * @brief Listing orders; directories always come first.
+ */
+typedef enum {
+    PST_DIR_SORT_NAME = 0,      /*!< Natural order ignoring case: "track2" before "track10" */
+    PST_DIR_SORT_SIZE,          /*!< Largest first, then by name */
+    PST_DIR_SORT_MTIME,         /*!< Newest first, then by name */
+} pst_dir_sort_t;
+
+/**
+ * @brief Entries of one directory.
+ */
+typedef struct pst_dir_listing {
+    char path[PST_DIR_PATH_MAX];    /*!< LVGL path, e.g. "S:/music" */
+    uint32_t dir_mtime;             /*!< FAT timestamp of the directory, 0 if it has none (root) */
+    bool from_index;                /*!< Taken from the index file and not yet checked against the card */
+    uint32_t count;
+    pst_dir_entry_t *entries;
+    char *names;                    /*!< NUL-terminated names */
+    uint32_t names_len;
+    // Private
+    uint32_t entries_cap;
+    uint32_t names_cap;
+    uint32_t last_use;
+    bool prefetched;                /*!< Put by pst_dir_prefetch and not opened since */
+} pst_dir_listing_t;
+
+/**
+ * @brief Cache configuration.
+ */
+typedef struct {
+    uint16_t max_dirs;          /*!< Listings kept */
+    size_t budget_bytes;        /*!< PSRAM held by all listings */
+} pst_dir_cache_cfg_t;
+
+#define PST_DIR_CACHE_DEFAULT_CONFIG()  \
+    {                                   \
+        .max_dirs = 16,                 \
+        .budget_bytes = 512 * 1024,     \
+    }
+
+/**
+ * @brief Counters since init.
+ */
+typedef struct {
+    uint32_t hits;
+    uint32_t misses;
+    uint32_t evictions;         /*!< Listings dropped to make room */
+    uint32_t invalidations;     /*!< Listings dropped as out of date */
+    uint32_t prefetch_hits;     /*!< Hits on listings put by pst_dir_prefetch before the folder was opened */
+    uint32_t prefetch_unused;   /*!< Prefetched listings dropped without ever being opened */
+    uint16_t dirs;              /*!< Listings held */
+    size_t bytes_used;
+} pst_dir_cache_stats_t;
+
+/**
+ * @brief Enable the cache; without it every lookup misses.
+ *
+ * @param cfg  Configuration, NULL for PST_DIR_CACHE_DEFAULT_CONFIG().
+ *
+ * @return
+ *      - ESP_OK                 on success
+ *      - ESP_ERR_INVALID_STATE  if already initialized
+ */
+esp_err_t pst_dir_cache_init(const pst_dir_cache_cfg_t *cfg);
+
+/**
+ * @brief Cached listing of `path` for opening the folder, NULL on a miss. Valid until
+ *        the next cache call.
+ */
+const pst_dir_listing_t *pst_dir_cache_get(const char *path);
+
+/**
+ * @brief Copy of the cached listing of `path` (owned by the caller), NULL on a miss
+ *        or if out of memory. For tasks other than the LVGL task, which take the
+ *        lock just for the copy. Not counted as a hit or a miss.
+ */
+pst_dir_listing_t *pst_dir_cache_dup(const char *path);
+
+/**
+ * @brief true if a listing of `path` with timestamp `dir_mtime` is cached (any
+ *        listing of it if `dir_mtime` is 0, as for the root). Not counted as a hit
+ *        or a miss.
+ */
+bool pst_dir_cache_is_current(const char *path, uint32_t dir_mtime);
+
+/**
+ * @brief Store a listing (the cache takes ownership), replacing any listing of its path.
+ */
+void pst_dir_cache_put(pst_dir_listing_t *listing);
+
+/**
+ * @brief Drop the listing of `path` (e.g. after writing a file in it), NULL for all.
+ */
+void pst_dir_cache_invalidate(const char *path);
+
+/**
+ * @brief Copy the current counters.
+ */
+void pst_dir_cache_get_stats(pst_dir_cache_stats_t *out);
+
+/**
+ * @brief Allocate an empty listing.
+ *
+ * @return the listing, NULL if out of memory or the path is too long.
+ */
+pst_dir_listing_t *pst_dir_listing_new(const char *path);
+
+/**
+ * @brief Empty a listing, keeping its memory.
+ */
+void pst_dir_listing_clear(pst_dir_listing_t *listing);
+
+/**
+ * @brief Append an entry.
+ *
+ * @return false if out of memory.
+ */
+bool pst_dir_listing_add(pst_dir_listing_t *listing, const char *name, bool is_dir, uint32_t size, uint32_t mtime);
+
+/**
+ * @brief Name of entry `i`.
+ */
+static inline const char *pst_dir_listing_name(const pst_dir_listing_t *listing, uint32_t i)
+{
+    return listing->names + listing->entries[i].name;
+}
+
+/**
+ * @brief Sort a listing: directories first, then in `order`.
+ *
+ * Names mostly compare by their precomputed keys; the metadata comes from the
+ * directory read, so sorting does no I/O.
+ *
+ * @return false if out of memory (the listing is left as it was).
+ */
+bool pst_dir_listing_sort(pst_dir_listing_t *listing, pst_dir_sort_t order);
+
+/**
+ * @brief true if two listings hold the same entries in the same order.
+ */
+bool pst_dir_listing_equal(const pst_dir_listing_t *a, const pst_dir_listing_t *b);
+
+/**
+ * @brief PSRAM held by a listing.
+ */
+size_t pst_dir_listing_bytes(const pst_dir_listing_t *listing);
+
+/**
+ * @brief Free a listing not owned by the cache.
+ */
+void pst_dir_listing_free(pst_dir_listing_t *listing);
+
+#ifdef __cplusplus
+}
+#endif
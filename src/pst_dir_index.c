@@ -0,0 +1,228 @@
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+#include "esp_heap_caps.h"
+#include "esp_log.h"
+#include "esp_rom_crc.h"
+#include "ff.h"
+#include "pst_dir_index.h"
+#include "pst_dir_prefetch.h"
+#include "pst_thumb.h"
+
+static const char *TAG = "PST_DIR_INDEX";
+
+#define INDEX_MAGIC 0x49545350u     // "PSTI"
+#define FLAG_DIR 0x1u
+#define WRITE_CHUNK 64              // entries converted per write
+
+typedef struct {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t header_size;
+    uint32_t generation;
+    uint32_t dir_mtime;
+    uint32_t count;
+    uint32_t names_len;
+    uint32_t crc;
+} index_header_t;
+
+typedef struct {
+    uint32_t name;
+    uint32_t size;
+    uint32_t mtime;
+    uint32_t flags;
+} index_entry_t;
+
+_Static_assert(sizeof(index_header_t) == 28, "index header must not be padded");
+_Static_assert(sizeof(index_entry_t) == 16, "index entry must not be padded");
+
+// CRC of the header fields before the CRC itself, continued over the payload
+static uint32_t header_crc(const index_header_t *h)
+{
+    return esp_rom_crc32_le(0, (const uint8_t *)h, offsetof(index_header_t, crc));
+}
+
+static bool file_path(char *out, size_t len, const char *dir, const char *name)
+{
+    size_t dir_len = strlen(dir);
+    const char *sep = (dir_len && dir[dir_len - 1] == '/') ? "" : "/";
+    return snprintf(out, len, "%s%s%s", dir, sep, name) < (int)len;
+}
+
+static bool read_all(FIL *f, void *buf, uint32_t len)
+{
+    UINT got;
+    return f_read(f, buf, len, &got) == FR_OK && got == len;
+}
+
+static bool write_all(FIL *f, const void *buf, uint32_t len)
+{
+    UINT put;
+    return f_write(f, buf, len, &put) == FR_OK && put == len;
+}
+
+bool pst_dir_index_is_own_file(const char *name)
+{
+    return strcmp(name, PST_DIR_INDEX_NAME) == 0 || strcmp(name, PST_DIR_INDEX_TMP_NAME) == 0 ||
+           strcmp(name, PST_DIR_MRU_NAME) == 0 || strcmp(name, PST_THUMB_DIR_NAME) == 0;
+}
+
+esp_err_t pst_dir_index_load(const char *dir, const char *path, pst_dir_listing_t **out, uint32_t *generation)
+{
+    char fn[PST_DIR_PATH_MAX + 16];
+    index_header_t h;
+    index_entry_t *entries = NULL;
+    char *names = NULL;
+    esp_err_t err = ESP_ERR_INVALID_CRC;
+
+    *out = NULL;
+    if (!file_path(fn, sizeof(fn), dir, PST_DIR_INDEX_NAME))
+        return ESP_ERR_NOT_FOUND;
+
+    // FIL holds a sector buffer: too large for the worker stack
+    FIL *f = heap_caps_malloc(sizeof(FIL), MALLOC_CAP_DEFAULT);
+    if (!f)
+        return ESP_ERR_NO_MEM;
+    if (f_open(f, fn, FA_READ) != FR_OK)
+    {
+        heap_caps_free(f);
+        return ESP_ERR_NOT_FOUND;
+    }
+
+    if (!read_all(f, &h, sizeof(h)) || h.magic != INDEX_MAGIC)
+        goto out;
+    if (h.version != PST_DIR_INDEX_VERSION || h.header_size != sizeof(h))
+    {
+        err = ESP_ERR_INVALID_VERSION;
+        goto out;
+    }
+    // Header sizes are checked against the file first: FSIZE_t is 32 bits, their products could wrap
+    FSIZE_t payload = f_size(f) - sizeof(h);
+    if (h.count > payload / sizeof(index_entry_t) || h.names_len != payload - h.count * sizeof(index_entry_t) ||
+        (h.count && !h.names_len))
+        goto out;
+
+    entries = heap_caps_malloc(h.count * sizeof(index_entry_t) + 1, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+    names = heap_caps_malloc(h.names_len + 1, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+    if (!entries || !names)
+    {
+        err = ESP_ERR_NO_MEM;
+        goto out;
+    }
+    if (!read_all(f, entries, h.count * sizeof(index_entry_t)) || !read_all(f, names, h.names_len))
+        goto out;
+
+    uint32_t crc = esp_rom_crc32_le(header_crc(&h), (const uint8_t *)entries, h.count * sizeof(index_entry_t));
+    crc = esp_rom_crc32_le(crc, (const uint8_t *)names, h.names_len);
+    if (crc != h.crc || (h.names_len && names[h.names_len - 1] != '\0'))
+        goto out;
+
+    pst_dir_listing_t *l = pst_dir_listing_new(path);
+    if (!l)
+    {
+        err = ESP_ERR_NO_MEM;
+        goto out;
+    }
+    for (uint32_t i = 0; i < h.count; i++)
+    {
+        const index_entry_t *e = &entries[i];
+        if (e->name >= h.names_len)
+        {
+            pst_dir_listing_free(l);
+            goto out;
+        }
+        if (!pst_dir_listing_add(l, names + e->name, e->flags & FLAG_DIR, e->size, e->mtime))
+        {
+            pst_dir_listing_free(l);
+            err = ESP_ERR_NO_MEM;
+            goto out;
+        }
+    }
+    l->dir_mtime = h.dir_mtime;
+    *out = l;
+    *generation = h.generation;
+    err = ESP_OK;
+
+out:
+    f_close(f);
+    heap_caps_free(f);
+    heap_caps_free(entries);
+    heap_caps_free(names);
+    if (err == ESP_ERR_INVALID_CRC || err == ESP_ERR_INVALID_VERSION)
+        ESP_LOGW(TAG, "%s: %s, rebuilding", fn, err == ESP_ERR_INVALID_CRC ? "corrupt" : "other version");
+    return err;
+}
+
+esp_err_t pst_dir_index_save(const char *dir, const pst_dir_listing_t *listing, uint32_t generation)
+{
+    char fn[PST_DIR_PATH_MAX + 16];
+    char tmp_fn[PST_DIR_PATH_MAX + 16];
+    index_entry_t chunk[WRITE_CHUNK];
+    bool ok = true;
+
+    if (!file_path(fn, sizeof(fn), dir, PST_DIR_INDEX_NAME) || !file_path(tmp_fn, sizeof(tmp_fn), dir, PST_DIR_INDEX_TMP_NAME))
+        return ESP_FAIL;
+
+    FIL *f = heap_caps_malloc(sizeof(FIL), MALLOC_CAP_DEFAULT);
+    if (!f)
+        return ESP_ERR_NO_MEM;
+    if (f_open(f, tmp_fn, FA_WRITE | FA_CREATE_ALWAYS) != FR_OK)
+    {
+        heap_caps_free(f);
+        return ESP_FAIL;
+    }
+
+    index_header_t h = {
+        .magic = INDEX_MAGIC,
+        .version = PST_DIR_INDEX_VERSION,
+        .header_size = sizeof(h),
+        .generation = generation,
+        .dir_mtime = listing->dir_mtime,
+        .count = listing->count,
+        .names_len = listing->names_len,
+    };
+    // The CRC is patched in once the payload was written
+    ok = write_all(f, &h, sizeof(h));
+    uint32_t crc = header_crc(&h);
+    for (uint32_t i = 0; ok && i < listing->count; i += WRITE_CHUNK)
+    {
+        uint32_t n = listing->count - i < WRITE_CHUNK ? listing->count - i : WRITE_CHUNK;
+        for (uint32_t j = 0; j < n; j++)
+        {
+            const pst_dir_entry_t *e = &listing->entries[i + j];
+            chunk[j] = (index_entry_t) {
+                .name = e->name,
+                .size = e->size,
+                .mtime = e->mtime,
+                .flags = e->is_dir ? FLAG_DIR : 0,
+            };
+        }
+        crc = esp_rom_crc32_le(crc, (const uint8_t *)chunk, n * sizeof(index_entry_t));
+        ok = write_all(f, chunk, n * sizeof(index_entry_t));
+    }
+    if (ok)
+    {
+        crc = esp_rom_crc32_le(crc, (const uint8_t *)listing->names, listing->names_len);
+        ok = write_all(f, listing->names, listing->names_len);
+    }
+    h.crc = crc;
+    ok = ok && f_lseek(f, 0) == FR_OK && write_all(f, &h, sizeof(h));
+    ok = f_close(f) == FR_OK && ok;
+    heap_caps_free(f);
+
+    // Swap it in: FatFs does not rename over an existing file
+    if (ok)
+    {
+        f_unlink(fn);
+        ok = f_rename(tmp_fn, fn) == FR_OK;
+    }
+    if (!ok)
+    {
+        f_unlink(tmp_fn);
+        ESP_LOGW(TAG, "%s: cannot be written", fn);
+        return ESP_FAIL;
+    }
+    // Out of the way of file managers on a PC
+    f_chmod(fn, AM_HID, AM_HID);
+    return ESP_OK;
+}
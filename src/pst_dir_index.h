@@ -0,0 +1,83 @@
+/**
+ * On-card directory index for PST.
+ *
+ * Responsibilities:
+ *  - Save a folder's sorted listing in a hidden file inside the folder
+ *    (PST_DIR_INDEX_NAME), so the next boot shows a large folder from one file
+ *    read instead of walking its FAT directory entries
+ *  - Detect indexes that cannot be trusted (bad magic, other version, truncated,
+ *    CRC mismatch, entries pointing outside the names) and reject them
+ *  - Replace an index atomically: the new one is written next to it and renamed,
+ *    so a power cut leaves the old index or none, never a partial one
+ *
+ * An index is a hint: pst_dir_scan always reads the folder after showing it and
+ * rewrites the index when the two differ. Its generation counts the rewrites.
+ *
+ * Layout (little endian, no padding): a 28-byte header, then 16-byte entries,
+ * then the NUL-terminated names:
+ *  - Header:  "PSTI", u16 version, u16 header size, u32 generation,
+ *             u32 directory FAT timestamp, u32 entry count, u32 names bytes,
+ *             u32 CRC-32 of the header fields before it, the entries and the names
+ *  - Entry:   u32 name offset, u32 size, u32 FAT timestamp, u32 flags (bit 0: directory)
+ *
+ * Requirements:
+ *  - SD card mounted via bsp_sd_init(); paths are FatFs paths ("0:/music")
+ *  - Called from one task at a time per folder (the pst_dir_scan worker)
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "esp_err.h"
+#include "pst_dir_cache.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define PST_DIR_INDEX_NAME ".pstidx"
+#define PST_DIR_INDEX_TMP_NAME ".pstidx.tmp"
+#define PST_DIR_INDEX_VERSION 2
+
+/**
+ * @brief true if `name` is an index file, or another file PST keeps on the card
+ *        (pst_dir_prefetch's list of recent folders, pst_thumb's thumbnail
+ *        folder); kept out of listings.
+ */
+bool pst_dir_index_is_own_file(const char *name);
+
+/**
+ * @brief Read the index of a folder.
+ *
+ * @param dir         FatFs path of the folder, e.g. "0:/logs".
+ * @param path        LVGL path given to the listing, e.g. "S:/logs".
+ * @param out         Receives the listing (owned by the caller), sorted.
+ * @param generation  Receives the index generation.
+ *
+ * @return
+ *      - ESP_OK                   on success
+ *      - ESP_ERR_NOT_FOUND        if the folder has no index
+ *      - ESP_ERR_INVALID_VERSION  if the index is of another version
+ *      - ESP_ERR_INVALID_CRC      if the index is truncated or corrupt
+ *      - ESP_ERR_NO_MEM           if out of memory
+ */
+esp_err_t pst_dir_index_load(const char *dir, const char *path, pst_dir_listing_t **out, uint32_t *generation);
+
+/**
+ * @brief Write the index of a folder, replacing any previous one.
+ *
+ * @param dir         FatFs path of the folder.
+ * @param listing     Sorted listing (pst_dir_listing_sort()).
+ * @param generation  Generation to store, the previous one + 1.
+ *
+ * @return
+ *      - ESP_OK        on success
+ *      - ESP_FAIL      if the card cannot be written
+ *      - ESP_ERR_NO_MEM if out of memory
+ */
+esp_err_t pst_dir_index_save(const char *dir, const pst_dir_listing_t *listing, uint32_t generation);
+
+#ifdef __cplusplus
+}
+#endif
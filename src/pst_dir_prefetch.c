@@ -0,0 +1,366 @@
+#include <stdio.h>
+#include <string.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+#include "esp_heap_caps.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "ff.h"
+#include "lvgl.h"
+#include "esp_bsp.h"
+#include "pst_dir_cache.h"
+#include "pst_dir_index.h"
+#include "pst_dir_prefetch.h"
+#include "pst_fs.h"
+
+static const char *TAG = "PST_DIR_PREFETCH";
+
+#define FAT_TIME(fi) ((uint32_t)(fi).fdate << 16 | (fi).ftime)
+#define MRU_HEADER "PSTMRU 1\n"
+
+typedef enum {
+    REQ_FOLDER,
+    REQ_WARM,
+} req_kind_t;
+
+typedef struct {
+    uint8_t kind;
+    char path[PST_DIR_PATH_MAX];
+} prefetch_req_t;
+
+static pst_dir_prefetch_cfg_t s_cfg;
+static QueueHandle_t s_req_q = NULL;
+static pst_dir_prefetch_stats_t s_stats;    // current, indexed, reads, skipped, mru_* are written by the worker
+
+// MRU list, newest first; shared with the worker under the LVGL lock
+static char (*s_mru)[PST_DIR_PATH_MAX] = NULL;
+static uint8_t s_mru_n = 0;
+static bool s_mru_dirty = false;
+static TickType_t s_mru_changed;
+
+// NULL if the folder cannot be read, is too large or memory is short
+static pst_dir_listing_t *read_folder(const char *fatfs_path, const char *path)
+{
+    FILINFO fi;
+    FF_DIR dir;
+
+    pst_dir_listing_t *l = pst_dir_listing_new(path);
+    if (!l)
+        return NULL;
+    if (f_opendir(&dir, fatfs_path) != FR_OK)
+    {
+        pst_dir_listing_free(l);
+        return NULL;
+    }
+    while (f_readdir(&dir, &fi) == FR_OK && fi.fname[0])
+    {
+        if (pst_dir_index_is_own_file(fi.fname))
+            continue;
+        if (l->count >= s_cfg.max_entries ||
+            !pst_dir_listing_add(l, fi.fname, (fi.fattrib & AM_DIR) != 0,
+                                 fi.fsize > UINT32_MAX ? UINT32_MAX : (uint32_t)fi.fsize, FAT_TIME(fi)))
+        {
+            pst_dir_listing_free(l);
+            l = NULL;
+            break;
+        }
+    }
+    f_closedir(&dir);
+
+    if (l && !pst_dir_listing_sort(l, PST_DIR_SORT_NAME))
+    {
+        pst_dir_listing_free(l);
+        l = NULL;
+    }
+    return l;
+}
+
+static void prefetch_folder(const char *path)
+{
+    char fatfs_path[PST_DIR_PATH_MAX + 8];
+    FILINFO fi;
+    uint32_t dir_mtime = 0;
+    pst_dir_listing_t *l = NULL;
+    int64_t t0 = esp_timer_get_time();
+
+    if (!pst_fs_to_fatfs_path(path, fatfs_path, sizeof(fatfs_path)))
+    {
+        s_stats.skipped++;
+        return;
+    }
+    // The root has no directory entry, hence no timestamp
+    if (path[2] && f_stat(fatfs_path, &fi) == FR_OK)
+        dir_mtime = FAT_TIME(fi);
+
+    bsp_display_lock(0);
+    bool current = pst_dir_cache_is_current(path, dir_mtime);
+    bsp_display_unlock();
+    if (current)
+    {
+        s_stats.current++;
+        return;
+    }
+
+    // An index older than the folder's timestamp is stale for sure; a matching one is not proof
+    uint32_t generation;
+    if (dir_mtime && pst_dir_index_load(fatfs_path, path, &l, &generation) == ESP_OK &&
+        (l->dir_mtime != dir_mtime || l->count > s_cfg.max_entries))
+    {
+        pst_dir_listing_free(l);
+        l = NULL;
+    }
+    bool indexed = l != NULL;
+    if (indexed)
+    {
+        s_stats.indexed++;
+    }
+    else if ((l = read_folder(fatfs_path, path)))
+    {
+        s_stats.reads++;
+    }
+    else
+    {
+        s_stats.skipped++;
+        return;
+    }
+    l->dir_mtime = dir_mtime;
+    // The timestamp does not prove the index current: the scan reads the folder on opening
+    l->from_index = indexed;
+    l->prefetched = true;
+
+    uint32_t count = l->count;
+    bsp_display_lock(0);
+    // Opened and scanned meanwhile: that listing is at least as good as an index
+    if (indexed && dir_mtime && pst_dir_cache_is_current(path, dir_mtime))
+        pst_dir_listing_free(l);
+    else
+        pst_dir_cache_put(l);
+    bsp_display_unlock();
+    ESP_LOGD(TAG, "%s: %lu entries in %lu ms", path, (unsigned long)count,
+             (unsigned long)((esp_timer_get_time() - t0) / 1000));
+}
+
+static bool mru_file_path(char *out, size_t len)
+{
+    const char *drive = bsp_sd_get_fatfs_drive();
+    return drive && snprintf(out, len, "%s/%s", drive, PST_DIR_MRU_NAME) < (int)len;
+}
+
+static void mru_save(void)
+{
+    char fn[32];
+    uint8_t n;
+
+    // Copied under the lock, written without it
+    size_t size = strlen(MRU_HEADER) + (size_t)s_cfg.mru_size * PST_DIR_PATH_MAX;
+    char *buf = heap_caps_malloc(size, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+    if (!buf)
+        return;
+    size_t len = snprintf(buf, size, "%s", MRU_HEADER);
+    bsp_display_lock(0);
+    n = s_mru_n;
+    for (uint8_t i = 0; i < n; i++)
+        len += snprintf(buf + len, size - len, "%s\n", s_mru[i]);
+    s_mru_dirty = false;
+    bsp_display_unlock();
+
+    FIL *f = heap_caps_malloc(sizeof(FIL), MALLOC_CAP_DEFAULT);
+    bool ok = f && mru_file_path(fn, sizeof(fn)) && f_open(f, fn, FA_WRITE | FA_CREATE_ALWAYS) == FR_OK;
+    if (ok)
+    {
+        UINT put;
+        ok = f_write(f, buf, len, &put) == FR_OK && put == len;
+        ok = f_close(f) == FR_OK && ok;
+        // Out of the way of file managers on a PC
+        f_chmod(fn, AM_HID, AM_HID);
+    }
+    if (ok)
+        s_stats.mru_writes++;
+    else
+        ESP_LOGW(TAG, "Cannot write the list of recent folders");
+    heap_caps_free(f);
+    heap_caps_free(buf);
+}
+
+// Prefetch the folders of the MRU file, newest first, presses still going first
+static void mru_warm(void)
+{
+    char fn[32];
+    prefetch_req_t req;
+    UINT got = 0;
+    int64_t t0 = esp_timer_get_time();
+
+    size_t size = strlen(MRU_HEADER) + (size_t)s_cfg.mru_size * PST_DIR_PATH_MAX;
+    char *buf = heap_caps_malloc(size + 1, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+    FIL *f = heap_caps_malloc(sizeof(FIL), MALLOC_CAP_DEFAULT);
+    if (buf && f && mru_file_path(fn, sizeof(fn)) && f_open(f, fn, FA_READ) == FR_OK)
+    {
+        if (f_read(f, buf, size, &got) != FR_OK)
+            got = 0;
+        f_close(f);
+    }
+    heap_caps_free(f);
+    if (!buf)
+        return;
+    buf[got] = '\0';
+    if (strncmp(buf, MRU_HEADER, strlen(MRU_HEADER)) != 0)
+    {
+        if (got)
+            ESP_LOGW(TAG, "%s: not a list of recent folders, ignored", PST_DIR_MRU_NAME);
+        heap_caps_free(buf);
+        return;
+    }
+
+    uint32_t warmed = 0;
+    char *line = buf + strlen(MRU_HEADER);
+    while (*line)
+    {
+        char *end = strchr(line, '\n');
+        if (!end)
+            break;
+        *end = '\0';
+        if (line[0] == PST_FS_LETTER && line[1] == ':' && end - line < PST_DIR_PATH_MAX)
+        {
+            // Known to the list from now on; folders opened since boot stay ahead
+            bsp_display_lock(0);
+            bool known = false;
+            for (uint8_t i = 0; i < s_mru_n && !known; i++)
+                known = strcmp(s_mru[i], line) == 0;
+            if (!known && s_mru_n < s_cfg.mru_size)
+                strcpy(s_mru[s_mru_n++], line);
+            bsp_display_unlock();
+
+            while (xQueueReceive(s_req_q, &req, 0) == pdTRUE)
+            {
+                if (req.kind == REQ_FOLDER)
+                    prefetch_folder(req.path);
+            }
+            prefetch_folder(line);
+            warmed++;
+        }
+        line = end + 1;
+    }
+    s_stats.mru_warmed += warmed;
+    ESP_LOGI(TAG, "Warmed %lu recent folders in %lu ms", (unsigned long)warmed,
+             (unsigned long)((esp_timer_get_time() - t0) / 1000));
+    heap_caps_free(buf);
+}
+
+static void prefetch_task(void *arg)
+{
+    prefetch_req_t req;
+    TickType_t delay = pdMS_TO_TICKS(s_cfg.mru_save_delay_ms);
+
+    while (1)
+    {
+        if (xQueueReceive(s_req_q, &req, delay) == pdTRUE)
+        {
+            if (req.kind == REQ_WARM)
+                mru_warm();
+            else
+                prefetch_folder(req.path);
+        }
+        // Written once the list has settled: opening folders writes nothing
+        if (s_mru_dirty && xTaskGetTickCount() - s_mru_changed >= delay)
+            mru_save();
+    }
+}
+
+esp_err_t pst_dir_prefetch_init(const pst_dir_prefetch_cfg_t *cfg)
+{
+    const pst_dir_prefetch_cfg_t def_cfg = PST_DIR_PREFETCH_DEFAULT_CONFIG();
+
+    if (s_req_q)
+        return ESP_ERR_INVALID_STATE;
+
+    s_cfg = cfg ? *cfg : def_cfg;
+    if (s_cfg.mru_size > PST_DIR_MRU_MAX)
+        s_cfg.mru_size = PST_DIR_MRU_MAX;
+    memset(&s_stats, 0, sizeof(s_stats));
+
+    QueueHandle_t req_q = xQueueCreate(s_cfg.queue_len, sizeof(prefetch_req_t));
+    s_mru = heap_caps_calloc(s_cfg.mru_size ? s_cfg.mru_size : 1, PST_DIR_PATH_MAX, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+    if (!req_q || !s_mru)
+        goto err;
+
+    s_req_q = req_q;
+    BaseType_t res;
+    if (s_cfg.task_affinity < 0)
+        res = xTaskCreate(prefetch_task, "PST dir prefetch", s_cfg.task_stack, NULL, s_cfg.task_priority, NULL);
+    else
+        res = xTaskCreatePinnedToCore(prefetch_task, "PST dir prefetch", s_cfg.task_stack, NULL, s_cfg.task_priority, NULL, s_cfg.task_affinity);
+    if (res != pdPASS)
+    {
+        s_req_q = NULL;
+        goto err;
+    }
+    return ESP_OK;
+
+err:
+    if (req_q)
+        vQueueDelete(req_q);
+    heap_caps_free(s_mru);
+    s_mru = NULL;
+    return ESP_ERR_NO_MEM;
+}
+
+void pst_dir_prefetch_warm(void)
+{
+    const prefetch_req_t req = { .kind = REQ_WARM };
+
+    if (s_req_q && xQueueSend(s_req_q, &req, 0) != pdTRUE)
+        s_stats.dropped++;
+}
+
+bool pst_dir_prefetch(const char *path)
+{
+    prefetch_req_t req = { .kind = REQ_FOLDER };
+
+    if (!s_req_q || strlen(path) >= sizeof(req.path))
+        return false;
+
+    strcpy(req.path, path);
+    s_stats.requests++;
+    // The press is about to open this folder: it goes before older requests
+    if (xQueueSendToFront(s_req_q, &req, 0) != pdTRUE)
+    {
+        s_stats.dropped++;
+        return false;
+    }
+    return true;
+}
+
+void pst_dir_prefetch_note_open(const char *path)
+{
+    uint8_t i;
+
+    if (!s_mru || !s_cfg.mru_size || strlen(path) >= PST_DIR_PATH_MAX)
+        return;
+    for (i = 0; i < s_mru_n && strcmp(s_mru[i], path) != 0; i++)
+        ;
+    if (i == 0 && s_mru_n)
+        return;     // at the front already
+    if (i == s_mru_n)
+    {
+        // New: the oldest falls off a full list
+        if (s_mru_n < s_cfg.mru_size)
+            s_mru_n++;
+        i = s_mru_n - 1;
+    }
+    memmove(s_mru[1], s_mru[0], (size_t)i * PST_DIR_PATH_MAX);
+    strcpy(s_mru[0], path);
+    s_mru_dirty = true;
+    s_mru_changed = xTaskGetTickCount();
+}
+
+void pst_dir_prefetch_get_stats(pst_dir_prefetch_stats_t *out)
+{
+    pst_dir_cache_stats_t cache;
+
+    pst_dir_cache_get_stats(&cache);
+    *out = s_stats;
+    out->hits = cache.prefetch_hits;
+    out->misses = cache.misses;
+    out->unused = cache.prefetch_unused;
+}
@@ -0,0 +1,119 @@
+/**
+ * Folder listing prefetch for PST.
+ *
+ * Responsibilities:
+ *  - Read folders into pst_dir_cache ahead of time in a worker task, so that
+ *    opening them is served from memory (pst_dir_scan then only checks the
+ *    folder's timestamp)
+ *  - Take requests from the UI the moment a folder row is pressed, before the
+ *    click completes; the newest press goes first
+ *  - Keep the most recently opened folders in a small hidden file at the card
+ *    root (PST_DIR_MRU_NAME), written a while after the list changes, and warm
+ *    the cache with them at boot
+ *  - Take folders from their index file (pst_dir_index) when its timestamp
+ *    matches the folder's; such listings are marked from_index, so that
+ *    pst_dir_scan reads the folder when it is opened. Skip folders already cached
+ *    and current, and leave folders too large for the cache to the paged scan
+ *  - Count prefetch hits (folders opened from a prefetched listing) and misses
+ *    (folders opened without a cached listing)
+ *
+ * Requirements:
+ *  - pst_dir_cache_init() called before
+ *  - SD card mounted via bsp_sd_init() before pst_dir_prefetch_warm()
+ *  - pst_dir_prefetch() / pst_dir_prefetch_note_open() called with the LVGL lock
+ *    held (e.g. from LVGL event handlers)
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define PST_DIR_MRU_NAME ".pstmru"  /*!< Recently opened folders, at the card root */
+#define PST_DIR_MRU_MAX 16          /*!< Most folders kept in the MRU list */
+
+/**
+ * @brief Worker configuration.
+ */
+typedef struct {
+    int task_priority;          /*!< Below the LVGL task and next to the scan worker */
+    int task_stack;
+    int task_affinity;          /*!< Core to pin the worker to (-1 is no affinity) */
+    uint8_t queue_len;          /*!< Folders waiting; further requests are dropped */
+    uint32_t max_entries;       /*!< Larger folders are not prefetched (they are read a page at a time) */
+    uint8_t mru_size;           /*!< Folders kept in the MRU list (at most PST_DIR_MRU_MAX) */
+    uint32_t mru_save_delay_ms; /*!< The MRU file is written this long after the list last changed */
+} pst_dir_prefetch_cfg_t;
+
+#define PST_DIR_PREFETCH_DEFAULT_CONFIG()   \
+    {                                       \
+        .task_priority = 2,                 \
+        .task_stack = 4096,                 \
+        .task_affinity = -1,                \
+        .queue_len = 4,                     \
+        .max_entries = 4096,                \
+        .mru_size = 8,                      \
+        .mru_save_delay_ms = 5000,          \
+    }
+
+/**
+ * @brief Counters since init.
+ */
+typedef struct {
+    uint32_t requests;          /*!< Folders asked for, by presses and the MRU list */
+    uint32_t dropped;           /*!< Requests dropped, the queue being full */
+    uint32_t current;           /*!< Folders already cached and current: nothing read */
+    uint32_t indexed;           /*!< Folders loaded from their index file */
+    uint32_t reads;             /*!< Folders read from the card */
+    uint32_t skipped;           /*!< Folders too large or that could not be read */
+    uint32_t hits;              /*!< Folder opens served by a prefetched listing */
+    uint32_t misses;            /*!< Folder opens without a cached listing */
+    uint32_t unused;            /*!< Prefetched listings dropped from the cache without being opened */
+    uint32_t mru_warmed;        /*!< Folders requested at boot from the MRU file */
+    uint32_t mru_writes;        /*!< MRU file writes */
+} pst_dir_prefetch_stats_t;
+
+/**
+ * @brief Create the worker task.
+ *
+ * @param cfg  Configuration, NULL for PST_DIR_PREFETCH_DEFAULT_CONFIG().
+ *
+ * @return
+ *      - ESP_OK                 on success
+ *      - ESP_ERR_INVALID_STATE  if already initialized
+ *      - ESP_ERR_NO_MEM         if the task or the queue cannot be created
+ */
+esp_err_t pst_dir_prefetch_init(const pst_dir_prefetch_cfg_t *cfg);
+
+/**
+ * @brief Read the MRU file and prefetch its folders in the background.
+ */
+void pst_dir_prefetch_warm(void);
+
+/**
+ * @brief Prefetch a folder ahead of its opening, before the folders asked for earlier.
+ *
+ * @param path  LVGL path of the folder, e.g. "S:/music".
+ *
+ * @return false if not initialized, the path is too long or the queue is full.
+ */
+bool pst_dir_prefetch(const char *path);
+
+/**
+ * @brief Record that a folder was opened (moved to the front of the MRU list).
+ */
+void pst_dir_prefetch_note_open(const char *path);
+
+/**
+ * @brief Copy the current counters.
+ */
+void pst_dir_prefetch_get_stats(pst_dir_prefetch_stats_t *out);
+
+#ifdef __cplusplus
+}
+#endif
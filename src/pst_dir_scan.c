@@ -0,0 +1,640 @@
+#include <stdatomic.h>
+#include <string.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+#include "esp_heap_caps.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "ff.h"
+#include "lvgl.h"
+#include "esp_bsp.h"
+#include "pst_dir_index.h"
+#include "pst_dir_scan.h"
+#include "pst_fs.h"
+
+static const char *TAG = "PST_DIR_SCAN";
+
+#define SEND_POLL_MS 50         // how often a waiting worker checks for cancellation
+#define FAT_TIME(fi) ((uint32_t)(fi).fdate << 16 | (fi).ftime)
+
+typedef struct {
+    uint32_t id;
+    uint32_t known_mtime;       // timestamp of the cached listing
+    bool validate;              // a cached listing was served: skip the read if it is current
+    char path[PST_DIR_PATH_MAX];
+} scan_req_t;
+
+// Worker to LVGL task; entries and names follow in the same allocation
+typedef struct {
+    uint32_t scan_id;
+    uint32_t count;
+    uint32_t names_len;
+    uint32_t dir_mtime;
+    bool last;
+    bool unchanged;             // the listing delivered (cached or index) is current
+    bool indexed;               // entries from the folder's index file
+    bool restart;               // the index was out of date: the folder follows in full
+    esp_err_t err;
+    pst_dir_entry_t *entries;
+    char *names;
+} scan_msg_t;
+
+static pst_dir_scan_cfg_t s_cfg;
+static QueueHandle_t s_req_q = NULL;        // newest request only (overwritten)
+static QueueHandle_t s_msg_q = NULL;        // scan_msg_t *, worker to LVGL
+static lv_timer_t *s_timer = NULL;
+static TaskHandle_t s_task = NULL;
+static atomic_uint s_scan_id;               // newest scan; older ones are cancelled
+
+// LVGL task side
+static pst_dir_scan_cb_t s_cb = NULL;
+static void *s_cb_arg = NULL;
+static bool s_busy = false;
+static bool s_first_seen = false;
+static bool s_revalidating = false;         // what was delivered is being replaced: buffer to the end
+static bool s_from_cache = false;           // a cached listing was delivered
+static bool s_from_index = false;           // an index file was delivered
+static bool s_paged = false;                // the UI takes the folder a page at a time from s_building
+static bool s_paused = false;               // a page was delivered, the next waits for pst_dir_scan_more()
+static bool s_page_seen = false;
+static uint32_t s_limit = 0;                // entries the UI asked for (paged)
+static uint32_t s_delivered = 0;            // entries of s_building delivered (paged)
+static bool s_read_done = false;            // the worker read the whole folder (paged)
+static esp_err_t s_read_err = ESP_OK;
+static uint32_t s_read_mtime = 0;
+static uint32_t s_total = 0;
+static uint32_t s_cached_count = 0;         // entries of the cached listing delivered
+static int64_t s_start_us;
+static char s_path[PST_DIR_PATH_MAX];
+static pst_dir_listing_t *s_building = NULL; // entries of the running scan, cached once complete
+static pst_dir_scan_stats_t s_stats;       // index_* counters are written by the worker
+
+static bool cancelled(uint32_t id)
+{
+    return atomic_load_explicit(&s_scan_id, memory_order_relaxed) != id;
+}
+
+// Waits out a memory shortage; NULL only if the scan was cancelled meanwhile
+static scan_msg_t *msg_new(uint32_t id)
+{
+    size_t size = sizeof(scan_msg_t) + s_cfg.batch_entries * sizeof(pst_dir_entry_t) + s_cfg.batch_bytes;
+
+    while (!cancelled(id))
+    {
+        scan_msg_t *m = heap_caps_malloc(size, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+        if (!m)
+            m = heap_caps_malloc(size, MALLOC_CAP_DEFAULT);
+        if (m)
+        {
+            *m = (scan_msg_t) { .scan_id = id, .err = ESP_OK };
+            m->entries = (pst_dir_entry_t *)(m + 1);
+            m->names = (char *)(m->entries + s_cfg.batch_entries);
+            return m;
+        }
+        vTaskDelay(pdMS_TO_TICKS(SEND_POLL_MS));
+    }
+    return NULL;
+}
+
+// Hand a message to the UI, waiting while it is behind; false (message freed) if cancelled meanwhile
+static bool msg_send(scan_msg_t *m)
+{
+    while (!cancelled(m->scan_id))
+    {
+        if (xQueueSend(s_msg_q, &m, pdMS_TO_TICKS(SEND_POLL_MS)) == pdTRUE)
+            return true;
+    }
+    heap_caps_free(m);
+    return false;
+}
+
+// Send *m now and start the next message in it; false (*m NULL) if cancelled meanwhile
+static bool msg_flush(scan_msg_t **m)
+{
+    uint32_t id = (*m)->scan_id;
+    bool indexed = (*m)->indexed;
+
+    if (!msg_send(*m) || !(*m = msg_new(id)))
+    {
+        *m = NULL;
+        return false;
+    }
+    (*m)->indexed = indexed;
+    return true;
+}
+
+// Append an entry, sending *m first when it is full; false (*m NULL) if cancelled meanwhile
+static bool msg_add(scan_msg_t **m, const char *name, const pst_dir_entry_t *entry)
+{
+    uint32_t len = strlen(name) + 1;
+
+    if (len > s_cfg.batch_bytes)
+        return true;
+    if (((*m)->count == s_cfg.batch_entries || (*m)->names_len + len > s_cfg.batch_bytes) && !msg_flush(m))
+        return false;
+
+    scan_msg_t *cur = *m;
+    memcpy(cur->names + cur->names_len, name, len);
+    cur->entries[cur->count] = *entry;
+    cur->entries[cur->count++].name = cur->names_len;
+    cur->names_len += len;
+    return true;
+}
+
+static bool msg_add_listing(scan_msg_t **m, const pst_dir_listing_t *listing)
+{
+    for (uint32_t i = 0; i < listing->count; i++)
+    {
+        if (!msg_add(m, pst_dir_listing_name(listing, i), &listing->entries[i]))
+            return false;
+    }
+    return true;
+}
+
+static void scan(const scan_req_t *req)
+{
+    char fatfs_path[PST_DIR_PATH_MAX + 8];
+    FILINFO fi;
+    FF_DIR dir;
+    uint32_t dir_mtime = 0;
+    uint32_t generation = 0;
+    pst_dir_listing_t *index = NULL;    // from the folder's index file, already delivered
+    pst_dir_listing_t *found = NULL;    // read from the card, for the index file
+    bool shown = false;                 // the index was delivered
+    bool rebuild = false;               // the index file is unusable: replace it whatever the size
+    bool changed = true;
+    esp_err_t err = ESP_OK;
+
+    scan_msg_t *m = msg_new(req->id);
+    if (!m)
+        return;
+
+    if (!pst_fs_to_fatfs_path(req->path, fatfs_path, sizeof(fatfs_path)))
+    {
+        err = ESP_ERR_NOT_FOUND;
+        goto done;
+    }
+    // The root has no directory entry, hence no timestamp
+    if (req->path[2] && f_stat(fatfs_path, &fi) == FR_OK)
+        dir_mtime = FAT_TIME(fi);
+    if (req->validate && dir_mtime && dir_mtime == req->known_mtime)
+    {
+        m->unchanged = true;
+        goto done;
+    }
+
+    // Deliver the index at once, then read the folder to check it. A cached
+    // listing was delivered instead: the index is only compared.
+    if (s_cfg.index_min_entries)
+    {
+        esp_err_t ret = pst_dir_index_load(fatfs_path, req->path, &index, &generation);
+        if (ret == ESP_OK && !req->validate)
+        {
+            s_stats.index_loads++;
+            shown = true;
+            m->indexed = true;
+            if (!msg_add_listing(&m, index) || !msg_flush(&m))
+                goto cancelled;
+            m->indexed = false;
+        }
+        else if (ret != ESP_OK && ret != ESP_ERR_NOT_FOUND)
+        {
+            s_stats.index_rejected++;
+            rebuild = true;
+        }
+    }
+
+    if (f_opendir(&dir, fatfs_path) != FR_OK)
+    {
+        err = ESP_ERR_NOT_FOUND;
+        goto done;
+    }
+    if (s_cfg.index_min_entries)
+        found = pst_dir_listing_new(req->path);
+
+    // FatFs hands out the metadata with the name: no stat() per entry
+    while (f_readdir(&dir, &fi) == FR_OK && fi.fname[0])
+    {
+        if (cancelled(req->id))
+        {
+            f_closedir(&dir);
+            goto cancelled;
+        }
+        if (pst_dir_index_is_own_file(fi.fname))
+            continue;
+
+        pst_dir_entry_t e = {
+            .size = fi.fsize > UINT32_MAX ? UINT32_MAX : (uint32_t)fi.fsize,
+            .mtime = FAT_TIME(fi),
+            .is_dir = (fi.fattrib & AM_DIR) != 0,
+        };
+        if (found && !pst_dir_listing_add(found, fi.fname, e.is_dir, e.size, e.mtime))
+        {
+            pst_dir_listing_free(found);
+            found = NULL;
+        }
+        // With the index delivered, the folder is only sent if it differs. Pages
+        // are held back on the LVGL side: the read never waits for the user.
+        if (!shown && !msg_add(&m, fi.fname, &e))
+        {
+            f_closedir(&dir);
+            goto cancelled;
+        }
+    }
+    f_closedir(&dir);
+
+    if (found && !pst_dir_listing_sort(found, PST_DIR_SORT_NAME))
+    {
+        pst_dir_listing_free(found);
+        found = NULL;
+    }
+    if (found)
+        found->dir_mtime = dir_mtime;
+    if (index && found)
+        changed = !pst_dir_listing_equal(index, found);
+    if (shown)
+    {
+        if (!found)
+        {
+            err = ESP_ERR_NO_MEM;
+        }
+        else if (!changed)
+        {
+            m->unchanged = true;
+        }
+        else
+        {
+            m->restart = true;
+            if (!msg_add_listing(&m, found))
+                goto cancelled;
+        }
+    }
+
+done:
+    m->last = true;
+    m->err = err;
+    m->dir_mtime = dir_mtime;
+    msg_send(m);
+    m = NULL;
+
+    // Written once the whole folder is on its way to the UI, out of the way of the browser
+    if (found && err == ESP_OK && changed && (index || rebuild || found->count >= s_cfg.index_min_entries) &&
+        pst_dir_index_save(fatfs_path, found, generation + 1) == ESP_OK)
+        s_stats.index_writes++;
+
+cancelled:
+    heap_caps_free(m);
+    pst_dir_listing_free(index);
+    pst_dir_listing_free(found);
+}
+
+static void scan_task(void *arg)
+{
+    scan_req_t req;
+
+    while (1)
+    {
+        if (xQueueReceive(s_req_q, &req, portMAX_DELAY) == pdTRUE && !cancelled(req.id))
+            scan(&req);
+    }
+}
+
+static void deliver(const pst_dir_scan_batch_t *b)
+{
+    uint32_t ms = (uint32_t)((esp_timer_get_time() - s_start_us) / 1000);
+
+    if (!s_first_seen && (b->count || b->last))
+    {
+        s_first_seen = true;
+        s_stats.first_entry_ms = ms;
+    }
+    if (!s_page_seen && (b->partial || b->last))
+    {
+        s_page_seen = true;
+        s_stats.first_page_ms = ms;
+        if (b->partial)
+            ESP_LOGI(TAG, "%s: first page of %lu entries after %lu ms", s_path, (unsigned long)b->total, (unsigned long)ms);
+    }
+    if (b->last)
+    {
+        s_busy = false;
+        s_stats.total_ms = ms;
+        s_stats.last_entries = b->total;
+        const char *from = s_from_cache ? (b->restart ? " (cache refreshed)" : " (cached)") :
+                           s_from_index ? (b->restart ? " (index refreshed)" : " (index)") : "";
+        ESP_LOGI(TAG, "%s: %lu entries%s, first after %lu ms, done in %lu ms", s_path, (unsigned long)b->total,
+                 from, (unsigned long)s_stats.first_entry_ms, (unsigned long)ms);
+    }
+    if (s_cb)
+        s_cb(b, s_cb_arg);
+}
+
+// The scan is over: cache what it read, if it is complete and new
+static void building_done(bool cache, uint32_t dir_mtime)
+{
+    if (!s_building)
+        return;
+    if (cache && pst_dir_listing_sort(s_building, PST_DIR_SORT_NAME))
+    {
+        s_building->dir_mtime = dir_mtime;
+        pst_dir_cache_put(s_building);
+    }
+    else
+    {
+        pst_dir_listing_free(s_building);
+    }
+    s_building = NULL;
+}
+
+// Paged scan: hand the UI the entries of s_building up to `end`
+static void deliver_read(uint32_t end, bool partial, bool last)
+{
+    const pst_dir_scan_batch_t b = {
+        .scan_id = atomic_load_explicit(&s_scan_id, memory_order_relaxed),
+        .total = end,
+        .count = end - s_delivered,
+        .entries = s_building->entries + s_delivered,
+        .names = s_building->names,
+        .partial = partial,
+        .last = last,
+        .err = last ? s_read_err : ESP_OK,
+    };
+
+    s_delivered = end;
+    s_paused = partial;
+    deliver(&b);
+}
+
+// Paged scan: deliver a page once it is read in full, the rest once the folder is
+static void page_check(void)
+{
+    uint32_t read = s_building->count;
+
+    if (s_read_done && read <= s_limit)
+    {
+        deliver_read(read, false, true);
+        building_done(s_read_err == ESP_OK, s_read_mtime);
+    }
+    else if (read >= s_limit && s_delivered < s_limit)
+    {
+        deliver_read(s_limit, true, false);
+    }
+}
+
+static void handle_msg(const scan_msg_t *m)
+{
+    if (m->indexed)
+    {
+        s_from_index = true;
+        // In memory already: delivered in full as it comes
+        s_paged = false;
+    }
+    else
+    {
+        s_stats.entries += m->count;
+    }
+    if (m->restart)
+    {
+        // The index delivered was out of date: collect the folder, then replace it
+        if (s_building)
+            pst_dir_listing_clear(s_building);
+        else
+            s_building = pst_dir_listing_new(s_path);
+        s_total = 0;
+        s_revalidating = true;
+    }
+    s_total += m->count;
+    for (uint32_t i = 0; i < m->count && s_building; i++)
+    {
+        const pst_dir_entry_t *e = &m->entries[i];
+        if (!pst_dir_listing_add(s_building, m->names + e->name, e->is_dir, e->size, e->mtime))
+        {
+            // No room to hold pages back: what was read goes to the UI now, this
+            // message and the next ones as they come
+            if (s_paged && s_building->count - i > s_delivered)
+                deliver_read(s_building->count - i, false, false);
+            s_paged = false;
+            // Delivered anyway, just not cached
+            pst_dir_listing_free(s_building);
+            s_building = NULL;
+        }
+    }
+
+    if (s_paged)
+    {
+        if (m->last)
+        {
+            s_read_done = true;
+            s_read_err = m->err;
+            s_read_mtime = m->dir_mtime;
+        }
+        page_check();
+        return;
+    }
+
+    pst_dir_scan_batch_t b = {
+        .scan_id = m->scan_id,
+        .last = m->last,
+        .err = m->err,
+    };
+    if (m->unchanged)
+    {
+        s_stats.unchanged++;
+        b.total = s_from_cache ? s_cached_count : s_total;
+        deliver(&b);
+    }
+    else if (!s_revalidating)
+    {
+        b.total = s_total;
+        b.count = m->count;
+        b.entries = m->entries;
+        b.names = m->names;
+        deliver(&b);
+    }
+    else if (m->last)
+    {
+        // The listing delivered was out of date: replace it in one go
+        s_stats.refreshed++;
+        b.restart = true;
+        b.total = s_total;
+        if (s_building)
+        {
+            b.count = s_building->count;
+            b.entries = s_building->entries;
+            b.names = s_building->names;
+        }
+        else if (b.err == ESP_OK)
+        {
+            b.err = ESP_ERR_NO_MEM;
+        }
+        deliver(&b);
+    }
+
+    // A confirmed index is cached too; a confirmed cache entry is already there
+    if (m->last)
+        building_done(m->err == ESP_OK && !(m->unchanged && s_from_cache), m->dir_mtime);
+}
+
+static void deliver_timer_cb(lv_timer_t *timer)
+{
+    scan_msg_t *m;
+    int delivered = 0;
+
+    while (delivered < s_cfg.batches_per_pass && xQueueReceive(s_msg_q, &m, 0) == pdTRUE)
+    {
+        if (s_busy && m->scan_id == atomic_load_explicit(&s_scan_id, memory_order_relaxed))
+        {
+            handle_msg(m);
+            delivered++;
+        }
+        else
+        {
+            s_stats.stale_batches++;
+        }
+        heap_caps_free(m);
+    }
+    // The UI asked for the next page of what was read meanwhile
+    if (s_busy && s_paged && !s_paused && s_building)
+        page_check();
+}
+
+esp_err_t pst_dir_scan_init(const pst_dir_scan_cfg_t *cfg)
+{
+    const pst_dir_scan_cfg_t def_cfg = PST_DIR_SCAN_DEFAULT_CONFIG();
+
+    if (s_req_q)
+        return ESP_ERR_INVALID_STATE;
+
+    s_cfg = cfg ? *cfg : def_cfg;
+    memset(&s_stats, 0, sizeof(s_stats));
+
+    QueueHandle_t req_q = xQueueCreate(1, sizeof(scan_req_t));
+    s_msg_q = xQueueCreate(s_cfg.queue_len, sizeof(scan_msg_t *));
+    if (!req_q || !s_msg_q)
+        goto err;
+
+    bsp_display_lock(0);
+    s_timer = lv_timer_create(deliver_timer_cb, s_cfg.deliver_period_ms, NULL);
+    bsp_display_unlock();
+    if (!s_timer)
+        goto err;
+
+    s_req_q = req_q;
+    BaseType_t res;
+    if (s_cfg.task_affinity < 0)
+        res = xTaskCreate(scan_task, "PST dir scan", s_cfg.task_stack, NULL, s_cfg.task_priority, &s_task);
+    else
+        res = xTaskCreatePinnedToCore(scan_task, "PST dir scan", s_cfg.task_stack, NULL, s_cfg.task_priority, &s_task, s_cfg.task_affinity);
+    if (res != pdPASS)
+    {
+        s_req_q = NULL;
+        bsp_display_lock(0);
+        lv_timer_del(s_timer);
+        bsp_display_unlock();
+        s_timer = NULL;
+        goto err;
+    }
+    return ESP_OK;
+
+err:
+    if (req_q)
+        vQueueDelete(req_q);
+    if (s_msg_q)
+        vQueueDelete(s_msg_q);
+    s_msg_q = NULL;
+    return ESP_ERR_NO_MEM;
+}
+
+void pst_dir_scan_cancel(void)
+{
+    if (s_busy)
+    {
+        s_stats.cancelled++;
+        s_busy = false;
+    }
+    // Read in full but not all shown: cached all the same
+    building_done(s_paged && s_read_done && s_read_err == ESP_OK, s_read_mtime);
+    s_paged = false;
+    s_paused = false;
+    atomic_fetch_add(&s_scan_id, 1);
+}
+
+void pst_dir_scan_more(bool to_end)
+{
+    if (!s_busy || !s_paged || (!s_paused && !to_end))
+        return;
+
+    if (s_paused)
+        s_stats.pages++;
+    if (to_end)
+        s_limit = UINT32_MAX;
+    else if (s_limit != UINT32_MAX)
+        s_limit += s_cfg.page_entries;
+    // Delivered by the timer: the caller may be binding rows
+    s_paused = false;
+}
+
+uint32_t pst_dir_scan_start(const char *path, pst_dir_scan_cb_t cb, void *arg)
+{
+    scan_req_t req;
+
+    if (!s_req_q || strlen(path) >= sizeof(req.path))
+        return 0;
+
+    pst_dir_scan_cancel();
+    req.id = atomic_load(&s_scan_id);
+    strcpy(req.path, path);
+    strcpy(s_path, path);
+
+    s_cb = cb;
+    s_cb_arg = arg;
+    s_busy = true;
+    s_first_seen = false;
+    s_page_seen = false;
+    s_total = 0;
+    s_start_us = esp_timer_get_time();
+    s_stats.scans++;
+    s_building = pst_dir_listing_new(path);
+
+    const pst_dir_listing_t *cached = pst_dir_cache_get(path);
+    req.validate = cached != NULL;
+    // A listing from an index file is always checked against the card
+    req.known_mtime = cached && !cached->from_index ? cached->dir_mtime : 0;
+    // A cached folder is shown already: the check is delivered in one go
+    s_paged = !cached && s_cfg.page_entries && s_building;
+    s_limit = s_cfg.page_entries;
+    s_delivered = 0;
+    s_read_done = false;
+    s_read_err = ESP_OK;
+    s_revalidating = cached != NULL;
+    s_from_cache = cached != NULL;
+    s_from_index = false;
+    xQueueOverwrite(s_req_q, &req);
+
+    if (cached)
+    {
+        s_stats.cached++;
+        s_cached_count = cached->count;
+        const pst_dir_scan_batch_t b = {
+            .scan_id = req.id,
+            .total = cached->count,
+            .count = cached->count,
+            .entries = cached->entries,
+            .names = cached->names,
+            .cached = true,
+        };
+        deliver(&b);
+    }
+    return req.id;
+}
+
+bool pst_dir_scan_busy(void)
+{
+    return s_busy;
+}
+
+void pst_dir_scan_get_stats(pst_dir_scan_stats_t *out)
+{
+    *out = s_stats;
+}
@@ -0,0 +1,180 @@
+/**
+ * Background directory enumeration for PST.
+ *
+ * Responsibilities:
+ *  - Read directories in a worker task, outside the LVGL task and its lock, so a
+ *    slow SD card or a folder with thousands of entries does not stall rendering
+ *    and touch
+ *  - Read names, types, sizes and timestamps in the same pass (FatFs f_readdir),
+ *    without one stat() per entry
+ *  - Stream the entries to the UI in batches through a queue; an LVGL timer hands
+ *    them to the scan callback, a few batches per pass
+ *  - Hand folders to the UI a page at a time, the next when it asks for it
+ *    (pst_dir_scan_more()), so the first page shows whatever the folder size;
+ *    the worker still reads the whole folder meanwhile, so it gets cached and
+ *    indexed even if the user leaves after the first page
+ *  - Serve folders from pst_dir_cache at once, then check them against the card in
+ *    the background (directory timestamp, or a rescan for the root) and replace
+ *    them if they changed
+ *  - Otherwise serve large folders from their index file (pst_dir_index) at once,
+ *    then read them and replace the listing and the index if they differ
+ *  - Cancel the scan in progress when another one starts (only the newest scan is
+ *    delivered)
+ *  - Measure time to the first entry and total scan time, as the UI sees them
+ *
+ * Requirements:
+ *  - Display + LVGL must already be initialized via bsp_display_start_with_config()
+ *  - SD card mounted via bsp_sd_init() before a scan starts
+ *  - pst_dir_scan_start() / pst_dir_scan_cancel() called with the LVGL lock held
+ *    (e.g. from LVGL event handlers)
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "esp_err.h"
+#include "pst_dir_cache.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Entries of a directory handed to the scan callback.
+ */
+typedef struct {
+    uint32_t scan_id;               /*!< Scan the batch belongs to */
+    uint32_t total;                 /*!< Entries delivered by the scan so far, this batch included */
+    uint32_t count;                 /*!< Entries in this batch */
+    const pst_dir_entry_t *entries; /*!< Entry names are offsets into `names` */
+    const char *names;
+    bool restart;                   /*!< The folder changed: drop what was delivered, this batch holds all of it */
+    bool cached;                    /*!< Served from pst_dir_cache, being checked against the card */
+    bool partial;                   /*!< End of a page: the next one is delivered after pst_dir_scan_more() */
+    bool last;                      /*!< Final batch of the scan */
+    esp_err_t err;                  /*!< On the last batch: ESP_OK, or ESP_ERR_NOT_FOUND if the directory cannot be opened */
+} pst_dir_scan_batch_t;
+
+/**
+ * @brief Called from the LVGL task (lock held) with each batch of the current scan.
+ *
+ * The batch is only valid during the call.
+ */
+typedef void (*pst_dir_scan_cb_t)(const pst_dir_scan_batch_t *batch, void *arg);
+
+/**
+ * @brief Worker configuration.
+ */
+typedef struct {
+    int task_priority;          /*!< Below the LVGL task: scanning only uses idle time */
+    int task_stack;
+    int task_affinity;          /*!< Core to pin the worker to (-1 is no affinity) */
+    uint16_t batch_entries;     /*!< Entries per batch (a batch is also sent when names fill batch_bytes) */
+    uint16_t batch_bytes;       /*!< Name bytes per batch */
+    uint8_t queue_len;          /*!< Batches in flight; the worker waits when the UI falls behind */
+    uint8_t batches_per_pass;   /*!< Batches handed to the callback per LVGL timer pass */
+    uint32_t deliver_period_ms; /*!< LVGL timer period delivering the batches */
+    uint16_t index_min_entries; /*!< Folders with this many entries get an index file, 0 disables indexes */
+    uint32_t page_entries;      /*!< Entries delivered per page, 0 delivers folders as they are read */
+} pst_dir_scan_cfg_t;
+
+#define PST_DIR_SCAN_DEFAULT_CONFIG()   \
+    {                                   \
+        .task_priority = 2,             \
+        .task_stack = 4096,             \
+        .task_affinity = -1,            \
+        .batch_entries = 32,            \
+        .batch_bytes = 2048,            \
+        .queue_len = 4,                 \
+        .batches_per_pass = 2,          \
+        .deliver_period_ms = 20,        \
+        .index_min_entries = 64,        \
+        .page_entries = 256,            \
+    }
+
+/**
+ * @brief Counters since init; timings of the last completed scan.
+ */
+typedef struct {
+    uint32_t scans;             /*!< Scans started */
+    uint32_t cancelled;         /*!< Scans abandoned for a newer one */
+    uint32_t cached;            /*!< Scans served from pst_dir_cache */
+    uint32_t unchanged;         /*!< Cached folders confirmed by their timestamp, indexed ones by a read */
+    uint32_t refreshed;         /*!< Cached or indexed folders read again and replaced */
+    uint32_t index_loads;       /*!< Folders served from their index file */
+    uint32_t index_rejected;    /*!< Index files found corrupt or of another version */
+    uint32_t index_writes;      /*!< Index files written */
+    uint32_t entries;           /*!< Entries read from the card */
+    uint32_t stale_batches;     /*!< Batches of a cancelled scan dropped before delivery */
+    uint32_t pages;             /*!< Pages delivered on request after the first */
+    uint32_t first_entry_ms;    /*!< Start to the first entry delivered (to the end for an empty folder) */
+    uint32_t first_page_ms;     /*!< Start to the end of the first page (or of the scan) */
+    uint32_t total_ms;          /*!< Start to the last batch delivered, time waiting for pst_dir_scan_more() included */
+    uint32_t last_entries;      /*!< Entries of the last completed scan */
+} pst_dir_scan_stats_t;
+
+/**
+ * @brief Create the worker task and the delivery timer.
+ *
+ * @param cfg  Configuration, NULL for PST_DIR_SCAN_DEFAULT_CONFIG().
+ *
+ * @return
+ *      - ESP_OK                 on success
+ *      - ESP_ERR_INVALID_STATE  if already initialized
+ *      - ESP_ERR_NO_MEM         if the task, queues or timer cannot be created
+ */
+esp_err_t pst_dir_scan_init(const pst_dir_scan_cfg_t *cfg);
+
+/**
+ * @brief Scan a directory, cancelling the scan in progress.
+ *
+ * A cached folder is delivered (cached = true) before this function returns,
+ * an indexed one in the first batches; the last batch follows once the card was
+ * checked, with restart set if the folder changed. Other folders are delivered a
+ * page at a time, once each is read in full (batches with partial set end a page).
+ *
+ * @param path  LVGL path of the directory, e.g. "S:" or "S:/music".
+ * @param cb    Receives the batches; always gets a last batch unless cancelled.
+ * @param arg   Argument of cb.
+ *
+ * @return
+ *      - the scan id (> 0), as found in the batches
+ *      - 0 if not initialized or the path is too long
+ */
+uint32_t pst_dir_scan_start(const char *path, pst_dir_scan_cb_t cb, void *arg);
+
+/**
+ * @brief Cancel the scan in progress; none of its batches is delivered anymore.
+ */
+void pst_dir_scan_cancel(void);
+
+/**
+ * @brief Read the next page of a paged scan, or all the rest.
+ *
+ * Does nothing unless the scan waits at the end of a page, or `to_end` is set
+ * (e.g. the folder is about to be filtered or sorted and needs all its entries).
+ */
+void pst_dir_scan_more(bool to_end);
+
+/**
+ * @brief true while a scan has batches left to deliver, pages not delivered yet included.
+ */
+bool pst_dir_scan_busy(void);
+
+/**
+ * @brief Name of entry `i` of a batch.
+ */
+static inline const char *pst_dir_scan_batch_name(const pst_dir_scan_batch_t *batch, uint32_t i)
+{
+    return batch->names + batch->entries[i].name;
+}
+
+/**
+ * @brief Copy the current counters.
+ */
+void pst_dir_scan_get_stats(pst_dir_scan_stats_t *out);
+
+#ifdef __cplusplus
+}
+#endif
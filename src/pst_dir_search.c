@@ -0,0 +1,447 @@
+#include <stdatomic.h>
+#include <stdio.h>
+#include <string.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+#include "esp_heap_caps.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "ff.h"
+#include "lvgl.h"
+#include "esp_bsp.h"
+#include "pst_dir_index.h"
+#include "pst_dir_search.h"
+#include "pst_fs.h"
+#include "pst_name_index.h"
+
+static const char *TAG = "PST_DIR_SEARCH";
+
+#define SEND_POLL_MS 50         // how often a waiting worker checks for cancellation
+#define FAT_TIME(fi) ((uint32_t)(fi).fdate << 16 | (fi).ftime)
+
+typedef struct {
+    uint32_t id;
+    char root[PST_DIR_PATH_MAX];
+    char query[PST_NAME_QUERY_MAX];     // folded
+} search_req_t;
+
+// Worker to LVGL task; entries and paths follow in the same allocation
+typedef struct {
+    uint32_t search_id;
+    uint32_t count;
+    uint32_t paths_len;
+    uint32_t dirs;
+    uint32_t elapsed_ms;
+    bool last;
+    bool truncated;
+    esp_err_t err;
+    pst_dir_entry_t *entries;
+    char *paths;
+} search_msg_t;
+
+// One folder level of the walk
+typedef struct {
+    pst_dir_listing_t *listing;     // entries from the cache; NULL: read from dir
+    uint32_t pos;
+    uint16_t path_len;              // s_walk_path of this folder
+    FF_DIR dir;
+} frame_t;
+
+static pst_dir_search_cfg_t s_cfg;
+static QueueHandle_t s_req_q = NULL;        // newest request only (overwritten)
+static QueueHandle_t s_msg_q = NULL;        // search_msg_t *, worker to LVGL
+static lv_timer_t *s_timer = NULL;
+static atomic_uint s_search_id;             // newest search; older ones are cancelled
+static pst_dir_search_stats_t s_stats;      // dirs* counters are written by the worker
+
+// Worker side
+static frame_t *s_frames = NULL;            // max_depth + 1 levels
+static char s_walk_path[PST_DIR_PATH_MAX];  // LVGL path of the entry being looked at
+static uint32_t s_walk_dirs;
+static int64_t s_walk_start_us;
+
+// LVGL task side
+static pst_dir_search_cb_t s_cb = NULL;
+static void *s_cb_arg = NULL;
+static bool s_busy = false;
+static uint32_t s_total = 0;
+static char s_query[PST_NAME_QUERY_MAX];
+
+static bool cancelled(uint32_t id)
+{
+    return atomic_load_explicit(&s_search_id, memory_order_relaxed) != id;
+}
+
+// Waits out a memory shortage; NULL only if the search was cancelled meanwhile
+static search_msg_t *msg_new(uint32_t id)
+{
+    size_t size = sizeof(search_msg_t) + s_cfg.batch_results * sizeof(pst_dir_entry_t) + s_cfg.batch_bytes;
+
+    while (!cancelled(id))
+    {
+        search_msg_t *m = heap_caps_malloc(size, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+        if (!m)
+            m = heap_caps_malloc(size, MALLOC_CAP_DEFAULT);
+        if (m)
+        {
+            *m = (search_msg_t) { .search_id = id, .err = ESP_OK };
+            m->entries = (pst_dir_entry_t *)(m + 1);
+            m->paths = (char *)(m->entries + s_cfg.batch_results);
+            return m;
+        }
+        vTaskDelay(pdMS_TO_TICKS(SEND_POLL_MS));
+    }
+    return NULL;
+}
+
+// Hand a message to the UI, waiting while it is behind; false (message freed) if cancelled meanwhile
+static bool msg_send(search_msg_t *m)
+{
+    m->dirs = s_walk_dirs;
+    m->elapsed_ms = (uint32_t)((esp_timer_get_time() - s_walk_start_us) / 1000);
+    while (!cancelled(m->search_id))
+    {
+        if (xQueueSend(s_msg_q, &m, pdMS_TO_TICKS(SEND_POLL_MS)) == pdTRUE)
+            return true;
+    }
+    heap_caps_free(m);
+    return false;
+}
+
+// Send *m now and start the next message in it; false (*m NULL) if cancelled meanwhile
+static bool msg_flush(search_msg_t **m)
+{
+    uint32_t id = (*m)->search_id;
+
+    if (!msg_send(*m) || !(*m = msg_new(id)))
+    {
+        *m = NULL;
+        return false;
+    }
+    return true;
+}
+
+// Append a match, sending *m first when it is full; false (*m NULL) if cancelled meanwhile
+static bool msg_add(search_msg_t **m, const char *path, const pst_dir_entry_t *entry)
+{
+    uint32_t len = strlen(path) + 1;
+
+    if (len > s_cfg.batch_bytes)
+        return true;
+    if (((*m)->count == s_cfg.batch_results || (*m)->paths_len + len > s_cfg.batch_bytes) && !msg_flush(m))
+        return false;
+
+    search_msg_t *cur = *m;
+    memcpy(cur->paths + cur->paths_len, path, len);
+    cur->entries[cur->count] = *entry;
+    cur->entries[cur->count++].name = cur->paths_len;
+    cur->paths_len += len;
+    return true;
+}
+
+static bool open_frame(frame_t *f, const char *path)
+{
+    char fatfs_path[PST_DIR_PATH_MAX + 8];
+
+    f->pos = 0;
+
+    // Folders the browser read this session: copied under the LVGL lock. Index
+    // files, and listings taken from one and not checked yet, are not used: FatFs
+    // never moves folder timestamps, so nothing tells whether files came since.
+    bsp_display_lock(0);
+    f->listing = pst_dir_cache_dup(path);
+    bsp_display_unlock();
+    if (f->listing && !f->listing->from_index)
+    {
+        s_stats.dirs_cached++;
+        return true;
+    }
+    pst_dir_listing_free(f->listing);
+    f->listing = NULL;
+
+    if (!pst_fs_to_fatfs_path(path, fatfs_path, sizeof(fatfs_path)))
+        return false;
+    return f_opendir(&f->dir, fatfs_path) == FR_OK;
+}
+
+static bool next_entry(frame_t *f, FILINFO *fi, const char **name, pst_dir_entry_t *e)
+{
+    if (f->listing)
+    {
+        if (f->pos >= f->listing->count)
+            return false;
+        *name = pst_dir_listing_name(f->listing, f->pos);
+        *e = f->listing->entries[f->pos++];
+        return true;
+    }
+
+    do
+    {
+        if (f_readdir(&f->dir, fi) != FR_OK || !fi->fname[0])
+            return false;
+    } while (pst_dir_index_is_own_file(fi->fname));
+    *name = fi->fname;
+    *e = (pst_dir_entry_t) {
+        .size = fi->fsize > UINT32_MAX ? UINT32_MAX : (uint32_t)fi->fsize,
+        .mtime = FAT_TIME(*fi),
+        .is_dir = (fi->fattrib & AM_DIR) != 0,
+    };
+    return true;
+}
+
+static void close_frame(frame_t *f)
+{
+    if (f->listing)
+    {
+        pst_dir_listing_free(f->listing);
+        f->listing = NULL;
+    }
+    else
+    {
+        f_closedir(&f->dir);
+    }
+}
+
+static void search(const search_req_t *req)
+{
+    FILINFO fi;
+    uint32_t total = 0;
+    int depth = 0;
+    bool truncated = false;
+    esp_err_t err = ESP_OK;
+
+    s_walk_dirs = 0;
+    s_walk_start_us = esp_timer_get_time();
+    int64_t flush_us = s_walk_start_us;
+
+    search_msg_t *m = msg_new(req->id);
+    if (!m)
+        return;
+
+    strcpy(s_walk_path, req->root);
+    if (!open_frame(&s_frames[0], s_walk_path))
+    {
+        err = ESP_ERR_NOT_FOUND;
+        goto done;
+    }
+    s_frames[0].path_len = strlen(s_walk_path);
+    depth = 1;
+
+    // Depth first, one frame per level: memory does not grow with the tree
+    while (depth > 0)
+    {
+        frame_t *f = &s_frames[depth - 1];
+        const char *name;
+        pst_dir_entry_t e;
+
+        if (cancelled(req->id))
+            goto cancelled;
+        if (!next_entry(f, &fi, &name, &e))
+        {
+            close_frame(f);
+            s_walk_dirs++;
+            s_stats.dirs++;
+            if (--depth > 0)
+                s_walk_path[s_frames[depth - 1].path_len] = '\0';
+            continue;
+        }
+
+        size_t len = f->path_len + 1 + strlen(name);
+        if (len >= sizeof(s_walk_path))
+        {
+            s_stats.dirs_skipped += e.is_dir;
+            continue;
+        }
+        s_walk_path[f->path_len] = '/';
+        strcpy(s_walk_path + f->path_len + 1, name);
+
+        if (pst_name_match(name, req->query))
+        {
+            if (!msg_add(&m, s_walk_path, &e))
+                goto cancelled;
+            if (++total >= s_cfg.max_results)
+            {
+                truncated = true;
+                break;
+            }
+        }
+
+        bool entered = false;
+        if (e.is_dir)
+        {
+            entered = depth <= s_cfg.max_depth && open_frame(&s_frames[depth], s_walk_path);
+            if (entered)
+                s_frames[depth++].path_len = len;
+            else
+                s_stats.dirs_skipped++;
+        }
+        if (!entered)
+            s_walk_path[f->path_len] = '\0';
+
+        // Matches do not wait long for their batch; progress shows while none come
+        int64_t now = esp_timer_get_time();
+        if (now - flush_us >= (int64_t)s_cfg.flush_ms * 1000)
+        {
+            flush_us = now;
+            if (!msg_flush(&m))
+                goto cancelled;
+        }
+    }
+
+done:
+    while (depth > 0)
+        close_frame(&s_frames[--depth]);
+    m->last = true;
+    m->truncated = truncated;
+    m->err = err;
+    msg_send(m);
+    return;
+
+cancelled:
+    while (depth > 0)
+        close_frame(&s_frames[--depth]);
+    heap_caps_free(m);
+}
+
+static void search_task(void *arg)
+{
+    search_req_t req;
+
+    while (1)
+    {
+        if (xQueueReceive(s_req_q, &req, portMAX_DELAY) == pdTRUE && !cancelled(req.id))
+            search(&req);
+    }
+}
+
+static void deliver_timer_cb(lv_timer_t *timer)
+{
+    search_msg_t *m;
+
+    // One batch per pass: matches trickle in without long LVGL passes
+    if (xQueueReceive(s_msg_q, &m, 0) != pdTRUE)
+        return;
+
+    if (s_busy && m->search_id == atomic_load_explicit(&s_search_id, memory_order_relaxed))
+    {
+        s_total += m->count;
+        s_stats.results += m->count;
+        const pst_dir_search_batch_t b = {
+            .search_id = m->search_id,
+            .count = m->count,
+            .entries = m->entries,
+            .paths = m->paths,
+            .total = s_total,
+            .dirs = m->dirs,
+            .elapsed_ms = m->elapsed_ms,
+            .last = m->last,
+            .truncated = m->truncated,
+            .err = m->err,
+        };
+        if (b.last)
+        {
+            s_busy = false;
+            s_stats.last_ms = b.elapsed_ms;
+            s_stats.last_dirs_per_s = b.elapsed_ms ? (uint32_t)((uint64_t)b.dirs * 1000 / b.elapsed_ms) : b.dirs;
+            ESP_LOGI(TAG, "\"%s\": %lu matches%s in %lu folders, %lu ms (%lu folders/s)", s_query, (unsigned long)b.total,
+                     b.truncated ? " (capped)" : "", (unsigned long)b.dirs, (unsigned long)b.elapsed_ms,
+                     (unsigned long)s_stats.last_dirs_per_s);
+        }
+        if (s_cb)
+            s_cb(&b, s_cb_arg);
+    }
+    heap_caps_free(m);
+}
+
+esp_err_t pst_dir_search_init(const pst_dir_search_cfg_t *cfg)
+{
+    const pst_dir_search_cfg_t def_cfg = PST_DIR_SEARCH_DEFAULT_CONFIG();
+
+    if (s_req_q)
+        return ESP_ERR_INVALID_STATE;
+
+    s_cfg = cfg ? *cfg : def_cfg;
+    memset(&s_stats, 0, sizeof(s_stats));
+
+    QueueHandle_t req_q = xQueueCreate(1, sizeof(search_req_t));
+    s_msg_q = xQueueCreate(s_cfg.queue_len, sizeof(search_msg_t *));
+    s_frames = heap_caps_malloc((s_cfg.max_depth + 1) * sizeof(frame_t), MALLOC_CAP_DEFAULT);
+    if (!req_q || !s_msg_q || !s_frames)
+        goto err;
+
+    bsp_display_lock(0);
+    s_timer = lv_timer_create(deliver_timer_cb, s_cfg.deliver_period_ms, NULL);
+    bsp_display_unlock();
+    if (!s_timer)
+        goto err;
+
+    s_req_q = req_q;
+    BaseType_t res;
+    if (s_cfg.task_affinity < 0)
+        res = xTaskCreate(search_task, "PST dir search", s_cfg.task_stack, NULL, s_cfg.task_priority, NULL);
+    else
+        res = xTaskCreatePinnedToCore(search_task, "PST dir search", s_cfg.task_stack, NULL, s_cfg.task_priority, NULL, s_cfg.task_affinity);
+    if (res != pdPASS)
+    {
+        s_req_q = NULL;
+        bsp_display_lock(0);
+        lv_timer_del(s_timer);
+        bsp_display_unlock();
+        s_timer = NULL;
+        goto err;
+    }
+    return ESP_OK;
+
+err:
+    if (req_q)
+        vQueueDelete(req_q);
+    if (s_msg_q)
+        vQueueDelete(s_msg_q);
+    s_msg_q = NULL;
+    heap_caps_free(s_frames);
+    s_frames = NULL;
+    return ESP_ERR_NO_MEM;
+}
+
+void pst_dir_search_cancel(void)
+{
+    if (s_busy)
+    {
+        s_stats.cancelled++;
+        s_busy = false;
+    }
+    atomic_fetch_add(&s_search_id, 1);
+}
+
+uint32_t pst_dir_search_start(const char *root, const char *query, pst_dir_search_cb_t cb, void *arg)
+{
+    static search_req_t req;    // too large for the LVGL task stack
+
+    if (!s_req_q || strlen(root) >= sizeof(req.root) || !query[0] || strlen(query) >= sizeof(req.query))
+        return 0;
+
+    pst_dir_search_cancel();
+    req.id = atomic_load(&s_search_id);
+    strcpy(req.root, root);
+    pst_name_fold(query, req.query, sizeof(req.query));
+    snprintf(s_query, sizeof(s_query), "%s", query);
+
+    s_cb = cb;
+    s_cb_arg = arg;
+    s_busy = true;
+    s_total = 0;
+    s_stats.searches++;
+    xQueueOverwrite(s_req_q, &req);
+    return req.id;
+}
+
+bool pst_dir_search_busy(void)
+{
+    return s_busy;
+}
+
+void pst_dir_search_get_stats(pst_dir_search_stats_t *out)
+{
+    *out = s_stats;
+}
@@ -0,0 +1,157 @@
+/**
+ * Recursive file name search for PST.
+ *
+ * Responsibilities:
+ *  - Walk a folder tree in a worker task, outside the LVGL task and its lock,
+ *    matching names case-insensitively (pst_name_match)
+ *  - Bound memory: the walk keeps one frame per folder level on an explicit stack
+ *    (no recursion), deeper folders are skipped and counted
+ *  - Take folders the browser read this session from pst_dir_cache, read the
+ *    others from the card
+ *  - Stream the matches to the UI in batches (an LVGL timer delivers them), with
+ *    progress batches while nothing matches
+ *  - Stop at a result cap; cancel the search in progress when another one starts
+ *  - Report folders searched per second
+ *
+ * Index files (pst_dir_index) are not searched, nor cached listings taken from
+ * one and not checked yet: FatFs never updates folder timestamps, so nothing
+ * tells whether files or subfolders were added since the index was written.
+ *
+ * Requirements:
+ *  - Display + LVGL must already be initialized via bsp_display_start_with_config()
+ *  - SD card mounted via bsp_sd_init() before a search starts
+ *  - pst_dir_search_start() / pst_dir_search_cancel() called with the LVGL lock held
+ *    (e.g. from LVGL event handlers)
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "esp_err.h"
+#include "pst_dir_cache.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Matches handed to the search callback.
+ */
+typedef struct {
+    uint32_t search_id;             /*!< Search the batch belongs to */
+    uint32_t count;                 /*!< Matches in this batch (0 in progress batches) */
+    const pst_dir_entry_t *entries; /*!< Entry names are offsets of full LVGL paths in `paths` */
+    const char *paths;
+    uint32_t total;                 /*!< Matches so far, this batch included */
+    uint32_t dirs;                  /*!< Folders searched so far */
+    uint32_t elapsed_ms;
+    bool last;                      /*!< Final batch of the search */
+    bool truncated;                 /*!< On the last batch: stopped at max_results */
+    esp_err_t err;                  /*!< On the last batch: ESP_OK, or ESP_ERR_NOT_FOUND if the root cannot be opened */
+} pst_dir_search_batch_t;
+
+/**
+ * @brief Called from the LVGL task (lock held) with each batch of the current search.
+ *
+ * The batch is only valid during the call.
+ */
+typedef void (*pst_dir_search_cb_t)(const pst_dir_search_batch_t *batch, void *arg);
+
+/**
+ * @brief Worker configuration.
+ */
+typedef struct {
+    int task_priority;          /*!< Below the LVGL task: searching only uses idle time */
+    int task_stack;
+    int task_affinity;          /*!< Core to pin the worker to (-1 is no affinity) */
+    uint16_t max_depth;         /*!< Folder levels below the root walked into */
+    uint32_t max_results;       /*!< The search stops at this many matches */
+    uint16_t batch_results;     /*!< Matches per batch (a batch is also sent when paths fill batch_bytes) */
+    uint16_t batch_bytes;       /*!< Path bytes per batch */
+    uint32_t flush_ms;          /*!< Longest a match waits for its batch to fill; also the progress period */
+    uint8_t queue_len;          /*!< Batches in flight; the worker waits when the UI falls behind */
+    uint32_t deliver_period_ms; /*!< LVGL timer period delivering the batches */
+} pst_dir_search_cfg_t;
+
+#define PST_DIR_SEARCH_DEFAULT_CONFIG() \
+    {                                   \
+        .task_priority = 2,             \
+        .task_stack = 6144,             \
+        .task_affinity = -1,            \
+        .max_depth = 16,                \
+        .max_results = 500,             \
+        .batch_results = 16,            \
+        .batch_bytes = 2048,            \
+        .flush_ms = 100,                \
+        .queue_len = 4,                 \
+        .deliver_period_ms = 30,        \
+    }
+
+/**
+ * @brief Counters since init; rate and time of the last completed search.
+ */
+typedef struct {
+    uint32_t searches;          /*!< Searches started */
+    uint32_t cancelled;         /*!< Searches abandoned for a newer one, or cancelled */
+    uint32_t dirs;              /*!< Folders searched */
+    uint32_t dirs_cached;       /*!< ... taken from pst_dir_cache */
+    uint32_t dirs_skipped;      /*!< Folders too deep, with too long a path, or unreadable */
+    uint32_t results;           /*!< Matches delivered */
+    uint32_t last_ms;           /*!< Duration of the last completed search */
+    uint32_t last_dirs_per_s;   /*!< Folders per second of the last completed search */
+} pst_dir_search_stats_t;
+
+/**
+ * @brief Create the worker task and the delivery timer.
+ *
+ * @param cfg  Configuration, NULL for PST_DIR_SEARCH_DEFAULT_CONFIG().
+ *
+ * @return
+ *      - ESP_OK                 on success
+ *      - ESP_ERR_INVALID_STATE  if already initialized
+ *      - ESP_ERR_NO_MEM         if the task, queues or timer cannot be created
+ */
+esp_err_t pst_dir_search_init(const pst_dir_search_cfg_t *cfg);
+
+/**
+ * @brief Search a folder tree for names containing `query`, cancelling the search
+ *        in progress.
+ *
+ * @param root   LVGL path of the folder to search, e.g. "S:".
+ * @param query  Text to find, ignoring case.
+ * @param cb     Receives the batches; always gets a last batch unless cancelled.
+ * @param arg    Argument of cb.
+ *
+ * @return
+ *      - the search id (> 0), as found in the batches
+ *      - 0 if not initialized, or the root or the query is too long or empty
+ */
+uint32_t pst_dir_search_start(const char *root, const char *query, pst_dir_search_cb_t cb, void *arg);
+
+/**
+ * @brief Cancel the search in progress; none of its batches is delivered anymore.
+ */
+void pst_dir_search_cancel(void);
+
+/**
+ * @brief true while a search has batches left to deliver.
+ */
+bool pst_dir_search_busy(void);
+
+/**
+ * @brief Full LVGL path of match `i` of a batch.
+ */
+static inline const char *pst_dir_search_batch_path(const pst_dir_search_batch_t *batch, uint32_t i)
+{
+    return batch->paths + batch->entries[i].name;
+}
+
+/**
+ * @brief Copy the current counters.
+ */
+void pst_dir_search_get_stats(pst_dir_search_stats_t *out);
+
+#ifdef __cplusplus
+}
+#endif
@@ -2,28 +2,58 @@
 #include <stdio.h>
 #include <string.h>
 #include <stdlib.h>
+#include "esp_heap_caps.h"
 #include "esp_log.h"
+#include "esp_timer.h"
 #include "esp_bsp.h"
+#include "pst_dir_prefetch.h"
+#include "pst_dir_scan.h"
+#include "pst_dir_search.h"
 #include "pst_file_browser.h"
 #include "pst_keyboard.h"
+#include "pst_name_index.h"
+#include "pst_snapshot.h"
+#include "pst_thumb.h"
+#include "pst_vlist.h"
 
 static const char *TAG = "PST_MODERN_FS";
 
 static lv_obj_t *s_list = NULL;
 static lv_obj_t *s_path_label = NULL;
 static lv_obj_t *s_main_cont = NULL; // Main container to prevent total screen wipe
+static pst_snapshot_t *s_header_snap = NULL; // Header is drawn from a cached bitmap
+static lv_obj_t *s_spinner = NULL; // Shown while the folder is being read
+static lv_obj_t *s_info = NULL; // Empty folder or error message over the list
+static lv_obj_t *s_sort_label = NULL; // Order of the rows, on the sort button
 static char s_current_path[256] = "S:";
 static char s_filter[64] = "";
 static pst_file_selected_cb_t s_file_cb = NULL;
 
-static void refresh_list(void);
+// Every entry of the current folder, in one PSRAM listing whatever their number:
+// only the rows on screen are LVGL objects (pst_vlist). With a filter, the rows
+// show the matching entries (s_match), found by a name index over the folder.
+static pst_dir_listing_t *s_folder = NULL;
+static pst_name_index_t *s_name_index = NULL;  // over s_folder, built by the first filter on it
+static uint32_t *s_match = NULL;               // entries passing the filter, ascending
+static uint32_t s_match_n = 0;
+static uint32_t s_match_cap = 0;
+static char s_filter_folded[PST_NAME_QUERY_MAX];
+static bool s_has_up = false;       // row 0 is ".."
+static pst_dir_sort_t s_sort = PST_DIR_SORT_NAME;
+static bool s_partial = false;      // more pages of the folder to deliver: the last row asks for them
 
-static void btn_delete_event_cb(lv_event_t *e)
-{
-    char *name = lv_obj_get_user_data(lv_event_get_target(e));
-    if (name)
-        lv_mem_free(name);
-}
+#define LOAD_AHEAD_ROWS 20          // the next page is read once a row this close to the end is shown
+
+// Card search: while s_results exists the rows show its matches (full paths),
+// row 0 leads back to the folder
+static pst_dir_listing_t *s_results = NULL;
+static char s_search[64] = "";
+static bool s_header_long_pressed = false;
+
+static void refresh_list(void);
+static void filter_changed(void);
+static void start_search(const char *query);
+static void end_search(void);
 
 static void on_search_finished(const char *text, bool submitted)
 {
@@ -36,11 +66,19 @@ static void on_search_finished(const char *text, bool submitted)
         s_filter[0] = '\0';
     }
 
-    // We do NOT call pst_file_browser_create here anymore.
-    // We just refresh the existing UI that's still in memory.
+    // The folder is in memory already: filtering does not read the card
     if (bsp_display_lock(100))
     {
-        refresh_list();
+        filter_changed();
+        bsp_display_unlock();
+    }
+}
+
+static void on_card_search_finished(const char *text, bool submitted)
+{
+    if (submitted && text && text[0] != '\0' && bsp_display_lock(100))
+    {
+        start_search(text);
         bsp_display_unlock();
     }
 }
@@ -48,62 +86,451 @@ static void on_search_finished(const char *text, bool submitted)
 static void header_click_event_handler(lv_event_t *e)
 {
     static uint32_t last_click = 0;
+
+    if (lv_event_get_code(e) == LV_EVENT_LONG_PRESSED)
+    {
+        // Long press: search the whole card
+        s_header_long_pressed = true;
+        if (pst_keyboard_create("Search the card:", on_card_search_finished))
+            pst_keyboard_set_input(s_search);
+        return;
+    }
+    // The release of a long press clicks too
+    if (s_header_long_pressed)
+    {
+        s_header_long_pressed = false;
+        return;
+    }
     if (lv_tick_get() - last_click < 500)
         return;
     last_click = lv_tick_get();
 
-    pst_keyboard_create("Search files:", on_search_finished);
+    // Showing the card search: a click edits its query
+    if (s_results)
+    {
+        if (pst_keyboard_create("Search the card:", on_card_search_finished))
+            pst_keyboard_set_input(s_search);
+        return;
+    }
+    // Starting from the current filter: a longer one narrows its matches
+    if (pst_keyboard_create("Search files:", on_search_finished))
+        pst_keyboard_set_input(s_filter);
 }
 
-static void list_btn_event_handler(lv_event_t *e)
+static uint32_t shown_count(void)
 {
-    lv_obj_t *btn = lv_event_get_target(e);
-    const char *btn_text = lv_list_get_btn_text(s_list, btn);
-    char *clean_name = lv_obj_get_user_data(btn);
+    return s_filter[0] != '\0' ? s_match_n : s_folder->count;
+}
 
-    // Fixed: 'static' ensures the path survives function exit for the callback
-    static char new_path[512];
+static const char *folder_name(uint32_t id, void *arg)
+{
+    return pst_dir_listing_name(s_folder, id);
+}
+
+// Rows of the folder: "..", the entries shown, "Loading more" while pages are left
+static uint32_t row_count(void)
+{
+    return s_has_up + shown_count() + s_partial;
+}
 
-    if (strcmp(btn_text, LV_SYMBOL_UP " ..") == 0)
+static bool is_more_row(uint32_t index)
+{
+    return !s_results && s_partial && index == s_has_up + shown_count();
+}
+
+// Filtering and sorting need the whole folder: read the pages left in one go
+static void load_rest(void)
+{
+    if (!s_partial)
+        return;
+    s_partial = false;
+    pst_dir_scan_more(true);
+}
+
+// Entry of a row other than "..", with its full path in *path if not NULL
+static const pst_dir_entry_t *row_entry(uint32_t row, const char **label, char *path, size_t path_size)
+{
+    uint32_t i = row - s_has_up;
+
+    if (s_results)
     {
-        s_filter[0] = '\0';
-        char *last_slash = strrchr(s_current_path, '/');
-        if (last_slash != NULL && last_slash > s_current_path + 2)
-            *last_slash = '\0';
+        const char *full = pst_dir_listing_name(s_results, i);
+        *label = strncmp(full, "S:/", 3) == 0 ? full + 3 : full;
+        if (path)
+            snprintf(path, path_size, "%s", full);
+        return &s_results->entries[i];
+    }
+
+    uint32_t id = s_filter[0] != '\0' ? s_match[i] : i;
+    *label = folder_name(id, NULL);
+    if (path)
+        snprintf(path, path_size, "%s/%s", s_current_path, *label);
+    return &s_folder->entries[id];
+}
+
+// Size and FAT date of an entry for the details column
+static void format_details(const pst_dir_entry_t *e, char *out, size_t out_size)
+{
+    char date[24] = "";
+    char size[16] = "";
+
+    if (e->mtime)
+    {
+        uint32_t d = e->mtime >> 16;
+        uint32_t t = e->mtime & 0xFFFF;
+        snprintf(date, sizeof(date), "%04lu-%02lu-%02lu %02lu:%02lu", (unsigned long)(1980 + (d >> 9)),
+                 (unsigned long)((d >> 5) & 0xF), (unsigned long)(d & 0x1F), (unsigned long)(t >> 11),
+                 (unsigned long)((t >> 5) & 0x3F));
+    }
+    if (!e->is_dir)
+    {
+        if (e->size < 1024)
+            snprintf(size, sizeof(size), "%lu B", (unsigned long)e->size);
+        else if (e->size < 1024 * 1024)
+            snprintf(size, sizeof(size), "%lu.%lu KB", (unsigned long)(e->size / 1024),
+                     (unsigned long)(e->size % 1024 * 10 / 1024));
         else
-            strcpy(s_current_path, "S:");
+            snprintf(size, sizeof(size), "%lu.%lu MB", (unsigned long)(e->size >> 20),
+                     (unsigned long)((e->size & 0xFFFFF) * 10 >> 20));
+    }
+    snprintf(out, out_size, "%s%s%s", size, size[0] && date[0] ? "  " : "", date);
+}
+
+static void bind_row(lv_obj_t *row, uint32_t index, void *arg)
+{
+    char details[48];
+
+    if (s_has_up && index == 0)
+    {
+        pst_vlist_row_set(row, s_results ? LV_SYMBOL_LEFT : LV_SYMBOL_UP, s_results ? "Back to the folder" : "..");
+        lv_obj_remove_local_style_prop(row, LV_STYLE_TEXT_COLOR, 0);
+        pst_vlist_row_set_detail(row, NULL);
+        return;
+    }
+    if (is_more_row(index))
+    {
+        pst_vlist_row_set(row, LV_SYMBOL_DOWN, "Loading more...");
+        lv_obj_remove_local_style_prop(row, LV_STYLE_TEXT_COLOR, 0);
+        pst_vlist_row_set_detail(row, NULL);
+        pst_dir_scan_more(false);
+        return;
+    }
+    // Nearing the end of what was read: read the next page before it is reached
+    if (!s_results && s_partial && index + LOAD_AHEAD_ROWS >= row_count())
+        pst_dir_scan_more(false);
+
+    const char *label;
+    char path[PST_DIR_PATH_MAX];
+    const pst_dir_entry_t *e = row_entry(index, &label, path, sizeof(path));
+    bool is_dir = e->is_dir;
+    const void *icon = is_dir ? LV_SYMBOL_DIRECTORY : LV_SYMBOL_FILE;
+    // Images show their thumbnail once the worker has it (on_thumbs_ready)
+    if (!is_dir && pst_thumb_is_image(label))
+    {
+        const lv_img_dsc_t *thumb = pst_thumb_get(path, e->size, e->mtime);
+        if (thumb)
+            icon = thumb;
+    }
+    pst_vlist_row_set(row, icon, label);
+    format_details(e, details, sizeof(details));
+    pst_vlist_row_set_detail(row, details);
+    if (is_dir)
+        lv_obj_set_style_text_color(row, lv_palette_main(LV_PALETTE_AMBER), 0);
+    else
+        lv_obj_remove_local_style_prop(row, LV_STYLE_TEXT_COLOR, 0);
+}
+
+// Thumbnails arrived from the worker: rebind the rows still waiting for theirs
+static void on_thumbs_ready(void *arg)
+{
+    if (s_list)
+        pst_vlist_refresh(s_list);
+}
+
+// "S:/a/b" -> "S:/a", "S:/a" -> "S:"
+static void to_parent(char *path)
+{
+    char *last_slash = strrchr(path, '/');
+    if (last_slash != NULL && last_slash > path + 2)
+        *last_slash = '\0';
+    else
+        strcpy(path, "S:");
+}
+
+// A press on a folder usually ends in a click: its listing is read into the cache
+// meanwhile, so the click finds it in memory
+static void on_row_pressed(uint32_t index, void *arg)
+{
+    char path[PST_DIR_PATH_MAX];
+
+    if ((s_results && index == 0) || is_more_row(index))
+        return;
+    if (s_has_up && index == 0)
+    {
+        snprintf(path, sizeof(path), "%s", s_current_path);
+        to_parent(path);
     }
     else
     {
-        if (!clean_name)
+        const char *label;
+        if (!row_entry(index, &label, path, sizeof(path))->is_dir)
             return;
-        snprintf(new_path, sizeof(new_path), "%s/%s", s_current_path, clean_name);
+    }
+    pst_dir_prefetch(path);
+}
 
-        lv_fs_dir_t dir;
-        if (lv_fs_dir_open(&dir, new_path) == LV_FS_RES_OK)
-        {
-            lv_fs_dir_close(&dir);
-            strncpy(s_current_path, new_path, sizeof(s_current_path) - 1);
-            s_filter[0] = '\0';
-        }
-        else
+static void on_row_clicked(uint32_t index, void *arg)
+{
+    // Fixed: 'static' ensures the path survives function exit for the callback
+    static char new_path[512];
+
+    if (s_results && index == 0)
+    {
+        // Back from the card search to the folder, read meanwhile
+        end_search();
+        filter_changed();
+        return;
+    }
+    if (is_more_row(index))
+    {
+        pst_dir_scan_more(false);
+        return;
+    }
+    if (s_has_up && index == 0)
+    {
+        s_filter[0] = '\0';
+        to_parent(s_current_path);
+    }
+    else
+    {
+        // Directories were marked by the scan, no need to probe the card here
+        const char *label;
+        bool is_dir = row_entry(index, &label, new_path, sizeof(new_path))->is_dir;
+        if (!is_dir)
         {
             if (s_file_cb)
                 s_file_cb(new_path);
             return;
         }
+        strncpy(s_current_path, new_path, sizeof(s_current_path) - 1);
+        s_filter[0] = '\0';
     }
+    // Opening a folder found by the card search ends the search
+    end_search();
     refresh_list();
 }
 
-static void refresh_list(void)
+static bool match_add(uint32_t id)
+{
+    if (s_match_n == s_match_cap)
+    {
+        uint32_t cap = s_match_cap ? s_match_cap * 2 : 256;
+        uint32_t *p = heap_caps_realloc(s_match, cap * sizeof(uint32_t), MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+        if (!p)
+            return false;
+        s_match = p;
+        s_match_cap = cap;
+    }
+    s_match[s_match_n++] = id;
+    return true;
+}
+
+// The folder's entries or their order changed: the name index is out of date
+static void folder_changed(void)
+{
+    pst_name_index_free(s_name_index);
+    s_name_index = NULL;
+}
+
+static void match_by_name(void)
+{
+    s_match_n = 0;
+    for (uint32_t id = 0; id < s_folder->count; id++)
+    {
+        if (pst_name_match(folder_name(id, NULL), s_filter_folded))
+            match_add(id);
+    }
+}
+
+static void apply_filter(void)
+{
+    s_match_n = 0;
+    if (s_filter[0] == '\0')
+        return;
+
+    pst_name_fold(s_filter, s_filter_folded, sizeof(s_filter_folded));
+    if (!s_name_index)
+        s_name_index = pst_name_index_build(s_folder->count, folder_name, NULL);
+    if (s_name_index)
+    {
+        const uint32_t *ids;
+        uint32_t n = pst_name_index_query(s_name_index, s_filter, &ids);
+        for (uint32_t i = 0; i < n && match_add(ids[i]); i++)
+            ;
+    }
+    else
+    {
+        ESP_LOGW(TAG, "No memory for a name index, filtering name by name");
+        match_by_name();
+    }
+}
+
+static void add_entry(const char *name, const pst_dir_entry_t *entry)
+{
+    if (!pst_dir_listing_add(s_folder, name, entry->is_dir, entry->size, entry->mtime))
+        ESP_LOGW(TAG, "Out of memory, folder listed partially");
+}
+
+// Index of the entry whose name is at `name` in the folder's names, which sorting does not move
+static uint32_t find_entry(uint32_t name)
+{
+    for (uint32_t i = 0; i < s_folder->count; i++)
+    {
+        if (s_folder->entries[i].name == name)
+            return i;
+    }
+    return UINT32_MAX;
+}
+
+static void show_info(const char *text)
+{
+    if (text)
+    {
+        lv_label_set_text(s_info, text);
+        lv_obj_clear_flag(s_info, LV_OBJ_FLAG_HIDDEN);
+    }
+    else
+    {
+        lv_obj_add_flag(s_info, LV_OBJ_FLAG_HIDDEN);
+    }
+}
+
+static void show_filter_result(void)
+{
+    show_info(shown_count() == 0 && s_filter[0] != '\0' ? "No files match your search." : NULL);
+}
+
+// The spinner turns while the folder is read or the card searched
+static void update_spinner(void)
+{
+    if ((pst_dir_scan_busy() && !s_partial) || pst_dir_search_busy())
+        lv_obj_clear_flag(s_spinner, LV_OBJ_FLAG_HIDDEN);
+    else
+        lv_obj_add_flag(s_spinner, LV_OBJ_FLAG_HIDDEN);
+}
+
+static void scan_finished(esp_err_t err)
+{
+    update_spinner();
+
+    // The rows show the card search: its batches report
+    if (s_results)
+        return;
+    if (err != ESP_OK)
+        show_info("Cannot open this folder.");
+    else
+        show_filter_result();
+}
+
+// Entries arrive from the scan worker a batch at a time, in the LVGL task
+static void on_scan_batch(const pst_dir_scan_batch_t *batch, void *arg)
 {
     if (!s_list)
         return;
-    lv_obj_clean(s_list);
 
+    // A page ends: the next one is delivered once the last rows come into view
+    s_partial = batch->partial;
+    // A cached folder changed on the card: the batch holds all of it again
+    if (batch->restart)
+    {
+        pst_dir_listing_clear(s_folder);
+        s_match_n = 0;
+    }
+
+    // Scrolled into the folder: the entry at the top of the view stays there while
+    // the batch is merged in
+    uint32_t top = pst_vlist_get_top(s_list);
+    uint32_t anchor = UINT32_MAX;
+    if (!s_results && s_filter[0] == '\0' && !batch->restart && top > 0 && top - s_has_up < s_folder->count)
+        anchor = s_folder->entries[top - s_has_up].name;
+
+    for (uint32_t i = 0; i < batch->count; i++)
+        add_entry(pst_dir_scan_batch_name(batch, i), &batch->entries[i]);
+    bool changed = batch->count || batch->restart;
+    if (changed)
+    {
+        // Entries read from the card come in directory order: each batch is merged
+        // into the rows shown, which are in order already
+        pst_dir_listing_sort(s_folder, s_sort);
+        folder_changed();
+        // The name index is built once the folder is complete
+        if (s_filter[0] != '\0' && !batch->last)
+            match_by_name();
+    }
+    if (batch->last)
+        apply_filter();
+    if (s_results)
+    {
+        // Searching the card: the folder fills in behind the results
+        if (batch->last)
+            scan_finished(batch->err);
+        return;
+    }
+    pst_vlist_set_count(s_list, row_count());
+    if (changed && anchor != UINT32_MAX)
+    {
+        uint32_t now = find_entry(anchor);
+        if (now != UINT32_MAX && now + s_has_up != top)
+            pst_vlist_scroll_to(s_list, now + s_has_up, LV_ANIM_OFF);
+    }
+    if (changed || batch->last || batch->partial)
+        pst_vlist_refresh(s_list);
+    if (batch->last)
+        scan_finished(batch->err);
+    else if (batch->partial)
+        update_spinner();
+}
+
+static const char *const s_sort_names[] = { "Name", "Size", "Date" };
+
+static void sort_click_event_handler(lv_event_t *e)
+{
+    s_sort = (s_sort + 1) % (sizeof(s_sort_names) / sizeof(s_sort_names[0]));
+    lv_label_set_text(s_sort_label, s_sort_names[s_sort]);
+    if (!s_folder)
+        return;
+    if (s_partial)
+    {
+        // Sorted in full once the rest of the folder is read
+        load_rest();
+        update_spinner();
+        pst_vlist_set_count(s_list, row_count());
+        return;
+    }
+
+    // Keys and metadata are in memory: re-sorting reads nothing from the card
+    int64_t t0 = esp_timer_get_time();
+    if (!pst_dir_listing_sort(s_folder, s_sort))
+        ESP_LOGW(TAG, "Out of memory, folder left in its order");
+    ESP_LOGI(TAG, "Sorted %lu entries by %s in %lu us", (unsigned long)s_folder->count, s_sort_names[s_sort],
+             (unsigned long)(esp_timer_get_time() - t0));
+    folder_changed();
+    apply_filter();
+    if (s_results)
+        return;
+    pst_vlist_refresh(s_list);
+    pst_vlist_scroll_to(s_list, 0, LV_ANIM_OFF);
+}
+
+static void update_header(void)
+{
     lv_obj_t *header_obj = lv_obj_get_parent(s_path_label);
-    if (s_filter[0] != '\0')
+    if (s_results)
+    {
+        lv_label_set_text_fmt(s_path_label, "Search: %s", s_search);
+        lv_obj_set_style_bg_color(header_obj, lv_palette_main(LV_PALETTE_DEEP_PURPLE), 0);
+    }
+    else if (s_filter[0] != '\0')
     {
         lv_label_set_text_fmt(s_path_label, "Filter: %s", s_filter);
         lv_obj_set_style_bg_color(header_obj, lv_palette_main(LV_PALETTE_TEAL), 0);
@@ -113,68 +540,198 @@ static void refresh_list(void)
         lv_label_set_text(s_path_label, s_current_path);
         lv_obj_set_style_bg_color(header_obj, lv_palette_main(LV_PALETTE_BLUE_GREY), 0);
     }
+    // Label text changes send no event the snapshot could see
+    pst_snapshot_invalidate(s_header_snap);
+}
 
-    if (strcmp(s_current_path, "S:") != 0)
+static void filter_changed(void)
+{
+    if (!s_list || !s_folder)
+        return;
+
+    int64_t t0 = esp_timer_get_time();
+    update_header();
+    // Matches in the pages not read yet are added as they arrive
+    if (s_filter[0] != '\0' && !s_results)
     {
-        lv_obj_t *btn = lv_list_add_btn(s_list, NULL, LV_SYMBOL_UP " ..");
-        lv_obj_add_event_cb(btn, list_btn_event_handler, LV_EVENT_CLICKED, NULL);
+        load_rest();
+        update_spinner();
     }
+    apply_filter();
+    pst_vlist_set_count(s_list, row_count());
+    pst_vlist_refresh(s_list);
+    pst_vlist_scroll_to(s_list, 0, LV_ANIM_OFF);
+    if (!pst_dir_scan_busy())
+        show_filter_result();
+    ESP_LOGI(TAG, "Filter \"%s\": %lu of %lu entries in %lu us", s_filter, (unsigned long)shown_count(),
+             (unsigned long)s_folder->count, (unsigned long)(esp_timer_get_time() - t0));
+}
 
-    lv_fs_dir_t dir;
-    if (lv_fs_dir_open(&dir, s_current_path) != LV_FS_RES_OK)
+static void end_search(void)
+{
+    if (!s_results)
         return;
+    pst_dir_search_cancel();
+    pst_dir_listing_free(s_results);
+    s_results = NULL;
+    s_has_up = strcmp(s_current_path, "S:") != 0;
+    if (s_spinner)
+        update_spinner();
+}
 
-    char fn[256];
-    uint32_t items_found = 0;
-    while (lv_fs_dir_read(&dir, fn) == LV_FS_RES_OK)
+// Matches arrive from the search worker a batch at a time, in the LVGL task
+static void on_search_batch(const pst_dir_search_batch_t *batch, void *arg)
+{
+    if (!s_list || !s_results)
+        return;
+
+    for (uint32_t i = 0; i < batch->count; i++)
     {
-        if (fn[0] == '\0')
+        const pst_dir_entry_t *e = &batch->entries[i];
+        if (!pst_dir_listing_add(s_results, pst_dir_search_batch_path(batch, i), e->is_dir, e->size, e->mtime))
+        {
+            ESP_LOGW(TAG, "Out of memory, search results cut short");
             break;
-        bool is_dir = (fn[0] == '/');
-        const char *entry_name = is_dir ? &fn[1] : fn;
-
-        if (s_filter[0] != '\0' && strcasestr(entry_name, s_filter) == NULL)
-            continue;
-
-        items_found++;
-        lv_obj_t *btn = lv_list_add_btn(s_list, is_dir ? LV_SYMBOL_DIRECTORY : LV_SYMBOL_FILE, entry_name);
-        char *name_copy = lv_mem_alloc(strlen(entry_name) + 1);
-        if (name_copy)
+        }
+    }
+    pst_vlist_set_count(s_list, 1 + s_results->count);
+    if (!batch->last)
+    {
+        if (s_results->count == 0)
         {
-            strcpy(name_copy, entry_name);
-            lv_obj_set_user_data(btn, name_copy);
-            lv_obj_add_event_cb(btn, btn_delete_event_cb, LV_EVENT_DELETE, NULL);
+            char text[48];
+            snprintf(text, sizeof(text), "Searching... %lu folders", (unsigned long)batch->dirs);
+            show_info(text);
         }
-        if (is_dir)
-            lv_obj_set_style_text_color(btn, lv_palette_main(LV_PALETTE_AMBER), 0);
-        lv_obj_add_event_cb(btn, list_btn_event_handler, LV_EVENT_CLICKED, NULL);
+        else
+        {
+            show_info(NULL);
+        }
+        return;
+    }
+
+    pst_vlist_refresh(s_list);
+    update_spinner();
+    if (batch->err != ESP_OK)
+        show_info("Cannot open this folder.");
+    else
+        show_info(s_results->count == 0 ? "No files found." : NULL);
+    if (batch->truncated)
+    {
+        lv_label_set_text_fmt(s_path_label, "Search: %s (first %lu)", s_search, (unsigned long)s_results->count);
+        pst_snapshot_invalidate(s_header_snap);
+    }
+}
+
+static void start_search(const char *query)
+{
+    if (!s_list)
+        return;
+
+    snprintf(s_search, sizeof(s_search), "%s", query);
+    if (!s_results)
+        s_results = pst_dir_listing_new("");
+    if (!s_results)
+    {
+        show_info("Cannot open this folder.");
+        return;
     }
-    lv_fs_dir_close(&dir);
+    pst_dir_listing_clear(s_results);
+    s_has_up = true;    // row 0 leads back to the folder
+    pst_thumb_drop_pending();
+    update_header();
+    pst_vlist_set_count(s_list, 1);
+    pst_vlist_refresh(s_list);
+    pst_vlist_scroll_to(s_list, 0, LV_ANIM_OFF);
+    show_info(NULL);
+
+    // The whole card is searched in the background, folders already read first
+    if (!pst_dir_search_start("S:", s_search, on_search_batch, NULL))
+        show_info("Cannot open this folder.");
+    update_spinner();
+}
 
-    if (items_found == 0 && s_filter[0] != '\0')
+static void refresh_list(void)
+{
+    if (!s_list)
+        return;
+
+    update_header();
+    if (!s_folder)
+        s_folder = pst_dir_listing_new("");
+    if (!s_folder)
     {
-        lv_obj_t *empty_info = lv_list_add_text(s_list, "No files match your search.");
-        lv_obj_set_style_text_align(empty_info, LV_TEXT_ALIGN_CENTER, 0);
+        show_info("Cannot open this folder.");
+        return;
     }
+    pst_dir_listing_clear(s_folder);
+    folder_changed();
+    s_match_n = 0;
+    if (s_filter[0] != '\0')
+        pst_name_fold(s_filter, s_filter_folded, sizeof(s_filter_folded));
+    s_has_up = strcmp(s_current_path, "S:") != 0;
+    s_partial = false;
+    pst_thumb_drop_pending();
+    pst_vlist_set_count(s_list, s_has_up);
+    pst_vlist_refresh(s_list);
+    pst_vlist_scroll_to(s_list, 0, LV_ANIM_OFF);
+    show_info(NULL);
+
+    // The folder is read by the scan worker; the list fills in as batches arrive
+    pst_dir_prefetch_note_open(s_current_path);
+    if (!pst_dir_scan_start(s_current_path, on_scan_batch, NULL))
+        scan_finished(ESP_FAIL);
+    update_spinner();
+}
+
+static void main_cont_delete_event_cb(lv_event_t *e)
+{
+    // The screen holding the browser was deleted (e.g. evicted by pst_screen).
+    // s_current_path is kept so a rebuilt browser reopens the same folder.
+    pst_dir_scan_cancel();
+    pst_dir_search_cancel();
+    pst_dir_listing_free(s_results);
+    s_results = NULL;
+    s_main_cont = NULL;
+    s_list = NULL;
+    s_path_label = NULL;
+    s_spinner = NULL;
+    s_info = NULL;
+    s_sort_label = NULL;
+    s_header_snap = NULL; // Released with the header
 }
 
 bool pst_file_browser_create(const char *root_path, pst_file_selected_cb_t on_file_cb)
+{
+    if (!bsp_display_lock(100))
+        return false;
+
+    bool ok = pst_file_browser_attach(lv_scr_act(), root_path, on_file_cb);
+    bsp_display_unlock();
+    return ok;
+}
+
+bool pst_file_browser_attach(lv_obj_t *parent, const char *root_path, pst_file_selected_cb_t on_file_cb)
 {
     s_file_cb = on_file_cb;
     if (!bsp_display_lock(100))
         return false;
 
-    lv_obj_t *scr = lv_scr_act();
+    // Moving to another parent: drop the old tree
+    if (s_main_cont != NULL && lv_obj_get_parent(s_main_cont) != parent)
+        lv_obj_del(s_main_cont);
 
     // Create persistent main container if it doesn't exist
     if (s_main_cont == NULL)
     {
-        s_main_cont = lv_obj_create(scr);
+        s_main_cont = lv_obj_create(parent);
+        lv_obj_add_event_cb(s_main_cont, main_cont_delete_event_cb, LV_EVENT_DELETE, NULL);
         lv_obj_set_size(s_main_cont, LV_PCT(100), LV_PCT(100));
         lv_obj_set_style_pad_all(s_main_cont, 0, 0);
         lv_obj_set_style_border_width(s_main_cont, 0, 0);
         lv_obj_set_style_radius(s_main_cont, 0, 0);
     }
+    s_header_snap = NULL; // Released with the old header
     lv_obj_clean(s_main_cont);
 
     lv_obj_t *header = lv_btn_create(s_main_cont);
@@ -183,16 +740,48 @@ bool pst_file_browser_create(const char *root_path, pst_file_selected_cb_t on_fi
     lv_obj_set_style_border_width(header, 0, 0);
     lv_obj_align(header, LV_ALIGN_TOP_MID, 0, 0);
     lv_obj_add_event_cb(header, header_click_event_handler, LV_EVENT_CLICKED, NULL);
+    lv_obj_add_event_cb(header, header_click_event_handler, LV_EVENT_LONG_PRESSED, NULL);
 
     s_path_label = lv_label_create(header);
     lv_obj_align(s_path_label, LV_ALIGN_LEFT_MID, 10, 0);
     lv_obj_set_style_text_color(s_path_label, lv_color_white(), 0);
 
-    s_list = lv_list_create(s_main_cont);
+    // Rows are recycled: a folder of any size costs the same objects
+    pst_vlist_cfg_t list_cfg = PST_VLIST_DEFAULT_CONFIG();
+    list_cfg.bind_cb = bind_row;
+    list_cfg.click_cb = on_row_clicked;
+    list_cfg.press_cb = on_row_pressed;
+    s_list = pst_vlist_create(s_main_cont, &list_cfg);
+    if (!s_list)
+    {
+        bsp_display_unlock();
+        return false;
+    }
+    pst_thumb_set_ready_cb(on_thumbs_ready, NULL);
     lv_obj_set_size(s_list, LV_PCT(95), LV_PCT(82));
     lv_obj_align(s_list, LV_ALIGN_BOTTOM_MID, 0, -5);
     lv_obj_set_style_radius(s_list, 10, 0);
 
+    s_info = lv_label_create(s_list);
+    lv_obj_add_flag(s_info, LV_OBJ_FLAG_HIDDEN | LV_OBJ_FLAG_FLOATING);
+    lv_obj_align(s_info, LV_ALIGN_TOP_MID, 0, 60);
+
+    // Over the header, not in it: the header is a snapshot and the spinner animates
+    s_spinner = lv_spinner_create(s_main_cont, 1000, 60);
+    lv_obj_set_size(s_spinner, 30, 30);
+    lv_obj_align_to(s_spinner, header, LV_ALIGN_RIGHT_MID, -10, 0);
+    lv_obj_add_flag(s_spinner, LV_OBJ_FLAG_HIDDEN | LV_OBJ_FLAG_IGNORE_LAYOUT);
+
+    // Sort order, left of the spinner and over the header like it
+    lv_obj_t *sort_btn = lv_btn_create(s_main_cont);
+    lv_obj_set_size(sort_btn, 64, 32);
+    lv_obj_align_to(sort_btn, header, LV_ALIGN_RIGHT_MID, -50, 0);
+    lv_obj_add_flag(sort_btn, LV_OBJ_FLAG_IGNORE_LAYOUT);
+    lv_obj_add_event_cb(sort_btn, sort_click_event_handler, LV_EVENT_CLICKED, NULL);
+    s_sort_label = lv_label_create(sort_btn);
+    lv_label_set_text(s_sort_label, s_sort_names[s_sort]);
+    lv_obj_center(s_sort_label);
+
     if (root_path && root_path[0] != '\0')
     {
         strncpy(s_current_path, root_path, sizeof(s_current_path) - 1);
@@ -200,6 +789,7 @@ bool pst_file_browser_create(const char *root_path, pst_file_selected_cb_t on_fi
     }
 
     refresh_list();
+    s_header_snap = pst_snapshot_attach(header);
     bsp_display_unlock();
     return true;
 }
\ No newline at end of file
@@ -5,15 +5,32 @@
  *  - Render a scrollable list of files/directories rooted at a base path (e.g. "/sd")
  *  - Keep a persistent Back button/header always visible
  *  - Expose a callback when a file (not directory) is selected, with full path
+ *  - Read folders in the background (pst_dir_scan), filling the list as entries
+ *    arrive, and show any number of entries with a fixed pool of rows (pst_vlist)
+ *  - Show large folders from their first page, reading the next page as the list
+ *    nears its end; filtering or sorting reads the rest first
+ *  - Reopen visited folders at once from pst_dir_cache, and have folders read into
+ *    it as their row is pressed (pst_dir_prefetch), before the click
+ *  - Filter the folder by name from memory (pst_name_index), without reading the
+ *    card again
+ *  - Sort by name (natural order), size or date, directories first, and show
+ *    size and date in a details column, all from the directory read
+ *  - Search the whole card from a long press on the header (pst_dir_search),
+ *    listing the matches as they are found
+ *  - Show image thumbnails as icons (pst_thumb), asked for as rows are bound and
+ *    filled in as they arrive
  *
  * Requirements:
  *  - Display + LVGL must already be initialized via bsp_display_start_with_config()
  *  - SD card should be mounted via bsp_sd_init()
+ *  - pst_dir_cache_init(), pst_dir_scan_init(), pst_dir_search_init(),
+ *    pst_dir_prefetch_init() and pst_thumb_init() called once
  */
 
 #pragma once
 
 #include <stdbool.h>
+#include "lvgl.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -43,6 +60,21 @@ typedef void (*pst_file_selected_cb_t)(const char *full_path);
  */
 bool pst_file_browser_create(const char *root_path, pst_file_selected_cb_t on_file_cb);
 
+/**
+ * @brief Build the PST file browser inside a given parent, e.g. a pst_screen screen.
+ *
+ * Same as pst_file_browser_create() but on `parent` instead of the active screen.
+ * When the parent is deleted the browser releases its widgets and can be attached
+ * again later; the current folder is remembered.
+ *
+ * @param parent         Object (usually a screen) to build the browser in.
+ * @param root_path      Base directory, NULL or "" to keep the current folder.
+ * @param on_file_cb     Callback invoked when a regular file is tapped.
+ *
+ * @return true on success, false if LVGL lock fails.
+ */
+bool pst_file_browser_attach(lv_obj_t *parent, const char *root_path, pst_file_selected_cb_t on_file_cb);
+
 /**
  * @brief Programmatically change root path and refresh browser.
  *
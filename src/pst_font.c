@@ -0,0 +1,374 @@
+#include <lvgl.h>
+#include <stdio.h>
+#include <string.h>
+#include "esp_heap_caps.h"
+#include "esp_timer.h"
+#include "esp_log.h"
+#include "esp_bsp.h"
+#include "pst_font.h"
+
+static const char *TAG = "PST_FONT";
+
+#define FONT_PATH_MAX 64
+#define GLYPH_NONE (-1)
+
+typedef const uint8_t *(*get_bitmap_cb_t)(const lv_font_t *, uint32_t);
+
+typedef struct {
+    lv_font_t *font;            // NULL = free slot
+    get_bitmap_cb_t orig_get_bitmap;
+    char path[FONT_PATH_MAX];
+    uint16_t refs;
+} font_slot_t;
+
+typedef struct {
+    uint8_t *bitmap;            // NULL = free
+    uint32_t letter;
+    uint16_t size;
+    uint8_t font;               // index in s_fonts
+    int16_t next;               // hash chain, or free list
+    int16_t lru_prev;           // towards most recently used
+    int16_t lru_next;           // towards least recently used
+} glyph_t;
+
+static pst_font_cfg_t s_cfg;
+static font_slot_t s_fonts[PST_FONT_MAX_LOADED];
+static glyph_t *s_glyphs = NULL;
+static int16_t *s_buckets = NULL;
+static uint16_t s_bucket_mask;
+static int16_t s_free = GLYPH_NONE;
+static int16_t s_lru_head = GLYPH_NONE;  // most recently used
+static int16_t s_lru_tail = GLYPH_NONE;  // least recently used
+static pst_font_stats_t s_stats;
+
+static inline uint16_t bucket_of(uint8_t font, uint32_t letter)
+{
+    return (uint16_t)((letter * 2654435761u) ^ (font * 40503u)) & s_bucket_mask;
+}
+
+static int font_index(const lv_font_t *font)
+{
+    for (int i = 0; i < PST_FONT_MAX_LOADED; i++)
+    {
+        if (s_fonts[i].font == font)
+            return i;
+    }
+    return -1;
+}
+
+static void lru_unlink(int16_t g)
+{
+    glyph_t *gl = &s_glyphs[g];
+    if (gl->lru_prev != GLYPH_NONE)
+        s_glyphs[gl->lru_prev].lru_next = gl->lru_next;
+    else
+        s_lru_head = gl->lru_next;
+    if (gl->lru_next != GLYPH_NONE)
+        s_glyphs[gl->lru_next].lru_prev = gl->lru_prev;
+    else
+        s_lru_tail = gl->lru_prev;
+}
+
+static void lru_push_head(int16_t g)
+{
+    glyph_t *gl = &s_glyphs[g];
+    gl->lru_prev = GLYPH_NONE;
+    gl->lru_next = s_lru_head;
+    if (s_lru_head != GLYPH_NONE)
+        s_glyphs[s_lru_head].lru_prev = g;
+    s_lru_head = g;
+    if (s_lru_tail == GLYPH_NONE)
+        s_lru_tail = g;
+}
+
+static int16_t lookup(uint8_t font, uint32_t letter)
+{
+    int16_t g = s_buckets[bucket_of(font, letter)];
+    while (g != GLYPH_NONE)
+    {
+        if (s_glyphs[g].letter == letter && s_glyphs[g].font == font)
+            return g;
+        g = s_glyphs[g].next;
+    }
+    return GLYPH_NONE;
+}
+
+static void remove_glyph(int16_t g)
+{
+    glyph_t *gl = &s_glyphs[g];
+    int16_t *link = &s_buckets[bucket_of(gl->font, gl->letter)];
+    while (*link != g)
+        link = &s_glyphs[*link].next;
+    *link = gl->next;
+    lru_unlink(g);
+
+    s_stats.bytes_used -= gl->size;
+    s_stats.glyphs--;
+    heap_caps_free(gl->bitmap);
+    gl->bitmap = NULL;
+    gl->next = s_free;
+    s_free = g;
+}
+
+/**
+ * Size of the buffer lv_font_get_bitmap_fmt_txt() decompresses a glyph into
+ * (3 bpp glyphs are expanded to 4 bpp).
+ */
+static size_t decompressed_size(const lv_font_t *font, uint32_t letter)
+{
+    lv_font_glyph_dsc_t dsc;
+    if (!font->get_glyph_dsc(font, &dsc, letter, 0))
+        return 0;
+
+    size_t px = (size_t)dsc.box_w * dsc.box_h;
+    switch (dsc.bpp)
+    {
+    case 1:
+        return (px + 7) >> 3;
+    case 2:
+        return (px + 3) >> 2;
+    case 3:
+    case 4:
+        return (px + 1) >> 1;
+    default:
+        return px;
+    }
+}
+
+/**
+ * Copy a freshly decompressed bitmap into the cache, evicting the least
+ * recently used glyphs as needed. Returns the cached copy, or NULL.
+ */
+static const uint8_t *insert(uint8_t font, uint32_t letter, const uint8_t *bitmap, size_t size)
+{
+    if (size > s_cfg.budget_bytes || size > UINT16_MAX)
+        return NULL;
+
+    while (s_free == GLYPH_NONE || s_stats.bytes_used + size > s_cfg.budget_bytes)
+    {
+        if (s_lru_tail == GLYPH_NONE)
+            return NULL;
+        remove_glyph(s_lru_tail);
+        s_stats.evictions++;
+    }
+
+    uint8_t *copy = heap_caps_malloc(size, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+    if (!copy)
+        return NULL;
+    memcpy(copy, bitmap, size);
+
+    int16_t g = s_free;
+    glyph_t *gl = &s_glyphs[g];
+    s_free = gl->next;
+
+    gl->bitmap = copy;
+    gl->letter = letter;
+    gl->size = (uint16_t)size;
+    gl->font = font;
+    uint16_t b = bucket_of(font, letter);
+    gl->next = s_buckets[b];
+    s_buckets[b] = g;
+    lru_push_head(g);
+
+    s_stats.bytes_used += size;
+    s_stats.glyphs++;
+    return copy;
+}
+
+// Prewarm decodes are counted apart: they are not lookups made while drawing
+static const uint8_t *get_bitmap(const lv_font_t *font, uint32_t letter, bool prewarm)
+{
+    int idx = font_index(font);
+    if (idx < 0)
+        return NULL;
+
+    int16_t g = lookup((uint8_t)idx, letter);
+    if (g != GLYPH_NONE)
+    {
+        if (!prewarm)
+            s_stats.hits++;
+        if (g != s_lru_head)
+        {
+            lru_unlink(g);
+            lru_push_head(g);
+        }
+        return s_glyphs[g].bitmap;
+    }
+
+    // The decompressed bitmap lives in LVGL's shared buffer until the next call
+    const uint8_t *bitmap = s_fonts[idx].orig_get_bitmap(font, letter);
+    if (!bitmap)
+        return NULL;
+
+    if (prewarm)
+        s_stats.prewarmed++;
+    else
+        s_stats.misses++;
+    const uint8_t *copy = insert((uint8_t)idx, letter, bitmap, decompressed_size(font, letter));
+    return copy ? copy : bitmap;
+}
+
+// Replaces get_glyph_bitmap of compressed fonts loaded here
+static const uint8_t *cached_get_bitmap(const lv_font_t *font, uint32_t letter)
+{
+    return get_bitmap(font, letter, false);
+}
+
+static bool is_compressed(const lv_font_t *font)
+{
+    const lv_font_fmt_txt_dsc_t *fdsc = font->dsc;
+    return fdsc && fdsc->bitmap_format != LV_FONT_FMT_TXT_PLAIN;
+}
+
+esp_err_t pst_font_init(const pst_font_cfg_t *cfg)
+{
+    const pst_font_cfg_t def_cfg = PST_FONT_DEFAULT_CONFIG();
+
+    if (s_glyphs)
+        return ESP_ERR_INVALID_STATE;
+
+    s_cfg = cfg ? *cfg : def_cfg;
+    if (s_cfg.max_glyphs == 0 || s_cfg.max_glyphs > INT16_MAX)
+        s_cfg.max_glyphs = def_cfg.max_glyphs;
+
+    uint32_t buckets = 1;
+    while (buckets < s_cfg.max_glyphs)
+        buckets <<= 1;
+
+    s_glyphs = heap_caps_calloc(s_cfg.max_glyphs, sizeof(glyph_t), MALLOC_CAP_DEFAULT);
+    s_buckets = heap_caps_malloc(buckets * sizeof(int16_t), MALLOC_CAP_DEFAULT);
+    if (!s_glyphs || !s_buckets)
+    {
+        ESP_LOGE(TAG, "Init failed, no memory");
+        heap_caps_free(s_glyphs);
+        heap_caps_free(s_buckets);
+        s_glyphs = NULL;
+        s_buckets = NULL;
+        return ESP_ERR_NO_MEM;
+    }
+
+    s_bucket_mask = (uint16_t)(buckets - 1);
+    for (uint32_t i = 0; i < buckets; i++)
+        s_buckets[i] = GLYPH_NONE;
+    for (uint16_t i = 0; i < s_cfg.max_glyphs; i++)
+        s_glyphs[i].next = (i + 1 < s_cfg.max_glyphs) ? (int16_t)(i + 1) : GLYPH_NONE;
+    s_free = 0;
+
+    memset(&s_stats, 0, sizeof(s_stats));
+    ESP_LOGI(TAG, "Glyph cache: %u KB PSRAM budget, %u glyphs",
+             (unsigned)(s_cfg.budget_bytes / 1024), s_cfg.max_glyphs);
+    return ESP_OK;
+}
+
+lv_font_t *pst_font_load(const char *name)
+{
+    char path[FONT_PATH_MAX];
+    lv_font_t *font = NULL;
+
+    if (!s_glyphs || !name)
+        return NULL;
+
+    // "X:..." is already an LVGL path, anything else lives in PST_FONT_DIR
+    if (name[0] != '\0' && name[1] == ':')
+        snprintf(path, sizeof(path), "%s", name);
+    else
+        snprintf(path, sizeof(path), "%s/%s", PST_FONT_DIR, name);
+
+    if (!bsp_display_lock(0))
+        return NULL;
+
+    int free_idx = -1;
+    for (int i = 0; i < PST_FONT_MAX_LOADED; i++)
+    {
+        if (s_fonts[i].font && strcmp(s_fonts[i].path, path) == 0)
+        {
+            s_fonts[i].refs++;
+            font = s_fonts[i].font;
+            goto out;
+        }
+        if (!s_fonts[i].font && free_idx < 0)
+            free_idx = i;
+    }
+
+    if (free_idx < 0)
+    {
+        ESP_LOGE(TAG, "Too many fonts loaded, cannot load %s", path);
+        goto out;
+    }
+
+    int64_t t0 = esp_timer_get_time();
+    font = lv_font_load(path);
+    if (!font)
+    {
+        ESP_LOGE(TAG, "Cannot load %s", path);
+        goto out;
+    }
+
+    font_slot_t *slot = &s_fonts[free_idx];
+    slot->font = font;
+    slot->refs = 1;
+    snprintf(slot->path, sizeof(slot->path), "%s", path);
+    s_stats.fonts_loaded++;
+
+    if (is_compressed(font))
+    {
+        slot->orig_get_bitmap = font->get_glyph_bitmap;
+        font->get_glyph_bitmap = cached_get_bitmap;
+
+        if (s_cfg.prewarm_ascii)
+        {
+            for (uint32_t c = 0x20; c <= 0x7E; c++)
+                get_bitmap(font, c, true);
+        }
+    }
+
+    ESP_LOGI(TAG, "Loaded %s (line height %d, %s) in %d ms", path, font->line_height,
+             slot->orig_get_bitmap ? "compressed, cached" : "plain",
+             (int)((esp_timer_get_time() - t0) / 1000));
+
+out:
+    bsp_display_unlock();
+    return font;
+}
+
+void pst_font_unload(lv_font_t *font)
+{
+    if (!font || !bsp_display_lock(0))
+        return;
+
+    int idx = font_index(font);
+    if (idx >= 0 && --s_fonts[idx].refs == 0)
+    {
+        for (uint16_t g = 0; g < s_cfg.max_glyphs; g++)
+        {
+            if (s_glyphs[g].bitmap && s_glyphs[g].font == idx)
+                remove_glyph((int16_t)g);
+        }
+        ESP_LOGI(TAG, "Unloaded %s", s_fonts[idx].path);
+        lv_font_free(font);
+        memset(&s_fonts[idx], 0, sizeof(s_fonts[idx]));
+        s_stats.fonts_loaded--;
+    }
+
+    bsp_display_unlock();
+}
+
+void pst_font_get_stats(pst_font_stats_t *out)
+{
+    bsp_display_lock(0);
+    *out = s_stats;
+    bsp_display_unlock();
+
+    uint32_t lookups = out->hits + out->misses;
+    out->hit_rate_pct = lookups ? (uint32_t)((uint64_t)out->hits * 100 / lookups) : 0;
+}
+
+void pst_font_reset_stats(void)
+{
+    bsp_display_lock(0);
+    s_stats.hits = 0;
+    s_stats.misses = 0;
+    s_stats.evictions = 0;
+    s_stats.prewarmed = 0;
+    bsp_display_unlock();
+}
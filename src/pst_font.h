@@ -0,0 +1,115 @@
+/**
+ * SD-loaded LVGL binary fonts with a PSRAM glyph cache for PST.
+ *
+ * Responsibilities:
+ *  - Load LVGL binary fonts (lv_font_conv --format bin) from PST_FONT_DIR on the SD card,
+ *    once per name, with reference counting
+ *  - Keep decompressed glyph bitmaps of compressed fonts in a byte-budgeted PSRAM
+ *    cache with LRU eviction, so a glyph is decompressed once, not on every draw
+ *  - Prewarm the printable ASCII range when a font is loaded
+ *  - Report cache hits, misses and evictions, prewarm decodes apart from the misses
+ *
+ * The whole font file is read into RAM by lv_font_load() (large blocks land in
+ * PSRAM through malloc), so rendering never reads the SD card per glyph.
+ * Plain (uncompressed) fonts are drawn straight from that copy and bypass the cache.
+ *
+ * Requirements:
+ *  - Display + LVGL must already be initialized via bsp_display_start_with_config()
+ *  - SD card mounted via bsp_sd_init() before pst_font_load()
+ *  - Long file names need CONFIG_FATFS_LFN_HEAP (on in sdkconfig.defaults), e.g. "S:/fonts/Mono 24.bin"
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "esp_err.h"
+#include "lvgl.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Directory font names are resolved against.
+ */
+#define PST_FONT_DIR "S:/fonts"
+
+/**
+ * @brief Maximum number of fonts loaded at the same time.
+ */
+#define PST_FONT_MAX_LOADED 8
+
+/**
+ * @brief Glyph cache configuration.
+ */
+typedef struct {
+    size_t budget_bytes;    /*!< PSRAM bytes available for decompressed glyph bitmaps */
+    uint16_t max_glyphs;    /*!< Maximum number of cached glyphs */
+    bool prewarm_ascii;     /*!< Decompress U+0020..U+007E when a compressed font is loaded */
+} pst_font_cfg_t;
+
+#define PST_FONT_DEFAULT_CONFIG()           \
+    {                                       \
+        .budget_bytes = 256 * 1024,         \
+        .max_glyphs = 1024,                 \
+        .prewarm_ascii = true,              \
+    }
+
+/**
+ * @brief Glyph cache counters since init (or the last pst_font_reset_stats()).
+ */
+typedef struct {
+    uint32_t hits;              /*!< Bitmaps served from the cache */
+    uint32_t misses;            /*!< Bitmaps decompressed while drawing */
+    uint32_t prewarmed;         /*!< Bitmaps decompressed at load (prewarm_ascii), not in the hit rate */
+    uint32_t evictions;         /*!< Glyphs dropped to make room */
+    uint32_t hit_rate_pct;      /*!< hits * 100 / (hits + misses) */
+    size_t bytes_used;          /*!< Bitmap bytes currently held */
+    uint16_t glyphs;            /*!< Glyphs currently held */
+    uint8_t fonts_loaded;       /*!< Fonts currently loaded */
+} pst_font_stats_t;
+
+/**
+ * @brief Allocate the glyph cache.
+ *
+ * @param cfg  Configuration, NULL for PST_FONT_DEFAULT_CONFIG().
+ *
+ * @return
+ *      - ESP_OK                 on success
+ *      - ESP_ERR_INVALID_STATE  if already initialized
+ *      - ESP_ERR_NO_MEM         if memory allocation fails
+ */
+esp_err_t pst_font_init(const pst_font_cfg_t *cfg);
+
+/**
+ * @brief Load a binary font, or take another reference on it if it is already loaded.
+ *
+ * @param name  File name inside PST_FONT_DIR (e.g. "MONO24.BIN"), or a full
+ *              LVGL path with drive letter (e.g. "S:/ui/BIG.BIN").
+ *
+ * @return The font, or NULL if it cannot be loaded. Release it with pst_font_unload().
+ */
+lv_font_t *pst_font_load(const char *name);
+
+/**
+ * @brief Drop a reference; the font and its cached glyphs are freed with the last one.
+ *
+ * No widget may still use the font when the last reference is dropped.
+ */
+void pst_font_unload(lv_font_t *font);
+
+/**
+ * @brief Copy the current counters.
+ */
+void pst_font_get_stats(pst_font_stats_t *out);
+
+/**
+ * @brief Clear hit/miss/eviction counters (occupancy is kept).
+ */
+void pst_font_reset_stats(void);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,274 @@
+#include <stdio.h>
+#include <string.h>
+#include "esp_heap_caps.h"
+#include "esp_log.h"
+#include "ff.h"
+#include "lvgl.h"
+#include "esp_bsp.h"
+#include "pst_fs.h"
+
+static const char *TAG = "PST_FS";
+
+#define PATH_MAX_LEN 256
+
+typedef struct {
+    FIL fil;
+    pst_fs_cache_file_t cache;
+    uint32_t pos;
+} fs_file_t;
+
+static lv_fs_drv_t s_drv;
+static pst_fs_cache_t *s_cache = NULL;
+static pst_fs_stats_t s_stats;
+
+// "/music" (LVGL path past the letter) -> "0:/music"
+static bool to_fatfs_path(const char *path, char *out, size_t len)
+{
+    const char *drive = bsp_sd_get_fatfs_drive();
+
+    if (!drive)
+        return false;
+    return snprintf(out, len, "%s%s%s", drive, path[0] == '/' ? "" : "/", path) < (int)len;
+}
+
+bool pst_fs_to_fatfs_path(const char *path, char *out, size_t len)
+{
+    if (path[0] != PST_FS_LETTER || path[1] != ':')
+        return false;
+    return to_fatfs_path(path + 2, out, len);
+}
+
+// Cache key of a path, however LVGL hands it over: "/fonts/a.bin" -> "fonts/a.bin"
+static const char *cache_path(const char *path)
+{
+    while (*path == '/' || *path == '\\')
+        path++;
+    return path;
+}
+
+static lv_fs_res_t to_lv_res(FRESULT res)
+{
+    switch (res)
+    {
+    case FR_OK:
+        return LV_FS_RES_OK;
+    case FR_NO_FILE:
+    case FR_NO_PATH:
+        return LV_FS_RES_NOT_EX;
+    case FR_DENIED:
+    case FR_WRITE_PROTECTED:
+        return LV_FS_RES_DENIED;
+    case FR_LOCKED:
+        return LV_FS_RES_LOCKED;
+    case FR_NOT_ENOUGH_CORE:
+        return LV_FS_RES_OUT_OF_MEM;
+    case FR_DISK_ERR:
+    case FR_NOT_READY:
+        return LV_FS_RES_HW_ERR;
+    default:
+        return LV_FS_RES_FS_ERR;
+    }
+}
+
+static bool card_read_cb(void *io, uint32_t pos, void *buf, uint32_t len, uint32_t *got)
+{
+    fs_file_t *f = io;
+    UINT br;
+
+    if (f_tell(&f->fil) != pos && f_lseek(&f->fil, pos) != FR_OK)
+        return false;
+    if (f_read(&f->fil, buf, len, &br) != FR_OK)
+        return false;
+    *got = br;
+    return true;
+}
+
+static void *fs_open(lv_fs_drv_t *drv, const char *path, lv_fs_mode_t mode)
+{
+    char fn[PATH_MAX_LEN];
+    BYTE flags = 0;
+
+    if (mode & LV_FS_MODE_RD)
+        flags |= FA_READ;
+    if (mode & LV_FS_MODE_WR)
+        flags |= FA_WRITE | FA_OPEN_ALWAYS;
+
+    // FIL holds a sector buffer
+    fs_file_t *f = heap_caps_malloc(sizeof(fs_file_t), MALLOC_CAP_DEFAULT);
+    FRESULT res = FR_NOT_READY;
+    if (!f || !to_fatfs_path(path, fn, sizeof(fn)) || (res = f_open(&f->fil, fn, flags)) != FR_OK)
+    {
+        ESP_LOGD(TAG, "Cannot open %s (%d)", path, res);
+        s_stats.open_failed++;
+        heap_caps_free(f);
+        return NULL;
+    }
+    FSIZE_t size = f_size(&f->fil);
+    pst_fs_cache_open(&f->cache, cache_path(path), size > UINT32_MAX ? UINT32_MAX : (uint32_t)size, f);
+    f->pos = 0;
+    s_stats.opens++;
+    return f;
+}
+
+static lv_fs_res_t fs_close(lv_fs_drv_t *drv, void *file_p)
+{
+    fs_file_t *f = file_p;
+
+    FRESULT res = f_close(&f->fil);
+    heap_caps_free(f);
+    return to_lv_res(res);
+}
+
+static lv_fs_res_t fs_read(lv_fs_drv_t *drv, void *file_p, void *buf, uint32_t btr, uint32_t *br)
+{
+    fs_file_t *f = file_p;
+
+    if (!pst_fs_cache_read(s_cache, &f->cache, f->pos, buf, btr, br))
+        return LV_FS_RES_HW_ERR;
+    f->pos += *br;
+    return LV_FS_RES_OK;
+}
+
+static lv_fs_res_t fs_write(lv_fs_drv_t *drv, void *file_p, const void *buf, uint32_t btw, uint32_t *bw)
+{
+    fs_file_t *f = file_p;
+    UINT put = 0;
+
+    *bw = 0;
+    FRESULT res = f_lseek(&f->fil, f->pos);
+    if (res == FR_OK)
+        res = f_write(&f->fil, buf, btw, &put);
+    if (put)
+    {
+        FSIZE_t size = f_size(&f->fil);
+        pst_fs_cache_wrote(s_cache, &f->cache, f->pos, buf, put, size > UINT32_MAX ? UINT32_MAX : (uint32_t)size);
+    }
+    f->pos += put;
+    *bw = put;
+    return to_lv_res(res);
+}
+
+// Reads seek the card themselves: only the position is kept here
+static lv_fs_res_t fs_seek(lv_fs_drv_t *drv, void *file_p, uint32_t pos, lv_fs_whence_t whence)
+{
+    fs_file_t *f = file_p;
+
+    switch (whence)
+    {
+    case LV_FS_SEEK_SET:
+        f->pos = pos;
+        break;
+    case LV_FS_SEEK_CUR:
+        f->pos += pos;
+        break;
+    case LV_FS_SEEK_END:
+        f->pos = f->cache.size + pos;
+        break;
+    default:
+        return LV_FS_RES_INV_PARAM;
+    }
+    return LV_FS_RES_OK;
+}
+
+static lv_fs_res_t fs_tell(lv_fs_drv_t *drv, void *file_p, uint32_t *pos_p)
+{
+    *pos_p = ((fs_file_t *)file_p)->pos;
+    return LV_FS_RES_OK;
+}
+
+static void *fs_dir_open(lv_fs_drv_t *drv, const char *path)
+{
+    char fn[PATH_MAX_LEN];
+
+    FF_DIR *dir = heap_caps_malloc(sizeof(FF_DIR), MALLOC_CAP_DEFAULT);
+    if (!dir || !to_fatfs_path(path, fn, sizeof(fn)) || f_opendir(dir, fn) != FR_OK)
+    {
+        heap_caps_free(dir);
+        return NULL;
+    }
+    return dir;
+}
+
+static lv_fs_res_t fs_dir_read(lv_fs_drv_t *drv, void *dir_p, char *fn)
+{
+    FILINFO fi;
+
+    FRESULT res = f_readdir(dir_p, &fi);
+    if (res != FR_OK)
+        return to_lv_res(res);
+    // "" once done; the caller's buffer is as long as a FatFs name
+    if (fi.fname[0] && (fi.fattrib & AM_DIR))
+        snprintf(fn, sizeof(fi.fname), "/%s", fi.fname);
+    else
+        strcpy(fn, fi.fname);
+    return LV_FS_RES_OK;
+}
+
+static lv_fs_res_t fs_dir_close(lv_fs_drv_t *drv, void *dir_p)
+{
+    FRESULT res = f_closedir(dir_p);
+    heap_caps_free(dir_p);
+    return to_lv_res(res);
+}
+
+esp_err_t pst_fs_init(const pst_fs_cfg_t *cfg)
+{
+    const pst_fs_cfg_t def_cfg = PST_FS_DEFAULT_CONFIG();
+    const pst_fs_cfg_t *c = cfg ? cfg : &def_cfg;
+
+    if (s_cache)
+        return ESP_ERR_INVALID_STATE;
+    if (!c->cache.block_size || c->cache.block_size % 512)
+        return ESP_ERR_INVALID_ARG;
+
+    memset(&s_stats, 0, sizeof(s_stats));
+    s_cache = pst_fs_cache_new(&c->cache, card_read_cb);
+    if (!s_cache)
+        return ESP_ERR_NO_MEM;
+
+    if (!bsp_display_lock(0))
+    {
+        pst_fs_cache_free(s_cache);
+        s_cache = NULL;
+        return ESP_ERR_TIMEOUT;
+    }
+    lv_fs_drv_init(&s_drv);
+    s_drv.letter = PST_FS_LETTER;
+    s_drv.cache_size = 0;       // reads are cached below, in blocks
+    s_drv.open_cb = fs_open;
+    s_drv.close_cb = fs_close;
+    s_drv.read_cb = fs_read;
+    s_drv.write_cb = fs_write;
+    s_drv.seek_cb = fs_seek;
+    s_drv.tell_cb = fs_tell;
+    s_drv.dir_open_cb = fs_dir_open;
+    s_drv.dir_read_cb = fs_dir_read;
+    s_drv.dir_close_cb = fs_dir_close;
+    lv_fs_drv_register(&s_drv);
+    bsp_display_unlock();
+
+    ESP_LOGI(TAG, "Drive %c: with a %lu KB block cache (%lu-byte blocks, read-ahead up to %u)", PST_FS_LETTER,
+             (unsigned long)(c->cache.budget_bytes / 1024), (unsigned long)c->cache.block_size,
+             c->cache.readahead_max);
+    return ESP_OK;
+}
+
+void pst_fs_invalidate(const char *path)
+{
+    if (!s_cache)
+        return;
+    bsp_display_lock(0);
+    if (path && path[0] == PST_FS_LETTER && path[1] == ':')
+        path = cache_path(path + 2);
+    pst_fs_cache_invalidate(s_cache, path);
+    bsp_display_unlock();
+}
+
+void pst_fs_get_stats(pst_fs_stats_t *out)
+{
+    bsp_display_lock(0);
+    *out = s_stats;
+    if (s_cache)
+        pst_fs_cache_get_stats(s_cache, &out->cache);
+    bsp_display_unlock();
+}
@@ -0,0 +1,94 @@
+/**
+ * SD card drive for LVGL with a block cache, for PST.
+ *
+ * Responsibilities:
+ *  - Register the LVGL drive PST_FS_LETTER ("S:/fonts/a.bin") on the FatFs volume
+ *    of the card, in place of LVGL's POSIX driver
+ *  - Read files through a block cache in PSRAM (pst_fs_cache): sector-aligned
+ *    blocks, read-ahead on sequential reads, large reads straight to the card
+ *  - Write through to the card, keeping cached blocks current
+ *  - List folders for lv_fs_dir_read() ("/" before folder names, as LVGL's drivers do)
+ *  - Count hits, misses and read-ahead blocks dropped unused
+ *
+ * Image decoders, fonts (lv_font_load) and anything else going through lv_fs
+ * read in small pieces: from the cache, each piece no longer waits for the card.
+ *
+ * Requirements:
+ *  - Display + LVGL must already be initialized via bsp_display_start_with_config()
+ *  - SD card mounted via bsp_sd_init() before files are opened
+ *  - lv_fs calls on the drive made with the LVGL lock held, as for any LVGL call
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "esp_err.h"
+#include "pst_fs_cache.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define PST_FS_LETTER 'S'           /*!< LVGL drive letter of the SD card */
+
+/**
+ * @brief Drive configuration.
+ */
+typedef struct {
+    pst_fs_cache_cfg_t cache;
+} pst_fs_cfg_t;
+
+#define PST_FS_DEFAULT_CONFIG()                     \
+    {                                               \
+        .cache = PST_FS_CACHE_DEFAULT_CONFIG(),     \
+    }
+
+/**
+ * @brief Counters since init.
+ */
+typedef struct {
+    pst_fs_cache_stats_t cache;
+    uint32_t opens;             /*!< Files opened */
+    uint32_t open_failed;       /*!< Opens that failed (missing file, no card, ...) */
+} pst_fs_stats_t;
+
+/**
+ * @brief Create the cache and register the drive with LVGL.
+ *
+ * @param cfg  Configuration, NULL for PST_FS_DEFAULT_CONFIG().
+ *
+ * @return
+ *      - ESP_OK                 on success
+ *      - ESP_ERR_INVALID_STATE  if already initialized
+ *      - ESP_ERR_INVALID_ARG    if the block size is not a multiple of 512
+ *      - ESP_ERR_NO_MEM         if the cache cannot be allocated
+ *      - ESP_ERR_TIMEOUT        if the LVGL lock could not be taken
+ */
+esp_err_t pst_fs_init(const pst_fs_cfg_t *cfg);
+
+/**
+ * @brief Drop the cached blocks of a file (e.g. rewritten through FatFs), or all if `path` is NULL.
+ *
+ * @param path  LVGL path, e.g. "S:/fonts/a.bin".
+ */
+void pst_fs_invalidate(const char *path);
+
+/**
+ * @brief FatFs path of an LVGL path on the card: "S:/music" -> "0:/music", "S:" -> "0:/".
+ *
+ * For code reading the card through FatFs directly, e.g. from a worker task.
+ *
+ * @return false if the path is not on PST_FS_LETTER, the card is not mounted or `out` is too short.
+ */
+bool pst_fs_to_fatfs_path(const char *path, char *out, size_t len);
+
+/**
+ * @brief Copy the current counters.
+ */
+void pst_fs_get_stats(pst_fs_stats_t *out);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,327 @@
+#include <stdlib.h>
+#include <string.h>
+#include "pst_fs_cache.h"
+
+#ifdef ESP_PLATFORM
+#include "esp_heap_caps.h"
+#define CACHE_MALLOC(size) heap_caps_malloc((size), MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT)
+#define CACHE_CALLOC(n, size) heap_caps_calloc((n), (size), MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT)
+#define CACHE_MALLOC_DMA(size) heap_caps_malloc((size), MALLOC_CAP_DMA | MALLOC_CAP_INTERNAL)
+#define CACHE_FREE(p) heap_caps_free(p)
+#else
+#define CACHE_MALLOC(size) malloc(size)
+#define CACHE_CALLOC(n, size) calloc((n), (size))
+#define CACHE_MALLOC_DMA(size) malloc(size)
+#define CACHE_FREE(p) free(p)
+#endif
+
+#define SECTOR_SIZE 512
+#define MIN(a, b) ((a) < (b) ? (a) : (b))
+
+typedef struct {
+    uint64_t key;
+    uint64_t path_key;
+    uint32_t no;                // block number in the file
+    uint32_t len;               // bytes held, less than the block size only at the end of the file
+    uint32_t last_use;
+    bool used;
+    bool ahead;                 // read ahead and not read since
+} block_t;
+
+struct pst_fs_cache {
+    pst_fs_cache_cfg_t cfg;
+    pst_fs_cache_read_cb_t read_cb;
+    uint32_t count;             // blocks
+    block_t *blocks;
+    uint8_t *data;              // count blocks, back to back
+    uint8_t *scratch;           // readahead_max + 1 blocks; the card reads into it, so internal RAM
+    uint32_t tick;
+    pst_fs_cache_stats_t stats;
+};
+
+static uint64_t fnv(uint64_t h, const void *p, size_t len)
+{
+    for (size_t i = 0; i < len; i++)
+        h = (h ^ ((const uint8_t *)p)[i]) * 0x100000001b3ull;
+    return h;
+}
+
+static uint64_t path_key(const char *path)
+{
+    return fnv(0xcbf29ce484222325ull, path, strlen(path));
+}
+
+static uint64_t file_key(uint64_t path_key, uint32_t size)
+{
+    return fnv(path_key, &size, sizeof(size));
+}
+
+static uint8_t *block_data(pst_fs_cache_t *c, const block_t *b)
+{
+    return c->data + (size_t)(b - c->blocks) * c->cfg.block_size;
+}
+
+static block_t *find(pst_fs_cache_t *c, uint64_t key, uint32_t no)
+{
+    for (uint32_t i = 0; i < c->count; i++)
+    {
+        block_t *b = &c->blocks[i];
+        if (b->used && b->no == no && b->key == key)
+            return b;
+    }
+    return NULL;
+}
+
+static void drop(pst_fs_cache_t *c, block_t *b)
+{
+    if (b->ahead)
+        c->stats.readahead_wasted++;
+    b->used = false;
+    b->ahead = false;
+}
+
+// A free block, else the least recently used one
+static block_t *take(pst_fs_cache_t *c)
+{
+    block_t *lru = NULL;
+
+    for (uint32_t i = 0; i < c->count; i++)
+    {
+        block_t *b = &c->blocks[i];
+        if (!b->used)
+            return b;
+        if (!lru || b->last_use < lru->last_use)
+            lru = b;
+    }
+    c->stats.evictions++;
+    drop(c, lru);
+    return lru;
+}
+
+static bool card_read(pst_fs_cache_t *c, pst_fs_cache_file_t *f, uint32_t pos, void *buf, uint32_t len, uint32_t *got)
+{
+    c->stats.card_reads++;
+    if (!c->read_cb(f->io, pos, buf, len, got))
+        return false;
+    c->stats.card_bytes += *got;
+    return true;
+}
+
+// Read block `no` and up to count - 1 following ones in one card read; the
+// first `needed` are asked for, the others read ahead. *out is NULL past the end.
+static bool fill(pst_fs_cache_t *c, pst_fs_cache_file_t *f, uint32_t no, uint32_t count, uint32_t needed,
+                 block_t **out)
+{
+    uint32_t bs = c->cfg.block_size;
+    uint32_t got;
+
+    *out = NULL;
+    count = MIN(count, (uint32_t)c->cfg.readahead_max + 1);
+    count = MIN(count, (f->size + bs - 1) / bs - no);
+    // Stop at a block already held
+    for (uint32_t i = 1; i < count; i++)
+    {
+        if (find(c, f->key, no + i))
+        {
+            count = i;
+            break;
+        }
+    }
+    if (!card_read(c, f, no * bs, c->scratch, MIN(count * bs, f->size - no * bs), &got))
+        return false;
+
+    for (uint32_t i = 0; i * bs < got; i++)
+    {
+        block_t *b = take(c);
+        b->key = f->key;
+        b->path_key = f->path_key;
+        b->no = no + i;
+        b->len = MIN(bs, got - i * bs);
+        b->last_use = ++c->tick;
+        b->used = true;
+        b->ahead = i >= needed;
+        memcpy(block_data(c, b), c->scratch + i * bs, b->len);
+        if (b->ahead)
+            c->stats.readahead++;
+        else
+            c->stats.misses++;
+        if (!*out)
+            *out = b;
+    }
+    return true;
+}
+
+pst_fs_cache_t *pst_fs_cache_new(const pst_fs_cache_cfg_t *cfg, pst_fs_cache_read_cb_t read_cb)
+{
+    const pst_fs_cache_cfg_t def_cfg = PST_FS_CACHE_DEFAULT_CONFIG();
+
+    pst_fs_cache_t *c = CACHE_CALLOC(1, sizeof(*c));
+    if (!c)
+        return NULL;
+    c->cfg = cfg ? *cfg : def_cfg;
+    c->read_cb = read_cb;
+    if (!c->cfg.block_size || c->cfg.block_size % SECTOR_SIZE)
+    {
+        CACHE_FREE(c);
+        return NULL;
+    }
+    // At least two blocks, and a read-ahead that fits
+    c->count = c->cfg.budget_bytes / c->cfg.block_size;
+    if (c->count < 2)
+        c->count = 2;
+    if (c->cfg.readahead_max >= c->count)
+        c->cfg.readahead_max = c->count - 1;
+
+    c->blocks = CACHE_CALLOC(c->count, sizeof(block_t));
+    c->data = CACHE_MALLOC((size_t)c->count * c->cfg.block_size);
+    c->scratch = CACHE_MALLOC_DMA(((size_t)c->cfg.readahead_max + 1) * c->cfg.block_size);
+    if (!c->blocks || !c->data || !c->scratch)
+    {
+        pst_fs_cache_free(c);
+        return NULL;
+    }
+    return c;
+}
+
+void pst_fs_cache_free(pst_fs_cache_t *c)
+{
+    if (!c)
+        return;
+    CACHE_FREE(c->blocks);
+    CACHE_FREE(c->data);
+    CACHE_FREE(c->scratch);
+    CACHE_FREE(c);
+}
+
+void pst_fs_cache_open(pst_fs_cache_file_t *f, const char *path, uint32_t size, void *io)
+{
+    f->path_key = path_key(path);
+    f->key = file_key(f->path_key, size);
+    f->size = size;
+    f->next = 0;
+    f->window = 0;
+    f->io = io;
+}
+
+bool pst_fs_cache_read(pst_fs_cache_t *c, pst_fs_cache_file_t *f, uint32_t pos, void *buf, uint32_t len,
+                       uint32_t *got)
+{
+    uint32_t bs = c->cfg.block_size;
+    uint8_t *out = buf;
+    bool ok = true;
+
+    *got = 0;
+    c->stats.reads++;
+    if (pos >= f->size || !len)
+    {
+        f->next = pos;
+        return true;
+    }
+    len = MIN(len, f->size - pos);
+
+    // Sequential reads widen the read-ahead, a seek closes it
+    if (pos == f->next)
+        f->window = f->window ? MIN(f->window * 2, c->cfg.readahead_max) : MIN(1, c->cfg.readahead_max);
+    else
+        f->window = 0;
+
+    // As large as a full read-ahead: the cache would only copy it
+    if (len > ((uint32_t)c->cfg.readahead_max + 1) * bs)
+    {
+        c->stats.bypassed++;
+        ok = card_read(c, f, pos, buf, len, got);
+        c->stats.bytes += *got;
+        f->next = pos + *got;
+        return ok;
+    }
+
+    uint32_t filled_to = 0;     // blocks below were read by this call
+    while (len)
+    {
+        uint32_t no = pos / bs;
+        uint32_t off = pos % bs;
+        block_t *b = find(c, f->key, no);
+        if (b)
+        {
+            if (no >= filled_to)
+                c->stats.hits++;
+            b->ahead = false;
+        }
+        else
+        {
+            uint32_t needed = (off + len + bs - 1) / bs;
+            ok = fill(c, f, no, needed + f->window, needed, &b);
+            if (!ok || !b)
+                break;
+            filled_to = no + needed;
+        }
+        b->last_use = ++c->tick;
+        // The file is shorter than when it was opened
+        if (off >= b->len)
+            break;
+        uint32_t n = MIN(b->len - off, len);
+        memcpy(out, block_data(c, b) + off, n);
+        out += n;
+        pos += n;
+        len -= n;
+        *got += n;
+    }
+    c->stats.bytes += *got;
+    f->next = pos;
+    return ok;
+}
+
+void pst_fs_cache_wrote(pst_fs_cache_t *c, pst_fs_cache_file_t *f, uint32_t pos, const void *buf, uint32_t len,
+                        uint32_t size)
+{
+    uint32_t bs = c->cfg.block_size;
+    uint64_t old_key = f->key;
+
+    c->stats.writes++;
+    // The blocks follow the file to its new size
+    f->size = size;
+    f->key = file_key(f->path_key, size);
+    for (uint32_t i = 0; i < c->count; i++)
+    {
+        block_t *b = &c->blocks[i];
+        if (!b->used || b->key != old_key)
+            continue;
+        b->key = f->key;
+
+        uint32_t start = b->no * bs;
+        if (pos < start + bs && pos + len > start)
+        {
+            // Written past the bytes held: the gap was filled by the file system
+            if (pos > start + b->len)
+            {
+                drop(c, b);
+                continue;
+            }
+            uint32_t from = pos > start ? pos : start;
+            uint32_t to = MIN(pos + len, start + bs);
+            memcpy(block_data(c, b) + (from - start), (const uint8_t *)buf + (from - pos), to - from);
+            if (to - start > b->len)
+                b->len = to - start;
+        }
+        // A short last block is no longer the end of the file
+        if (b->len < bs && start + b->len < size)
+            drop(c, b);
+    }
+}
+
+void pst_fs_cache_invalidate(pst_fs_cache_t *c, const char *path)
+{
+    uint64_t key = path ? path_key(path) : 0;
+
+    for (uint32_t i = 0; i < c->count; i++)
+    {
+        block_t *b = &c->blocks[i];
+        if (b->used && (!path || b->path_key == key))
+            drop(c, b);
+    }
+}
+
+void pst_fs_cache_get_stats(const pst_fs_cache_t *c, pst_fs_cache_stats_t *out)
+{
+    *out = c->stats;
+}
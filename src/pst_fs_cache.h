@@ -0,0 +1,142 @@
+/**
+ * Block cache with read-ahead for PST file reads.
+ *
+ * Responsibilities:
+ *  - Keep file data in fixed-size blocks aligned on the block size (a multiple of
+ *    the 512-byte sector), within a byte budget, least recently used out first
+ *  - Serve small reads from memory: a read costs the card once per block
+ *  - Read ahead on sequential reads, doubling the blocks fetched up to a window,
+ *    so that a file read front to back is fetched in few large reads
+ *  - Pass large reads straight to the card, past the cache
+ *  - Write through: writes go to the card, cached blocks are updated in place
+ *  - Count hits, misses, card reads and read-ahead blocks dropped unused
+ *
+ * Blocks are keyed by file path and size at open: a file grown or shrunk behind
+ * the cache's back gets new blocks. A file rewritten at the same size by other
+ * means (e.g. FatFs calls of another module) needs pst_fs_cache_invalidate().
+ *
+ * The cache only depends on the C library and reads through a callback, so
+ * tools/pst_fs_check.c can run it on the host against a folder. Memory comes
+ * from PSRAM on the device.
+ *
+ * Requirements:
+ *  - A cache is used by one task at a time
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct pst_fs_cache pst_fs_cache_t;
+
+/**
+ * @brief Read `len` bytes at `pos` of an open file into `buf`.
+ *
+ * @return true on success, with the bytes read (fewer at the end of the file) in *got.
+ */
+typedef bool (*pst_fs_cache_read_cb_t)(void *io, uint32_t pos, void *buf, uint32_t len, uint32_t *got);
+
+/**
+ * @brief Cache configuration.
+ */
+typedef struct {
+    uint32_t block_size;        /*!< Bytes per block, a multiple of 512 */
+    uint32_t budget_bytes;      /*!< Bytes of blocks held */
+    uint8_t readahead_max;      /*!< Most blocks read past the one asked for (costs internal RAM: one block each) */
+} pst_fs_cache_cfg_t;
+
+#define PST_FS_CACHE_DEFAULT_CONFIG()       \
+    {                                       \
+        .block_size = 4096,                 \
+        .budget_bytes = 256 * 1024,         \
+        .readahead_max = 4,                 \
+    }
+
+/**
+ * @brief Cache state of an open file, kept by the caller.
+ */
+typedef struct {
+    uint64_t path_key;          /*!< Hash of the path */
+    uint64_t key;               /*!< Hash of the path and size: the blocks' key */
+    uint32_t size;              /*!< File size */
+    uint32_t next;              /*!< Where a sequential read would start */
+    uint8_t window;             /*!< Blocks read ahead on the next miss */
+    void *io;                   /*!< Passed to the read callback */
+} pst_fs_cache_file_t;
+
+/**
+ * @brief Counters since creation.
+ */
+typedef struct {
+    uint32_t reads;             /*!< Reads asked for */
+    uint32_t hits;              /*!< Blocks found in the cache */
+    uint32_t misses;            /*!< Blocks read from the card */
+    uint32_t readahead;         /*!< Blocks read ahead of a read */
+    uint32_t readahead_wasted;  /*!< ... dropped without having been read */
+    uint32_t bypassed;          /*!< Large reads passed to the card */
+    uint32_t card_reads;        /*!< Read callbacks */
+    uint64_t card_bytes;        /*!< Bytes read from the card */
+    uint64_t bytes;             /*!< Bytes read */
+    uint32_t writes;            /*!< Writes passed through */
+    uint32_t evictions;         /*!< Blocks dropped to make room */
+} pst_fs_cache_stats_t;
+
+/**
+ * @brief Create a cache.
+ *
+ * @param cfg      Configuration, NULL for PST_FS_CACHE_DEFAULT_CONFIG().
+ * @param read_cb  Reads from the card.
+ *
+ * @return the cache, NULL if out of memory or the block size is not a multiple of 512.
+ */
+pst_fs_cache_t *pst_fs_cache_new(const pst_fs_cache_cfg_t *cfg, pst_fs_cache_read_cb_t read_cb);
+
+/**
+ * @brief Free a cache (NULL is ignored).
+ */
+void pst_fs_cache_free(pst_fs_cache_t *cache);
+
+/**
+ * @brief Set up the cache state of a file just opened.
+ *
+ * @param path  Path of the file, the same for every opening.
+ * @param size  Size of the file.
+ * @param io    Passed to the read callback.
+ */
+void pst_fs_cache_open(pst_fs_cache_file_t *file, const char *path, uint32_t size, void *io);
+
+/**
+ * @brief Read from a file, through the cache.
+ *
+ * @return false if the card read failed; *got holds the bytes read (fewer at the end of the file).
+ */
+bool pst_fs_cache_read(pst_fs_cache_t *cache, pst_fs_cache_file_t *file, uint32_t pos, void *buf, uint32_t len,
+                       uint32_t *got);
+
+/**
+ * @brief Bring the cache up to date after `len` bytes were written to the card at `pos`.
+ *
+ * @param size  File size after the write.
+ */
+void pst_fs_cache_wrote(pst_fs_cache_t *cache, pst_fs_cache_file_t *file, uint32_t pos, const void *buf,
+                        uint32_t len, uint32_t size);
+
+/**
+ * @brief Drop the blocks of a path (any size), or all blocks if `path` is NULL.
+ */
+void pst_fs_cache_invalidate(pst_fs_cache_t *cache, const char *path);
+
+/**
+ * @brief Copy the current counters.
+ */
+void pst_fs_cache_get_stats(const pst_fs_cache_t *cache, pst_fs_cache_stats_t *out);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,211 @@
+#include <string.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
+#include "esp_log.h"
+#include "esp_bsp.h"
+#include "pst_gesture.h"
+
+static const char *TAG = "PST_GESTURE";
+
+// Recognizer, only touched by the touch task
+static pst_gesture_rec_t s_rec;
+static pst_gesture_rec_cfg_t s_rec_cfg;
+
+static pst_gesture_cfg_t s_cfg;
+static QueueHandle_t s_queue = NULL;
+static lv_timer_t *s_timer = NULL;
+static lv_event_code_t s_event_code;
+static pst_gesture_stats_t s_stats;
+
+// Delivery state, LVGL task only
+static lv_obj_t *s_targets[PST_GESTURE_MAX_TARGETS];   // in attach order
+static int s_target_cnt = 0;
+static lv_obj_t *s_active_target = NULL;               // receiver of the two-finger gesture
+
+void pst_gesture_feed(const pst_touch_sample_t *sample)
+{
+    pst_gesture_t g;
+
+    if (!s_queue)
+        return;
+
+    const pst_gesture_input_t in = {
+        .t_us = sample->t_us,
+        .x = sample->x,
+        .y = sample->y,
+        .x2 = sample->x2,
+        .y2 = sample->y2,
+        .points = sample->points,
+    };
+    if (!pst_gesture_rec_feed(&s_rec, &s_rec_cfg, &in, &g))
+        return;
+
+    switch (g.type)
+    {
+    case PST_GESTURE_BEGIN:
+        s_stats.pinches++;
+        break;
+    case PST_GESTURE_UPDATE:
+        s_stats.updates++;
+        break;
+    case PST_GESTURE_FLICK:
+        s_stats.flicks++;
+        break;
+    default:
+        break;
+    }
+    if (xQueueSend(s_queue, &g, 0) != pdTRUE)
+        s_stats.dropped++;
+}
+
+static lv_obj_t *find_target(lv_coord_t x, lv_coord_t y)
+{
+    lv_point_t pt = { x, y };
+
+    // Most recently attached first: usually the one drawn on top
+    for (int i = s_target_cnt - 1; i >= 0; i--)
+    {
+        lv_area_t area;
+        lv_obj_get_coords(s_targets[i], &area);
+        if (_lv_area_is_point_on(&area, &pt, 0) && lv_obj_is_visible(s_targets[i]))
+            return s_targets[i];
+    }
+    return NULL;
+}
+
+static void deliver(pst_gesture_t *g)
+{
+    lv_obj_t *target;
+
+    switch (g->type)
+    {
+    case PST_GESTURE_BEGIN:
+        s_active_target = find_target(g->start_x, g->start_y);
+        target = s_active_target;
+        break;
+    case PST_GESTURE_FLICK:
+        target = find_target(g->start_x, g->start_y);
+        break;
+    default:
+        target = s_active_target;
+        break;
+    }
+
+    if (!target)
+    {
+        if (g->type == PST_GESTURE_BEGIN || g->type == PST_GESTURE_FLICK)
+            s_stats.unclaimed++;
+        return;
+    }
+
+    lv_event_send(target, s_event_code, g);
+    if (g->type == PST_GESTURE_END)
+        s_active_target = NULL;
+}
+
+static void deliver_timer_cb(lv_timer_t *timer)
+{
+    pst_gesture_t g;
+    pst_gesture_t next;
+    bool have = xQueueReceive(s_queue, &g, 0) == pdTRUE;
+
+    while (have)
+    {
+        bool have_next = xQueueReceive(s_queue, &next, 0) == pdTRUE;
+        // Only the newest of consecutive updates is worth a redraw
+        if (g.type == PST_GESTURE_UPDATE && have_next && next.type == PST_GESTURE_UPDATE)
+        {
+            s_stats.coalesced++;
+            g = next;
+            continue;
+        }
+        deliver(&g);
+        g = next;
+        have = have_next;
+    }
+}
+
+esp_err_t pst_gesture_init(const pst_gesture_cfg_t *cfg)
+{
+    const pst_gesture_cfg_t def_cfg = PST_GESTURE_DEFAULT_CONFIG();
+
+    if (s_queue)
+        return ESP_ERR_INVALID_STATE;
+
+    s_cfg = cfg ? *cfg : def_cfg;
+    memset(&s_stats, 0, sizeof(s_stats));
+    s_rec_cfg = (pst_gesture_rec_cfg_t) {
+        .flick_min_speed = s_cfg.flick_min_speed,
+        .flick_window_ms = s_cfg.flick_window_ms,
+        .update_min_px = s_cfg.update_min_px,
+    };
+    pst_gesture_rec_reset(&s_rec);
+
+    QueueHandle_t queue = xQueueCreate(s_cfg.queue_len, sizeof(pst_gesture_t));
+    if (!queue)
+        return ESP_ERR_NO_MEM;
+
+    bsp_display_lock(0);
+    s_event_code = (lv_event_code_t)lv_event_register_id();
+    s_timer = lv_timer_create(deliver_timer_cb, s_cfg.deliver_period_ms, NULL);
+    bsp_display_unlock();
+    if (!s_timer)
+    {
+        vQueueDelete(queue);
+        return ESP_ERR_NO_MEM;
+    }
+
+    // Published last: the touch task starts feeding once the queue is set
+    s_queue = queue;
+    ESP_LOGI(TAG, "Gestures enabled (flick >= %lu px/s)", (unsigned long)s_cfg.flick_min_speed);
+    return ESP_OK;
+}
+
+lv_event_code_t pst_gesture_event_code(void)
+{
+    return s_event_code;
+}
+
+static void target_delete_cb(lv_event_t *e)
+{
+    pst_gesture_detach(lv_event_get_target(e));
+}
+
+esp_err_t pst_gesture_attach(lv_obj_t *obj)
+{
+    if (!s_queue)
+        return ESP_ERR_INVALID_STATE;
+
+    for (int i = 0; i < s_target_cnt; i++)
+    {
+        if (s_targets[i] == obj)
+            return ESP_OK;
+    }
+    if (s_target_cnt >= PST_GESTURE_MAX_TARGETS)
+        return ESP_ERR_NO_MEM;
+
+    s_targets[s_target_cnt++] = obj;
+    lv_obj_add_event_cb(obj, target_delete_cb, LV_EVENT_DELETE, NULL);
+    return ESP_OK;
+}
+
+void pst_gesture_detach(lv_obj_t *obj)
+{
+    for (int i = 0; i < s_target_cnt; i++)
+    {
+        if (s_targets[i] != obj)
+            continue;
+
+        lv_obj_remove_event_cb(obj, target_delete_cb);
+        memmove(&s_targets[i], &s_targets[i + 1], (s_target_cnt - i - 1) * sizeof(s_targets[0]));
+        s_target_cnt--;
+        if (s_active_target == obj)
+            s_active_target = NULL;
+        return;
+    }
+}
+
+void pst_gesture_get_stats(pst_gesture_stats_t *out)
+{
+    *out = s_stats;
+}
@@ -0,0 +1,117 @@
+/**
+ * Off-thread gesture recognizer for PST.
+ *
+ * Responsibilities:
+ *  - Recognize two-finger pinch/pan and one-finger flicks from the touch samples
+ *    (pst_gesture_rec), in the touch task, so the LVGL task only receives finished results
+ *  - Queue compact gesture events and deliver them to attached widgets from an
+ *    LVGL timer, coalescing updates so a widget gets at most one per pass
+ *  - Count recognized and dropped events
+ *
+ * Widgets opt in with pst_gesture_attach() and receive pst_gesture_event_code()
+ * events, with a `const pst_gesture_t *` as parameter (lv_event_get_param()).
+ * A gesture goes to the most recently attached visible widget under the point
+ * where it started; every update and the end of a two-finger gesture go to the
+ * widget that received its begin.
+ *
+ * Requirements:
+ *  - CONFIG_PST_TOUCH_TASK enabled (samples come from pst_touch)
+ *  - pst_gesture_init() called once LVGL is running
+ *  - pst_gesture_attach() / pst_gesture_detach() called with the LVGL lock held
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "esp_err.h"
+#include "lvgl.h"
+#include "pst_gesture_rec.h"
+#include "pst_touch.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Maximum number of widgets receiving gestures.
+ */
+#define PST_GESTURE_MAX_TARGETS 8
+
+/**
+ * @brief Recognizer configuration.
+ */
+typedef struct {
+    uint32_t flick_min_speed;   /*!< px/s above which a release is a flick */
+    uint32_t flick_window_ms;   /*!< Movement window the flick velocity is measured on */
+    uint8_t update_min_px;      /*!< Centroid travel or distance change that emits an update */
+    uint8_t queue_len;          /*!< Events queued towards LVGL */
+    uint32_t deliver_period_ms; /*!< LVGL timer period delivering the events */
+} pst_gesture_cfg_t;
+
+#define PST_GESTURE_DEFAULT_CONFIG()    \
+    {                                   \
+        .flick_min_speed = 600,         \
+        .flick_window_ms = 60,          \
+        .update_min_px = 2,             \
+        .queue_len = 16,                \
+        .deliver_period_ms = 10,        \
+    }
+
+/**
+ * @brief Counters since init.
+ */
+typedef struct {
+    uint32_t pinches;           /*!< Two-finger gestures begun */
+    uint32_t flicks;            /*!< Flicks recognized */
+    uint32_t updates;           /*!< Updates queued */
+    uint32_t coalesced;         /*!< Updates replaced by a newer one before delivery */
+    uint32_t dropped;           /*!< Events lost because the queue was full */
+    uint32_t unclaimed;         /*!< Gestures started outside every attached widget */
+} pst_gesture_stats_t;
+
+/**
+ * @brief Start recognizing and delivering gestures.
+ *
+ * @param cfg  Configuration, NULL for PST_GESTURE_DEFAULT_CONFIG().
+ *
+ * @return
+ *      - ESP_OK                 on success
+ *      - ESP_ERR_INVALID_STATE  if already initialized
+ *      - ESP_ERR_NO_MEM         if the queue or the timer cannot be created
+ */
+esp_err_t pst_gesture_init(const pst_gesture_cfg_t *cfg);
+
+/**
+ * @brief LVGL event code of gesture events (registered at init).
+ */
+lv_event_code_t pst_gesture_event_code(void);
+
+/**
+ * @brief Deliver gestures starting on `obj` to it (detached automatically on delete).
+ *
+ * @return
+ *      - ESP_OK                 on success
+ *      - ESP_ERR_INVALID_STATE  if not initialized
+ *      - ESP_ERR_NO_MEM         if PST_GESTURE_MAX_TARGETS widgets are attached
+ */
+esp_err_t pst_gesture_attach(lv_obj_t *obj);
+
+/**
+ * @brief Stop delivering gestures to `obj`.
+ */
+void pst_gesture_detach(lv_obj_t *obj);
+
+/**
+ * @brief Touch task hook: feed one sample to the recognizer.
+ */
+void pst_gesture_feed(const pst_touch_sample_t *sample);
+
+/**
+ * @brief Copy the current counters.
+ */
+void pst_gesture_get_stats(pst_gesture_stats_t *out);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,152 @@
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include "pst_gesture_rec.h"
+
+#define HIST_MASK (PST_GESTURE_REC_HIST_LEN - 1)
+#define MIN_DIST_PX 16.0f       // closer fingers make the scale too jumpy
+#define FLICK_MIN_DT_US 5000    // shorter movements give no usable velocity
+
+typedef enum {
+    G_IDLE = 0,
+    G_ONE,          // one finger, tracking its movement
+    G_TWO,          // two fingers, pinch/pan in progress
+    G_WAIT_UP,      // a two-finger gesture ended, wait for the last finger to lift
+} g_state_t;
+
+static int16_t clamp_i16(float v)
+{
+    if (v > INT16_MAX)
+        return INT16_MAX;
+    if (v < INT16_MIN)
+        return INT16_MIN;
+    return (int16_t)v;
+}
+
+static bool flick_check(pst_gesture_rec_t *r, const pst_gesture_rec_cfg_t *cfg, int64_t t_release, pst_gesture_t *out)
+{
+    if (r->hist_n < 2)
+        return false;
+
+    const int64_t window_us = (int64_t)cfg->flick_window_ms * 1000;
+    unsigned last_i = (r->hist_n - 1) & HIST_MASK;
+    // The finger stopped before lifting
+    if (t_release - r->hist[last_i].t_us > window_us)
+        return false;
+
+    unsigned first_i = last_i;
+    unsigned avail = r->hist_n < PST_GESTURE_REC_HIST_LEN ? r->hist_n : PST_GESTURE_REC_HIST_LEN;
+    for (unsigned i = 2; i <= avail; i++)
+    {
+        unsigned p = (r->hist_n - i) & HIST_MASK;
+        if (r->hist[last_i].t_us - r->hist[p].t_us > window_us)
+            break;
+        first_i = p;
+    }
+
+    int64_t dt = r->hist[last_i].t_us - r->hist[first_i].t_us;
+    if (dt < FLICK_MIN_DT_US)
+        return false;
+
+    float vx = (r->hist[last_i].x - r->hist[first_i].x) * 1e6f / dt;
+    float vy = (r->hist[last_i].y - r->hist[first_i].y) * 1e6f / dt;
+    float min = cfg->flick_min_speed;
+    if (vx * vx + vy * vy < min * min)
+        return false;
+
+    *out = (pst_gesture_t) {
+        .type = PST_GESTURE_FLICK,
+        .x = r->hist[last_i].x,
+        .y = r->hist[last_i].y,
+        .start_x = r->press_x,
+        .start_y = r->press_y,
+        .scale_q8 = 256,
+        .vx = clamp_i16(vx),
+        .vy = clamp_i16(vy),
+        .t_ms = (uint32_t)(t_release / 1000),
+    };
+    return true;
+}
+
+void pst_gesture_rec_reset(pst_gesture_rec_t *r)
+{
+    memset(r, 0, sizeof(*r));
+    r->state = G_IDLE;
+}
+
+bool pst_gesture_rec_feed(pst_gesture_rec_t *r, const pst_gesture_rec_cfg_t *cfg, const pst_gesture_input_t *in,
+                          pst_gesture_t *out)
+{
+    uint32_t t_ms = (uint32_t)(in->t_us / 1000);
+
+    if (in->points >= 2)
+    {
+        float dist = hypotf((float)in->x2 - in->x, (float)in->y2 - in->y);
+        int16_t cx = (in->x + in->x2) / 2;
+        int16_t cy = (in->y + in->y2) / 2;
+
+        if (r->state != G_TWO)
+        {
+            r->dist0 = dist > MIN_DIST_PX ? dist : MIN_DIST_PX;
+            r->dist_sent = dist;
+            r->two = (pst_gesture_t) {
+                .type = PST_GESTURE_BEGIN,
+                .x = cx,
+                .y = cy,
+                .start_x = cx,
+                .start_y = cy,
+                .scale_q8 = 256,
+                .t_ms = t_ms,
+            };
+            r->state = G_TWO;
+            *out = r->two;
+            return true;
+        }
+
+        // Only movements that matter reach LVGL
+        const int min = cfg->update_min_px;
+        if (abs(cx - r->two.x) < min && abs(cy - r->two.y) < min && fabsf(dist - r->dist_sent) < min)
+            return false;
+
+        float scale = dist * 256.0f / r->dist0;
+        r->two.type = PST_GESTURE_UPDATE;
+        r->two.x = cx;
+        r->two.y = cy;
+        r->two.scale_q8 = scale > UINT16_MAX ? UINT16_MAX : (uint16_t)scale;
+        r->two.t_ms = t_ms;
+        r->dist_sent = dist;
+        *out = r->two;
+        return true;
+    }
+
+    if (r->state == G_TWO)
+    {
+        r->two.type = PST_GESTURE_END;
+        r->two.t_ms = t_ms;
+        r->state = in->points ? G_WAIT_UP : G_IDLE;
+        *out = r->two;
+        return true;
+    }
+
+    if (in->points == 1)
+    {
+        if (r->state == G_WAIT_UP)
+            return false;
+        if (r->state == G_IDLE)
+        {
+            r->state = G_ONE;
+            r->hist_n = 0;
+            r->press_x = in->x;
+            r->press_y = in->y;
+        }
+        unsigned i = r->hist_n++ & HIST_MASK;
+        r->hist[i].t_us = in->t_us;
+        r->hist[i].x = in->x;
+        r->hist[i].y = in->y;
+        return false;
+    }
+
+    bool flick = r->state == G_ONE && flick_check(r, cfg, in->t_us, out);
+    r->state = G_IDLE;
+    return flick;
+}
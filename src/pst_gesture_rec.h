@@ -0,0 +1,110 @@
+/**
+ * Gesture recognizer state machine for PST.
+ *
+ * Responsibilities:
+ *  - Turn touch samples (one or two points) into gesture events: begin, update and
+ *    end of a two-finger pinch/pan, and flicks of one finger lifted while moving fast
+ *  - Emit an update only when the centroid or the finger distance moved enough
+ *  - Ignore the finger left after a two-finger gesture until it lifts too
+ *
+ * Like pst_touch_filter, the recognizer only depends on the C library, so
+ * tools/pst_gesture_replay.c can run it on pst_touch_rec recordings on the host;
+ * pst_gesture feeds it from the touch task and delivers its events to LVGL.
+ *
+ * Requirements:
+ *  - One pst_gesture_rec_t per touch panel, fed its samples in time order
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define PST_GESTURE_REC_HIST_LEN 8      /*!< One-finger positions kept for the flick velocity (power of 2) */
+
+/**
+ * @brief Gesture event kinds.
+ */
+typedef enum {
+    PST_GESTURE_BEGIN = 0,      /*!< Second finger down */
+    PST_GESTURE_UPDATE,         /*!< Fingers moved: scale and pan since begin */
+    PST_GESTURE_END,            /*!< A finger lifted, last scale and pan */
+    PST_GESTURE_FLICK,          /*!< One finger lifted while moving fast */
+} pst_gesture_type_t;
+
+/**
+ * @brief One gesture event.
+ */
+typedef struct {
+    uint8_t type;               /*!< pst_gesture_type_t */
+    int16_t x;                  /*!< Two fingers: centroid; flick: release point */
+    int16_t y;
+    int16_t start_x;            /*!< Two fingers: centroid at begin; flick: press point */
+    int16_t start_y;
+    uint16_t scale_q8;          /*!< Finger distance / distance at begin, 256 = 1.0 */
+    int16_t vx;                 /*!< Flick velocity in px/s */
+    int16_t vy;
+    uint32_t t_ms;              /*!< Sample time (esp_timer, ms) */
+} pst_gesture_t;
+
+/**
+ * @brief Recognizer tuning.
+ */
+typedef struct {
+    uint32_t flick_min_speed;   /*!< px/s above which a release is a flick */
+    uint32_t flick_window_ms;   /*!< Movement window the flick velocity is measured on */
+    uint8_t update_min_px;      /*!< Centroid travel or distance change that emits an update */
+} pst_gesture_rec_cfg_t;
+
+/**
+ * @brief One touch sample, in display coordinates.
+ */
+typedef struct {
+    int64_t t_us;
+    uint16_t x;                 /*!< First point (last known position on release) */
+    uint16_t y;
+    uint16_t x2;                /*!< Second point, valid when points >= 2 */
+    uint16_t y2;
+    uint8_t points;             /*!< Points down, 0 = released */
+} pst_gesture_input_t;
+
+/**
+ * @brief Recognizer state.
+ */
+typedef struct {
+    uint8_t state;              /*!< Idle, one finger, two fingers, waiting for the last finger up */
+    struct {
+        int64_t t_us;
+        int16_t x;
+        int16_t y;
+    } hist[PST_GESTURE_REC_HIST_LEN];
+    unsigned hist_n;            /*!< One-finger positions seen since press */
+    int16_t press_x;
+    int16_t press_y;
+    float dist0;                /*!< Finger distance at begin */
+    float dist_sent;            /*!< Finger distance of the last event */
+    pst_gesture_t two;          /*!< Last two-finger event */
+} pst_gesture_rec_t;
+
+/**
+ * @brief Start from idle (no finger down).
+ */
+void pst_gesture_rec_reset(pst_gesture_rec_t *r);
+
+/**
+ * @brief Feed one sample.
+ *
+ * @param out  Event recognized, valid when true is returned.
+ *
+ * @return true if the sample produced an event (at most one per sample).
+ */
+bool pst_gesture_rec_feed(pst_gesture_rec_t *r, const pst_gesture_rec_cfg_t *cfg, const pst_gesture_input_t *in,
+                          pst_gesture_t *out);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,508 @@
+#include <lvgl.h>
+#include <string.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
+#include "esp_heap_caps.h"
+#include "esp_log.h"
+#include "esp_bsp.h"
+#include "pst_img_cache.h"
+
+static const char *TAG = "PST_IMG_CACHE";
+
+// Open handles stored in lv_img_decoder_dsc_t::user_data start with their kind
+typedef enum {
+    HANDLE_ENTRY = 1,   // served from a cache entry
+    HANDLE_PASS,        // forwarded to the decoder that really opened the image
+} handle_kind_t;
+
+typedef struct {
+    uint8_t kind;
+    char *src;              // NULL = free slot
+    uint32_t hash;
+    uint8_t *data;          // decoded pixels in PSRAM
+    size_t size;
+    lv_img_header_t header;
+    uint32_t last_use;
+    uint16_t refs;          // open decoder descriptors using this entry
+    bool pinned;
+    bool stale;             // invalidated while open, freed on last close
+} img_entry_t;
+
+typedef struct {
+    uint8_t kind;
+    lv_img_decoder_dsc_t inner;
+} img_pass_t;
+
+typedef struct {
+    char src[PST_IMG_CACHE_PATH_MAX];
+    bool pin;
+} preload_req_t;
+
+static pst_img_cache_cfg_t s_cfg;
+static img_entry_t *s_entries = NULL;
+static lv_img_decoder_t *s_decoder = NULL;
+static lv_timer_t *s_preload_timer = NULL;
+static QueueHandle_t s_preload_q = NULL;
+static pst_img_cache_stats_t s_stats;
+static uint32_t s_use_tick = 0;
+static bool s_bypass = false;   // set while we call the other decoders ourselves
+
+static uint32_t src_hash(const char *src)
+{
+    // FNV-1a
+    uint32_t h = 2166136261u;
+    while (*src)
+    {
+        h ^= (uint8_t)*src++;
+        h *= 16777619u;
+    }
+    return h;
+}
+
+static img_entry_t *find_entry(const char *src)
+{
+    uint32_t h = src_hash(src);
+    for (uint16_t i = 0; i < s_cfg.max_entries; i++)
+    {
+        img_entry_t *e = &s_entries[i];
+        if (e->src && !e->stale && e->hash == h && strcmp(e->src, src) == 0)
+            return e;
+    }
+    return NULL;
+}
+
+static void free_entry(img_entry_t *e)
+{
+    s_stats.bytes_used -= e->size;
+    s_stats.entries--;
+    if (e->pinned)
+        s_stats.pinned--;
+    heap_caps_free(e->data);
+    lv_mem_free(e->src);
+    memset(e, 0, sizeof(*e));
+}
+
+static void drop_entry(img_entry_t *e)
+{
+    if (e->refs == 0)
+    {
+        free_entry(e);
+    }
+    else
+    {
+        // Still drawn from; the last close frees it
+        e->stale = true;
+    }
+}
+
+static void set_pinned(img_entry_t *e, bool pinned)
+{
+    if (e->pinned == pinned)
+        return;
+    e->pinned = pinned;
+    if (pinned)
+        s_stats.pinned++;
+    else
+        s_stats.pinned--;
+}
+
+/**
+ * Make room for `size` more bytes and one more entry by evicting the least
+ * recently used images that are neither open nor pinned.
+ * Returns a free slot, or NULL if the space cannot be found.
+ */
+static img_entry_t *reserve(size_t size)
+{
+    if (size > s_cfg.budget_bytes)
+        return NULL;
+
+    while (true)
+    {
+        img_entry_t *free_slot = NULL;
+        img_entry_t *victim = NULL;
+        for (uint16_t i = 0; i < s_cfg.max_entries; i++)
+        {
+            img_entry_t *e = &s_entries[i];
+            if (!e->src)
+            {
+                if (!free_slot)
+                    free_slot = e;
+                continue;
+            }
+            if (e->refs || e->pinned)
+                continue;
+            if (!victim || e->last_use < victim->last_use)
+                victim = e;
+        }
+
+        if (free_slot && s_stats.bytes_used + size <= s_cfg.budget_bytes)
+            return free_slot;
+        if (!victim)
+            return NULL;
+
+        ESP_LOGD(TAG, "Evict %s (%u bytes)", victim->src, (unsigned)victim->size);
+        free_entry(victim);
+        s_stats.evictions++;
+    }
+}
+
+/**
+ * Colour format the decoded pixels are stored in, or LV_IMG_CF_UNKNOWN if we
+ * cannot hold them. `has_data` tells whether the decoder produced a whole frame
+ * (img_data) or only works line by line.
+ */
+static lv_img_cf_t cached_cf(lv_img_cf_t cf, bool has_data)
+{
+    switch (cf)
+    {
+    case LV_IMG_CF_TRUE_COLOR:
+    case LV_IMG_CF_TRUE_COLOR_ALPHA:
+    case LV_IMG_CF_TRUE_COLOR_CHROMA_KEYED:
+        return cf;
+    // Whole-frame raw decoders (PNG) output native colour, alpha if they have it
+    case LV_IMG_CF_RAW:
+        return has_data ? LV_IMG_CF_TRUE_COLOR : LV_IMG_CF_UNKNOWN;
+    case LV_IMG_CF_RAW_ALPHA:
+        return has_data ? LV_IMG_CF_TRUE_COLOR_ALPHA : LV_IMG_CF_UNKNOWN;
+    case LV_IMG_CF_RAW_CHROMA_KEYED:
+        return has_data ? LV_IMG_CF_TRUE_COLOR_CHROMA_KEYED : LV_IMG_CF_UNKNOWN;
+    // Indexed files are expanded to colour + alpha by read_line
+    case LV_IMG_CF_INDEXED_1BIT:
+    case LV_IMG_CF_INDEXED_2BIT:
+    case LV_IMG_CF_INDEXED_4BIT:
+    case LV_IMG_CF_INDEXED_8BIT:
+        return has_data ? LV_IMG_CF_UNKNOWN : LV_IMG_CF_TRUE_COLOR_ALPHA;
+    default:
+        // Alpha-only images depend on the recolour passed at open time
+        return LV_IMG_CF_UNKNOWN;
+    }
+}
+
+/**
+ * Copy an image opened by another decoder into a new entry.
+ * Returns NULL if the image cannot be cached; `inner` is left open either way.
+ */
+static img_entry_t *capture(const char *src, lv_img_decoder_dsc_t *inner)
+{
+    lv_coord_t w = inner->header.w;
+    lv_coord_t h = inner->header.h;
+    lv_img_cf_t cf = cached_cf(inner->header.cf, inner->img_data != NULL);
+    if (cf == LV_IMG_CF_UNKNOWN || w == 0 || h == 0)
+        return NULL;
+
+    size_t size = lv_img_buf_get_img_size(w, h, cf);
+    img_entry_t *e = reserve(size);
+    if (!e)
+        return NULL;
+
+    uint8_t *data = heap_caps_malloc(size, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+    char *src_copy = lv_mem_alloc(strlen(src) + 1);
+    if (!data || !src_copy)
+    {
+        ESP_LOGW(TAG, "No memory for %s (%u bytes)", src, (unsigned)size);
+        heap_caps_free(data);
+        if (src_copy)
+            lv_mem_free(src_copy);
+        return NULL;
+    }
+
+    if (inner->img_data)
+    {
+        memcpy(data, inner->img_data, size);
+    }
+    else
+    {
+        size_t stride = size / h;
+        for (lv_coord_t y = 0; y < h; y++)
+        {
+            if (lv_img_decoder_read_line(inner, 0, y, w, data + y * stride) != LV_RES_OK)
+            {
+                ESP_LOGW(TAG, "Read failed at line %d of %s", y, src);
+                heap_caps_free(data);
+                lv_mem_free(src_copy);
+                return NULL;
+            }
+        }
+    }
+
+    strcpy(src_copy, src);
+    e->kind = HANDLE_ENTRY;
+    e->src = src_copy;
+    e->hash = src_hash(src);
+    e->data = data;
+    e->size = size;
+    e->header = inner->header;
+    e->header.cf = cf;
+    e->last_use = ++s_use_tick;
+    s_stats.bytes_used += size;
+    s_stats.entries++;
+    return e;
+}
+
+static lv_res_t open_inner(lv_img_decoder_dsc_t *inner, const char *src, lv_color_t color, int32_t frame_id)
+{
+    s_bypass = true;
+    lv_res_t res = lv_img_decoder_open(inner, src, color, frame_id);
+    s_bypass = false;
+    return res;
+}
+
+static img_entry_t *load(const char *src)
+{
+    lv_img_decoder_dsc_t inner;
+    if (open_inner(&inner, src, lv_color_black(), 0) != LV_RES_OK)
+    {
+        ESP_LOGW(TAG, "Cannot decode %s", src);
+        return NULL;
+    }
+
+    img_entry_t *e = capture(src, &inner);
+    lv_img_decoder_close(&inner);
+    if (!e)
+        s_stats.uncacheable++;
+    return e;
+}
+
+static lv_res_t cache_info(lv_img_decoder_t *decoder, const void *src, lv_img_header_t *header)
+{
+    if (s_bypass || lv_img_src_get_type(src) != LV_IMG_SRC_FILE)
+        return LV_RES_INV;
+
+    img_entry_t *e = find_entry(src);
+    if (e)
+    {
+        *header = e->header;
+        return LV_RES_OK;
+    }
+
+    // Not cached: answer with what the real decoder reports, so open_cb gets called
+    s_bypass = true;
+    lv_res_t res = lv_img_decoder_get_info(src, header);
+    s_bypass = false;
+    return res;
+}
+
+static lv_res_t cache_open(lv_img_decoder_t *decoder, lv_img_decoder_dsc_t *dsc)
+{
+    if (dsc->src_type != LV_IMG_SRC_FILE)
+        return LV_RES_INV;
+
+    const char *src = dsc->src;
+    img_entry_t *e = find_entry(src);
+    if (e)
+    {
+        s_stats.hits++;
+    }
+    else
+    {
+        s_stats.misses++;
+
+        lv_img_decoder_dsc_t inner;
+        if (open_inner(&inner, src, dsc->color, dsc->frame_id) != LV_RES_OK)
+            return LV_RES_INV;
+
+        // Only the first frame of animated images is cached
+        e = dsc->frame_id == 0 ? capture(src, &inner) : NULL;
+        if (e)
+        {
+            lv_img_decoder_close(&inner);
+        }
+        else
+        {
+            s_stats.uncacheable++;
+
+            img_pass_t *pass = lv_mem_alloc(sizeof(img_pass_t));
+            if (!pass)
+            {
+                lv_img_decoder_close(&inner);
+                return LV_RES_INV;
+            }
+            pass->kind = HANDLE_PASS;
+            pass->inner = inner;
+            dsc->header = inner.header;
+            dsc->img_data = inner.img_data;
+            dsc->user_data = pass;
+            return LV_RES_OK;
+        }
+    }
+
+    e->refs++;
+    e->last_use = ++s_use_tick;
+    dsc->header = e->header;
+    dsc->img_data = e->data;
+    dsc->user_data = e;
+    return LV_RES_OK;
+}
+
+static lv_res_t cache_read_line(lv_img_decoder_t *decoder, lv_img_decoder_dsc_t *dsc,
+                                lv_coord_t x, lv_coord_t y, lv_coord_t len, uint8_t *buf)
+{
+    // Entries always provide img_data, only pass-through handles get here
+    img_pass_t *pass = dsc->user_data;
+    if (!pass || pass->kind != HANDLE_PASS)
+        return LV_RES_INV;
+    return lv_img_decoder_read_line(&pass->inner, x, y, len, buf);
+}
+
+static void cache_close(lv_img_decoder_t *decoder, lv_img_decoder_dsc_t *dsc)
+{
+    uint8_t *kind = dsc->user_data;
+    if (!kind)
+        return;
+
+    if (*kind == HANDLE_PASS)
+    {
+        img_pass_t *pass = dsc->user_data;
+        lv_img_decoder_close(&pass->inner);
+        lv_mem_free(pass);
+    }
+    else
+    {
+        img_entry_t *e = dsc->user_data;
+        if (e->refs)
+            e->refs--;
+        if (e->stale && e->refs == 0)
+            free_entry(e);
+    }
+    dsc->user_data = NULL;
+}
+
+static void preload_timer_cb(lv_timer_t *timer)
+{
+    preload_req_t req;
+    if (xQueueReceive(s_preload_q, &req, 0) != pdTRUE)
+        return;
+
+    img_entry_t *e = find_entry(req.src);
+    if (!e)
+    {
+        e = load(req.src);
+        if (!e)
+            return;
+        s_stats.preloaded++;
+        ESP_LOGD(TAG, "Preloaded %s (%u bytes)", req.src, (unsigned)e->size);
+    }
+    e->last_use = ++s_use_tick;
+    if (req.pin)
+        set_pinned(e, true);
+}
+
+esp_err_t pst_img_cache_init(const pst_img_cache_cfg_t *cfg)
+{
+    const pst_img_cache_cfg_t def_cfg = PST_IMG_CACHE_DEFAULT_CONFIG();
+
+    if (s_decoder)
+        return ESP_ERR_INVALID_STATE;
+    if (!bsp_display_lock(0))
+        return ESP_ERR_TIMEOUT;
+
+    s_cfg = cfg ? *cfg : def_cfg;
+    s_entries = heap_caps_calloc(s_cfg.max_entries, sizeof(img_entry_t), MALLOC_CAP_DEFAULT);
+    s_preload_q = xQueueCreate(s_cfg.preload_queue_len, sizeof(preload_req_t));
+    s_decoder = lv_img_decoder_create();
+    s_preload_timer = lv_timer_create(preload_timer_cb, s_cfg.preload_period_ms, NULL);
+    if (!s_entries || !s_preload_q || !s_decoder || !s_preload_timer)
+    {
+        ESP_LOGE(TAG, "Init failed, no memory");
+        if (s_preload_timer)
+            lv_timer_del(s_preload_timer);
+        if (s_decoder)
+            lv_img_decoder_delete(s_decoder);
+        if (s_preload_q)
+            vQueueDelete(s_preload_q);
+        heap_caps_free(s_entries);
+        s_preload_timer = NULL;
+        s_decoder = NULL;
+        s_preload_q = NULL;
+        s_entries = NULL;
+        bsp_display_unlock();
+        return ESP_ERR_NO_MEM;
+    }
+
+    // lv_img_decoder_create() inserts at the head of the list: we are asked before PNG/BMP/built-in
+    lv_img_decoder_set_info_cb(s_decoder, cache_info);
+    lv_img_decoder_set_open_cb(s_decoder, cache_open);
+    lv_img_decoder_set_read_line_cb(s_decoder, cache_read_line);
+    lv_img_decoder_set_close_cb(s_decoder, cache_close);
+
+    memset(&s_stats, 0, sizeof(s_stats));
+    s_stats.budget_bytes = s_cfg.budget_bytes;
+
+    bsp_display_unlock();
+    ESP_LOGI(TAG, "Image cache: %u KB PSRAM budget, %u entries",
+             (unsigned)(s_cfg.budget_bytes / 1024), s_cfg.max_entries);
+    return ESP_OK;
+}
+
+bool pst_img_cache_preload(const char *src, bool pin)
+{
+    preload_req_t req;
+
+    if (!s_preload_q || !src || strlen(src) >= sizeof(req.src))
+        return false;
+
+    strcpy(req.src, src);
+    req.pin = pin;
+    if (xQueueSend(s_preload_q, &req, 0) != pdTRUE)
+    {
+        // Other counters are written by the LVGL task, under its lock (recursive)
+        bsp_display_lock(0);
+        s_stats.preload_dropped++;
+        bsp_display_unlock();
+        return false;
+    }
+    return true;
+}
+
+void pst_img_cache_set_pinned(const char *src, bool pinned)
+{
+    if (!s_decoder || !src)
+        return;
+
+    bsp_display_lock(0);
+    img_entry_t *e = find_entry(src);
+    if (e)
+        set_pinned(e, pinned);
+    bsp_display_unlock();
+
+    if (!e && pinned)
+        pst_img_cache_preload(src, true);
+}
+
+void pst_img_cache_invalidate(const char *src)
+{
+    if (!s_decoder)
+        return;
+
+    bsp_display_lock(0);
+    // Close LVGL's cached descriptors first so our entries lose their references
+    lv_img_cache_invalidate_src(src);
+    for (uint16_t i = 0; i < s_cfg.max_entries; i++)
+    {
+        img_entry_t *e = &s_entries[i];
+        if (!e->src || e->stale)
+            continue;
+        if (src ? strcmp(e->src, src) == 0 : !e->pinned)
+            drop_entry(e);
+    }
+    bsp_display_unlock();
+}
+
+void pst_img_cache_get_stats(pst_img_cache_stats_t *out)
+{
+    bsp_display_lock(0);
+    *out = s_stats;
+    bsp_display_unlock();
+}
+
+void pst_img_cache_reset_stats(void)
+{
+    bsp_display_lock(0);
+    s_stats.hits = 0;
+    s_stats.misses = 0;
+    s_stats.evictions = 0;
+    s_stats.uncacheable = 0;
+    s_stats.preloaded = 0;
+    s_stats.preload_dropped = 0;
+    bsp_display_unlock();
+}
@@ -0,0 +1,133 @@
+/**
+ * Byte-budgeted PSRAM image cache for PST.
+ *
+ * Responsibilities:
+ *  - Sit in front of the LVGL image decoders (PNG, BMP, LVGL .bin) for file sources
+ *    such as "S:/icons/folder.png", and keep the decoded pixels in PSRAM
+ *  - Bound the cache by bytes, not entry count, and evict the least recently used
+ *    image that is neither open nor pinned
+ *  - Let always-visible assets be pinned so they are never evicted
+ *  - Preload images in the background (one per LVGL timer tick) before a screen needs them
+ *  - Count hits, misses and evictions
+ *
+ * A cached image is served straight from PSRAM: redrawing it, or showing it on
+ * another screen, does not read the SD card or run a decoder again.
+ * LVGL's own LV_IMG_CACHE_DEF_SIZE cache still sits on top and keeps the last
+ * few opened images, each of which holds a reference on its entry here.
+ *
+ * Requirements:
+ *  - Display + LVGL must already be initialized via bsp_display_start_with_config()
+ *  - Decoders to be cached (lv_png, lv_bmp) are registered by lv_init(), before
+ *    pst_img_cache_init(), so this cache is asked first
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Longest file source (drive letter included) that can be preloaded.
+ */
+#define PST_IMG_CACHE_PATH_MAX 128
+
+/**
+ * @brief Image cache configuration.
+ */
+typedef struct {
+    size_t budget_bytes;            /*!< PSRAM bytes available for decoded pixels */
+    uint16_t max_entries;           /*!< Maximum number of cached images */
+    uint16_t preload_queue_len;     /*!< Preload requests that can be pending */
+    uint32_t preload_period_ms;     /*!< Preload timer period, one image is decoded per tick */
+} pst_img_cache_cfg_t;
+
+#define PST_IMG_CACHE_DEFAULT_CONFIG()      \
+    {                                       \
+        .budget_bytes = 2 * 1024 * 1024,    \
+        .max_entries = 32,                  \
+        .preload_queue_len = 16,            \
+        .preload_period_ms = 30,            \
+    }
+
+/**
+ * @brief Cache counters since init (or the last pst_img_cache_reset_stats()).
+ */
+typedef struct {
+    uint32_t hits;              /*!< Opens served from PSRAM */
+    uint32_t misses;            /*!< Opens that had to decode from the SD card */
+    uint32_t evictions;         /*!< Entries dropped to make room */
+    uint32_t uncacheable;       /*!< Opens passed through (format, size or budget) */
+    uint32_t preloaded;         /*!< Images decoded by the preload timer */
+    uint32_t preload_dropped;   /*!< Preload requests refused because the queue was full */
+    size_t bytes_used;          /*!< Decoded bytes currently held */
+    size_t budget_bytes;        /*!< Configured budget */
+    uint16_t entries;           /*!< Images currently held */
+    uint16_t pinned;            /*!< Of which pinned */
+} pst_img_cache_stats_t;
+
+/**
+ * @brief Register the cache as the first LVGL image decoder and start the preload timer.
+ *
+ * @param cfg  Configuration, NULL for PST_IMG_CACHE_DEFAULT_CONFIG().
+ *
+ * @return
+ *      - ESP_OK                 on success
+ *      - ESP_ERR_INVALID_STATE  if already initialized
+ *      - ESP_ERR_NO_MEM         if memory allocation fails
+ *      - ESP_ERR_TIMEOUT        if the LVGL lock could not be taken
+ */
+esp_err_t pst_img_cache_init(const pst_img_cache_cfg_t *cfg);
+
+/**
+ * @brief Queue an image to be decoded into the cache in the background.
+ *
+ * Safe to call from any task. An image that is already cached is only
+ * touched (and pinned if requested).
+ *
+ * @param src  File source, e.g. "S:/icons/folder.png".
+ * @param pin  Pin the entry once it is loaded.
+ *
+ * @return true if queued, false if the queue is full or the path too long.
+ */
+bool pst_img_cache_preload(const char *src, bool pin);
+
+/**
+ * @brief Pin or unpin a cached image.
+ *
+ * A pinned image is never evicted. Pinning an image that is not cached yet
+ * queues a pinned preload.
+ *
+ * @param src     File source.
+ * @param pinned  New pin state.
+ */
+void pst_img_cache_set_pinned(const char *src, bool pinned);
+
+/**
+ * @brief Drop an image from the cache, e.g. after the file was rewritten.
+ *
+ * Also drops LVGL's own cache entry. An image still being drawn is released
+ * once LVGL closes it.
+ *
+ * @param src  File source, or NULL to drop every unpinned image.
+ */
+void pst_img_cache_invalidate(const char *src);
+
+/**
+ * @brief Copy the current counters.
+ */
+void pst_img_cache_get_stats(pst_img_cache_stats_t *out);
+
+/**
+ * @brief Clear hit/miss/eviction counters (occupancy is kept).
+ */
+void pst_img_cache_reset_stats(void);
+
+#ifdef __cplusplus
+}
+#endif
@@ -2,6 +2,7 @@
 #include "esp_log.h"
 #include "esp_bsp.h"
 #include "pst_keyboard.h"
+#include "pst_snapshot.h"
 
 static const char *TAG = "PST_KEYBOARD";
 
@@ -48,12 +49,18 @@ bool pst_keyboard_create(const char *prompt_text, pst_keyboard_done_cb_t on_done
     // DO NOT clean the screen here!
 
     // 1. Create a Modal Background (Dimming effect)
-    s_modal_base = lv_obj_create(lv_scr_act());
-    lv_obj_set_size(s_modal_base, LV_PCT(100), LV_PCT(100));
-    lv_obj_set_style_bg_color(s_modal_base, lv_color_black(), 0);
-    lv_obj_set_style_bg_opa(s_modal_base, LV_OPA_50, 0); // Dim the background
-    lv_obj_set_style_border_width(s_modal_base, 0, 0);
-    lv_obj_set_style_radius(s_modal_base, 0, 0);
+    // A frozen, pre-dimmed picture of the screen: nothing underneath is redrawn while typing
+    s_modal_base = pst_snapshot_backdrop_create(lv_scr_act(), LV_OPA_50);
+    if (!s_modal_base)
+    {
+        ESP_LOGW(TAG, "No backdrop snapshot, dimming the live screen");
+        s_modal_base = lv_obj_create(lv_scr_act());
+        lv_obj_set_size(s_modal_base, LV_PCT(100), LV_PCT(100));
+        lv_obj_set_style_bg_color(s_modal_base, lv_color_black(), 0);
+        lv_obj_set_style_bg_opa(s_modal_base, LV_OPA_50, 0); // Dim the background
+        lv_obj_set_style_border_width(s_modal_base, 0, 0);
+        lv_obj_set_style_radius(s_modal_base, 0, 0);
+    }
     lv_obj_add_event_cb(s_modal_base, modal_click_cb, LV_EVENT_CLICKED, NULL);
 
     // 2. Create Text Area inside a small container
@@ -75,6 +82,16 @@ bool pst_keyboard_create(const char *prompt_text, pst_keyboard_done_cb_t on_done
     return true;
 }
 
+void pst_keyboard_set_input(const char *initial_text)
+{
+    if (bsp_display_lock(100))
+    {
+        if (s_ta)
+            lv_textarea_set_text(s_ta, initial_text ? initial_text : "");
+        bsp_display_unlock();
+    }
+}
+
 void pst_keyboard_destroy(void)
 {
     if (bsp_display_lock(100))
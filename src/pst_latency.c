@@ -0,0 +1,426 @@
+#include "pst_latency.h"
+
+#if CONFIG_PST_LATENCY_TRACE
+
+#include <stdio.h>
+#include <string.h>
+#include "freertos/FreeRTOS.h"
+#include "esp_timer.h"
+#include "esp_log.h"
+#include "esp_bsp.h"
+#include "pst_perf.h"
+#include "pst_touch.h"
+
+static const char *TAG = "PST_LATENCY";
+
+#define OVERLAY_PERIOD_MS 500
+
+// Stage reached by the touch being followed
+typedef enum {
+    TRK_IDLE = 0,
+    TRK_INPUT,      // read by LVGL, waiting for an event
+    TRK_EVENT,      // event sent, waiting for the next frame
+    TRK_RENDER,     // frame rendering, waiting for its last chunk
+    TRK_FLUSH,      // last chunk queued, its transfer-done ISR completes it
+} trk_state_t;
+
+typedef struct {
+    uint32_t buckets[PST_LATENCY_BUCKETS];
+    uint32_t count;
+    uint64_t sum_us;
+    uint32_t max_us;
+} hist_t;
+
+static const char *const s_stage_names[PST_LATENCY_STAGE_MAX] = {
+    "irq>indev", "indev>event", "event>render", "render>photon", "total",
+};
+static const char *const s_src_names[PST_LATENCY_SRC_MAX] = { "touch", "synthetic" };
+
+// Histograms are written by the transfer-done ISR, read by tasks
+static portMUX_TYPE s_lock = portMUX_INITIALIZER_UNLOCKED;
+static hist_t s_hist[PST_LATENCY_SRC_MAX][PST_LATENCY_STAGE_MAX];
+static uint32_t s_unmatched;
+
+// Only the LVGL task moves the state forward; the ISR only completes TRK_FLUSH
+static volatile trk_state_t s_state = TRK_IDLE;
+static volatile int64_t s_last_irq_us;
+static bool s_trk_synthetic;
+static int64_t s_t_irq;
+static int64_t s_t_indev;
+static int64_t s_t_event;
+static int64_t s_t_render;
+
+// Chunks queued (LVGL task) and transferred (ISR) since boot; the last chunk of
+// the followed frame is number s_flush_last
+static uint32_t s_flush_queued;
+static volatile uint32_t s_flush_done;
+static volatile uint32_t s_flush_last;
+
+static bool s_ready = false;
+static void (*s_prev_render_start_cb)(lv_disp_drv_t *drv);
+static void (*s_prev_feedback_cb)(lv_indev_drv_t *drv, uint8_t code);
+
+static lv_obj_t *s_overlay = NULL;
+static lv_timer_t *s_overlay_timer = NULL;
+static uint32_t s_overlay_count[PST_LATENCY_SRC_MAX];
+
+static esp_timer_handle_t s_synth_timer = NULL;
+static lv_point_t s_synth_pt;
+static bool s_synth_down;
+static uint32_t s_synth_left;   // taps left, 0 = no limit
+
+static PST_IRAM_ATTR int bucket_of(uint32_t us)
+{
+    if (us < 8)
+        return us;
+
+    int msb = 31 - __builtin_clz(us);
+    int idx = (msb - 2) * 8 + ((us >> (msb - 3)) & 7);
+    return idx < PST_LATENCY_BUCKETS ? idx : PST_LATENCY_BUCKETS - 1;
+}
+
+static uint32_t bucket_upper(int idx)
+{
+    if (idx < 8)
+        return idx;
+
+    int msb = idx / 8 + 2;
+    return ((uint32_t)(9 + idx % 8) << (msb - 3)) - 1;
+}
+
+static PST_IRAM_ATTR void hist_add(hist_t *h, int64_t us)
+{
+    uint32_t v = us > 0 ? (uint32_t)us : 0;
+    h->buckets[bucket_of(v)]++;
+    h->count++;
+    h->sum_us += v;
+    if (v > h->max_us)
+        h->max_us = v;
+}
+
+static uint32_t percentile(const hist_t *h, uint32_t pct)
+{
+    uint32_t target = (uint32_t)(((uint64_t)h->count * pct + 99) / 100);
+    uint32_t seen = 0;
+
+    for (int i = 0; i < PST_LATENCY_BUCKETS; i++)
+    {
+        seen += h->buckets[i];
+        if (seen >= target)
+        {
+            uint32_t upper = bucket_upper(i);
+            return upper < h->max_us ? upper : h->max_us;
+        }
+    }
+    return h->max_us;
+}
+
+PST_IRAM_ATTR void pst_latency_mark_irq(void)
+{
+    s_last_irq_us = esp_timer_get_time();
+}
+
+PST_IRAM_ATTR int64_t pst_latency_irq_time(void)
+{
+    return s_last_irq_us;
+}
+
+PST_IRAM_ATTR void pst_latency_input(int64_t t_irq_us, bool synthetic)
+{
+    int64_t now = esp_timer_get_time();
+
+    portENTER_CRITICAL(&s_lock);
+    if (s_state != TRK_IDLE && now - s_t_indev >= PST_LATENCY_TIMEOUT_US)
+    {
+        s_unmatched++;
+        s_state = TRK_IDLE;
+    }
+    // A sample that sent no event (finger held still) is replaced by the newer one
+    if (s_state == TRK_IDLE || s_state == TRK_INPUT)
+    {
+        s_trk_synthetic = synthetic;
+        s_t_irq = t_irq_us;
+        s_t_indev = now;
+        s_state = TRK_INPUT;
+    }
+    portEXIT_CRITICAL(&s_lock);
+}
+
+static void feedback_cb(lv_indev_drv_t *drv, uint8_t code)
+{
+    if (s_prev_feedback_cb)
+        s_prev_feedback_cb(drv, code);
+
+    // Only events that change what is drawn; PRESSING repeats while the finger rests
+    switch (code)
+    {
+    case LV_EVENT_PRESSED:
+    case LV_EVENT_RELEASED:
+    case LV_EVENT_PRESS_LOST:
+    case LV_EVENT_LONG_PRESSED:
+        break;
+    default:
+        return;
+    }
+
+    if (s_state == TRK_INPUT)
+    {
+        s_t_event = esp_timer_get_time();
+        s_state = TRK_EVENT;
+    }
+}
+
+static void render_start_cb(lv_disp_drv_t *drv)
+{
+    if (s_prev_render_start_cb)
+        s_prev_render_start_cb(drv);
+
+    if (s_state == TRK_EVENT)
+    {
+        s_t_render = esp_timer_get_time();
+        s_state = TRK_RENDER;
+    }
+}
+
+PST_IRAM_ATTR void pst_latency_flush_queue(bool last)
+{
+    s_flush_queued++;
+    if (last && s_state == TRK_RENDER)
+    {
+        s_flush_last = s_flush_queued;
+        s_state = TRK_FLUSH;
+    }
+}
+
+PST_IRAM_ATTR void pst_latency_flush_done(void)
+{
+    // Earlier chunks of the frame may still be in flight when the last is queued
+    uint32_t done = ++s_flush_done;
+    if (s_state != TRK_FLUSH || done != s_flush_last)
+        return;
+
+    int64_t now = esp_timer_get_time();
+    portENTER_CRITICAL_ISR(&s_lock);
+    hist_t *h = s_hist[s_trk_synthetic ? PST_LATENCY_SRC_SYNTHETIC : PST_LATENCY_SRC_TOUCH];
+    hist_add(&h[PST_LATENCY_IRQ_TO_INDEV], s_t_indev - s_t_irq);
+    hist_add(&h[PST_LATENCY_INDEV_TO_EVENT], s_t_event - s_t_indev);
+    hist_add(&h[PST_LATENCY_EVENT_TO_RENDER], s_t_render - s_t_event);
+    hist_add(&h[PST_LATENCY_RENDER_TO_PHOTON], now - s_t_render);
+    hist_add(&h[PST_LATENCY_TOTAL], now - s_t_irq);
+    s_state = TRK_IDLE;
+    portEXIT_CRITICAL_ISR(&s_lock);
+}
+
+esp_err_t pst_latency_init(lv_disp_t *disp, lv_indev_t *indev)
+{
+    if (!disp || !indev)
+        return ESP_ERR_INVALID_ARG;
+    if (s_ready)
+        return ESP_ERR_INVALID_STATE;
+
+    bsp_display_lock(0);
+    s_prev_render_start_cb = disp->driver->render_start_cb;
+    disp->driver->render_start_cb = render_start_cb;
+    s_prev_feedback_cb = indev->driver->feedback_cb;
+    indev->driver->feedback_cb = feedback_cb;
+    s_ready = true;
+    bsp_display_unlock();
+    return ESP_OK;
+}
+
+void pst_latency_get(pst_latency_src_t src, pst_latency_stage_t stage, pst_latency_summary_t *out)
+{
+    hist_t h;
+
+    memset(out, 0, sizeof(*out));
+    if (src >= PST_LATENCY_SRC_MAX || stage >= PST_LATENCY_STAGE_MAX)
+        return;
+
+    portENTER_CRITICAL(&s_lock);
+    h = s_hist[src][stage];
+    portEXIT_CRITICAL(&s_lock);
+
+    if (!h.count)
+        return;
+    out->count = h.count;
+    out->p50_us = percentile(&h, 50);
+    out->p95_us = percentile(&h, 95);
+    out->p99_us = percentile(&h, 99);
+    out->avg_us = (uint32_t)(h.sum_us / h.count);
+    out->max_us = h.max_us;
+}
+
+static void reset_src(pst_latency_src_t src)
+{
+    portENTER_CRITICAL(&s_lock);
+    memset(s_hist[src], 0, sizeof(s_hist[src]));
+    portEXIT_CRITICAL(&s_lock);
+    s_overlay_count[src] = 0;
+}
+
+void pst_latency_reset(void)
+{
+    for (int i = 0; i < PST_LATENCY_SRC_MAX; i++)
+        reset_src(i);
+    s_unmatched = 0;
+}
+
+void pst_latency_report(void)
+{
+    for (int src = 0; src < PST_LATENCY_SRC_MAX; src++)
+    {
+        for (int stage = 0; stage < PST_LATENCY_STAGE_MAX; stage++)
+        {
+            pst_latency_summary_t sum;
+            pst_latency_get(src, stage, &sum);
+            if (!sum.count)
+                break;
+            ESP_LOGI(TAG, "[%s] %-13s n=%lu p50=%luus p95=%luus p99=%luus avg=%luus max=%luus",
+                     s_src_names[src], s_stage_names[stage], (unsigned long)sum.count,
+                     (unsigned long)sum.p50_us, (unsigned long)sum.p95_us, (unsigned long)sum.p99_us,
+                     (unsigned long)sum.avg_us, (unsigned long)sum.max_us);
+        }
+    }
+    ESP_LOGI(TAG, "Unmatched touches: %lu", (unsigned long)s_unmatched);
+}
+
+static int overlay_line(char *buf, size_t len, pst_latency_src_t src)
+{
+    pst_latency_summary_t sum;
+    pst_latency_get(src, PST_LATENCY_TOTAL, &sum);
+    if (!sum.count)
+        return 0;
+
+    return snprintf(buf, len, "%s p50 %lu.%lu p95 %lu.%lu p99 %lu.%lu ms n=%lu",
+                    src == PST_LATENCY_SRC_TOUCH ? "touch" : "synth",
+                    (unsigned long)(sum.p50_us / 1000), (unsigned long)(sum.p50_us % 1000 / 100),
+                    (unsigned long)(sum.p95_us / 1000), (unsigned long)(sum.p95_us % 1000 / 100),
+                    (unsigned long)(sum.p99_us / 1000), (unsigned long)(sum.p99_us % 1000 / 100),
+                    (unsigned long)sum.count);
+}
+
+static void overlay_timer_cb(lv_timer_t *timer)
+{
+    // Redraw only after new measurements, so the overlay does not create frames of its own
+    bool changed = false;
+    for (int src = 0; src < PST_LATENCY_SRC_MAX; src++)
+    {
+        pst_latency_summary_t sum;
+        pst_latency_get(src, PST_LATENCY_TOTAL, &sum);
+        changed |= sum.count != s_overlay_count[src];
+        s_overlay_count[src] = sum.count;
+    }
+    if (!changed)
+        return;
+
+    char text[128] = "touch -";
+    int n = overlay_line(text, sizeof(text), PST_LATENCY_SRC_TOUCH);
+    if (n < 0 || n >= (int)sizeof(text))
+        n = strlen(text);
+    if (s_overlay_count[PST_LATENCY_SRC_SYNTHETIC] && n < (int)sizeof(text) - 1)
+    {
+        text[n++] = '\n';
+        overlay_line(text + n, sizeof(text) - n, PST_LATENCY_SRC_SYNTHETIC);
+    }
+    lv_label_set_text(s_overlay, text);
+}
+
+static void overlay_delete_cb(lv_event_t *e)
+{
+    s_overlay = NULL;
+    if (s_overlay_timer)
+    {
+        lv_timer_del(s_overlay_timer);
+        s_overlay_timer = NULL;
+    }
+}
+
+static void overlay_create(void)
+{
+    s_overlay = lv_label_create(lv_layer_top());
+    lv_label_set_text(s_overlay, "touch -");
+    lv_obj_align(s_overlay, LV_ALIGN_TOP_RIGHT, -4, 4);
+    lv_obj_set_style_pad_all(s_overlay, 4, 0);
+    lv_obj_set_style_bg_opa(s_overlay, LV_OPA_70, 0);
+    lv_obj_set_style_bg_color(s_overlay, lv_color_black(), 0);
+    // A visible pressed state gives every (synthetic) tap a frame to measure
+    lv_obj_set_style_bg_color(s_overlay, lv_palette_main(LV_PALETTE_BLUE), LV_STATE_PRESSED);
+    lv_obj_set_style_text_color(s_overlay, lv_color_white(), 0);
+    lv_obj_add_flag(s_overlay, LV_OBJ_FLAG_CLICKABLE);
+    lv_obj_add_event_cb(s_overlay, overlay_delete_cb, LV_EVENT_DELETE, NULL);
+
+    memset(s_overlay_count, 0, sizeof(s_overlay_count));
+    s_overlay_timer = lv_timer_create(overlay_timer_cb, OVERLAY_PERIOD_MS, NULL);
+}
+
+void pst_latency_overlay_show(bool show)
+{
+    bsp_display_lock(0);
+    if (show && !s_overlay)
+        overlay_create();
+    else if (!show && s_overlay)
+        lv_obj_del(s_overlay);
+    bsp_display_unlock();
+}
+
+static void synth_timer_cb(void *arg)
+{
+    s_synth_down = !s_synth_down;
+    if (pst_touch_inject(s_synth_pt.x, s_synth_pt.y, s_synth_down) != ESP_OK)
+        ESP_LOGW(TAG, "Synthetic %s dropped", s_synth_down ? "press" : "release");
+
+    if (!s_synth_down && s_synth_left && --s_synth_left == 0)
+    {
+        esp_timer_stop(s_synth_timer);
+        ESP_LOGI(TAG, "Synthetic taps done");
+    }
+}
+
+esp_err_t pst_latency_synthetic_start(uint32_t period_ms, uint32_t taps)
+{
+    if (period_ms < 20)
+        return ESP_ERR_INVALID_ARG;
+    if (!s_ready || (s_synth_timer && esp_timer_is_active(s_synth_timer)))
+        return ESP_ERR_INVALID_STATE;
+
+    if (!s_synth_timer)
+    {
+        const esp_timer_create_args_t args = {
+            .callback = synth_timer_cb,
+            .name = "pst_lat_synth",
+        };
+        if (esp_timer_create(&args, &s_synth_timer) != ESP_OK)
+            return ESP_ERR_NO_MEM;
+    }
+
+    // Tap the middle of the overlay
+    bsp_display_lock(0);
+    if (!s_overlay)
+        overlay_create();
+    lv_obj_update_layout(s_overlay);
+    lv_area_t area;
+    lv_obj_get_coords(s_overlay, &area);
+    s_synth_pt.x = (area.x1 + area.x2) / 2;
+    s_synth_pt.y = (area.y1 + area.y2) / 2;
+    bsp_display_unlock();
+
+    reset_src(PST_LATENCY_SRC_SYNTHETIC);
+    s_synth_down = false;
+    s_synth_left = taps;
+    return esp_timer_start_periodic(s_synth_timer, (uint64_t)period_ms * 1000 / 2);
+}
+
+void pst_latency_synthetic_stop(void)
+{
+    if (!s_synth_timer || !esp_timer_is_active(s_synth_timer))
+        return;
+
+    esp_timer_stop(s_synth_timer);
+    if (s_synth_down)
+    {
+        s_synth_down = false;
+        pst_touch_inject(s_synth_pt.x, s_synth_pt.y, false);
+    }
+}
+
+#endif
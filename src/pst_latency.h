@@ -0,0 +1,190 @@
+/**
+ * Touch-to-photon latency instrumentation for PST.
+ *
+ * Responsibilities:
+ *  - Follow one touch at a time from the touch interrupt to the end of the panel
+ *    transfer that shows its result, with a timestamp at every stage:
+ *      irq     touch INT fired (bsp_touch_interrupt_cb)
+ *      indev   LVGL read the sample from the touch ring
+ *      event   LVGL sent an input event for it (indev feedback_cb)
+ *      render  the next frame started rendering (disp render_start_cb)
+ *      photon  the last chunk of that frame left the DMA (on_color_trans_done)
+ *  - Keep a log-scale histogram per stage and for the total, and report p50/p95/p99
+ *  - Show the live percentiles in an overlay on lv_layer_top()
+ *  - Inject synthetic taps on the overlay through the touch task, to measure the
+ *    software-only part of the path (no touch controller, no I2C read)
+ *
+ * A touch that sends no event, or whose frame does not start within
+ * PST_LATENCY_TIMEOUT_US, is dropped and counted as unmatched.
+ *
+ * Requirements:
+ *  - CONFIG_PST_LATENCY_TRACE enabled; otherwise every hook compiles to nothing
+ *  - CONFIG_PST_TOUCH_TASK enabled, so samples carry their interrupt time
+ *  - pst_latency_init() called once the display and touch are started
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "sdkconfig.h"
+#include "esp_err.h"
+#include "lvgl.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief A touch whose frame has not started after this long is dropped.
+ */
+#define PST_LATENCY_TIMEOUT_US 500000
+
+/**
+ * @brief Histogram buckets: exact below 8 us, then 8 buckets per power of two (<= 12.5% error).
+ */
+#define PST_LATENCY_BUCKETS 160
+
+/**
+ * @brief Measured intervals.
+ */
+typedef enum {
+    PST_LATENCY_IRQ_TO_INDEV = 0,   /*!< Touch task read + wait for the LVGL input timer */
+    PST_LATENCY_INDEV_TO_EVENT,     /*!< LVGL input processing up to the event */
+    PST_LATENCY_EVENT_TO_RENDER,    /*!< Event handlers and wait for the refresh timer */
+    PST_LATENCY_RENDER_TO_PHOTON,   /*!< Rendering and panel transfer */
+    PST_LATENCY_TOTAL,              /*!< Interrupt to end of transfer */
+    PST_LATENCY_STAGE_MAX,
+} pst_latency_stage_t;
+
+/**
+ * @brief Where the measured touches came from.
+ */
+typedef enum {
+    PST_LATENCY_SRC_TOUCH = 0,      /*!< Real touches from the controller */
+    PST_LATENCY_SRC_SYNTHETIC,      /*!< Taps injected by pst_latency_synthetic_start() */
+    PST_LATENCY_SRC_MAX,
+} pst_latency_src_t;
+
+/**
+ * @brief Summary of one interval.
+ */
+typedef struct {
+    uint32_t count;             /*!< Touches measured */
+    uint32_t p50_us;            /*!< Median */
+    uint32_t p95_us;            /*!< 95th percentile */
+    uint32_t p99_us;            /*!< 99th percentile */
+    uint32_t avg_us;            /*!< Mean */
+    uint32_t max_us;            /*!< Worst */
+} pst_latency_summary_t;
+
+#if CONFIG_PST_LATENCY_TRACE
+
+/**
+ * @brief Hook the display and input device and start measuring.
+ *
+ * Chains to any render_start_cb / feedback_cb already installed.
+ *
+ * @return
+ *      - ESP_OK                 on success
+ *      - ESP_ERR_INVALID_ARG    if disp or indev is NULL
+ *      - ESP_ERR_INVALID_STATE  if already initialized
+ */
+esp_err_t pst_latency_init(lv_disp_t *disp, lv_indev_t *indev);
+
+/**
+ * @brief Touch interrupt hook (ISR): remember when INT fired.
+ */
+void pst_latency_mark_irq(void);
+
+/**
+ * @brief Time of the last touch interrupt, 0 if none yet.
+ */
+int64_t pst_latency_irq_time(void);
+
+/**
+ * @brief LVGL read hook: a touch sample reached LVGL.
+ *
+ * @param t_irq_us   Interrupt (or injection) time of the sample.
+ * @param synthetic  true for injected samples.
+ */
+void pst_latency_input(int64_t t_irq_us, bool synthetic);
+
+/**
+ * @brief Flush hook: a chunk is about to be queued, called before every draw_bitmap.
+ *
+ * @param last  true for the last chunk of the frame.
+ */
+void pst_latency_flush_queue(bool last);
+
+/**
+ * @brief Transfer-done hook (ISR): a queued chunk has left the DMA.
+ *
+ * Transfers complete in the order they were queued: the sample is closed by the
+ * completion of the last chunk, not of one queued before it.
+ */
+void pst_latency_flush_done(void);
+
+/**
+ * @brief Summarize one interval.
+ */
+void pst_latency_get(pst_latency_src_t src, pst_latency_stage_t stage, pst_latency_summary_t *out);
+
+/**
+ * @brief Clear all histograms.
+ */
+void pst_latency_reset(void);
+
+/**
+ * @brief Log p50/p95/p99 of every interval for both sources.
+ */
+void pst_latency_report(void);
+
+/**
+ * @brief Show or hide the percentile overlay (top right, refreshed twice a second).
+ */
+void pst_latency_overlay_show(bool show);
+
+/**
+ * @brief Tap the overlay every `period_ms` through the touch task.
+ *
+ * Each tap is a press and a release `period_ms / 2` apart. The overlay updates its
+ * text on every press, so each tap produces one frame to measure.
+ * Shows the overlay and clears the synthetic histograms.
+ *
+ * @param period_ms  Tap period, at least 20 ms.
+ * @param taps       Number of taps, 0 for no limit.
+ *
+ * @return
+ *      - ESP_OK                 on success
+ *      - ESP_ERR_INVALID_ARG    if period_ms is too short
+ *      - ESP_ERR_INVALID_STATE  if not initialized or already running
+ *      - ESP_ERR_NO_MEM         if the timer cannot be created
+ */
+esp_err_t pst_latency_synthetic_start(uint32_t period_ms, uint32_t taps);
+
+/**
+ * @brief Stop injecting taps.
+ */
+void pst_latency_synthetic_stop(void);
+
+#else
+
+static inline esp_err_t pst_latency_init(lv_disp_t *disp, lv_indev_t *indev) { return ESP_ERR_NOT_SUPPORTED; }
+static inline void pst_latency_mark_irq(void) {}
+static inline int64_t pst_latency_irq_time(void) { return 0; }
+static inline void pst_latency_input(int64_t t_irq_us, bool synthetic) {}
+static inline void pst_latency_flush_queue(bool last) {}
+static inline void pst_latency_flush_done(void) {}
+static inline void pst_latency_get(pst_latency_src_t src, pst_latency_stage_t stage, pst_latency_summary_t *out) { *out = (pst_latency_summary_t) { 0 }; }
+static inline void pst_latency_reset(void) {}
+static inline void pst_latency_report(void) {}
+static inline void pst_latency_overlay_show(bool show) {}
+static inline esp_err_t pst_latency_synthetic_start(uint32_t period_ms, uint32_t taps) { return ESP_ERR_NOT_SUPPORTED; }
+static inline void pst_latency_synthetic_stop(void) {}
+
+#endif
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,309 @@
+#include <stdlib.h>
+#include <string.h>
+#include "pst_name_index.h"
+
+#ifdef ESP_PLATFORM
+#include "esp_heap_caps.h"
+#define INDEX_MALLOC(size) heap_caps_malloc((size), MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT)
+#define INDEX_FREE(p) heap_caps_free(p)
+#else
+#define INDEX_MALLOC(size) malloc(size)
+#define INDEX_FREE(p) free(p)
+#endif
+
+#define TRI_BITS 12
+#define TRI_BUCKETS (1u << TRI_BITS)
+#define POST16_MAX 0xFFFF        // below this many names, postings take 16 bits
+#define NAME_MAX_BYTES 768      // FAT long names: 255 UTF-16 units, at most 3 UTF-8 bytes each
+
+struct pst_name_index {
+    uint32_t count;
+    char *fold;                 // folded names, NUL-terminated, back to back
+    uint32_t *fold_off;         // name -> its folded name in fold
+    size_t fold_len;
+    uint32_t *bucket;           // TRI_BUCKETS + 1 offsets into post; NULL: no trigram table
+    void *post;                 // names holding a trigram of each bucket, ascending (post_at())
+    bool post_wide;             // postings are uint32_t (POST16_MAX names or more), else uint16_t
+    uint32_t post_len;
+    uint32_t *result;           // matches of the last query
+    uint32_t result_n;
+    char last[PST_NAME_QUERY_MAX]; // folded last query
+};
+
+// Simple case folding of the letters that have it below U+0800: the folded
+// character has the same UTF-8 length, so names fold in place.
+static uint32_t fold_cp(uint32_t c)
+{
+    if (c < 0x80)
+        return (c >= 'A' && c <= 'Z') ? c + 32 : c;
+    if (c >= 0xC0 && c <= 0xDE && c != 0xD7)
+        return c + 32;
+    if (c >= 0x100 && c <= 0x17F)
+    {
+        // Dotted/dotless i, kra, n-apostrophe and long s have no pair of this length
+        if (c == 0x130 || c == 0x131 || c == 0x138 || c == 0x149 || c == 0x17F)
+            return c;
+        if (c == 0x178)
+            return 0xFF;
+        // Upper case is odd in these runs, even elsewhere
+        if ((c >= 0x139 && c <= 0x148) || (c >= 0x179 && c <= 0x17E))
+            return (c & 1) ? c + 1 : c;
+        return c | 1;
+    }
+    if (c >= 0x386 && c <= 0x3AB)
+    {
+        if (c == 0x386)
+            return 0x3AC;
+        if (c >= 0x388 && c <= 0x38A)
+            return c + 37;
+        if (c == 0x38C)
+            return 0x3CC;
+        if (c == 0x38E || c == 0x38F)
+            return c + 63;
+        if (c >= 0x391 && c != 0x3A2)
+            return c + 32;
+        return c;
+    }
+    if (c == 0x3C2)
+        return 0x3C3;   // final sigma
+    if (c >= 0x400 && c <= 0x40F)
+        return c + 80;
+    if (c >= 0x410 && c <= 0x42F)
+        return c + 32;
+    if ((c >= 0x460 && c <= 0x481) || (c >= 0x48A && c <= 0x4BF) || (c >= 0x4D0 && c <= 0x52F))
+        return c | 1;
+    if (c == 0x4C0)
+        return 0x4CF;
+    if (c >= 0x4C1 && c <= 0x4CE)
+        return (c & 1) ? c + 1 : c;
+    return c;
+}
+
+size_t pst_name_fold(const char *in, char *out, size_t out_size)
+{
+    const uint8_t *s = (const uint8_t *)in;
+    size_t n = 0;
+
+    if (!out_size)
+        return 0;
+    while (*s && n + 1 < out_size)
+    {
+        uint8_t b = s[0];
+        if (b < 0x80)
+        {
+            out[n++] = (char)fold_cp(b);
+            s++;
+        }
+        else if ((b & 0xE0) == 0xC0 && (s[1] & 0xC0) == 0x80)
+        {
+            if (n + 2 >= out_size)
+                break;
+            uint32_t c = fold_cp((uint32_t)(b & 0x1F) << 6 | (s[1] & 0x3F));
+            out[n++] = (char)(0xC0 | c >> 6);
+            out[n++] = (char)(0x80 | (c & 0x3F));
+            s += 2;
+        }
+        else
+        {
+            // Longer sequences have no case to fold here; stray bytes are kept
+            out[n++] = (char)b;
+            s++;
+        }
+    }
+    out[n] = '\0';
+    return n;
+}
+
+bool pst_name_match(const char *name, const char *folded_query)
+{
+    char folded[NAME_MAX_BYTES];
+
+    pst_name_fold(name, folded, sizeof(folded));
+    return strstr(folded, folded_query) != NULL;
+}
+
+static inline uint32_t tri_hash(const char *p)
+{
+    const uint8_t *u = (const uint8_t *)p;
+    return ((uint32_t)u[0] << 16 | (uint32_t)u[1] << 8 | u[2]) * 2654435761u >> (32 - TRI_BITS);
+}
+
+static inline uint32_t post_at(const pst_name_index_t *idx, uint32_t k)
+{
+    return idx->post_wide ? ((const uint32_t *)idx->post)[k] : ((const uint16_t *)idx->post)[k];
+}
+
+// Postings of every trigram bucket, each name once per bucket
+static bool build_trigrams(pst_name_index_t *idx)
+{
+    uint32_t *last = INDEX_MALLOC(TRI_BUCKETS * sizeof(uint32_t));
+    idx->bucket = INDEX_MALLOC((TRI_BUCKETS + 1) * sizeof(uint32_t));
+    if (!last || !idx->bucket)
+        goto fail;
+
+    memset(idx->bucket, 0, (TRI_BUCKETS + 1) * sizeof(uint32_t));
+    memset(last, 0xFF, TRI_BUCKETS * sizeof(uint32_t));
+    for (uint32_t id = 0; id < idx->count; id++)
+    {
+        const char *s = idx->fold + idx->fold_off[id];
+        for (; s[0] && s[1] && s[2]; s++)
+        {
+            uint32_t h = tri_hash(s);
+            if (last[h] != id)
+            {
+                last[h] = id;
+                idx->bucket[h + 1]++;
+            }
+        }
+    }
+    for (uint32_t h = 0; h < TRI_BUCKETS; h++)
+        idx->bucket[h + 1] += idx->bucket[h];
+    idx->post_len = idx->bucket[TRI_BUCKETS];
+
+    idx->post_wide = idx->count >= POST16_MAX;
+    size_t post_size = idx->post_wide ? sizeof(uint32_t) : sizeof(uint16_t);
+    idx->post = INDEX_MALLOC((idx->post_len ? idx->post_len : 1) * post_size);
+    if (!idx->post)
+        goto fail;
+
+    // bucket[h] is the fill cursor of h, then shifted back to its start
+    memset(last, 0xFF, TRI_BUCKETS * sizeof(uint32_t));
+    for (uint32_t id = 0; id < idx->count; id++)
+    {
+        const char *s = idx->fold + idx->fold_off[id];
+        for (; s[0] && s[1] && s[2]; s++)
+        {
+            uint32_t h = tri_hash(s);
+            if (last[h] != id)
+            {
+                last[h] = id;
+                if (idx->post_wide)
+                    ((uint32_t *)idx->post)[idx->bucket[h]++] = id;
+                else
+                    ((uint16_t *)idx->post)[idx->bucket[h]++] = (uint16_t)id;
+            }
+        }
+    }
+    for (uint32_t h = TRI_BUCKETS; h > 0; h--)
+        idx->bucket[h] = idx->bucket[h - 1];
+    idx->bucket[0] = 0;
+    INDEX_FREE(last);
+    return true;
+
+fail:
+    INDEX_FREE(last);
+    INDEX_FREE(idx->bucket);
+    idx->bucket = NULL;
+    return false;
+}
+
+pst_name_index_t *pst_name_index_build(uint32_t count, pst_name_get_cb_t get_name, void *arg)
+{
+    pst_name_index_t *idx = INDEX_MALLOC(sizeof(*idx));
+    if (!idx)
+        return NULL;
+    memset(idx, 0, sizeof(*idx));
+    idx->count = count;
+
+    for (uint32_t i = 0; i < count; i++)
+        idx->fold_len += strlen(get_name(i, arg)) + 1;
+    idx->fold = INDEX_MALLOC(idx->fold_len ? idx->fold_len : 1);
+    idx->fold_off = INDEX_MALLOC((count ? count : 1) * sizeof(uint32_t));
+    idx->result = INDEX_MALLOC((count ? count : 1) * sizeof(uint32_t));
+    if (!idx->fold || !idx->fold_off || !idx->result)
+    {
+        pst_name_index_free(idx);
+        return NULL;
+    }
+
+    size_t off = 0;
+    for (uint32_t i = 0; i < count; i++)
+    {
+        const char *name = get_name(i, arg);
+        idx->fold_off[i] = off;
+        off += pst_name_fold(name, idx->fold + off, strlen(name) + 1) + 1;
+    }
+
+    // Without the table (out of memory), queries check every name
+    build_trigrams(idx);
+    return idx;
+}
+
+static inline bool contains(const pst_name_index_t *idx, uint32_t id, const char *q)
+{
+    return strstr(idx->fold + idx->fold_off[id], q) != NULL;
+}
+
+uint32_t pst_name_index_query(pst_name_index_t *idx, const char *query, const uint32_t **ids)
+{
+    char q[PST_NAME_QUERY_MAX];
+    size_t qlen = pst_name_fold(query, q, sizeof(q));
+    uint32_t n = 0;
+
+    if (qlen == 0)
+    {
+        for (uint32_t i = 0; i < idx->count; i++)
+            idx->result[i] = i;
+        n = idx->count;
+    }
+    else if (idx->last[0] && strstr(q, idx->last))
+    {
+        // The query grew: only the previous matches can match (compacted in place)
+        for (uint32_t i = 0; i < idx->result_n; i++)
+        {
+            if (contains(idx, idx->result[i], q))
+                idx->result[n++] = idx->result[i];
+        }
+    }
+    else if (qlen >= 3 && idx->bucket)
+    {
+        // Every match holds every trigram of the query: check the names of the rarest
+        uint32_t best = tri_hash(q);
+        for (size_t j = 1; j + 2 < qlen; j++)
+        {
+            uint32_t h = tri_hash(q + j);
+            if (idx->bucket[h + 1] - idx->bucket[h] < idx->bucket[best + 1] - idx->bucket[best])
+                best = h;
+        }
+        for (uint32_t k = idx->bucket[best]; k < idx->bucket[best + 1]; k++)
+        {
+            uint32_t id = post_at(idx, k);
+            if (contains(idx, id, q))
+                idx->result[n++] = id;
+        }
+    }
+    else
+    {
+        for (uint32_t i = 0; i < idx->count; i++)
+        {
+            if (contains(idx, i, q))
+                idx->result[n++] = i;
+        }
+    }
+
+    idx->result_n = n;
+    memcpy(idx->last, q, qlen + 1);
+    *ids = idx->result;
+    return n;
+}
+
+size_t pst_name_index_bytes(const pst_name_index_t *idx)
+{
+    size_t bytes = sizeof(*idx) + idx->fold_len + 2 * (size_t)idx->count * sizeof(uint32_t);
+    if (idx->bucket)
+        bytes += (TRI_BUCKETS + 1) * sizeof(uint32_t) +
+                 (size_t)idx->post_len * (idx->post_wide ? sizeof(uint32_t) : sizeof(uint16_t));
+    return bytes;
+}
+
+void pst_name_index_free(pst_name_index_t *idx)
+{
+    if (!idx)
+        return;
+    INDEX_FREE(idx->fold);
+    INDEX_FREE(idx->fold_off);
+    INDEX_FREE(idx->bucket);
+    INDEX_FREE(idx->post);
+    INDEX_FREE(idx->result);
+    INDEX_FREE(idx);
+}
@@ -0,0 +1,89 @@
+/**
+ * File name filter index for PST.
+ *
+ * Responsibilities:
+ *  - Answer case-insensitive substring queries over the names of a folder from
+ *    memory, without reading the card
+ *  - Fold case beyond ASCII: Latin-1, Latin Extended-A, Greek and Cyrillic letters
+ *    (simple one-to-one folding, e.g. "Ä" = "ä", "Ω" = "ω", "Д" = "д")
+ *  - Find candidates through a trigram table (the rarest trigram of the query),
+ *    then check them against the folded names
+ *  - Narrow incrementally: a query containing the previous one only checks the
+ *    previous matches
+ *
+ * The index only depends on the C library (names are UTF-8), so
+ * tools/pst_name_bench.c can run it on the host. Memory comes from PSRAM on the
+ * device.
+ *
+ * Postings take 16 bits per name below 65535 names (more than a FAT directory
+ * holds) and 32 bits from there on.
+ *
+ * Requirements:
+ *  - An index is used by one task at a time
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define PST_NAME_QUERY_MAX 256      /*!< Longest query, folded, terminator included */
+
+typedef struct pst_name_index pst_name_index_t;
+
+/**
+ * @brief Returns name `i` of the set being indexed.
+ */
+typedef const char *(*pst_name_get_cb_t)(uint32_t i, void *arg);
+
+/**
+ * @brief Fold the case of a UTF-8 string.
+ *
+ * Folding keeps the length of every character, so out needs strlen(in) + 1 bytes.
+ * Invalid UTF-8 is copied as is.
+ *
+ * @return the length of the folded string, truncated to out_size - 1.
+ */
+size_t pst_name_fold(const char *in, char *out, size_t out_size);
+
+/**
+ * @brief Index a set of names.
+ *
+ * @return the index, NULL if out of memory.
+ */
+pst_name_index_t *pst_name_index_build(uint32_t count, pst_name_get_cb_t get_name, void *arg);
+
+/**
+ * @brief Names containing `query`, ignoring case.
+ *
+ * @param ids  Receives the matching names in ascending order, valid until the
+ *             next query or pst_name_index_free(). An empty query matches all.
+ *
+ * @return the number of matches.
+ */
+uint32_t pst_name_index_query(pst_name_index_t *index, const char *query, const uint32_t **ids);
+
+/**
+ * @brief Memory held by an index.
+ */
+size_t pst_name_index_bytes(const pst_name_index_t *index);
+
+/**
+ * @brief Free an index (NULL is ignored).
+ */
+void pst_name_index_free(pst_name_index_t *index);
+
+/**
+ * @brief true if `name` contains `folded_query` (folded with pst_name_fold()),
+ *        ignoring case. For names not in an index.
+ */
+bool pst_name_match(const char *name, const char *folded_query);
+
+#ifdef __cplusplus
+}
+#endif
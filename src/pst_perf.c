@@ -0,0 +1,180 @@
+#include "pst_perf.h"
+
+#if CONFIG_PST_PERF_BENCH
+
+#include <string.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_cpu.h"
+#include "esp_timer.h"
+#include "esp_log.h"
+
+#if __has_include("xtensa_perfmon_access.h")
+#include "xtensa_perfmon_access.h"
+#include "xtensa_perfmon_masks.h"
+#define PST_PERF_HAS_PERFMON 1
+#else
+#define PST_PERF_HAS_PERFMON 0
+#endif
+
+static const char *TAG = "PST_PERF";
+
+#define PERFMON_ID_ICACHE 0
+#define PERFMON_ID_DCACHE 1
+
+typedef struct {
+    uint32_t frames;
+    uint32_t discarded;
+    uint64_t frame_us_sum;
+    uint32_t frame_us_max;
+    uint64_t flush_us_sum;
+    uint32_t flush_us_max;
+    uint64_t cycles_sum;
+    uint64_t icache_stall_sum;
+    uint64_t dcache_stall_sum;
+} perf_acc_t;
+
+static perf_acc_t s_acc;
+
+// State of the frame in progress (only touched by the LVGL task)
+static int64_t s_frame_t0;
+static uint32_t s_frame_cycles0;
+static int s_frame_core;
+static bool s_frame_flushed;
+static int64_t s_flush_t0;
+static uint32_t s_frame_flush_us;
+#if PST_PERF_HAS_PERFMON
+static bool s_perfmon_ready[portNUM_PROCESSORS];
+#endif
+
+static void perfmon_start(int core)
+{
+#if PST_PERF_HAS_PERFMON
+    // Counters are per core, configure them the first time the task runs there
+    if (!s_perfmon_ready[core])
+    {
+        xtensa_perfmon_init(PERFMON_ID_ICACHE, XTPERF_CNT_I_STALL, XTPERF_MASK_I_STALL_ICM, 0, -1);
+        xtensa_perfmon_init(PERFMON_ID_DCACHE, XTPERF_CNT_D_STALL, XTPERF_MASK_D_STALL_CACHE_MISS, 0, -1);
+        s_perfmon_ready[core] = true;
+    }
+    xtensa_perfmon_stop();
+    xtensa_perfmon_reset(PERFMON_ID_ICACHE);
+    xtensa_perfmon_reset(PERFMON_ID_DCACHE);
+    xtensa_perfmon_start();
+#endif
+}
+
+static void perfmon_stop(uint32_t *icache, uint32_t *dcache)
+{
+#if PST_PERF_HAS_PERFMON
+    xtensa_perfmon_stop();
+    *icache = xtensa_perfmon_value(PERFMON_ID_ICACHE);
+    *dcache = xtensa_perfmon_value(PERFMON_ID_DCACHE);
+#else
+    *icache = 0;
+    *dcache = 0;
+#endif
+}
+
+void pst_perf_frame_begin(void)
+{
+    s_frame_flushed = false;
+    s_frame_flush_us = 0;
+    s_frame_core = xPortGetCoreID();
+    perfmon_start(s_frame_core);
+    s_frame_cycles0 = esp_cpu_get_cycle_count();
+    s_frame_t0 = esp_timer_get_time();
+}
+
+void pst_perf_frame_end(void)
+{
+    uint32_t frame_us = (uint32_t)(esp_timer_get_time() - s_frame_t0);
+    uint32_t cycles = esp_cpu_get_cycle_count() - s_frame_cycles0;
+    uint32_t icache;
+    uint32_t dcache;
+    perfmon_stop(&icache, &dcache);
+
+    // Idle passes of lv_timer_handler() are not frames
+    if (!s_frame_flushed)
+        return;
+
+    if (xPortGetCoreID() != s_frame_core)
+    {
+        s_acc.discarded++;
+        return;
+    }
+
+    s_acc.frames++;
+    s_acc.frame_us_sum += frame_us;
+    if (frame_us > s_acc.frame_us_max)
+        s_acc.frame_us_max = frame_us;
+    s_acc.flush_us_sum += s_frame_flush_us;
+    if (s_frame_flush_us > s_acc.flush_us_max)
+        s_acc.flush_us_max = s_frame_flush_us;
+    s_acc.cycles_sum += cycles;
+    s_acc.icache_stall_sum += icache;
+    s_acc.dcache_stall_sum += dcache;
+
+    if (s_acc.frames >= CONFIG_PST_PERF_REPORT_FRAMES)
+    {
+        pst_perf_report();
+        pst_perf_reset();
+    }
+}
+
+void pst_perf_flush_begin(void)
+{
+    s_flush_t0 = esp_timer_get_time();
+}
+
+void pst_perf_flush_end(void)
+{
+    s_frame_flush_us += (uint32_t)(esp_timer_get_time() - s_flush_t0);
+    s_frame_flushed = true;
+}
+
+void pst_perf_get_stats(pst_perf_stats_t *out)
+{
+    perf_acc_t acc = s_acc;
+    uint32_t n = acc.frames ? acc.frames : 1;
+
+    memset(out, 0, sizeof(*out));
+    out->frames = acc.frames;
+    out->discarded = acc.discarded;
+    out->frame_us_avg = (uint32_t)(acc.frame_us_sum / n);
+    out->frame_us_max = acc.frame_us_max;
+    out->flush_us_avg = (uint32_t)(acc.flush_us_sum / n);
+    out->flush_us_max = acc.flush_us_max;
+    out->cycles_avg = (uint32_t)(acc.cycles_sum / n);
+    out->icache_stall_avg = (uint32_t)(acc.icache_stall_sum / n);
+    out->dcache_stall_avg = (uint32_t)(acc.dcache_stall_sum / n);
+    out->fast_mem_profile = PST_FAST_MEM_PROFILE;
+}
+
+void pst_perf_reset(void)
+{
+    memset(&s_acc, 0, sizeof(s_acc));
+}
+
+void pst_perf_report(void)
+{
+    pst_perf_stats_t st;
+    pst_perf_get_stats(&st);
+
+    ESP_LOGI(TAG, "[%s] frames=%lu (discarded %lu) frame avg=%luus max=%luus flush avg=%luus max=%luus",
+             st.fast_mem_profile ? "fast-mem" : "baseline",
+             (unsigned long)st.frames, (unsigned long)st.discarded,
+             (unsigned long)st.frame_us_avg, (unsigned long)st.frame_us_max,
+             (unsigned long)st.flush_us_avg, (unsigned long)st.flush_us_max);
+    ESP_LOGI(TAG, "[%s] cycles/frame=%lu icache-miss stall=%lu (%lu.%lu%%) dcache-miss stall=%lu (%lu.%lu%%)",
+             st.fast_mem_profile ? "fast-mem" : "baseline",
+             (unsigned long)st.cycles_avg,
+             (unsigned long)st.icache_stall_avg,
+             (unsigned long)(st.cycles_avg ? (uint64_t)st.icache_stall_avg * 100 / st.cycles_avg : 0),
+             (unsigned long)(st.cycles_avg ? (uint64_t)st.icache_stall_avg * 1000 / st.cycles_avg % 10 : 0),
+             (unsigned long)st.dcache_stall_avg,
+             (unsigned long)(st.cycles_avg ? (uint64_t)st.dcache_stall_avg * 100 / st.cycles_avg : 0),
+             (unsigned long)(st.cycles_avg ? (uint64_t)st.dcache_stall_avg * 1000 / st.cycles_avg % 10 : 0));
+}
+
+#endif
@@ -0,0 +1,104 @@
+/**
+ * Hot-path placement profile and frame bench for PST.
+ *
+ * Responsibilities:
+ *  - Provide PST_IRAM_ATTR / PST_DRAM_ATTR for render and input hot paths
+ *    (active with CONFIG_PST_FAST_MEM_PROFILE)
+ *  - In bench mode (CONFIG_PST_PERF_BENCH), measure each rendered frame:
+ *    wall time, flush time, CPU cycles and cache-miss stall cycles
+ *  - Log a summary tagged with the active profile, so an A/B comparison is
+ *    two builds that differ only in CONFIG_PST_FAST_MEM_PROFILE
+ *
+ * With bench mode off, every hook below compiles to nothing.
+ *
+ * The profile only places code through attributes. Untagged LVGL helpers and
+ * rodata would need a linker fragment naming LVGL's archive; LVGL comes from
+ * PlatformIO's lib_deps, outside the IDF components ldgen maps. Add one only
+ * together with bench numbers showing the stall counters move.
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "sdkconfig.h"
+#include "esp_attr.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#if CONFIG_PST_FAST_MEM_PROFILE
+#define PST_FAST_MEM_PROFILE 1
+#define PST_IRAM_ATTR IRAM_ATTR
+#define PST_DRAM_ATTR DRAM_ATTR
+#else
+#define PST_FAST_MEM_PROFILE 0
+#define PST_IRAM_ATTR
+#define PST_DRAM_ATTR
+#endif
+
+/**
+ * @brief Frame statistics since the last reset.
+ *
+ * Only loop iterations of the LVGL task that flushed at least once count as a frame.
+ * Stall counters are core-wide while the frame runs, so they include interrupts
+ * and any task that ran on the same core during a blocking flush.
+ */
+typedef struct {
+    uint32_t frames;            /*!< Frames measured */
+    uint32_t discarded;         /*!< Frames dropped because the task changed core */
+    uint32_t frame_us_avg;      /*!< Average lv_timer_handler() time of a rendering pass */
+    uint32_t frame_us_max;      /*!< Worst rendering pass */
+    uint32_t flush_us_avg;      /*!< Average time spent in the flush callback */
+    uint32_t flush_us_max;      /*!< Worst flush callback */
+    uint32_t cycles_avg;        /*!< Average CPU cycles per frame */
+    uint32_t icache_stall_avg;  /*!< Average cycles per frame stalled on I-cache misses (0 without perfmon) */
+    uint32_t dcache_stall_avg;  /*!< Average cycles per frame stalled on D-cache misses (0 without perfmon) */
+    bool fast_mem_profile;      /*!< CONFIG_PST_FAST_MEM_PROFILE of this build */
+} pst_perf_stats_t;
+
+#if CONFIG_PST_PERF_BENCH
+
+/**
+ * @brief Mark the start/end of one LVGL task iteration (around lv_timer_handler()).
+ */
+void pst_perf_frame_begin(void);
+void pst_perf_frame_end(void);
+
+/**
+ * @brief Mark the start/end of the display flush callback.
+ */
+void pst_perf_flush_begin(void);
+void pst_perf_flush_end(void);
+
+/**
+ * @brief Copy the statistics accumulated since the last reset.
+ */
+void pst_perf_get_stats(pst_perf_stats_t *out);
+
+/**
+ * @brief Clear all accumulated statistics.
+ */
+void pst_perf_reset(void);
+
+/**
+ * @brief Log the current statistics, tagged with the placement profile.
+ */
+void pst_perf_report(void);
+
+#else
+
+static inline void pst_perf_frame_begin(void) {}
+static inline void pst_perf_frame_end(void) {}
+static inline void pst_perf_flush_begin(void) {}
+static inline void pst_perf_flush_end(void) {}
+static inline void pst_perf_get_stats(pst_perf_stats_t *out) { *out = (pst_perf_stats_t) { .fast_mem_profile = PST_FAST_MEM_PROFILE }; }
+static inline void pst_perf_reset(void) {}
+static inline void pst_perf_report(void) {}
+
+#endif
+
+#ifdef __cplusplus
+}
+#endif
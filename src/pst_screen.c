@@ -0,0 +1,233 @@
+#include <lvgl.h>
+#include <string.h>
+#include "esp_heap_caps.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_bsp.h"
+#include "pst_screen.h"
+
+static const char *TAG = "PST_SCREEN";
+
+typedef struct {
+    bool registered;
+    pst_screen_desc_t desc;
+    lv_obj_t *scr;          // NULL while not resident
+    uint32_t last_show;     // LRU stamp
+    pst_screen_stats_t st;
+} screen_t;
+
+static screen_t s_screens[PST_SCREEN_MAX];
+static pst_screen_id_t s_active = PST_SCREEN_MAX;
+static size_t s_budget = 0;
+static bool s_ready = false;
+static uint32_t s_show_tick = 0;
+
+static size_t heap_free(void)
+{
+    return heap_caps_get_free_size(MALLOC_CAP_8BIT);
+}
+
+static const char *screen_name(pst_screen_id_t id)
+{
+    const char *name = s_screens[id].desc.name;
+    return name ? name : "?";
+}
+
+static void screen_delete_cb(lv_event_t *e)
+{
+    screen_t *s = lv_event_get_user_data(e);
+    // An old copy may be deleted after a rebuild in place
+    if (s->scr == lv_event_get_target(e))
+    {
+        s->scr = NULL;
+        s->st.resident = false;
+    }
+}
+
+static esp_err_t build(pst_screen_id_t id)
+{
+    screen_t *s = &s_screens[id];
+    size_t free0 = heap_free();
+    int64_t t0 = esp_timer_get_time();
+
+    lv_obj_t *scr = lv_obj_create(NULL);
+    if (!scr)
+        return ESP_ERR_NO_MEM;
+    lv_obj_add_event_cb(scr, screen_delete_cb, LV_EVENT_DELETE, s);
+    s->scr = scr;
+    s->desc.build(scr, s->desc.user_data);
+
+    size_t free1 = heap_free();
+    s->st.build_us = (uint32_t)(esp_timer_get_time() - t0);
+    s->st.mem_bytes = free0 > free1 ? free0 - free1 : 0;
+    s->st.builds++;
+    s->st.resident = true;
+
+    ESP_LOGI(TAG, "Built %s in %lu us, %u bytes", screen_name(id),
+             (unsigned long)s->st.build_us, (unsigned)s->st.mem_bytes);
+    return ESP_OK;
+}
+
+static size_t resident_bytes(void)
+{
+    size_t total = 0;
+    for (int i = 0; i < PST_SCREEN_MAX; i++)
+    {
+        if (s_screens[i].scr)
+            total += s_screens[i].st.mem_bytes;
+    }
+    return total;
+}
+
+/**
+ * Delete least recently shown screens until the resident ones fit the budget.
+ * The active screen, `keep` and pinned screens are never evicted.
+ */
+static void enforce_budget(pst_screen_id_t keep)
+{
+    while (resident_bytes() > s_budget)
+    {
+        int victim = -1;
+        for (int i = 0; i < PST_SCREEN_MAX; i++)
+        {
+            screen_t *s = &s_screens[i];
+            if (!s->scr || i == (int)keep || i == (int)s_active || s->desc.pinned)
+                continue;
+            if (victim < 0 || s->last_show < s_screens[victim].last_show)
+                victim = i;
+        }
+        if (victim < 0)
+            return;
+
+        ESP_LOGI(TAG, "Evict %s (%u bytes)", screen_name(victim), (unsigned)s_screens[victim].st.mem_bytes);
+        s_screens[victim].st.evictions++;
+        lv_obj_del(s_screens[victim].scr);
+    }
+}
+
+static esp_err_t prepare(pst_screen_id_t id, bool show)
+{
+    if (!s_ready || id >= PST_SCREEN_MAX || !s_screens[id].registered)
+        return ESP_ERR_INVALID_ARG;
+    if (!bsp_display_lock(0))
+        return ESP_ERR_TIMEOUT;
+
+    screen_t *s = &s_screens[id];
+    int64_t t0 = esp_timer_get_time();
+    esp_err_t ret = ESP_OK;
+
+    if (!s->scr)
+        ret = build(id);
+
+    if (ret == ESP_OK && show)
+    {
+        if (s_active != id)
+            lv_scr_load(s->scr);
+        s_active = id;
+        s->last_show = ++s_show_tick;
+        s->st.shows++;
+        s->st.show_us = (uint32_t)(esp_timer_get_time() - t0);
+    }
+
+    if (ret == ESP_OK)
+        enforce_budget(id);
+
+    bsp_display_unlock();
+    return ret;
+}
+
+esp_err_t pst_screen_init(const pst_screen_cfg_t *cfg)
+{
+    const pst_screen_cfg_t def_cfg = PST_SCREEN_DEFAULT_CONFIG();
+
+    if (s_ready)
+        return ESP_ERR_INVALID_STATE;
+
+    s_budget = (cfg ? cfg : &def_cfg)->budget_bytes;
+    memset(s_screens, 0, sizeof(s_screens));
+    s_active = PST_SCREEN_MAX;
+    s_ready = true;
+    return ESP_OK;
+}
+
+esp_err_t pst_screen_register(pst_screen_id_t id, const pst_screen_desc_t *desc)
+{
+    if (!s_ready || id >= PST_SCREEN_MAX || !desc || !desc->build)
+        return ESP_ERR_INVALID_ARG;
+
+    s_screens[id].desc = *desc;
+    s_screens[id].registered = true;
+    return ESP_OK;
+}
+
+esp_err_t pst_screen_show(pst_screen_id_t id)
+{
+    return prepare(id, true);
+}
+
+esp_err_t pst_screen_prebuild(pst_screen_id_t id)
+{
+    return prepare(id, false);
+}
+
+void pst_screen_invalidate(pst_screen_id_t id)
+{
+    if (!s_ready || id >= PST_SCREEN_MAX || !bsp_display_lock(0))
+        return;
+
+    screen_t *s = &s_screens[id];
+    lv_obj_t *old = s->scr;
+    if (old && id != s_active)
+    {
+        lv_obj_del(old);
+    }
+    else if (old)
+    {
+        // The active screen cannot be deleted: build the new one, switch, then drop the old
+        s->scr = NULL;
+        if (build(id) == ESP_OK)
+        {
+            lv_scr_load(s->scr);
+            lv_obj_del(old);
+        }
+        else
+        {
+            s->scr = old;
+        }
+    }
+
+    bsp_display_unlock();
+}
+
+pst_screen_id_t pst_screen_get_active(void)
+{
+    return s_active;
+}
+
+bool pst_screen_get_stats(pst_screen_id_t id, pst_screen_stats_t *out)
+{
+    if (id >= PST_SCREEN_MAX)
+        return false;
+
+    bsp_display_lock(0);
+    *out = s_screens[id].st;
+    bsp_display_unlock();
+    return true;
+}
+
+void pst_screen_report(void)
+{
+    bsp_display_lock(0);
+    ESP_LOGI(TAG, "Resident %u / %u bytes", (unsigned)resident_bytes(), (unsigned)s_budget);
+    for (int i = 0; i < PST_SCREEN_MAX; i++)
+    {
+        screen_t *s = &s_screens[i];
+        if (!s->registered)
+            continue;
+        ESP_LOGI(TAG, "%-8s %s build=%luus mem=%uB last show=%luus builds=%lu shows=%lu evictions=%lu",
+                 screen_name(i), s->scr ? "resident" : "unloaded",
+                 (unsigned long)s->st.build_us, (unsigned)s->st.mem_bytes, (unsigned long)s->st.show_us,
+                 (unsigned long)s->st.builds, (unsigned long)s->st.shows, (unsigned long)s->st.evictions);
+    }
+    bsp_display_unlock();
+}
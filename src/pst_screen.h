@@ -0,0 +1,150 @@
+/**
+ * Resident screen manager for the PST modes (Edit, Control, Status).
+ *
+ * Responsibilities:
+ *  - Build each mode's widget tree once, on its own LVGL screen, the first time it is shown
+ *  - Keep built screens resident up to a memory budget and switch with lv_scr_load(),
+ *    so a mode switch costs one frame instead of a rebuild
+ *  - Evict the least recently shown screens when the budget is exceeded
+ *  - Report build time and memory footprint per screen
+ *
+ * A screen's memory is measured as the drop in free heap across its build
+ * callback (LV_MEM_CUSTOM routes LVGL allocations through malloc), so it
+ * includes whatever the callback allocates besides widgets.
+ *
+ * Requirements:
+ *  - Display + LVGL must already be initialized via bsp_display_start_with_config()
+ *  - Build callbacks must not keep pointers into their screen after it is deleted:
+ *    add an LV_EVENT_DELETE handler to clear them, the screen may be evicted
+ *    whenever it is not the active one
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "esp_err.h"
+#include "lvgl.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef enum {
+    PST_SCREEN_EDIT = 0,
+    PST_SCREEN_CONTROL,
+    PST_SCREEN_STATUS,
+    PST_SCREEN_MAX,
+} pst_screen_id_t;
+
+/**
+ * @brief Build a screen's widget tree.
+ *
+ * Called with the LVGL lock held.
+ *
+ * @param scr        Empty screen object to populate.
+ * @param user_data  Pointer given at registration.
+ */
+typedef void (*pst_screen_build_cb_t)(lv_obj_t *scr, void *user_data);
+
+/**
+ * @brief Screen description.
+ */
+typedef struct {
+    const char *name;               /*!< Name used in logs */
+    pst_screen_build_cb_t build;    /*!< Populates the screen */
+    void *user_data;                /*!< Passed to build */
+    bool pinned;                    /*!< Never evicted (still counted in the budget) */
+} pst_screen_desc_t;
+
+/**
+ * @brief Screen manager configuration.
+ */
+typedef struct {
+    size_t budget_bytes;            /*!< Heap that resident screens may use together */
+} pst_screen_cfg_t;
+
+#define PST_SCREEN_DEFAULT_CONFIG()         \
+    {                                       \
+        .budget_bytes = 512 * 1024,         \
+    }
+
+/**
+ * @brief Per-screen statistics.
+ */
+typedef struct {
+    bool resident;                  /*!< Widget tree currently built */
+    uint32_t builds;                /*!< Times the screen was built */
+    uint32_t shows;                 /*!< Times the screen was shown */
+    uint32_t evictions;             /*!< Times the screen was evicted */
+    uint32_t build_us;              /*!< Duration of the last build */
+    uint32_t show_us;               /*!< Duration of the last switch (build included if any) */
+    size_t mem_bytes;               /*!< Heap used by the last build */
+} pst_screen_stats_t;
+
+/**
+ * @brief Initialize the screen manager.
+ *
+ * @param cfg  Configuration, NULL for PST_SCREEN_DEFAULT_CONFIG().
+ *
+ * @return
+ *      - ESP_OK                 on success
+ *      - ESP_ERR_INVALID_STATE  if already initialized
+ */
+esp_err_t pst_screen_init(const pst_screen_cfg_t *cfg);
+
+/**
+ * @brief Register the builder of a screen. The screen is built lazily.
+ *
+ * @return
+ *      - ESP_OK               on success
+ *      - ESP_ERR_INVALID_ARG  if id or desc is invalid
+ */
+esp_err_t pst_screen_register(pst_screen_id_t id, const pst_screen_desc_t *desc);
+
+/**
+ * @brief Make a screen active, building it first if it is not resident.
+ *
+ * @return
+ *      - ESP_OK                 on success
+ *      - ESP_ERR_INVALID_ARG    if the screen is not registered
+ *      - ESP_ERR_TIMEOUT        if the LVGL lock could not be taken
+ *      - ESP_ERR_NO_MEM         if the screen object cannot be created
+ */
+esp_err_t pst_screen_show(pst_screen_id_t id);
+
+/**
+ * @brief Build a screen in advance without showing it.
+ *
+ * @return Same as pst_screen_show().
+ */
+esp_err_t pst_screen_prebuild(pst_screen_id_t id);
+
+/**
+ * @brief Drop a resident screen so that it is rebuilt the next time it is shown.
+ *
+ * The active screen is rebuilt in place.
+ */
+void pst_screen_invalidate(pst_screen_id_t id);
+
+/**
+ * @brief Currently shown screen, or PST_SCREEN_MAX if none.
+ */
+pst_screen_id_t pst_screen_get_active(void);
+
+/**
+ * @brief Copy the statistics of a screen.
+ *
+ * @return false if id is invalid.
+ */
+bool pst_screen_get_stats(pst_screen_id_t id, pst_screen_stats_t *out);
+
+/**
+ * @brief Log build time and memory of every registered screen.
+ */
+void pst_screen_report(void);
+
+#ifdef __cplusplus
+}
+#endif
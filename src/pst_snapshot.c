@@ -0,0 +1,318 @@
+#include <lvgl.h>
+#include <string.h>
+#include "esp_heap_caps.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "pst_snapshot.h"
+
+static const char *TAG = "PST_SNAPSHOT";
+
+struct pst_snapshot_t {
+    lv_obj_t *obj;          // cached subtree, NULL = free slot
+    lv_obj_t *img;          // draws the bitmap in place of obj
+    lv_img_dsc_t dsc;
+    uint8_t *buf;           // PSRAM
+    uint32_t buf_size;
+    bool dirty;
+};
+
+typedef struct {
+    lv_img_dsc_t dsc;
+    uint8_t *buf;
+    uint32_t buf_size;
+} backdrop_t;
+
+static pst_snapshot_t s_snaps[PST_SNAPSHOT_MAX];
+static lv_timer_t *s_retake_timer = NULL;
+static bool s_taking = false;   // ignore the events our own style changes send
+static pst_snapshot_stats_t s_stats;
+
+static void subtree_event_cb(lv_event_t *e);
+
+static void watch_tree(lv_obj_t *obj, pst_snapshot_t *snap)
+{
+    lv_obj_remove_event_cb_with_user_data(obj, subtree_event_cb, snap);
+    lv_obj_add_event_cb(obj, subtree_event_cb, LV_EVENT_ALL, snap);
+
+    uint32_t cnt = lv_obj_get_child_cnt(obj);
+    for (uint32_t i = 0; i < cnt; i++)
+        watch_tree(lv_obj_get_child(obj, i), snap);
+}
+
+static void unwatch_tree(lv_obj_t *obj, pst_snapshot_t *snap)
+{
+    lv_obj_remove_event_cb_with_user_data(obj, subtree_event_cb, snap);
+
+    uint32_t cnt = lv_obj_get_child_cnt(obj);
+    for (uint32_t i = 0; i < cnt; i++)
+        unwatch_tree(lv_obj_get_child(obj, i), snap);
+}
+
+static void set_live(pst_snapshot_t *snap, bool live)
+{
+    s_taking = true;
+    lv_obj_set_style_opa(snap->obj, live ? LV_OPA_COVER : LV_OPA_TRANSP, 0);
+    s_taking = false;
+    if (snap->img)
+    {
+        if (live)
+            lv_obj_add_flag(snap->img, LV_OBJ_FLAG_HIDDEN);
+        else
+            lv_obj_clear_flag(snap->img, LV_OBJ_FLAG_HIDDEN);
+    }
+}
+
+static void *buf_reserve(uint8_t **buf, uint32_t *buf_size, uint32_t need)
+{
+    if (need <= *buf_size)
+        return *buf;
+
+    uint8_t *new_buf = heap_caps_malloc(need, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+    if (!new_buf)
+        return NULL;
+    heap_caps_free(*buf);
+    s_stats.bytes_held += need - *buf_size;
+    *buf = new_buf;
+    *buf_size = need;
+    return new_buf;
+}
+
+static void buf_release(uint8_t **buf, uint32_t *buf_size)
+{
+    heap_caps_free(*buf);
+    s_stats.bytes_held -= *buf_size;
+    *buf = NULL;
+    *buf_size = 0;
+}
+
+static bool take(pst_snapshot_t *snap)
+{
+    lv_obj_t *obj = snap->obj;
+    int64_t t0 = esp_timer_get_time();
+
+    // On failure the live subtree stays visible and the next invalidation retries
+    snap->dirty = false;
+    lv_obj_update_layout(obj);
+    set_live(snap, true);
+
+    uint32_t need = lv_snapshot_buf_size_needed(obj, LV_IMG_CF_TRUE_COLOR_ALPHA);
+    if (!buf_reserve(&snap->buf, &snap->buf_size, need))
+    {
+        ESP_LOGW(TAG, "No memory for a %lu byte snapshot, drawing live", (unsigned long)need);
+        return false;
+    }
+
+    // The image may be in LVGL's cache with the previous header
+    lv_img_cache_invalidate_src(&snap->dsc);
+    if (lv_snapshot_take_to_buf(obj, LV_IMG_CF_TRUE_COLOR_ALPHA, &snap->dsc, snap->buf, snap->buf_size) != LV_RES_OK)
+        return false;
+
+    // The bitmap includes the extra draw area (shadows, outlines) around obj
+    lv_area_t coords;
+    lv_obj_get_coords(obj, &coords);
+    lv_coord_t ext_w = (snap->dsc.header.w - lv_area_get_width(&coords)) / 2;
+    lv_coord_t ext_h = (snap->dsc.header.h - lv_area_get_height(&coords)) / 2;
+    lv_obj_set_pos(snap->img, lv_obj_get_x(obj) - ext_w, lv_obj_get_y(obj) - ext_h);
+    lv_img_set_src(snap->img, &snap->dsc);
+
+    // Children created since the last snapshot must be watched too
+    watch_tree(obj, snap);
+    set_live(snap, false);
+
+    s_stats.taken++;
+    s_stats.last_take_us = (uint32_t)(esp_timer_get_time() - t0);
+    return true;
+}
+
+static void retake_timer_cb(lv_timer_t *timer)
+{
+    for (int i = 0; i < PST_SNAPSHOT_MAX; i++)
+    {
+        pst_snapshot_t *snap = &s_snaps[i];
+        if (snap->obj && snap->dirty)
+            take(snap);
+    }
+    lv_timer_pause(timer);
+}
+
+static void subtree_event_cb(lv_event_t *e)
+{
+    if (s_taking)
+        return;
+
+    switch (lv_event_get_code(e))
+    {
+    case LV_EVENT_CHILD_CHANGED:
+    case LV_EVENT_SIZE_CHANGED:
+    case LV_EVENT_STYLE_CHANGED:
+    case LV_EVENT_VALUE_CHANGED:
+    case LV_EVENT_PRESSED:
+    case LV_EVENT_RELEASED:
+    case LV_EVENT_PRESS_LOST:
+        pst_snapshot_invalidate(lv_event_get_user_data(e));
+        break;
+    default:
+        break;
+    }
+}
+
+static void img_delete_cb(lv_event_t *e)
+{
+    pst_snapshot_t *snap = lv_event_get_user_data(e);
+    snap->img = NULL;
+}
+
+static void release(pst_snapshot_t *snap, bool obj_deleted)
+{
+    if (!obj_deleted)
+    {
+        unwatch_tree(snap->obj, snap);
+        set_live(snap, true);
+    }
+    if (snap->img)
+    {
+        lv_obj_remove_event_cb(snap->img, img_delete_cb);
+        lv_obj_del(snap->img);
+    }
+    lv_img_cache_invalidate_src(&snap->dsc);
+    buf_release(&snap->buf, &snap->buf_size);
+    memset(snap, 0, sizeof(*snap));
+    s_stats.attached--;
+}
+
+static void obj_delete_cb(lv_event_t *e)
+{
+    release(lv_event_get_user_data(e), true);
+}
+
+pst_snapshot_t *pst_snapshot_attach(lv_obj_t *obj)
+{
+    lv_obj_t *parent = obj ? lv_obj_get_parent(obj) : NULL;
+    if (!parent)
+        return NULL;
+
+    pst_snapshot_t *snap = NULL;
+    for (int i = 0; i < PST_SNAPSHOT_MAX && !snap; i++)
+    {
+        if (!s_snaps[i].obj)
+            snap = &s_snaps[i];
+    }
+    if (!snap)
+    {
+        ESP_LOGW(TAG, "All %d snapshot slots in use", PST_SNAPSHOT_MAX);
+        return NULL;
+    }
+
+    if (!s_retake_timer)
+    {
+        s_retake_timer = lv_timer_create(retake_timer_cb, 0, NULL);
+        if (!s_retake_timer)
+            return NULL;
+        lv_timer_pause(s_retake_timer);
+    }
+
+    lv_obj_t *img = lv_img_create(parent);
+    if (!img)
+        return NULL;
+    lv_obj_add_flag(img, LV_OBJ_FLAG_IGNORE_LAYOUT | LV_OBJ_FLAG_HIDDEN);
+    lv_obj_clear_flag(img, LV_OBJ_FLAG_CLICKABLE);
+    // Right below obj, which stays on top to receive input
+    lv_obj_move_to_index(img, lv_obj_get_index(obj));
+
+    snap->obj = obj;
+    snap->img = img;
+    lv_obj_add_event_cb(img, img_delete_cb, LV_EVENT_DELETE, snap);
+    lv_obj_add_event_cb(obj, obj_delete_cb, LV_EVENT_DELETE, snap);
+    s_stats.attached++;
+
+    if (!take(snap))
+    {
+        lv_obj_remove_event_cb(obj, obj_delete_cb);
+        release(snap, false);
+        return NULL;
+    }
+    return snap;
+}
+
+void pst_snapshot_invalidate(pst_snapshot_t *snap)
+{
+    if (!snap || !snap->obj || snap->dirty)
+        return;
+
+    snap->dirty = true;
+    s_stats.invalidations++;
+    set_live(snap, true);
+    // Batch the changes of this LVGL pass into one snapshot
+    lv_timer_resume(s_retake_timer);
+    lv_timer_ready(s_retake_timer);
+}
+
+void pst_snapshot_detach(pst_snapshot_t *snap)
+{
+    if (!snap || !snap->obj)
+        return;
+
+    lv_obj_remove_event_cb(snap->obj, obj_delete_cb);
+    release(snap, false);
+}
+
+static void backdrop_delete_cb(lv_event_t *e)
+{
+    backdrop_t *bd = lv_event_get_user_data(e);
+    lv_img_cache_invalidate_src(&bd->dsc);
+    buf_release(&bd->buf, &bd->buf_size);
+    lv_mem_free(bd);
+}
+
+lv_obj_t *pst_snapshot_backdrop_create(lv_obj_t *scr, lv_opa_t dim)
+{
+    int64_t t0 = esp_timer_get_time();
+
+    backdrop_t *bd = lv_mem_alloc(sizeof(backdrop_t));
+    if (!bd)
+        return NULL;
+    memset(bd, 0, sizeof(*bd));
+
+    uint32_t need = lv_snapshot_buf_size_needed(scr, LV_IMG_CF_TRUE_COLOR);
+    if (!buf_reserve(&bd->buf, &bd->buf_size, need) ||
+        lv_snapshot_take_to_buf(scr, LV_IMG_CF_TRUE_COLOR, &bd->dsc, bd->buf, bd->buf_size) != LV_RES_OK)
+    {
+        ESP_LOGW(TAG, "Cannot snapshot the screen (%lu bytes)", (unsigned long)need);
+        buf_release(&bd->buf, &bd->buf_size);
+        lv_mem_free(bd);
+        return NULL;
+    }
+
+    // Dim once here instead of blending a translucent layer every frame
+    lv_color_t *px = (lv_color_t *)bd->buf;
+    uint32_t px_cnt = (uint32_t)bd->dsc.header.w * bd->dsc.header.h;
+    lv_color_t black = lv_color_black();
+    for (uint32_t i = 0; i < px_cnt; i++)
+        px[i] = lv_color_mix(black, px[i], dim);
+
+    lv_obj_t *base = lv_obj_create(scr);
+    lv_obj_set_size(base, LV_PCT(100), LV_PCT(100));
+    lv_obj_set_style_pad_all(base, 0, 0);
+    lv_obj_set_style_border_width(base, 0, 0);
+    lv_obj_set_style_radius(base, 0, 0);
+    lv_obj_set_style_bg_opa(base, LV_OPA_COVER, 0);
+    lv_obj_set_style_bg_img_src(base, &bd->dsc, 0);
+    lv_obj_clear_flag(base, LV_OBJ_FLAG_SCROLLABLE);
+    lv_obj_add_event_cb(base, backdrop_delete_cb, LV_EVENT_DELETE, bd);
+
+    s_stats.taken++;
+    s_stats.last_take_us = (uint32_t)(esp_timer_get_time() - t0);
+    return base;
+}
+
+void pst_snapshot_get_stats(pst_snapshot_stats_t *out)
+{
+    *out = s_stats;
+}
+
+void pst_snapshot_reset_stats(void)
+{
+    s_stats.taken = 0;
+    s_stats.invalidations = 0;
+    s_stats.last_take_us = 0;
+}
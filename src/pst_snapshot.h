@@ -0,0 +1,102 @@
+/**
+ * Snapshot cache for static LVGL subtrees and modal backdrops.
+ *
+ * Responsibilities:
+ *  - Render a static subtree once into a PSRAM bitmap with lv_snapshot and draw
+ *    that bitmap in its place, so a frame costs one blit instead of the widget tree
+ *  - Re-render the bitmap automatically when the subtree changes (children added or
+ *    removed, size, style, value or pressed state), or on explicit invalidation
+ *  - Build opaque, pre-dimmed backdrops for modals from a snapshot of the active screen,
+ *    so LVGL stops rendering (and re-blending) the widgets underneath
+ *  - Count snapshots, invalidations and PSRAM held
+ *
+ * The cached subtree stays in place with its opacity set to 0: LVGL skips rendering it,
+ * but it still receives input. Changes that send no LVGL event (e.g. lv_label_set_text())
+ * need pst_snapshot_invalidate().
+ *
+ * Requirements:
+ *  - Display + LVGL must already be initialized via bsp_display_start_with_config()
+ *  - All functions must be called with the LVGL lock held (from LVGL callbacks, or
+ *    between bsp_display_lock() / bsp_display_unlock())
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "lvgl.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Maximum number of subtrees cached at the same time.
+ */
+#define PST_SNAPSHOT_MAX 8
+
+typedef struct pst_snapshot_t pst_snapshot_t;
+
+/**
+ * @brief Snapshot counters since boot (or the last pst_snapshot_reset_stats()).
+ */
+typedef struct {
+    uint32_t taken;             /*!< Snapshots rendered (attached subtrees and backdrops) */
+    uint32_t invalidations;     /*!< Invalidations, automatic or explicit */
+    uint32_t last_take_us;      /*!< Duration of the last snapshot */
+    size_t bytes_held;          /*!< PSRAM currently used by bitmaps */
+    uint8_t attached;           /*!< Subtrees currently cached */
+} pst_snapshot_stats_t;
+
+/**
+ * @brief Cache the rendering of a static subtree.
+ *
+ * The bitmap is drawn by an image created next to `obj` in its parent. The cache is
+ * released automatically when `obj` is deleted.
+ *
+ * @param obj  Root of the subtree. It must have a parent (screens cannot be attached).
+ *
+ * @return Handle, or NULL if no slot or memory is available (obj is then left as is).
+ */
+pst_snapshot_t *pst_snapshot_attach(lv_obj_t *obj);
+
+/**
+ * @brief Re-render a cached subtree before the next frame.
+ *
+ * Until then the live subtree is drawn, so the screen never shows stale content.
+ */
+void pst_snapshot_invalidate(pst_snapshot_t *snap);
+
+/**
+ * @brief Stop caching: free the bitmap and draw the live subtree again.
+ */
+void pst_snapshot_detach(pst_snapshot_t *snap);
+
+/**
+ * @brief Create an opaque full-size object showing a dimmed snapshot of a screen.
+ *
+ * Use it as the base of a modal: children added to it are drawn on the frozen,
+ * dimmed picture and nothing below it is rendered while it is shown.
+ * The bitmap is freed when the object is deleted.
+ *
+ * @param scr  Screen to capture and create the backdrop on (usually lv_scr_act()).
+ * @param dim  Amount of black mixed in (LV_OPA_50 = half dimmed).
+ *
+ * @return The backdrop, or NULL if the bitmap cannot be allocated.
+ */
+lv_obj_t *pst_snapshot_backdrop_create(lv_obj_t *scr, lv_opa_t dim);
+
+/**
+ * @brief Copy the current counters.
+ */
+void pst_snapshot_get_stats(pst_snapshot_stats_t *out);
+
+/**
+ * @brief Clear snapshot/invalidation counters (occupancy is kept).
+ */
+void pst_snapshot_reset_stats(void);
+
+#ifdef __cplusplus
+}
+#endif
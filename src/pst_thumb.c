@@ -0,0 +1,617 @@
+#include <stdio.h>
+#include <string.h>
+#include <strings.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+#include "esp_heap_caps.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "rom/tjpgd.h"
+#include "ff.h"
+#include "esp_bsp.h"
+#include "pst_dir_cache.h"
+#include "pst_fs.h"
+#include "pst_thumb.h"
+
+static const char *TAG = "PST_THUMB";
+
+#define THUMB_MAGIC 0x54545350u     // "PSTT"
+#define THUMB_VERSION 1
+#define THUMB_RGB565_SWAP LV_COLOR_16_SWAP
+#define JPEG_WORK_SIZE 3100         // work area of the ROM TJpgDec
+#define BMP_MAX_WIDTH 16384
+#define DELIVER_MAX 8               // thumbnails copied to the pool per timer run
+
+typedef struct {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t header_size;
+    uint16_t box;                   // cfg.size the thumbnail was made for
+    uint16_t width;
+    uint16_t height;
+    uint16_t format;                // THUMB_RGB565_SWAP of the writer
+    uint32_t src_size;
+    uint32_t src_mtime;
+    uint16_t path_len;              // the LVGL path follows, then the pixels
+    uint16_t reserved;
+} thumb_header_t;
+
+_Static_assert(sizeof(thumb_header_t) == 28, "thumbnail header must not be padded");
+
+typedef struct {
+    uint64_t key;
+    uint32_t size;
+    uint32_t mtime;
+    char path[PST_DIR_PATH_MAX];
+} thumb_req_t;
+
+// Worker -> LVGL task; width 0 if the image cannot be decoded
+typedef struct {
+    uint64_t key;
+    uint16_t width;
+    uint16_t height;
+    lv_color_t pixels[];
+} thumb_msg_t;
+
+typedef enum {
+    SLOT_FREE,
+    SLOT_PENDING,
+    SLOT_READY,
+    SLOT_FAILED,
+} slot_state_t;
+
+typedef struct {
+    uint64_t key;
+    uint32_t last_use;
+    uint8_t state;
+    lv_img_dsc_t dsc;               // data points into the slot's part of s_pixels
+} thumb_slot_t;
+
+// Sampling of the decoded image, nearest neighbour
+typedef struct {
+    uint16_t tw, th;
+    uint16_t sx[PST_THUMB_MAX_SIZE];
+    uint16_t sy[PST_THUMB_MAX_SIZE];
+    lv_color_t *out;
+} sampler_t;
+
+static pst_thumb_cfg_t s_cfg;
+static QueueHandle_t s_req_q = NULL;
+static QueueHandle_t s_msg_q = NULL;
+static lv_timer_t *s_timer = NULL;
+static pst_thumb_stats_t s_stats;   // disk_hits, decoded, failed, writes_failed are written by the worker
+
+// Pool, LVGL task only
+static thumb_slot_t *s_slots = NULL;
+static lv_color_t *s_pixels = NULL;
+static uint32_t s_tick = 0;
+static pst_thumb_ready_cb_t s_ready_cb = NULL;
+static void *s_ready_arg = NULL;
+
+// Time to first thumbnail: armed by a folder change, started by the first request
+static bool s_first_armed = false;
+static bool s_first_timing = false;
+static int64_t s_first_t0;
+
+// Worker only
+static FIL *s_fil = NULL;
+static void *s_jpeg_work = NULL;
+static sampler_t s_sampler;
+
+static uint64_t thumb_key(const char *path, uint32_t size, uint32_t mtime)
+{
+    const uint32_t tail[2] = { size, mtime };
+    uint64_t h = 0xcbf29ce484222325ull;     // FNV-1a
+
+    for (const char *p = path; *p; p++)
+        h = (h ^ (uint8_t)*p) * 0x100000001b3ull;
+    for (size_t i = 0; i < sizeof(tail); i++)
+        h = (h ^ ((const uint8_t *)tail)[i]) * 0x100000001b3ull;
+    return h;
+}
+
+// "0:/.pstthumb/c/c0ffee0123456789"; dir_len is the length of the shard folder part
+static bool thumb_file_path(uint64_t key, char *out, size_t len, size_t *dir_len)
+{
+    const char *drive = bsp_sd_get_fatfs_drive();
+    unsigned long hi = (unsigned long)(key >> 32), lo = (unsigned long)key;
+
+    if (!drive || snprintf(out, len, "%s/%s/%lx/%08lx%08lx", drive, PST_THUMB_DIR_NAME, hi >> 28, hi, lo) >= (int)len)
+        return false;
+    *dir_len = strrchr(out, '/') - out;
+    return true;
+}
+
+static bool read_all(FIL *f, void *buf, uint32_t len)
+{
+    UINT got;
+    return f_read(f, buf, len, &got) == FR_OK && got == len;
+}
+
+static bool write_all(FIL *f, const void *buf, uint32_t len)
+{
+    UINT put;
+    return f_write(f, buf, len, &put) == FR_OK && put == len;
+}
+
+// Largest size fitting the box with the source aspect, never enlarged
+static void fit(uint32_t w, uint32_t h, uint16_t box, uint16_t *tw, uint16_t *th)
+{
+    if (w >= h)
+    {
+        *tw = w < box ? w : box;
+        *th = (uint16_t)((uint64_t)h * *tw / w);
+    }
+    else
+    {
+        *th = h < box ? h : box;
+        *tw = (uint16_t)((uint64_t)w * *th / h);
+    }
+    if (!*tw)
+        *tw = 1;
+    if (!*th)
+        *th = 1;
+}
+
+// Source pixel at the centre of each thumbnail pixel
+static void sampler_setup(sampler_t *s, uint32_t w, uint32_t h, lv_color_t *out)
+{
+    fit(w, h, s_cfg.size, &s->tw, &s->th);
+    for (uint16_t i = 0; i < s->tw; i++)
+        s->sx[i] = (uint16_t)(((uint64_t)2 * i + 1) * w / (2u * s->tw));
+    for (uint16_t i = 0; i < s->th; i++)
+        s->sy[i] = (uint16_t)(((uint64_t)2 * i + 1) * h / (2u * s->th));
+    s->out = out;
+    memset(out, 0, (size_t)s->tw * s->th * sizeof(lv_color_t));
+}
+
+static uint32_t jpeg_in(JDEC *dec, uint8_t *buf, uint32_t len)
+{
+    FIL *f = dec->device;
+    UINT got;
+
+    if (!buf)
+        return f_lseek(f, f_tell(f) + len) == FR_OK ? len : 0;
+    return f_read(f, buf, len, &got) == FR_OK ? got : 0;
+}
+
+// Keep the sampled pixels of each decoded block (RGB888)
+static uint32_t jpeg_out(JDEC *dec, void *bitmap, JRECT *rect)
+{
+    const sampler_t *s = &s_sampler;
+    const uint8_t *rgb = bitmap;
+    uint32_t rw = rect->right - rect->left + 1;
+
+    for (uint16_t ty = 0; ty < s->th; ty++)
+    {
+        if (s->sy[ty] < rect->top || s->sy[ty] > rect->bottom)
+            continue;
+        for (uint16_t tx = 0; tx < s->tw; tx++)
+        {
+            if (s->sx[tx] < rect->left || s->sx[tx] > rect->right)
+                continue;
+            const uint8_t *p = rgb + 3 * ((s->sy[ty] - rect->top) * rw + (s->sx[tx] - rect->left));
+            s->out[ty * s->tw + tx] = lv_color_make(p[0], p[1], p[2]);
+        }
+    }
+    return 1;
+}
+
+static bool decode_jpeg(FIL *f, thumb_msg_t *m)
+{
+    JDEC dec;
+    uint8_t scale = 0;
+
+    if (jd_prepare(&dec, jpeg_in, s_jpeg_work, JPEG_WORK_SIZE, f) != JDR_OK || !dec.width || !dec.height)
+        return false;
+
+    // Smallest of the decoder's scales (1/1 to 1/8) still covering the thumbnail
+    uint32_t side = dec.width > dec.height ? dec.width : dec.height;
+    while (scale < 3 && (side >> (scale + 1)) >= s_cfg.size)
+        scale++;
+    uint32_t w = dec.width >> scale, h = dec.height >> scale;
+    sampler_setup(&s_sampler, w ? w : 1, h ? h : 1, m->pixels);
+    if (jd_decomp(&dec, jpeg_out, scale) != JDR_OK)
+        return false;
+    m->width = s_sampler.tw;
+    m->height = s_sampler.th;
+    return true;
+}
+
+static uint32_t rd32(const uint8_t *p)
+{
+    return p[0] | p[1] << 8 | p[2] << 16 | (uint32_t)p[3] << 24;
+}
+
+// Uncompressed 24/32 bpp (BI_RGB, or BI_BITFIELDS with the usual BGRA masks)
+static bool decode_bmp(FIL *f, thumb_msg_t *m)
+{
+    uint8_t h[54];
+
+    if (!read_all(f, h, sizeof(h)) || h[0] != 'B' || h[1] != 'M')
+        return false;
+    uint32_t offset = rd32(h + 10);
+    int32_t width = (int32_t)rd32(h + 18);
+    int32_t height = (int32_t)rd32(h + 22);
+    uint16_t bpp = h[28] | h[29] << 8;
+    uint32_t compression = rd32(h + 30);
+    if (width <= 0 || width > BMP_MAX_WIDTH || height == 0 || height < -BMP_MAX_WIDTH || height > BMP_MAX_WIDTH ||
+        (bpp != 24 && bpp != 32) || (compression != 0 && compression != 3))
+        return false;
+
+    // Rows are stored bottom-up unless the height is negative
+    bool bottom_up = height > 0;
+    uint32_t rows = bottom_up ? height : -height;
+    uint32_t stride = ((uint32_t)width * bpp + 31) / 32 * 4;
+    uint8_t *row = heap_caps_malloc(stride, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+    if (!row)
+        return false;
+
+    sampler_t *s = &s_sampler;
+    sampler_setup(s, width, rows, m->pixels);
+    bool ok = true;
+    for (uint16_t ty = 0; ty < s->th && ok; ty++)
+    {
+        uint32_t y = bottom_up ? rows - 1 - s->sy[ty] : s->sy[ty];
+        ok = f_lseek(f, offset + (FSIZE_t)y * stride) == FR_OK && read_all(f, row, stride);
+        for (uint16_t tx = 0; tx < s->tw && ok; tx++)
+        {
+            const uint8_t *p = row + (uint32_t)s->sx[tx] * (bpp / 8);
+            s->out[ty * s->tw + tx] = lv_color_make(p[2], p[1], p[0]);
+        }
+    }
+    heap_caps_free(row);
+    m->width = s->tw;
+    m->height = s->th;
+    return ok;
+}
+
+static const char *extension(const char *name)
+{
+    const char *dot = strrchr(name, '.');
+    return dot ? dot + 1 : "";
+}
+
+static bool decode(const thumb_req_t *req, thumb_msg_t *m)
+{
+    char fn[PST_DIR_PATH_MAX + 8];
+    const char *ext = extension(req->path);
+    bool ok = false;
+
+    if (!pst_fs_to_fatfs_path(req->path, fn, sizeof(fn)) || f_open(s_fil, fn, FA_READ) != FR_OK)
+        return false;
+    // Both stream the source a row or an MCU at a time; PNG would be decoded whole (pst_thumb.h)
+    if (strcasecmp(ext, "bmp") == 0)
+        ok = decode_bmp(s_fil, m);
+    else
+        ok = decode_jpeg(s_fil, m);
+    f_close(s_fil);
+    return ok;
+}
+
+static bool load_thumb(const char *fn, const thumb_req_t *req, thumb_msg_t *m)
+{
+    thumb_header_t h;
+    char path[PST_DIR_PATH_MAX];
+    size_t path_len = strlen(req->path);
+
+    if (f_open(s_fil, fn, FA_READ) != FR_OK)
+        return false;
+    bool ok = read_all(s_fil, &h, sizeof(h)) && h.magic == THUMB_MAGIC && h.version == THUMB_VERSION &&
+              h.header_size == sizeof(h) && h.box == s_cfg.size && h.format == THUMB_RGB565_SWAP &&
+              h.width && h.width <= s_cfg.size && h.height && h.height <= s_cfg.size &&
+              h.src_size == req->size && h.src_mtime == req->mtime && h.path_len == path_len &&
+              read_all(s_fil, path, path_len) && memcmp(path, req->path, path_len) == 0 &&
+              read_all(s_fil, m->pixels, (uint32_t)h.width * h.height * sizeof(lv_color_t));
+    f_close(s_fil);
+    if (ok)
+    {
+        m->width = h.width;
+        m->height = h.height;
+    }
+    return ok;
+}
+
+static bool save_thumb(char *fn, size_t dir_len, const thumb_req_t *req, const thumb_msg_t *m)
+{
+    const thumb_header_t h = {
+        .magic = THUMB_MAGIC,
+        .version = THUMB_VERSION,
+        .header_size = sizeof(h),
+        .box = s_cfg.size,
+        .width = m->width,
+        .height = m->height,
+        .format = THUMB_RGB565_SWAP,
+        .src_size = req->size,
+        .src_mtime = req->mtime,
+        .path_len = strlen(req->path),
+    };
+
+    if (f_open(s_fil, fn, FA_WRITE | FA_CREATE_ALWAYS) != FR_OK)
+    {
+        // First thumbnail of its shard: create the folders, the top one hidden
+        size_t top_len = dir_len - 2;
+        fn[top_len] = '\0';
+        if (f_mkdir(fn) == FR_OK)
+            f_chmod(fn, AM_HID, AM_HID);
+        fn[top_len] = '/';
+        fn[dir_len] = '\0';
+        f_mkdir(fn);
+        fn[dir_len] = '/';
+        if (f_open(s_fil, fn, FA_WRITE | FA_CREATE_ALWAYS) != FR_OK)
+            return false;
+    }
+    bool ok = write_all(s_fil, &h, sizeof(h)) && write_all(s_fil, req->path, h.path_len) &&
+              write_all(s_fil, m->pixels, (uint32_t)m->width * m->height * sizeof(lv_color_t));
+    ok = f_close(s_fil) == FR_OK && ok;
+    // A torn file fails its checks on load and is written again
+    return ok;
+}
+
+static void make_thumb(const thumb_req_t *req)
+{
+    char fn[48];
+    size_t dir_len;
+    size_t pixels = (size_t)s_cfg.size * s_cfg.size * sizeof(lv_color_t);
+
+    thumb_msg_t *m = heap_caps_malloc(sizeof(*m) + pixels, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+    if (!m)
+        return;     // the slot stays pending until dropped
+    m->key = req->key;
+    m->width = m->height = 0;
+
+    bool have_fn = thumb_file_path(req->key, fn, sizeof(fn), &dir_len);
+    if (have_fn && load_thumb(fn, req, m))
+    {
+        s_stats.disk_hits++;
+    }
+    else if (decode(req, m))
+    {
+        s_stats.decoded++;
+        if (!have_fn || !save_thumb(fn, dir_len, req, m))
+            s_stats.writes_failed++;
+    }
+    else
+    {
+        s_stats.failed++;
+        m->width = m->height = 0;
+        ESP_LOGD(TAG, "%s: cannot decode", req->path);
+    }
+    xQueueSend(s_msg_q, &m, portMAX_DELAY);
+}
+
+static void thumb_task(void *arg)
+{
+    thumb_req_t req;
+
+    while (1)
+    {
+        if (xQueueReceive(s_req_q, &req, portMAX_DELAY) == pdTRUE)
+            make_thumb(&req);
+    }
+}
+
+static thumb_slot_t *find_slot(uint64_t key)
+{
+    for (uint16_t i = 0; i < s_cfg.mem_entries; i++)
+    {
+        if (s_slots[i].state != SLOT_FREE && s_slots[i].key == key)
+            return &s_slots[i];
+    }
+    return NULL;
+}
+
+// A free slot, else the least recently used one, pending ones last
+static thumb_slot_t *take_slot(void)
+{
+    thumb_slot_t *best = NULL;
+
+    for (uint16_t i = 0; i < s_cfg.mem_entries; i++)
+    {
+        thumb_slot_t *s = &s_slots[i];
+        if (s->state == SLOT_FREE)
+            return s;
+        if (!best || (best->state == SLOT_PENDING && s->state != SLOT_PENDING) ||
+            ((best->state == SLOT_PENDING) == (s->state == SLOT_PENDING) && s->last_use < best->last_use))
+            best = s;
+    }
+    // LVGL keeps the header of image sources it has drawn
+    if (best->state == SLOT_READY)
+        lv_img_cache_invalidate_src(&best->dsc);
+    best->state = SLOT_FREE;
+    return best;
+}
+
+static void first_thumb(void)
+{
+    if (!s_first_timing)
+        return;
+    s_first_timing = false;
+    s_stats.first_ms = (uint32_t)((esp_timer_get_time() - s_first_t0) / 1000);
+
+    uint32_t hits = s_stats.mem_hits + s_stats.disk_hits;
+    uint32_t total = hits + s_stats.decoded + s_stats.failed;
+    ESP_LOGI(TAG, "First thumbnail in %lu ms (hit rate %lu%%)", (unsigned long)s_stats.first_ms,
+             (unsigned long)(total ? (uint64_t)hits * 100 / total : 0));
+}
+
+static void deliver_timer_cb(lv_timer_t *t)
+{
+    thumb_msg_t *m;
+    bool any = false;
+
+    for (int n = 0; n < DELIVER_MAX && xQueueReceive(s_msg_q, &m, 0) == pdTRUE; n++)
+    {
+        thumb_slot_t *s = find_slot(m->key);
+        if (!s)
+            s = take_slot();
+        else if (s->state == SLOT_READY)
+            lv_img_cache_invalidate_src(&s->dsc);
+        s->key = m->key;
+        s->last_use = ++s_tick;
+        if (m->width)
+        {
+            s->state = SLOT_READY;
+            s->dsc.header.cf = LV_IMG_CF_TRUE_COLOR;
+            s->dsc.header.always_zero = 0;
+            s->dsc.header.w = m->width;
+            s->dsc.header.h = m->height;
+            s->dsc.data_size = (uint32_t)m->width * m->height * sizeof(lv_color_t);
+            memcpy((void *)s->dsc.data, m->pixels, s->dsc.data_size);
+            first_thumb();
+            any = true;
+        }
+        else
+        {
+            s->state = SLOT_FAILED;
+        }
+        heap_caps_free(m);
+    }
+    if (any && s_ready_cb)
+        s_ready_cb(s_ready_arg);
+}
+
+esp_err_t pst_thumb_init(const pst_thumb_cfg_t *cfg)
+{
+    const pst_thumb_cfg_t def_cfg = PST_THUMB_DEFAULT_CONFIG();
+
+    if (s_req_q)
+        return ESP_ERR_INVALID_STATE;
+
+    s_cfg = cfg ? *cfg : def_cfg;
+    if (s_cfg.size > PST_THUMB_MAX_SIZE)
+        s_cfg.size = PST_THUMB_MAX_SIZE;
+    if (!s_cfg.size)
+        s_cfg.size = 1;
+    if (!s_cfg.mem_entries)
+        s_cfg.mem_entries = 1;
+    memset(&s_stats, 0, sizeof(s_stats));
+
+    size_t slot_pixels = (size_t)s_cfg.size * s_cfg.size;
+    QueueHandle_t req_q = xQueueCreate(s_cfg.queue_len, sizeof(thumb_req_t));
+    s_msg_q = xQueueCreate(s_cfg.queue_len, sizeof(thumb_msg_t *));
+    s_slots = heap_caps_calloc(s_cfg.mem_entries, sizeof(thumb_slot_t), MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+    s_pixels = heap_caps_malloc(s_cfg.mem_entries * slot_pixels * sizeof(lv_color_t), MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+    // FIL holds a sector buffer: too large for the worker stack
+    s_fil = heap_caps_malloc(sizeof(FIL), MALLOC_CAP_DEFAULT);
+    s_jpeg_work = heap_caps_malloc(JPEG_WORK_SIZE, MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+    if (!req_q || !s_msg_q || !s_slots || !s_pixels || !s_fil || !s_jpeg_work)
+        goto err;
+    for (uint16_t i = 0; i < s_cfg.mem_entries; i++)
+        s_slots[i].dsc.data = (const uint8_t *)(s_pixels + i * slot_pixels);
+
+    s_timer = lv_timer_create(deliver_timer_cb, s_cfg.deliver_period_ms, NULL);
+    if (!s_timer)
+        goto err;
+
+    s_req_q = req_q;
+    BaseType_t res;
+    if (s_cfg.task_affinity < 0)
+        res = xTaskCreate(thumb_task, "PST thumb", s_cfg.task_stack, NULL, s_cfg.task_priority, NULL);
+    else
+        res = xTaskCreatePinnedToCore(thumb_task, "PST thumb", s_cfg.task_stack, NULL, s_cfg.task_priority, NULL, s_cfg.task_affinity);
+    if (res != pdPASS)
+    {
+        s_req_q = NULL;
+        lv_timer_del(s_timer);
+        s_timer = NULL;
+        goto err;
+    }
+    return ESP_OK;
+
+err:
+    if (req_q)
+        vQueueDelete(req_q);
+    if (s_msg_q)
+        vQueueDelete(s_msg_q);
+    s_msg_q = NULL;
+    heap_caps_free(s_slots);
+    heap_caps_free(s_pixels);
+    heap_caps_free(s_fil);
+    heap_caps_free(s_jpeg_work);
+    s_slots = NULL;
+    s_pixels = NULL;
+    s_fil = NULL;
+    s_jpeg_work = NULL;
+    return ESP_ERR_NO_MEM;
+}
+
+bool pst_thumb_is_image(const char *name)
+{
+    const char *ext = extension(name);
+    // No PNG: lodepng would decode it at full size into PSRAM
+    return strcasecmp(ext, "jpg") == 0 || strcasecmp(ext, "jpeg") == 0 || strcasecmp(ext, "bmp") == 0;
+}
+
+const lv_img_dsc_t *pst_thumb_get(const char *path, uint32_t size, uint32_t mtime)
+{
+    thumb_req_t req;
+
+    if (!s_req_q)
+        return NULL;
+    if (s_first_armed)
+    {
+        s_first_armed = false;
+        s_first_timing = true;
+        s_first_t0 = esp_timer_get_time();
+    }
+
+    uint64_t key = thumb_key(path, size, mtime);
+    thumb_slot_t *s = find_slot(key);
+    if (s)
+    {
+        s->last_use = ++s_tick;
+        if (s->state != SLOT_READY)
+            return NULL;
+        s_stats.mem_hits++;
+        first_thumb();
+        return &s->dsc;
+    }
+
+    if (strlen(path) >= sizeof(req.path))
+        return NULL;
+    req.key = key;
+    req.size = size;
+    req.mtime = mtime;
+    strcpy(req.path, path);
+    if (xQueueSend(s_req_q, &req, 0) != pdTRUE)
+    {
+        // Asked again when the row is bound next
+        s_stats.dropped++;
+        return NULL;
+    }
+    s_stats.requests++;
+    s = take_slot();
+    s->key = key;
+    s->state = SLOT_PENDING;
+    s->last_use = ++s_tick;
+    return NULL;
+}
+
+void pst_thumb_set_ready_cb(pst_thumb_ready_cb_t cb, void *arg)
+{
+    s_ready_cb = cb;
+    s_ready_arg = arg;
+}
+
+void pst_thumb_drop_pending(void)
+{
+    if (!s_req_q)
+        return;
+
+    s_stats.dropped += uxQueueMessagesWaiting(s_req_q);
+    xQueueReset(s_req_q);
+    for (uint16_t i = 0; i < s_cfg.mem_entries; i++)
+    {
+        if (s_slots[i].state == SLOT_PENDING)
+            s_slots[i].state = SLOT_FREE;
+    }
+    s_first_armed = true;
+    s_first_timing = false;
+}
+
+void pst_thumb_get_stats(pst_thumb_stats_t *out)
+{
+    *out = s_stats;
+}
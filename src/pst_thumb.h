@@ -0,0 +1,138 @@
+/**
+ * Image thumbnails for PST.
+ *
+ * Responsibilities:
+ *  - Decode images into small thumbnails in a worker task, outside the LVGL task
+ *    and its lock: JPEG through the ROM TJpgDec at 1/2 to 1/8 scale, BMP
+ *    (24/32 bpp, uncompressed) one source row per thumbnail row
+ *  - Keep the thumbnails as RGB565 in a hidden folder of the card
+ *    (PST_THUMB_DIR_NAME), one file per image keyed by path, mtime and size, so
+ *    each image is decoded once; a changed file gets a new key
+ *  - Serve them to the UI from a fixed pool in PSRAM (least recently used goes
+ *    first), as LVGL image descriptors, and call back as they arrive
+ *  - Only work for the rows asking: requests of a folder left are dropped
+ *  - Measure time to first thumbnail after a folder change and the cache hit rate
+ *
+ * PNG is not decoded: lodepng (LVGL's decoder) has no scaled decode, it inflates
+ * the whole image at full size, 4 bytes a pixel, into PSRAM. A 12 MP photo needs
+ * 48 MB, more than there is, and even a 320x480 screenshot takes 600 KB to end
+ * up as a 64 px thumbnail. Thumbnail files of images since changed or deleted are
+ * not removed; deleting PST_THUMB_DIR_NAME is always safe.
+ *
+ * Requirements:
+ *  - Display + LVGL must already be initialized via bsp_display_start_with_config()
+ *  - SD card mounted via bsp_sd_init() before thumbnails are asked for
+ *  - pst_thumb_get() / pst_thumb_drop_pending() called with the LVGL lock held
+ *    (e.g. from LVGL event handlers or pst_vlist bind callbacks)
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "esp_err.h"
+#include "lvgl.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define PST_THUMB_DIR_NAME ".pstthumb"  /*!< Thumbnail files, at the card root */
+#define PST_THUMB_MAX_SIZE 64           /*!< Largest thumbnail side, px */
+
+/**
+ * @brief Called from the LVGL task (lock held) after thumbnails arrived.
+ */
+typedef void (*pst_thumb_ready_cb_t)(void *arg);
+
+/**
+ * @brief Worker and cache configuration.
+ */
+typedef struct {
+    int task_priority;          /*!< Below the LVGL task and next to the folder workers */
+    int task_stack;
+    int task_affinity;          /*!< Core to pin the worker to (-1 is no affinity) */
+    uint16_t size;              /*!< Thumbnails fit a size x size square, aspect kept (at most PST_THUMB_MAX_SIZE) */
+    uint16_t mem_entries;       /*!< Thumbnails held in memory */
+    uint8_t queue_len;          /*!< Images waiting; further requests are dropped and asked again on the next bind */
+    uint32_t deliver_period_ms; /*!< LVGL timer period delivering the thumbnails */
+} pst_thumb_cfg_t;
+
+#define PST_THUMB_DEFAULT_CONFIG()  \
+    {                               \
+        .task_priority = 2,         \
+        .task_stack = 4096,         \
+        .task_affinity = -1,        \
+        .size = 32,                 \
+        .mem_entries = 128,         \
+        .queue_len = 16,            \
+        .deliver_period_ms = 50,    \
+    }
+
+/**
+ * @brief Counters since init.
+ *
+ * The hit rate is (mem_hits + disk_hits) / (mem_hits + disk_hits + decoded + failed).
+ */
+typedef struct {
+    uint32_t requests;          /*!< Images queued for the worker */
+    uint32_t dropped;           /*!< Requests dropped, the queue being full or the folder left */
+    uint32_t mem_hits;          /*!< Thumbnails served from memory */
+    uint32_t disk_hits;         /*!< Thumbnails read from their file */
+    uint32_t decoded;           /*!< Thumbnails decoded from the image */
+    uint32_t failed;            /*!< Images that could not be decoded */
+    uint32_t writes_failed;     /*!< Thumbnails that could not be written to the card */
+    uint32_t first_ms;          /*!< Time to first thumbnail after the last folder change */
+} pst_thumb_stats_t;
+
+/**
+ * @brief Create the worker task, the memory pool and the delivery timer.
+ *
+ * @param cfg  Configuration, NULL for PST_THUMB_DEFAULT_CONFIG().
+ *
+ * @return
+ *      - ESP_OK                 on success
+ *      - ESP_ERR_INVALID_STATE  if already initialized
+ *      - ESP_ERR_NO_MEM         if the task, pool, queues or timer cannot be created
+ */
+esp_err_t pst_thumb_init(const pst_thumb_cfg_t *cfg);
+
+/**
+ * @brief true if the file name has an extension pst_thumb decodes.
+ */
+bool pst_thumb_is_image(const char *name);
+
+/**
+ * @brief Thumbnail of an image, or NULL until it is ready.
+ *
+ * A miss queues the image for the worker; the ready callback runs once it
+ * arrives and the caller asks again. The descriptor stays valid until the next
+ * delivery (pst_thumb_ready_cb_t), which may reuse its memory.
+ *
+ * @param path   LVGL path of the image, e.g. "S:/photos/a.jpg".
+ * @param size   File size, as listed.
+ * @param mtime  FAT timestamp, as listed.
+ *
+ * @return the thumbnail, or NULL if not ready, not decodable or not initialized.
+ */
+const lv_img_dsc_t *pst_thumb_get(const char *path, uint32_t size, uint32_t mtime);
+
+/**
+ * @brief Set the callback run after thumbnails arrived (NULL for none).
+ */
+void pst_thumb_set_ready_cb(pst_thumb_ready_cb_t cb, void *arg);
+
+/**
+ * @brief Drop the requests not yet served (e.g. of a folder left) and start timing
+ *        the first thumbnail of the next ones.
+ */
+void pst_thumb_drop_pending(void);
+
+/**
+ * @brief Copy the current counters.
+ */
+void pst_thumb_get_stats(pst_thumb_stats_t *out);
+
+#ifdef __cplusplus
+}
+#endif
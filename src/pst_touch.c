@@ -0,0 +1,304 @@
+#include <math.h>
+#include <stdatomic.h>
+#include <string.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+#include "esp_timer.h"
+#include "esp_log.h"
+#include "pst_gesture.h"
+#include "pst_latency.h"
+#include "pst_perf.h"
+#include "pst_touch.h"
+
+static const char *TAG = "PST_TOUCH";
+
+#define RING_MASK (PST_TOUCH_RING_LEN - 1)
+#define INJECT_QUEUE_LEN 8
+#define ASYNC_READ_TIMEOUT_MS 50
+_Static_assert((PST_TOUCH_RING_LEN & RING_MASK) == 0, "PST_TOUCH_RING_LEN must be a power of two");
+
+// SPSC ring: only the touch task writes s_head, only the LVGL task writes s_tail
+static pst_touch_sample_t s_ring[PST_TOUCH_RING_LEN];
+static atomic_uint s_head;
+static atomic_uint s_tail;
+
+static pst_touch_cfg_t s_cfg;
+static esp_lcd_touch_handle_t s_tp = NULL;
+static SemaphoreHandle_t s_int_sem = NULL;
+static QueueHandle_t s_inject_q = NULL;
+static TaskHandle_t s_task = NULL;
+static pst_touch_stats_t s_stats;
+static uint64_t s_read_us_sum = 0;
+static uint32_t s_reads = 0;
+static volatile bool s_read_ok;     // result of the last asynchronous read
+static pst_touch_sample_t s_last;   // consumer side: state reported to LVGL
+static bool s_predict_on = false;
+static pst_touch_predict_cfg_t s_predict_cfg;
+static pst_touch_predict_t s_predict;
+static pst_touch_filter_t s_filter;  // touch task side
+
+static bool ring_push(const pst_touch_sample_t *sample)
+{
+    unsigned head = atomic_load_explicit(&s_head, memory_order_relaxed);
+    unsigned tail = atomic_load_explicit(&s_tail, memory_order_acquire);
+    unsigned used = head - tail;
+
+    if (used >= PST_TOUCH_RING_LEN)
+    {
+        s_stats.overflows++;
+        return false;
+    }
+
+    s_ring[head & RING_MASK] = *sample;
+    atomic_store_explicit(&s_head, head + 1, memory_order_release);
+
+    s_stats.samples++;
+    if (used + 1 > s_stats.ring_max)
+        s_stats.ring_max = used + 1;
+    return true;
+}
+
+PST_IRAM_ATTR bool pst_touch_pop(pst_touch_sample_t *out)
+{
+    unsigned tail = atomic_load_explicit(&s_tail, memory_order_relaxed);
+    unsigned head = atomic_load_explicit(&s_head, memory_order_acquire);
+
+    if (tail == head)
+        return false;
+
+    *out = s_ring[tail & RING_MASK];
+    atomic_store_explicit(&s_tail, tail + 1, memory_order_release);
+    return true;
+}
+
+static void touch_task(void *arg)
+{
+    bool pressed = false;
+    uint16_t last_x = 0;
+    uint16_t last_y = 0;
+
+    ESP_LOGI(TAG, "Touch task started");
+    while (1)
+    {
+        // While a finger is down, wake up periodically so a release without interrupt is seen
+        TickType_t wait = pressed ? pdMS_TO_TICKS(s_cfg.release_poll_ms) : portMAX_DELAY;
+        bool irq = xSemaphoreTake(s_int_sem, wait) == pdTRUE;
+        int64_t t_wake = esp_timer_get_time();
+
+        // Injected samples take the place of a controller read
+        pst_touch_sample_t injected;
+        bool any_injected = false;
+        while (xQueueReceive(s_inject_q, &injected, 0) == pdTRUE)
+        {
+            injected.t_us = t_wake;
+            if (ring_push(&injected))
+                s_stats.injected++;
+            pst_gesture_feed(&injected);
+            any_injected = true;
+        }
+        if (any_injected)
+            continue;
+
+        if (irq)
+            s_stats.irq_wakeups++;
+        else
+            s_stats.poll_wakeups++;
+
+        // Drop the completion of a read that already timed out
+        if (s_cfg.async_read)
+            ulTaskNotifyTake(pdTRUE, 0);
+        esp_err_t err = esp_lcd_touch_read_data(s_tp);
+        if (err == ESP_OK && s_cfg.async_read)
+        {
+            // The bus works on its own; the coordinates are stored once it notifies
+            if (!ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(ASYNC_READ_TIMEOUT_MS)))
+            {
+                s_stats.read_timeouts++;
+                err = ESP_ERR_TIMEOUT;
+            }
+            else if (!s_read_ok)
+            {
+                err = ESP_FAIL;
+            }
+        }
+        uint32_t read_us = (uint32_t)(esp_timer_get_time() - t_wake);
+        s_reads++;
+        s_read_us_sum += read_us;
+        s_stats.read_us_avg = (uint32_t)(s_read_us_sum / s_reads);
+        if (read_us > s_stats.read_us_max)
+            s_stats.read_us_max = read_us;
+        if (err != ESP_OK)
+        {
+            s_stats.read_errors++;
+            continue;
+        }
+
+        uint16_t x[PST_TOUCH_MAX_POINTS];
+        uint16_t y[PST_TOUCH_MAX_POINTS];
+        uint8_t cnt = 0;
+        bool down = esp_lcd_touch_get_coordinates(s_tp, x, y, NULL, &cnt, PST_TOUCH_MAX_POINTS) && cnt > 0;
+
+        // Interrupt without a finger and no press to end: nothing to report
+        if (!down && !pressed)
+            continue;
+
+        // A single finger that did not move is not reported again: LVGL keeps its point
+        bool changed = true;
+        if (down && cnt == 1 && s_cfg.filter)
+            changed = pst_touch_filter_update(&s_filter, &s_cfg.filter_cfg, t_wake, &x[0], &y[0]);
+        else
+            pst_touch_filter_reset(&s_filter);
+
+        if (down)
+        {
+            last_x = x[0];
+            last_y = y[0];
+        }
+        // The interrupt time is only meaningful if this read was triggered by it
+        int64_t t_irq = pst_latency_irq_time();
+        if (!irq || t_irq <= 0 || t_irq > t_wake)
+            t_irq = t_wake;
+
+        pst_touch_sample_t sample = {
+            .t_us = t_wake,
+            .t_irq_us = t_irq,
+            .x = last_x,
+            .y = last_y,
+            .x2 = cnt > 1 ? x[1] : 0,
+            .y2 = cnt > 1 ? y[1] : 0,
+            .points = down ? cnt : 0,
+        };
+        if (changed || !pressed)
+            ring_push(&sample);
+        else
+            s_stats.filtered++;
+        pst_gesture_feed(&sample);
+        pressed = down;
+    }
+}
+
+esp_err_t pst_touch_start(esp_lcd_touch_handle_t tp, SemaphoreHandle_t int_sem, const pst_touch_cfg_t *cfg)
+{
+    const pst_touch_cfg_t def_cfg = PST_TOUCH_DEFAULT_CONFIG();
+
+    if (!tp || !int_sem)
+        return ESP_ERR_INVALID_ARG;
+    if (s_task)
+        return ESP_ERR_INVALID_STATE;
+
+    if (!s_inject_q)
+    {
+        s_inject_q = xQueueCreate(INJECT_QUEUE_LEN, sizeof(pst_touch_sample_t));
+        if (!s_inject_q)
+            return ESP_ERR_NO_MEM;
+    }
+
+    s_cfg = cfg ? *cfg : def_cfg;
+    s_tp = tp;
+    s_int_sem = int_sem;
+    atomic_store(&s_head, 0);
+    atomic_store(&s_tail, 0);
+    memset(&s_stats, 0, sizeof(s_stats));
+    memset(&s_last, 0, sizeof(s_last));
+    pst_touch_filter_reset(&s_filter);
+
+    BaseType_t res;
+    if (s_cfg.task_affinity < 0)
+        res = xTaskCreate(touch_task, "PST touch", s_cfg.task_stack, NULL, s_cfg.task_priority, &s_task);
+    else
+        res = xTaskCreatePinnedToCore(touch_task, "PST touch", s_cfg.task_stack, NULL, s_cfg.task_priority, &s_task, s_cfg.task_affinity);
+    if (res != pdPASS)
+    {
+        ESP_LOGE(TAG, "Failed to create touch task");
+        s_task = NULL;
+        return ESP_ERR_NO_MEM;
+    }
+    return ESP_OK;
+}
+
+PST_IRAM_ATTR bool pst_touch_read_done_isr(esp_lcd_touch_handle_t tp, bool ok, void *arg)
+{
+    BaseType_t woken = pdFALSE;
+
+    s_read_ok = ok;
+    if (s_task)
+        vTaskNotifyGiveFromISR(s_task, &woken);
+    return woken == pdTRUE;
+}
+
+esp_err_t pst_touch_inject(uint16_t x, uint16_t y, bool pressed)
+{
+    if (!s_task)
+        return ESP_ERR_INVALID_STATE;
+
+    pst_touch_sample_t sample = {
+        .t_irq_us = esp_timer_get_time(),
+        .x = x,
+        .y = y,
+        .points = pressed ? 1 : 0,
+        .flags = PST_TOUCH_FLAG_INJECTED,
+    };
+    if (xQueueSend(s_inject_q, &sample, 0) != pdTRUE)
+        return ESP_ERR_TIMEOUT;
+    xSemaphoreGive(s_int_sem);
+    return ESP_OK;
+}
+
+PST_IRAM_ATTR void pst_touch_lvgl_read(esp_lcd_touch_handle_t tp, lv_indev_data_t *data)
+{
+    pst_touch_sample_t sample;
+
+    // One sample per call; LVGL calls again at once while more are queued
+    if (pst_touch_pop(&sample))
+    {
+        // Hold LVGL's point while two fingers are down, so a pinch does not scroll or click
+        if (sample.points > 1 && s_last.points)
+        {
+            sample.x = s_last.x;
+            sample.y = s_last.y;
+        }
+        s_last = sample;
+        if (s_predict_on)
+        {
+            if (sample.points == 1)
+                pst_touch_predict_update(&s_predict, &s_predict_cfg, sample.t_us, sample.x, sample.y);
+            else
+                pst_touch_predict_reset(&s_predict);
+        }
+        pst_latency_input(sample.t_irq_us, sample.flags & PST_TOUCH_FLAG_INJECTED);
+        data->continue_reading = atomic_load_explicit(&s_tail, memory_order_relaxed) !=
+                                 atomic_load_explicit(&s_head, memory_order_acquire);
+    }
+
+    data->point.x = s_last.x;
+    data->point.y = s_last.y;
+    // A finger that stopped sends nothing the filter lets through: with no sample
+    // for a poll period it is taken to rest, not extrapolated further and further
+    int64_t now = esp_timer_get_time();
+    if (s_predict_on && s_last.points == 1 && now - s_last.t_us <= (int64_t)s_cfg.release_poll_ms * 1000)
+    {
+        float px;
+        float py;
+        pst_touch_predict_at(&s_predict, &s_predict_cfg, now + s_predict_cfg.lead_us, &px, &py);
+        data->point.x = (lv_coord_t)lroundf(px);
+        data->point.y = (lv_coord_t)lroundf(py);
+    }
+    data->state = s_last.points ? LV_INDEV_STATE_PRESSED : LV_INDEV_STATE_RELEASED;
+}
+
+void pst_touch_set_predict(const pst_touch_predict_cfg_t *cfg)
+{
+    s_predict_on = false;
+    pst_touch_predict_reset(&s_predict);
+    if (cfg)
+    {
+        s_predict_cfg = *cfg;
+        s_predict_on = cfg->aggressiveness > 0;
+    }
+}
+
+void pst_touch_get_stats(pst_touch_stats_t *out)
+{
+    *out = s_stats;
+}
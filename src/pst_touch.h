@@ -0,0 +1,186 @@
+/**
+ * Interrupt-driven touch reader for PST.
+ *
+ * Responsibilities:
+ *  - Run a dedicated task that sleeps on the touch INT semaphore and reads the
+ *    controller as soon as it fires, outside the LVGL task and its mutex
+ *  - Stamp every sample with esp_timer time and push it into a lock-free
+ *    single-producer/single-consumer ring
+ *  - Feed LVGL from the ring: every queued sample is handed to LVGL in order
+ *    (continue_reading), so presses shorter than the indev poll period are not lost.
+ *    LVGL sees the first point only; it is held still while a second finger is down
+ *  - Hand every sample to the gesture recognizer (pst_gesture) from the touch task
+ *  - Optionally report to LVGL where a dragging finger will be when the frame is
+ *    shown, instead of where it was sampled (pst_touch_predict)
+ *  - Optionally filter the jitter of a resting finger (pst_touch_filter) and skip the
+ *    samples that do not move the point, so a held press stops producing frames
+ *  - Poll while a finger is down so the release is seen even without an interrupt
+ *  - Optionally queue the controller read on an asynchronous I2C bus and sleep until
+ *    its completion interrupt, instead of waiting inside the I2C driver
+ *  - Accept injected samples, which travel the same ring and LVGL path as real ones
+ *
+ * Requirements:
+ *  - Created by the BSP when CONFIG_PST_TOUCH_TASK is enabled; the touch handle must
+ *    have its interrupt callback giving `int_sem`
+ *  - pst_touch_pop() / pst_touch_lvgl_read() are the only consumer (LVGL task)
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "esp_err.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "esp_lcd_touch.h"
+#include "lvgl.h"
+#include "pst_touch_filter.h"
+#include "pst_touch_predict.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Ring capacity in samples (power of two).
+ */
+#define PST_TOUCH_RING_LEN 64
+
+/**
+ * @brief Points read per report.
+ */
+#define PST_TOUCH_MAX_POINTS 2
+
+/**
+ * @brief One touch report, in display coordinates.
+ */
+typedef struct {
+    int64_t t_us;           /*!< esp_timer time the task was woken for this report */
+    int64_t t_irq_us;       /*!< Touch interrupt (or injection) time, t_us for polled reads */
+    uint16_t x;             /*!< First point X (last known position on release) */
+    uint16_t y;             /*!< First point Y (last known position on release) */
+    uint16_t x2;            /*!< Second point X, valid when points >= 2 */
+    uint16_t y2;            /*!< Second point Y, valid when points >= 2 */
+    uint8_t points;         /*!< Points reported, 0 = released */
+    uint8_t flags;          /*!< PST_TOUCH_FLAG_* */
+} pst_touch_sample_t;
+
+/**
+ * @brief Sample flag: injected with pst_touch_inject(), not read from the controller.
+ */
+#define PST_TOUCH_FLAG_INJECTED (1 << 0)
+
+/**
+ * @brief Touch task configuration.
+ */
+typedef struct {
+    int task_priority;          /*!< Above the LVGL task so reads are not delayed by rendering */
+    int task_stack;             /*!< Task stack size */
+    int task_affinity;          /*!< Core to pin the task to (-1 is no affinity) */
+    uint32_t release_poll_ms;   /*!< Poll period while pressed, to catch the release */
+    bool async_read;            /*!< esp_lcd_touch_read_data() only queues the read, the
+                                     controller driver calls pst_touch_read_done_isr() when done */
+    bool filter;                /*!< Filter the first point with filter_cfg while one finger is down */
+    pst_touch_filter_cfg_t filter_cfg;
+} pst_touch_cfg_t;
+
+#define PST_TOUCH_DEFAULT_CONFIG()  \
+    {                               \
+        .task_priority = 6,         \
+        .task_stack = 3072,         \
+        .task_affinity = -1,        \
+        .release_poll_ms = 20,      \
+        .async_read = false,        \
+        .filter = false,            \
+        .filter_cfg = PST_TOUCH_FILTER_DEFAULT_CONFIG(), \
+    }
+
+/**
+ * @brief Touch pipeline counters since start.
+ */
+typedef struct {
+    uint32_t samples;           /*!< Samples pushed to the ring */
+    uint32_t overflows;         /*!< Samples dropped because the ring was full */
+    uint32_t irq_wakeups;       /*!< Reads triggered by the interrupt */
+    uint32_t poll_wakeups;      /*!< Reads triggered by the release poll */
+    uint32_t read_errors;       /*!< Failed controller reads */
+    uint32_t read_us_avg;       /*!< Average controller read (I2C) time, queuing to completion */
+    uint32_t read_us_max;       /*!< Worst controller read time */
+    uint32_t read_timeouts;     /*!< Asynchronous reads not completed in time */
+    uint32_t ring_max;          /*!< Highest ring occupancy seen */
+    uint32_t injected;          /*!< Injected samples pushed to the ring */
+    uint32_t filtered;          /*!< Samples not pushed because the filtered point did not change */
+} pst_touch_stats_t;
+
+/**
+ * @brief Start the touch task.
+ *
+ * @param tp       Touch handle; its process_coordinates callback is applied by the task.
+ * @param int_sem  Binary semaphore given by the touch interrupt.
+ * @param cfg      Configuration, NULL for PST_TOUCH_DEFAULT_CONFIG().
+ *
+ * @return
+ *      - ESP_OK                 on success
+ *      - ESP_ERR_INVALID_ARG    if tp or int_sem is NULL
+ *      - ESP_ERR_INVALID_STATE  if already started
+ *      - ESP_ERR_NO_MEM         if the task or the injection queue cannot be created
+ */
+esp_err_t pst_touch_start(esp_lcd_touch_handle_t tp, SemaphoreHandle_t int_sem, const pst_touch_cfg_t *cfg);
+
+/**
+ * @brief Completion of an asynchronous controller read (cfg.async_read), from the I2C ISR.
+ *
+ * Matches esp_lcd_touch_axs15231b_read_done_cb_t.
+ *
+ * @return true if the touch task was woken and a context switch is needed.
+ */
+bool pst_touch_read_done_isr(esp_lcd_touch_handle_t tp, bool ok, void *arg);
+
+/**
+ * @brief Queue a synthetic sample, as if read from the controller.
+ *
+ * Wakes the touch task, which pushes the sample to the ring instead of reading the
+ * controller. Callable from any task or esp_timer callback (not from an ISR).
+ *
+ * @param x        X in display coordinates.
+ * @param y        Y in display coordinates.
+ * @param pressed  false to report a release.
+ *
+ * @return
+ *      - ESP_OK                 on success
+ *      - ESP_ERR_INVALID_STATE  if the touch task is not started
+ *      - ESP_ERR_TIMEOUT        if the injection queue is full
+ */
+esp_err_t pst_touch_inject(uint16_t x, uint16_t y, bool pressed);
+
+/**
+ * @brief Take the oldest sample from the ring (consumer side).
+ *
+ * @return false if the ring is empty.
+ */
+bool pst_touch_pop(pst_touch_sample_t *out);
+
+/**
+ * @brief LVGL read hook (lvgl_port_touch_cfg_t::touch_read_cb) draining the ring.
+ */
+void pst_touch_lvgl_read(esp_lcd_touch_handle_t tp, lv_indev_data_t *data);
+
+/**
+ * @brief Predict the point reported to LVGL while one finger is down.
+ *
+ * Presses and releases always report the sampled position, and so does a finger
+ * with no new sample for release_poll_ms (it stopped). Call before LVGL starts
+ * reading or with the LVGL lock held.
+ *
+ * @param cfg  Tuning, NULL to disable.
+ */
+void pst_touch_set_predict(const pst_touch_predict_cfg_t *cfg);
+
+/**
+ * @brief Copy the current counters.
+ */
+void pst_touch_get_stats(pst_touch_stats_t *out);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,41 @@
+#include "nvs.h"
+#include "pst_touch_cal.h"
+
+#define NVS_NAMESPACE "pst_touch"
+#define NVS_KEY_CAL "cal"
+
+esp_err_t pst_touch_cal_load(pst_touch_cal_t *out)
+{
+    nvs_handle_t nvs;
+    esp_err_t err = nvs_open(NVS_NAMESPACE, NVS_READONLY, &nvs);
+    if (err == ESP_ERR_NVS_NOT_FOUND)
+        return ESP_ERR_NOT_FOUND;
+    if (err != ESP_OK)
+        return err;
+
+    size_t len = sizeof(*out);
+    err = nvs_get_blob(nvs, NVS_KEY_CAL, out, &len);
+    nvs_close(nvs);
+    if (err == ESP_ERR_NVS_NOT_FOUND || (err == ESP_OK && len != sizeof(*out)))
+        return ESP_ERR_NOT_FOUND;
+    return err;
+}
+
+esp_err_t pst_touch_cal_save(const pst_touch_cal_t *cal)
+{
+    nvs_handle_t nvs;
+    esp_err_t err = nvs_open(NVS_NAMESPACE, NVS_READWRITE, &nvs);
+    if (err != ESP_OK)
+        return err;
+
+    if (cal)
+        err = nvs_set_blob(nvs, NVS_KEY_CAL, cal, sizeof(*cal));
+    else
+        err = nvs_erase_key(nvs, NVS_KEY_CAL);
+    if (err == ESP_ERR_NVS_NOT_FOUND)
+        err = ESP_OK;
+    if (err == ESP_OK)
+        err = nvs_commit(nvs);
+    nvs_close(nvs);
+    return err;
+}
@@ -0,0 +1,39 @@
+/**
+ * Stored touch calibration for PST.
+ *
+ * Responsibilities:
+ *  - Keep the calibration computed by pst_touch_cal_compute() in NVS across reboots
+ *
+ * Requirements:
+ *  - nvs_flash_init() done before pst_touch_cal_load() / pst_touch_cal_save()
+ */
+
+#pragma once
+
+#include "esp_err.h"
+#include "pst_touch_xform.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Read the stored calibration.
+ *
+ * @return
+ *      - ESP_OK             on success
+ *      - ESP_ERR_NOT_FOUND  if none is stored
+ *      - other              NVS errors
+ */
+esp_err_t pst_touch_cal_load(pst_touch_cal_t *out);
+
+/**
+ * @brief Store a calibration, NULL to erase it.
+ *
+ * @return ESP_OK or an NVS error.
+ */
+esp_err_t pst_touch_cal_save(const pst_touch_cal_t *cal);
+
+#ifdef __cplusplus
+}
+#endif
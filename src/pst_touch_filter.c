@@ -0,0 +1,95 @@
+#include <math.h>
+#include <string.h>
+#include "pst_touch_filter.h"
+
+#define PI_F 3.14159265f
+#define AVG_GAIN 0.25f          // stop detection average, about 7 samples
+
+void pst_touch_filter_reset(pst_touch_filter_t *f)
+{
+    memset(f, 0, sizeof(*f));
+}
+
+// Low-pass coefficient of a first order filter with cutoff `fc` for a step of `dt`
+static float smoothing(float dt, float fc)
+{
+    return 1.0f / (1.0f + 1.0f / (2.0f * PI_F * fc * dt));
+}
+
+static uint16_t to_px(float v)
+{
+    return v <= 0 ? 0 : (v >= UINT16_MAX ? UINT16_MAX : (uint16_t)lroundf(v));
+}
+
+bool pst_touch_filter_update(pst_touch_filter_t *f, const pst_touch_filter_cfg_t *cfg, int64_t t_us, uint16_t *x, uint16_t *y)
+{
+    if (!f->active)
+    {
+        pst_touch_filter_reset(f);
+        f->active = true;
+        f->moving = !cfg->dead_zone_px;
+        f->t_us = t_us;
+        f->still_us = t_us;
+        f->x = f->avg_x = f->still_x = f->out_x = *x;
+        f->y = f->avg_y = f->still_y = f->out_y = *y;
+        return true;
+    }
+
+    // 1-euro filter: the cutoff rises with the speed
+    if (cfg->euro_min_cutoff > 0)
+    {
+        float dt = t_us > f->t_us ? (t_us - f->t_us) / 1e6f : 1e-3f;
+        float a_d = smoothing(dt, cfg->euro_d_cutoff);
+        f->dx = a_d * (*x - f->x) / dt + (1.0f - a_d) * f->dx;
+        f->dy = a_d * (*y - f->y) / dt + (1.0f - a_d) * f->dy;
+        float a = smoothing(dt, cfg->euro_min_cutoff + cfg->euro_beta * hypotf(f->dx, f->dy));
+        f->x += a * (*x - f->x);
+        f->y += a * (*y - f->y);
+    }
+    else
+    {
+        f->x = *x;
+        f->y = *y;
+    }
+    f->t_us = t_us;
+
+    // Average over a few samples: noise must not look like motion to the stop detection
+    f->avg_x += AVG_GAIN * (f->x - f->avg_x);
+    f->avg_y += AVG_GAIN * (f->y - f->avg_y);
+
+    if (!f->moving)
+    {
+        if (hypotf(f->x - f->out_x, f->y - f->out_y) <= cfg->dead_zone_px)
+        {
+            *x = f->out_x;
+            *y = f->out_y;
+            return false;
+        }
+        f->moving = true;
+        f->still_x = f->avg_x;
+        f->still_y = f->avg_y;
+        f->still_us = t_us;
+    }
+    else if (hypotf(f->avg_x - f->still_x, f->avg_y - f->still_y) > cfg->hold_px)
+    {
+        f->still_x = f->avg_x;
+        f->still_y = f->avg_y;
+        f->still_us = t_us;
+    }
+    else if (cfg->dead_zone_px && t_us - f->still_us >= cfg->hold_ms * 1000LL)
+    {
+        // Stopped long enough: hold at the average position
+        f->moving = false;
+        f->x = f->avg_x;
+        f->y = f->avg_y;
+    }
+
+    uint16_t nx = to_px(f->x);
+    uint16_t ny = to_px(f->y);
+    bool changed = nx != f->out_x || ny != f->out_y;
+    f->out_x = nx;
+    f->out_y = ny;
+    *x = nx;
+    *y = ny;
+    return changed;
+}
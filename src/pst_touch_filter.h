@@ -0,0 +1,90 @@
+/**
+ * Touch jitter filter for PST.
+ *
+ * Responsibilities:
+ *  - Hold the reported point still while a finger rests on the panel: a dead zone
+ *    around the press point, left only when the finger moves beyond dead_zone_px
+ *  - Hysteresis: a moving finger is held again only after its average position
+ *    stayed within hold_px for hold_ms, so a slow drag is not chopped into steps
+ *  - Optionally smooth the moving point with a 1-euro filter (adaptive low-pass:
+ *    strong smoothing when slow, little lag when fast)
+ *  - Tell the caller which samples change the reported point, so unchanged ones
+ *    are not handed to LVGL and cause no scroll recomputation or redraw
+ *
+ * The filter only depends on the C library, so tools/pst_filter_eval.c can run it
+ * on recorded traces on the host.
+ *
+ * Requirements:
+ *  - One pst_touch_filter_t per pointer, updated with the samples of a press in
+ *    time order and reset on release
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Filter tuning, in display pixels (depends on the panel's noise and density).
+ */
+typedef struct {
+    uint8_t dead_zone_px;       /*!< Movement from the held point that starts a drag, 0 disables the dead zone */
+    uint8_t hold_px;            /*!< A moving finger whose average stays within this radius... */
+    uint16_t hold_ms;           /*!< ...for this long is held again */
+    float euro_min_cutoff;      /*!< 1-euro cutoff at rest, Hz; 0 disables the smoothing */
+    float euro_beta;            /*!< 1-euro cutoff increase per px/s of speed */
+    float euro_d_cutoff;        /*!< 1-euro cutoff of the speed estimate, Hz */
+} pst_touch_filter_cfg_t;
+
+#define PST_TOUCH_FILTER_DEFAULT_CONFIG()   \
+    {                                       \
+        .dead_zone_px = 8,                  \
+        .hold_px = 3,                       \
+        .hold_ms = 80,                      \
+        .euro_min_cutoff = 0,               \
+        .euro_beta = 0.05f,                 \
+        .euro_d_cutoff = 1.0f,              \
+    }
+
+/**
+ * @brief Filter state of one pointer.
+ */
+typedef struct {
+    int64_t t_us;               /*!< Time of the last sample */
+    float x;                    /*!< Smoothed position */
+    float y;
+    float dx;                   /*!< Smoothed speed, px/s */
+    float dy;
+    float avg_x;                /*!< Average position, for the stop detection */
+    float avg_y;
+    float still_x;              /*!< Where the finger stopped moving */
+    float still_y;
+    int64_t still_us;           /*!< Since when */
+    uint16_t out_x;             /*!< Reported position */
+    uint16_t out_y;
+    bool active;                /*!< A press is being filtered */
+    bool moving;                /*!< Outside the dead zone */
+} pst_touch_filter_t;
+
+/**
+ * @brief Forget the press (finger lifted).
+ */
+void pst_touch_filter_reset(pst_touch_filter_t *f);
+
+/**
+ * @brief Filter one sample of a pressed pointer.
+ *
+ * @param x  Sampled position, replaced by the position to report.
+ * @param y  Sampled position, replaced by the position to report.
+ *
+ * @return true if the reported position changed (always for the first sample of a press).
+ */
+bool pst_touch_filter_update(pst_touch_filter_t *f, const pst_touch_filter_cfg_t *cfg, int64_t t_us, uint16_t *x, uint16_t *y);
+
+#ifdef __cplusplus
+}
+#endif
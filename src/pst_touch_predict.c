@@ -0,0 +1,73 @@
+#include <math.h>
+#include <string.h>
+#include "pst_touch_predict.h"
+
+// A gap this long between samples restarts the estimate
+#define STALE_US 100000
+
+void pst_touch_predict_reset(pst_touch_predict_t *p)
+{
+    memset(p, 0, sizeof(*p));
+}
+
+void pst_touch_predict_update(pst_touch_predict_t *p, const pst_touch_predict_cfg_t *cfg, int64_t t_us, float x, float y)
+{
+    int64_t dt_us = t_us - p->t_us;
+
+    if (!p->samples || dt_us <= 0 || dt_us > STALE_US)
+    {
+        p->t_us = t_us;
+        p->x = x;
+        p->y = y;
+        p->vx = 0;
+        p->vy = 0;
+        p->samples = 1;
+        return;
+    }
+
+    // Constant-velocity prediction, corrected by the residual
+    float dt = dt_us / 1e6f;
+    float px = p->x + p->vx * dt;
+    float py = p->y + p->vy * dt;
+    float rx = x - px;
+    float ry = y - py;
+    float vx = p->vx + cfg->beta * rx / dt;
+    float vy = p->vy + cfg->beta * ry / dt;
+
+    // Direction reversal: stop extrapolating on that axis until the new motion builds up
+    if (vx * p->vx < 0)
+        vx = 0;
+    if (vy * p->vy < 0)
+        vy = 0;
+
+    p->x = px + cfg->alpha * rx;
+    p->y = py + cfg->alpha * ry;
+    p->vx = vx;
+    p->vy = vy;
+    p->t_us = t_us;
+    if (p->samples < UINT16_MAX)
+        p->samples++;
+}
+
+void pst_touch_predict_at(const pst_touch_predict_t *p, const pst_touch_predict_cfg_t *cfg, int64_t t_us, float *x, float *y)
+{
+    *x = p->x;
+    *y = p->y;
+    if (p->samples < cfg->min_samples || !cfg->aggressiveness || t_us <= p->t_us || t_us - p->t_us > STALE_US)
+        return;
+
+    float lead = (t_us - p->t_us) / 1e6f * cfg->aggressiveness / 100.0f;
+    float dx = p->vx * lead;
+    float dy = p->vy * lead;
+
+    float d2 = dx * dx + dy * dy;
+    float max = cfg->max_lead_px;
+    if (d2 > max * max)
+    {
+        float k = max / sqrtf(d2);
+        dx *= k;
+        dy *= k;
+    }
+    *x += dx;
+    *y += dy;
+}
@@ -0,0 +1,80 @@
+/**
+ * Touch position prediction for PST.
+ *
+ * Responsibilities:
+ *  - Track the finger with an alpha-beta (steady-state Kalman) constant-velocity filter
+ *  - Extrapolate it to when the next frame reaches the panel, so a dragged list
+ *    stays under the finger instead of one or two frames behind
+ *  - Stay safe: no prediction until the motion is known, none across a direction
+ *    reversal, and never further than max_lead_px
+ *
+ * The filter only depends on the C library, so tools/pst_predict_eval.c can run it
+ * on recorded traces on the host.
+ *
+ * Requirements:
+ *  - One pst_touch_predict_t per pointer, updated with samples in time order
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Prediction tuning.
+ */
+typedef struct {
+    float alpha;                /*!< Position gain (0..1], higher follows the samples closer */
+    float beta;                 /*!< Velocity gain (0..1], higher reacts faster to speed changes */
+    uint32_t lead_us;           /*!< LVGL read to photon time (render + flush, see pst_latency) */
+    uint8_t aggressiveness;     /*!< Percent of lead_us actually applied, 0 disables prediction */
+    uint16_t max_lead_px;       /*!< Longest extrapolation */
+    uint8_t min_samples;        /*!< Samples of a press before predicting */
+} pst_touch_predict_cfg_t;
+
+#define PST_TOUCH_PREDICT_DEFAULT_CONFIG()  \
+    {                                       \
+        .alpha = 0.85f,                     \
+        .beta = 0.35f,                      \
+        .lead_us = 30000,                   \
+        .aggressiveness = 70,               \
+        .max_lead_px = 48,                  \
+        .min_samples = 3,                   \
+    }
+
+/**
+ * @brief Filter state of one pointer.
+ */
+typedef struct {
+    int64_t t_us;               /*!< Time of the last sample */
+    float x;                    /*!< Filtered position */
+    float y;
+    float vx;                   /*!< Filtered velocity, px/s */
+    float vy;
+    uint16_t samples;           /*!< Samples since the press */
+} pst_touch_predict_t;
+
+/**
+ * @brief Forget the motion (finger lifted).
+ */
+void pst_touch_predict_reset(pst_touch_predict_t *p);
+
+/**
+ * @brief Feed one sample of a pressed pointer.
+ */
+void pst_touch_predict_update(pst_touch_predict_t *p, const pst_touch_predict_cfg_t *cfg, int64_t t_us, float x, float y);
+
+/**
+ * @brief Where the pointer is expected at `t_us` (the LVGL read time + cfg->lead_us).
+ *
+ * Returns the filtered position while there are fewer than min_samples samples.
+ */
+void pst_touch_predict_at(const pst_touch_predict_t *p, const pst_touch_predict_cfg_t *cfg, int64_t t_us, float *x, float *y);
+
+#ifdef __cplusplus
+}
+#endif
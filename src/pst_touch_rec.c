@@ -0,0 +1,399 @@
+#include "pst_touch_rec.h"
+
+#if CONFIG_PST_TOUCH_REC
+
+#include <stdio.h>
+#include <string.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_heap_caps.h"
+#include "esp_timer.h"
+#include "esp_log.h"
+#include "esp_bsp.h"
+#include "pst_dir_cache.h"
+#include "pst_touch_rec_fmt.h"
+
+static const char *TAG = "PST_TOUCH_REC";
+
+#define MAX_PAUSED 4
+#define PATH_MAX_LEN 64
+
+// Recorder: fed by the LVGL task, started and stopped under the LVGL lock
+static uint8_t *s_rec_buf = NULL;
+static uint32_t s_rec_cap;
+static uint32_t s_rec_count;
+static uint32_t s_rec_dropped;
+static volatile bool s_recording = false;
+static pst_touch_rec_cfg_t s_rec_cfg;
+static char s_rec_path[PATH_MAX_LEN];
+static pst_touch_rec_cursor_t s_rec_enc;
+static pst_touch_rec_event_t s_rec_prev;
+static bool s_rec_have_prev;
+static int64_t s_rec_t0_us;
+static uint16_t s_rec_hor_res;
+static uint16_t s_rec_ver_res;
+
+// Replay: LVGL task only, except start/stop which take the LVGL lock
+static struct {
+    bool active;
+    bool finishing;
+    bool aborted;
+    pst_touch_replay_mode_t mode;
+    uint32_t settle_ms;
+    pst_touch_replay_done_cb_t done_cb;
+    void *arg;
+    uint8_t *file;
+    pst_touch_rec_header_t hdr;
+    pst_touch_rec_cursor_t cur;
+    pst_touch_rec_event_t next;
+    bool have_next;
+    pst_touch_rec_event_t state;
+    uint32_t events;
+    uint32_t recorded_ms;
+    int64_t t0_us;
+    int64_t t_last_us;          // when the last record was delivered
+    lv_indev_drv_t drv;
+    lv_indev_t *indev;
+    lv_indev_t *paused[MAX_PAUSED];
+    int paused_cnt;
+    char path[PATH_MAX_LEN];
+} s_play;
+
+static void *buf_alloc(size_t size)
+{
+    void *buf = heap_caps_malloc(size, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+    return buf ? buf : heap_caps_malloc(size, MALLOC_CAP_DEFAULT);
+}
+
+static uint16_t clamp_coord(lv_coord_t v)
+{
+    if (v < 0)
+        return 0;
+    return v > 0xFFF ? 0xFFF : (uint16_t)v;
+}
+
+esp_err_t pst_touch_rec_start(const pst_touch_rec_cfg_t *cfg)
+{
+    const pst_touch_rec_cfg_t def_cfg = PST_TOUCH_REC_DEFAULT_CONFIG();
+    const pst_touch_rec_cfg_t *c = cfg ? cfg : &def_cfg;
+
+    uint8_t *buf = buf_alloc((size_t)c->max_records * PST_TOUCH_REC_RECORD_SIZE);
+    if (!buf)
+        return ESP_ERR_NO_MEM;
+
+    bsp_display_lock(0);
+    if (s_rec_buf || s_play.active)
+    {
+        bsp_display_unlock();
+        heap_caps_free(buf);
+        return ESP_ERR_INVALID_STATE;
+    }
+    s_rec_cfg = *c;
+    s_rec_path[0] = '\0';
+    if (c->path)
+        snprintf(s_rec_path, sizeof(s_rec_path), "%s", c->path);
+    s_rec_buf = buf;
+    s_rec_cap = c->max_records;
+    s_rec_count = 0;
+    s_rec_dropped = 0;
+    s_rec_have_prev = false;
+    memset(&s_rec_enc, 0, sizeof(s_rec_enc));
+    s_rec_hor_res = lv_disp_get_hor_res(NULL);
+    s_rec_ver_res = lv_disp_get_ver_res(NULL);
+    s_rec_t0_us = esp_timer_get_time();
+    s_recording = true;
+    bsp_display_unlock();
+
+    ESP_LOGI(TAG, "Recording (up to %lu records)", (unsigned long)c->max_records);
+    return ESP_OK;
+}
+
+static esp_err_t write_file(const char *path, const uint8_t *records, uint32_t count)
+{
+    const pst_touch_rec_header_t hdr = {
+        .hor_res = s_rec_hor_res,
+        .ver_res = s_rec_ver_res,
+        .read_period_ms = LV_INDEV_DEF_READ_PERIOD,
+        .records = count,
+    };
+    uint8_t raw[PST_TOUCH_REC_HEADER_SIZE];
+    pst_touch_rec_header_encode(&hdr, raw);
+
+    FILE *f = fopen(path, "wb");
+    if (!f)
+    {
+        ESP_LOGE(TAG, "Cannot create %s", path);
+        return ESP_FAIL;
+    }
+    size_t len = (size_t)count * PST_TOUCH_REC_RECORD_SIZE;
+    bool ok = fwrite(raw, 1, sizeof(raw), f) == sizeof(raw) && fwrite(records, 1, len, f) == len;
+    ok = (fclose(f) == 0) && ok;
+    if (!ok)
+    {
+        ESP_LOGE(TAG, "Write to %s failed", path);
+        return ESP_FAIL;
+    }
+    ESP_LOGI(TAG, "Saved %lu records to %s", (unsigned long)count, path);
+
+    // FatFs leaves the folder's timestamp alone: the browser would not see the new file
+    bsp_display_lock(0);
+    pst_dir_cache_invalidate(NULL);
+    bsp_display_unlock();
+    return ESP_OK;
+}
+
+esp_err_t pst_touch_rec_stop(const char *path)
+{
+    bsp_display_lock(0);
+    uint8_t *buf = s_rec_buf;
+    uint32_t count = s_rec_count;
+    s_recording = false;
+    s_rec_buf = NULL;
+    bsp_display_unlock();
+
+    if (!buf)
+        return ESP_ERR_INVALID_STATE;
+
+    if (s_rec_dropped)
+        ESP_LOGW(TAG, "Buffer full, %lu changes not recorded", (unsigned long)s_rec_dropped);
+    esp_err_t ret = path ? write_file(path, buf, count) : ESP_OK;
+    heap_caps_free(buf);
+    return ret;
+}
+
+static void save_task(void *arg)
+{
+    pst_touch_rec_stop(s_rec_path[0] ? s_rec_path : NULL);
+    vTaskDelete(NULL);
+}
+
+void pst_touch_rec_feed(const lv_indev_data_t *data)
+{
+    if (!s_recording)
+        return;
+
+    uint32_t t_ms = (uint32_t)((esp_timer_get_time() - s_rec_t0_us) / 1000);
+    if (s_rec_cfg.duration_ms && t_ms >= s_rec_cfg.duration_ms)
+    {
+        // The file is written outside the LVGL task
+        s_recording = false;
+        if (xTaskCreate(save_task, "PST rec save", 3072, NULL, 2, NULL) != pdPASS)
+            ESP_LOGE(TAG, "Cannot start the save task, call pst_touch_rec_stop()");
+        return;
+    }
+
+    const pst_touch_rec_event_t ev = {
+        .t_ms = t_ms,
+        .x = clamp_coord(data->point.x),
+        .y = clamp_coord(data->point.y),
+        .pressed = data->state == LV_INDEV_STATE_PRESSED,
+    };
+    // Only changes are recorded: LVGL reads the same state again until the next one
+    if (s_rec_have_prev && ev.pressed == s_rec_prev.pressed && ev.x == s_rec_prev.x && ev.y == s_rec_prev.y)
+        return;
+
+    unsigned n = pst_touch_rec_encode(&s_rec_enc, &ev, s_rec_buf + (size_t)s_rec_count * PST_TOUCH_REC_RECORD_SIZE,
+                                      s_rec_cap - s_rec_count);
+    if (!n)
+    {
+        s_rec_dropped++;
+        return;
+    }
+    s_rec_count += n;
+    s_rec_prev = ev;
+    s_rec_have_prev = true;
+}
+
+static void replay_finish(void *arg)
+{
+    pst_touch_replay_result_t res = {
+        .events = s_play.events,
+        .recorded_ms = s_play.recorded_ms,
+        .duration_ms = (uint32_t)((esp_timer_get_time() - s_play.t0_us) / 1000),
+        .aborted = s_play.aborted,
+    };
+    pst_perf_get_stats(&res.perf);
+
+    lv_indev_delete(s_play.indev);
+    s_play.indev = NULL;
+    for (int i = 0; i < s_play.paused_cnt; i++)
+        lv_indev_enable(s_play.paused[i], true);
+    heap_caps_free(s_play.file);
+    s_play.file = NULL;
+
+    ESP_LOGI(TAG, "Replay of %s %s: %lu events in %lu ms (recorded %lu ms), %lu frames, avg %lu us, max %lu us",
+             s_play.path, res.aborted ? "aborted" : "done", (unsigned long)res.events, (unsigned long)res.duration_ms,
+             (unsigned long)res.recorded_ms, (unsigned long)res.perf.frames, (unsigned long)res.perf.frame_us_avg,
+             (unsigned long)res.perf.frame_us_max);
+    pst_perf_report();
+
+    pst_touch_replay_done_cb_t cb = s_play.done_cb;
+    void *cb_arg = s_play.arg;
+    s_play.active = false;
+    if (cb)
+        cb(&res, cb_arg);
+}
+
+static void replay_read_cb(lv_indev_drv_t *drv, lv_indev_data_t *data)
+{
+    int64_t now = esp_timer_get_time();
+    uint32_t now_ms = (uint32_t)((now - s_play.t0_us) / 1000);
+
+    if (s_play.have_next && (s_play.mode == PST_TOUCH_REPLAY_FAST || now_ms >= s_play.next.t_ms))
+    {
+        s_play.state = s_play.next;
+        s_play.events++;
+        s_play.have_next = pst_touch_rec_decode_next(&s_play.cur, &s_play.next);
+        if (!s_play.have_next)
+            s_play.t_last_us = now;
+        // Catch up on records that are already due, without waiting for the next read
+        data->continue_reading = s_play.mode == PST_TOUCH_REPLAY_ORIGINAL && s_play.have_next && now_ms >= s_play.next.t_ms;
+    }
+
+    data->point.x = s_play.state.x;
+    data->point.y = s_play.state.y;
+    data->state = s_play.state.pressed ? LV_INDEV_STATE_PRESSED : LV_INDEV_STATE_RELEASED;
+
+    if (!s_play.have_next && !s_play.finishing && now - s_play.t_last_us >= (int64_t)s_play.settle_ms * 1000)
+    {
+        // The input device cannot be deleted from its own read callback
+        s_play.finishing = true;
+        lv_async_call(replay_finish, NULL);
+    }
+}
+
+static uint8_t *load_file(const char *path, pst_touch_rec_header_t *hdr, esp_err_t *err)
+{
+    uint8_t raw[PST_TOUCH_REC_HEADER_SIZE];
+    uint8_t *records = NULL;
+
+    FILE *f = fopen(path, "rb");
+    if (!f)
+    {
+        *err = ESP_ERR_NOT_FOUND;
+        return NULL;
+    }
+    *err = ESP_ERR_INVALID_RESPONSE;
+    if (fread(raw, 1, sizeof(raw), f) == sizeof(raw) && pst_touch_rec_header_decode(raw, hdr))
+    {
+        size_t len = (size_t)hdr->records * PST_TOUCH_REC_RECORD_SIZE;
+        records = buf_alloc(len ? len : 1);
+        if (!records)
+        {
+            *err = ESP_ERR_NO_MEM;
+        }
+        else if (fread(records, 1, len, f) != len)
+        {
+            heap_caps_free(records);
+            records = NULL;
+        }
+    }
+    fclose(f);
+    if (records)
+        *err = ESP_OK;
+    return records;
+}
+
+esp_err_t pst_touch_replay_start(const char *path, pst_touch_replay_mode_t mode, uint32_t settle_ms,
+                                 pst_touch_replay_done_cb_t done_cb, void *arg)
+{
+    pst_touch_rec_header_t hdr;
+    esp_err_t err;
+
+    if (s_play.active || s_rec_buf)
+        return ESP_ERR_INVALID_STATE;
+
+    uint8_t *file = load_file(path, &hdr, &err);
+    if (!file)
+    {
+        ESP_LOGE(TAG, "Cannot load %s (%s)", path, esp_err_to_name(err));
+        return err;
+    }
+
+    // Length of the recording and number of events
+    pst_touch_rec_cursor_t scan;
+    pst_touch_rec_event_t ev = { 0 };
+    uint32_t events = 0;
+    pst_touch_rec_decode_begin(&scan, file, hdr.records);
+    while (pst_touch_rec_decode_next(&scan, &ev))
+        events++;
+
+    bsp_display_lock(0);
+    if (s_play.active || s_rec_buf)
+    {
+        bsp_display_unlock();
+        heap_caps_free(file);
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    memset(&s_play, 0, sizeof(s_play));
+    lv_indev_drv_init(&s_play.drv);
+    s_play.drv.type = LV_INDEV_TYPE_POINTER;
+    s_play.drv.read_cb = replay_read_cb;
+    s_play.drv.disp = lv_disp_get_default();
+    s_play.indev = lv_indev_drv_register(&s_play.drv);
+    if (!s_play.indev)
+    {
+        bsp_display_unlock();
+        heap_caps_free(file);
+        return ESP_ERR_NO_MEM;
+    }
+    uint32_t period = hdr.read_period_ms ? hdr.read_period_ms : LV_INDEV_DEF_READ_PERIOD;
+    lv_timer_set_period(s_play.drv.read_timer, mode == PST_TOUCH_REPLAY_FAST ? 1 : period);
+
+    // The real touch would mix with the recording
+    for (lv_indev_t *indev = lv_indev_get_next(NULL); indev; indev = lv_indev_get_next(indev))
+    {
+        if (indev == s_play.indev || indev->driver->type != LV_INDEV_TYPE_POINTER || indev->proc.disabled)
+            continue;
+        if (s_play.paused_cnt < MAX_PAUSED)
+        {
+            lv_indev_enable(indev, false);
+            s_play.paused[s_play.paused_cnt++] = indev;
+        }
+    }
+
+    s_play.mode = mode;
+    s_play.settle_ms = settle_ms;
+    s_play.done_cb = done_cb;
+    s_play.arg = arg;
+    s_play.file = file;
+    s_play.hdr = hdr;
+    s_play.recorded_ms = ev.t_ms;
+    snprintf(s_play.path, sizeof(s_play.path), "%s", path);
+    pst_touch_rec_decode_begin(&s_play.cur, file, hdr.records);
+    s_play.have_next = pst_touch_rec_decode_next(&s_play.cur, &s_play.next);
+    s_play.t0_us = esp_timer_get_time();
+    s_play.t_last_us = s_play.t0_us;
+    pst_perf_reset();
+    s_play.active = true;
+    bsp_display_unlock();
+
+    ESP_LOGI(TAG, "Replaying %s: %lu events, %lu ms, %s", path, (unsigned long)events, (unsigned long)ev.t_ms,
+             mode == PST_TOUCH_REPLAY_FAST ? "fast" : "original timing");
+    return ESP_OK;
+}
+
+void pst_touch_replay_stop(void)
+{
+    bsp_display_lock(0);
+    if (s_play.active && !s_play.finishing)
+    {
+        s_play.aborted = true;
+        s_play.finishing = true;
+        lv_async_call(replay_finish, NULL);
+    }
+    bsp_display_unlock();
+}
+
+void pst_touch_rec_get_stats(pst_touch_rec_stats_t *out)
+{
+    *out = (pst_touch_rec_stats_t) {
+        .records = s_rec_count,
+        .dropped = s_rec_dropped,
+        .recording = s_recording,
+        .replaying = s_play.active,
+    };
+}
+
+#endif
@@ -0,0 +1,164 @@
+/**
+ * Touch input record and replay for PST benchmarks.
+ *
+ * Responsibilities:
+ *  - Record what the touch input device hands to LVGL (lvgl_port_touchpad_read),
+ *    timestamped, one record per change, into a PSRAM buffer written to the SD
+ *    card on stop (format: pst_touch_rec_fmt.h)
+ *  - Replay a recording through an input device of its own, at the original timing
+ *    or one record per LVGL read, with the real touch disabled meanwhile
+ *  - Measure every replay: wall time and pst_perf frame statistics, logged and
+ *    passed to the completion callback
+ *
+ * A benchmark is a recording of a scenario (e.g. open the keyboard, type a filter,
+ * scroll the list) replayed on each firmware build to compare. Fast replays keep
+ * the order of the input but not its timing: long presses and scroll momentum
+ * behave differently, so compare them only with other fast replays.
+ *
+ * Requirements:
+ *  - CONFIG_PST_TOUCH_REC enabled; otherwise every hook compiles to nothing
+ *  - CONFIG_PST_PERF_BENCH enabled for frame statistics (they are zero without it)
+ *  - SD card mounted for pst_touch_rec_stop() with a path and for replays
+ *  - Not called with the LVGL lock held (the functions take it)
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "sdkconfig.h"
+#include "esp_err.h"
+#include "lvgl.h"
+#include "pst_perf.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Recorder configuration.
+ */
+typedef struct {
+    uint32_t max_records;       /*!< Buffer size; recording stops when it is full */
+    uint32_t duration_ms;       /*!< Stop and save to `path` after this long, 0 to stop explicitly */
+    const char *path;           /*!< File written when duration_ms elapses */
+} pst_touch_rec_cfg_t;
+
+#define PST_TOUCH_REC_DEFAULT_CONFIG()  \
+    {                                   \
+        .max_records = 16384,           \
+        .duration_ms = 0,               \
+        .path = NULL,                   \
+    }
+
+/**
+ * @brief Replay pacing.
+ */
+typedef enum {
+    PST_TOUCH_REPLAY_ORIGINAL = 0,  /*!< Every record at its recorded time */
+    PST_TOUCH_REPLAY_FAST,          /*!< One record per LVGL read, reads every LVGL pass */
+} pst_touch_replay_mode_t;
+
+/**
+ * @brief Result of one replay.
+ */
+typedef struct {
+    uint32_t events;            /*!< Records replayed */
+    uint32_t recorded_ms;       /*!< Length of the recording */
+    uint32_t duration_ms;       /*!< Wall time of the replay, settle time included */
+    bool aborted;               /*!< Stopped with pst_touch_replay_stop() */
+    pst_perf_stats_t perf;      /*!< Frames rendered during the replay */
+} pst_touch_replay_result_t;
+
+/**
+ * @brief Called from the LVGL task when a replay ends.
+ */
+typedef void (*pst_touch_replay_done_cb_t)(const pst_touch_replay_result_t *result, void *arg);
+
+/**
+ * @brief Recorder counters.
+ */
+typedef struct {
+    uint32_t records;           /*!< Records in the buffer */
+    uint32_t dropped;           /*!< Changes lost because the buffer was full */
+    bool recording;
+    bool replaying;
+} pst_touch_rec_stats_t;
+
+#if CONFIG_PST_TOUCH_REC
+
+/**
+ * @brief Start recording.
+ *
+ * @param cfg  Configuration, NULL for PST_TOUCH_REC_DEFAULT_CONFIG().
+ *
+ * @return
+ *      - ESP_OK                 on success
+ *      - ESP_ERR_INVALID_STATE  if recording or replaying
+ *      - ESP_ERR_NO_MEM         if the buffer cannot be allocated
+ */
+esp_err_t pst_touch_rec_start(const pst_touch_rec_cfg_t *cfg);
+
+/**
+ * @brief Stop recording and write the recording.
+ *
+ * @param path  File to write, NULL to discard the recording.
+ *
+ * @return
+ *      - ESP_OK                 on success
+ *      - ESP_ERR_INVALID_STATE  if not recording
+ *      - ESP_FAIL               if the file cannot be written
+ */
+esp_err_t pst_touch_rec_stop(const char *path);
+
+/**
+ * @brief lv_port hook: the state just read for LVGL (LVGL task).
+ */
+void pst_touch_rec_feed(const lv_indev_data_t *data);
+
+/**
+ * @brief Replay a recording.
+ *
+ * The file is loaded first; the replay starts with the next LVGL read.
+ *
+ * @param path      Recording.
+ * @param mode      Pacing.
+ * @param settle_ms Time after the last record before the replay ends (lets scrolling settle).
+ * @param done_cb   Completion callback, may be NULL.
+ * @param arg       Argument of done_cb.
+ *
+ * @return
+ *      - ESP_OK                 on success
+ *      - ESP_ERR_INVALID_STATE  if recording or replaying
+ *      - ESP_ERR_NOT_FOUND      if the file cannot be opened
+ *      - ESP_ERR_INVALID_RESPONSE if the file is not a recording
+ *      - ESP_ERR_NO_MEM         if the recording or the input device cannot be allocated
+ */
+esp_err_t pst_touch_replay_start(const char *path, pst_touch_replay_mode_t mode, uint32_t settle_ms,
+                                 pst_touch_replay_done_cb_t done_cb, void *arg);
+
+/**
+ * @brief Abort the running replay (its callback still runs, with `aborted` set).
+ */
+void pst_touch_replay_stop(void);
+
+/**
+ * @brief Copy the current counters.
+ */
+void pst_touch_rec_get_stats(pst_touch_rec_stats_t *out);
+
+#else
+
+static inline esp_err_t pst_touch_rec_start(const pst_touch_rec_cfg_t *cfg) { return ESP_ERR_NOT_SUPPORTED; }
+static inline esp_err_t pst_touch_rec_stop(const char *path) { return ESP_ERR_NOT_SUPPORTED; }
+static inline void pst_touch_rec_feed(const lv_indev_data_t *data) {}
+static inline esp_err_t pst_touch_replay_start(const char *path, pst_touch_replay_mode_t mode, uint32_t settle_ms,
+                                               pst_touch_replay_done_cb_t done_cb, void *arg) { return ESP_ERR_NOT_SUPPORTED; }
+static inline void pst_touch_replay_stop(void) {}
+static inline void pst_touch_rec_get_stats(pst_touch_rec_stats_t *out) { *out = (pst_touch_rec_stats_t) { 0 }; }
+
+#endif
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,103 @@
+#include <string.h>
+#include "pst_touch_rec_fmt.h"
+
+#define MAGIC "PSTR"
+#define DT_MAX 0xFFFF
+#define REC_PRESSED (1UL << 24)
+#define REC_GAP (1UL << 25)
+
+static void put_u16(uint8_t *p, uint16_t v)
+{
+    p[0] = v & 0xFF;
+    p[1] = v >> 8;
+}
+
+static void put_u32(uint8_t *p, uint32_t v)
+{
+    put_u16(p, v & 0xFFFF);
+    put_u16(p + 2, v >> 16);
+}
+
+static uint16_t get_u16(const uint8_t *p)
+{
+    return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+static uint32_t get_u32(const uint8_t *p)
+{
+    return get_u16(p) | ((uint32_t)get_u16(p + 2) << 16);
+}
+
+void pst_touch_rec_header_encode(const pst_touch_rec_header_t *h, uint8_t out[PST_TOUCH_REC_HEADER_SIZE])
+{
+    memcpy(out, MAGIC, 4);
+    out[4] = PST_TOUCH_REC_VERSION;
+    out[5] = PST_TOUCH_REC_RECORD_SIZE;
+    put_u16(out + 6, h->hor_res);
+    put_u16(out + 8, h->ver_res);
+    put_u16(out + 10, h->read_period_ms);
+    put_u32(out + 12, h->records);
+}
+
+bool pst_touch_rec_header_decode(const uint8_t in[PST_TOUCH_REC_HEADER_SIZE], pst_touch_rec_header_t *h)
+{
+    if (memcmp(in, MAGIC, 4) || in[4] != PST_TOUCH_REC_VERSION || in[5] != PST_TOUCH_REC_RECORD_SIZE)
+        return false;
+
+    h->hor_res = get_u16(in + 6);
+    h->ver_res = get_u16(in + 8);
+    h->read_period_ms = get_u16(in + 10);
+    h->records = get_u32(in + 12);
+    return true;
+}
+
+unsigned pst_touch_rec_encode(pst_touch_rec_cursor_t *c, const pst_touch_rec_event_t *ev, uint8_t *out, unsigned max)
+{
+    uint32_t dt = ev->t_ms - c->t_ms;
+    unsigned gaps = dt ? (dt - 1) / DT_MAX : 0;
+
+    if (gaps + 1 > max)
+        return 0;
+
+    for (unsigned i = 0; i < gaps; i++)
+    {
+        put_u16(out, DT_MAX);
+        put_u32(out + 2, REC_GAP);
+        out += PST_TOUCH_REC_RECORD_SIZE;
+        dt -= DT_MAX;
+    }
+
+    uint32_t v = (ev->x & 0xFFF) | ((uint32_t)(ev->y & 0xFFF) << 12) | (ev->pressed ? REC_PRESSED : 0);
+    put_u16(out, (uint16_t)dt);
+    put_u32(out + 2, v);
+    c->t_ms = ev->t_ms;
+    return gaps + 1;
+}
+
+void pst_touch_rec_decode_begin(pst_touch_rec_cursor_t *c, const uint8_t *records, uint32_t count)
+{
+    c->t_ms = 0;
+    c->p = records;
+    c->left = count;
+}
+
+bool pst_touch_rec_decode_next(pst_touch_rec_cursor_t *c, pst_touch_rec_event_t *ev)
+{
+    while (c->left)
+    {
+        uint16_t dt = get_u16(c->p);
+        uint32_t v = get_u32(c->p + 2);
+        c->p += PST_TOUCH_REC_RECORD_SIZE;
+        c->left--;
+        c->t_ms += dt;
+        if (v & REC_GAP)
+            continue;
+
+        ev->t_ms = c->t_ms;
+        ev->x = v & 0xFFF;
+        ev->y = (v >> 12) & 0xFFF;
+        ev->pressed = (v & REC_PRESSED) != 0;
+        return true;
+    }
+    return false;
+}
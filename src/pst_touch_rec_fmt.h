@@ -0,0 +1,95 @@
+/**
+ * Touch recording file format for PST.
+ *
+ * Responsibilities:
+ *  - Encode and decode the compact binary recordings of pst_touch_rec: what LVGL
+ *    read from the touch input device, one record per change
+ *  - Keep the byte layout fixed (little endian, no padding), so recordings made on
+ *    the device can be read on the host
+ *
+ * Layout: a 16-byte header, then 6-byte records:
+ *  - Header:  "PSTR", u8 version, u8 record size, u16 hor_res, u16 ver_res,
+ *             u16 LVGL read period (ms), u32 record count
+ *  - Record:  u16 ms since the previous record, u32 x (bits 0-11) | y (bits 12-23) |
+ *             pressed (bit 24) | gap (bit 25, the record only carries time)
+ *
+ * Like pst_touch_predict, this only depends on the C library; the host tools
+ * (tools/pst_predict_eval.c) read recordings with it.
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define PST_TOUCH_REC_VERSION 1
+#define PST_TOUCH_REC_HEADER_SIZE 16
+#define PST_TOUCH_REC_RECORD_SIZE 6
+
+/**
+ * @brief Recording header.
+ */
+typedef struct {
+    uint16_t hor_res;           /*!< Display resolution when recorded */
+    uint16_t ver_res;
+    uint16_t read_period_ms;    /*!< LVGL input read period when recorded */
+    uint32_t records;           /*!< Records following the header, gaps included */
+} pst_touch_rec_header_t;
+
+/**
+ * @brief One input state read by LVGL.
+ */
+typedef struct {
+    uint32_t t_ms;              /*!< Time since the start of the recording */
+    uint16_t x;
+    uint16_t y;
+    bool pressed;
+} pst_touch_rec_event_t;
+
+/**
+ * @brief Encoder or decoder position.
+ */
+typedef struct {
+    uint32_t t_ms;              /*!< Time of the last record written or read */
+    const uint8_t *p;           /*!< Decoder: next record */
+    uint32_t left;              /*!< Decoder: records left */
+} pst_touch_rec_cursor_t;
+
+void pst_touch_rec_header_encode(const pst_touch_rec_header_t *h, uint8_t out[PST_TOUCH_REC_HEADER_SIZE]);
+
+/**
+ * @return false if `in` is not a recording of a supported version.
+ */
+bool pst_touch_rec_header_decode(const uint8_t in[PST_TOUCH_REC_HEADER_SIZE], pst_touch_rec_header_t *h);
+
+/**
+ * @brief Append one event, preceded by gap records if it is more than 65 s after the last.
+ *
+ * @param c    Encoder position, zeroed at the start of the recording.
+ * @param ev   Event; its time must not be before the last one.
+ * @param out  Room for `max` records.
+ *
+ * @return Records written, 0 if `max` is too small (nothing is written then).
+ */
+unsigned pst_touch_rec_encode(pst_touch_rec_cursor_t *c, const pst_touch_rec_event_t *ev, uint8_t *out, unsigned max);
+
+/**
+ * @brief Start decoding the records following a header.
+ */
+void pst_touch_rec_decode_begin(pst_touch_rec_cursor_t *c, const uint8_t *records, uint32_t count);
+
+/**
+ * @brief Next event, gap records skipped.
+ *
+ * @return false at the end of the recording.
+ */
+bool pst_touch_rec_decode_next(pst_touch_rec_cursor_t *c, pst_touch_rec_event_t *ev);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,168 @@
+#include <math.h>
+#include <string.h>
+#include "pst_touch_xform.h"
+
+#ifdef ESP_PLATFORM
+#include "pst_perf.h"
+#else
+#define PST_IRAM_ATTR
+#endif
+
+// Limits of a plausible calibration (a touch panel glued slightly off, not a different panel)
+#define CAL_SCALE_MIN 0.5
+#define CAL_SCALE_MAX 2.0
+#define CAL_SHEAR_MAX 0.5
+#define CAL_OFFSET_MAX 128.0
+#define CAL_DET_MIN 1000.0
+
+// Affine matrix in floating point, only used while building
+typedef struct {
+    double a, b, c;
+    double d, e, f;
+} affine_t;
+
+/**
+ * Return outer(inner(p)).
+ */
+static affine_t affine_mul(const affine_t *outer, const affine_t *inner)
+{
+    affine_t r = {
+        .a = outer->a * inner->a + outer->b * inner->d,
+        .b = outer->a * inner->b + outer->b * inner->e,
+        .c = outer->a * inner->c + outer->b * inner->f + outer->c,
+        .d = outer->d * inner->a + outer->e * inner->d,
+        .e = outer->d * inner->b + outer->e * inner->e,
+        .f = outer->d * inner->c + outer->e * inner->f + outer->f,
+    };
+    return r;
+}
+
+static int32_t to_q16(double v)
+{
+    return (int32_t)lround(v * PST_TOUCH_XFORM_ONE);
+}
+
+void pst_touch_xform_build(pst_touch_xform_t *xf, const pst_touch_orient_t *orient, const pst_touch_cal_t *cal)
+{
+    const double xm = orient->x_max - 1;
+    const double ym = orient->y_max - 1;
+    uint16_t w = orient->x_max;
+    uint16_t h = orient->y_max;
+    affine_t m;
+
+    // Rotation maps the last controller pixel to the last display pixel (x_max - 1)
+    switch (orient->rotate)
+    {
+    case PST_TOUCH_ROT_90:
+        m = (affine_t) { 0, 1, 0, -1, 0, xm };
+        w = orient->y_max;
+        h = orient->x_max;
+        break;
+    case PST_TOUCH_ROT_180:
+        m = (affine_t) { -1, 0, xm, 0, -1, ym };
+        break;
+    case PST_TOUCH_ROT_270:
+        m = (affine_t) { 0, -1, ym, 1, 0, 0 };
+        w = orient->y_max;
+        h = orient->x_max;
+        break;
+    default:
+        m = (affine_t) { 1, 0, 0, 0, 1, 0 };
+        break;
+    }
+
+    if (orient->mirror_x)
+    {
+        const affine_t mx = { -1, 0, w - 1, 0, 1, 0 };
+        m = affine_mul(&mx, &m);
+    }
+    if (orient->mirror_y)
+    {
+        const affine_t my = { 1, 0, 0, 0, -1, h - 1 };
+        m = affine_mul(&my, &m);
+    }
+    if (orient->swap_xy)
+    {
+        const affine_t sw = { 0, 1, 0, 1, 0, 0 };
+        m = affine_mul(&sw, &m);
+        uint16_t tmp = w;
+        w = h;
+        h = tmp;
+    }
+    if (cal)
+    {
+        const double one = PST_TOUCH_XFORM_ONE;
+        const affine_t c = {
+            cal->a / one, cal->b / one, cal->c / one,
+            cal->d / one, cal->e / one, cal->f / one,
+        };
+        m = affine_mul(&c, &m);
+    }
+
+    // +0.5 in the offsets turns the final shift into rounding
+    xf->a = to_q16(m.a);
+    xf->b = to_q16(m.b);
+    xf->c = to_q16(m.c + 0.5);
+    xf->d = to_q16(m.d);
+    xf->e = to_q16(m.e);
+    xf->f = to_q16(m.f + 0.5);
+    xf->w = w;
+    xf->h = h;
+}
+
+PST_IRAM_ATTR void pst_touch_xform_apply(const pst_touch_xform_t *xf, uint16_t *x, uint16_t *y, uint8_t point_num)
+{
+    for (int i = 0; i < point_num; i++)
+    {
+        // |a|, |b| <= 2.0 and coordinates < 2^10 keep the sums within int32
+        int32_t px = x[i];
+        int32_t py = y[i];
+        int32_t nx = (xf->a * px + xf->b * py + xf->c) >> 16;
+        int32_t ny = (xf->d * px + xf->e * py + xf->f) >> 16;
+
+        x[i] = nx < 0 ? 0 : (nx >= xf->w ? xf->w - 1 : nx);
+        y[i] = ny < 0 ? 0 : (ny >= xf->h ? xf->h - 1 : ny);
+    }
+}
+
+bool pst_touch_cal_compute(const pst_touch_point_t measured[3], const pst_touch_point_t target[3],
+                           pst_touch_cal_t *out)
+{
+    // Differences to the third point: target - t2 = M (measured - m2)
+    double mx0 = measured[0].x - measured[2].x;
+    double my0 = measured[0].y - measured[2].y;
+    double mx1 = measured[1].x - measured[2].x;
+    double my1 = measured[1].y - measured[2].y;
+    double det = mx0 * my1 - mx1 * my0;
+
+    // Points too close to a line
+    if (fabs(det) < CAL_DET_MIN)
+        return false;
+
+    double tx0 = target[0].x - target[2].x;
+    double tx1 = target[1].x - target[2].x;
+    double ty0 = target[0].y - target[2].y;
+    double ty1 = target[1].y - target[2].y;
+
+    affine_t m = {
+        .a = (tx0 * my1 - tx1 * my0) / det,
+        .b = (mx0 * tx1 - mx1 * tx0) / det,
+        .d = (ty0 * my1 - ty1 * my0) / det,
+        .e = (mx0 * ty1 - mx1 * ty0) / det,
+    };
+    m.c = target[2].x - m.a * measured[2].x - m.b * measured[2].y;
+    m.f = target[2].y - m.d * measured[2].x - m.e * measured[2].y;
+
+    if (m.a < CAL_SCALE_MIN || m.a > CAL_SCALE_MAX || m.e < CAL_SCALE_MIN || m.e > CAL_SCALE_MAX ||
+        fabs(m.b) > CAL_SHEAR_MAX || fabs(m.d) > CAL_SHEAR_MAX ||
+        fabs(m.c) > CAL_OFFSET_MAX || fabs(m.f) > CAL_OFFSET_MAX)
+        return false;
+
+    out->a = to_q16(m.a);
+    out->b = to_q16(m.b);
+    out->c = to_q16(m.c);
+    out->d = to_q16(m.d);
+    out->e = to_q16(m.e);
+    out->f = to_q16(m.f);
+    return true;
+}
@@ -0,0 +1,112 @@
+/**
+ * Fixed-point touch coordinate transform and calibration for PST.
+ *
+ * Responsibilities:
+ *  - Fold display rotation, mirror and swap flags and an optional calibration into
+ *    one Q16.16 affine matrix, computed once per display configuration
+ *  - Map controller points to display pixels in a single pass, without branches
+ *    per point, clamped to the display
+ *  - Compute a calibration from three touched targets (kept in NVS by pst_touch_cal)
+ *
+ * The calibration is an affine correction in display space: it maps the points the
+ * uncalibrated transform reports to where the targets really are, so it survives a
+ * rotation change and can be measured with ordinary LVGL input.
+ *
+ * Plain C without ESP-IDF or LVGL, so that tools/pst_xform_check.c runs it on the host.
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define PST_TOUCH_XFORM_ONE (1 << 16)   /*!< 1.0 in Q16.16 */
+
+/**
+ * @brief Display-space calibration: x' = (a x + b y + c) / 2^16, y' = (d x + e y + f) / 2^16.
+ */
+typedef struct {
+    int32_t a, b, c;
+    int32_t d, e, f;
+} pst_touch_cal_t;
+
+#define PST_TOUCH_CAL_IDENTITY()                \
+    {                                           \
+        .a = PST_TOUCH_XFORM_ONE, .b = 0, .c = 0, \
+        .d = 0, .e = PST_TOUCH_XFORM_ONE, .f = 0, \
+    }
+
+/**
+ * @brief Display rotation, same values as lv_disp_rot_t.
+ */
+typedef enum {
+    PST_TOUCH_ROT_0 = 0,
+    PST_TOUCH_ROT_90,
+    PST_TOUCH_ROT_180,
+    PST_TOUCH_ROT_270,
+} pst_touch_rot_t;
+
+/**
+ * @brief A point in controller or display pixels, laid out as lv_point_t.
+ */
+typedef struct {
+    int16_t x;
+    int16_t y;
+} pst_touch_point_t;
+
+/**
+ * @brief Orientation of the controller relative to the display.
+ */
+typedef struct {
+    uint16_t x_max;             /*!< Controller X resolution */
+    uint16_t y_max;             /*!< Controller Y resolution */
+    pst_touch_rot_t rotate;     /*!< Display rotation */
+    bool mirror_x;              /*!< Mirror X after rotation */
+    bool mirror_y;              /*!< Mirror Y after rotation */
+    bool swap_xy;               /*!< Swap X and Y after mirroring */
+} pst_touch_orient_t;
+
+/**
+ * @brief Controller-to-display transform, rounding included in c and f.
+ */
+typedef struct {
+    int32_t a, b, c;
+    int32_t d, e, f;
+    uint16_t w;                 /*!< Display width, X is clamped to [0, w - 1] */
+    uint16_t h;                 /*!< Display height, Y is clamped to [0, h - 1] */
+} pst_touch_xform_t;
+
+/**
+ * @brief Build the transform for an orientation and an optional calibration.
+ *
+ * @param xf      Transform to fill.
+ * @param orient  Controller orientation.
+ * @param cal     Calibration, NULL for none.
+ */
+void pst_touch_xform_build(pst_touch_xform_t *xf, const pst_touch_orient_t *orient, const pst_touch_cal_t *cal);
+
+/**
+ * @brief Transform points in place.
+ */
+void pst_touch_xform_apply(const pst_touch_xform_t *xf, uint16_t *x, uint16_t *y, uint8_t point_num);
+
+/**
+ * @brief Compute a calibration from three targets.
+ *
+ * @param measured  Points reported while touching the targets (uncalibrated).
+ * @param target    Where the targets were drawn.
+ * @param out       Calibration.
+ *
+ * @return false if the points are (nearly) collinear or the correction is implausible
+ *         (scale beyond 0.5..2 or offset beyond 128 px).
+ */
+bool pst_touch_cal_compute(const pst_touch_point_t measured[3], const pst_touch_point_t target[3],
+                           pst_touch_cal_t *out);
+
+#ifdef __cplusplus
+}
+#endif
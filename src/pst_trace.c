@@ -0,0 +1,269 @@
+#include "pst_trace.h"
+
+#if CONFIG_PST_TRACE
+
+#include <stdarg.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <string.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_cpu.h"
+#include "esp_timer.h"
+#include "esp_log.h"
+#include "pst_perf.h"
+
+static const char *TAG = "PST_TRACE";
+
+#define RING_LEN CONFIG_PST_TRACE_RING_LEN
+#define RING_MASK (RING_LEN - 1)
+#define SEEN_LEN 256            // format strings already defined in the file
+#define LINE_LEN 160
+_Static_assert((RING_LEN & RING_MASK) == 0, "CONFIG_PST_TRACE_RING_LEN must be a power of two");
+
+// File stream, decoded by tools/pst_trace_decode.py
+#define FILE_MAGIC "PSTT"
+#define FILE_VERSION 1
+#define REC_DEFINE 'D'          // u32 id, u16 len, format string
+#define REC_EVENT 'E'           // u32 id, u32 t_us, u8 core, u8 nargs, u32 args[nargs]
+#define REC_DROPPED 'X'         // u8 core, u32 count
+
+typedef struct {
+    const char *fmt;
+    uint32_t t_us;
+    uint32_t args[PST_TRACE_MAX_ARGS];
+    uint8_t nargs;
+} slot_t;
+
+// One ring per core: its producer is whatever runs on that core with interrupts masked,
+// its consumer the trace task
+typedef struct {
+    slot_t slots[RING_LEN];
+    atomic_uint head;
+    atomic_uint tail;
+    uint32_t written;
+    uint32_t dropped;
+    uint32_t dropped_reported;  // trace task only
+} ring_t;
+
+static ring_t s_rings[portNUM_PROCESSORS];
+
+static pst_trace_cfg_t s_cfg;
+static TaskHandle_t s_task = NULL;
+static FILE *s_file = NULL;
+static const char *s_seen[SEEN_LEN];
+static uint32_t s_emitted;
+
+PST_IRAM_ATTR void pst_trace_write(const char *fmt, int nargs, ...)
+{
+    uint32_t t_us = (uint32_t)esp_timer_get_time();
+
+    // Nothing else runs on this core until the slot is published
+    UBaseType_t irq = portSET_INTERRUPT_MASK_FROM_ISR();
+    ring_t *r = &s_rings[esp_cpu_get_core_id()];
+    unsigned head = atomic_load_explicit(&r->head, memory_order_relaxed);
+    unsigned tail = atomic_load_explicit(&r->tail, memory_order_acquire);
+
+    if (head - tail >= RING_LEN)
+    {
+        r->dropped++;
+    }
+    else
+    {
+        slot_t *s = &r->slots[head & RING_MASK];
+        s->fmt = fmt;
+        s->t_us = t_us;
+        s->nargs = nargs < PST_TRACE_MAX_ARGS ? nargs : PST_TRACE_MAX_ARGS;
+
+        va_list ap;
+        va_start(ap, nargs);
+        for (int i = 0; i < s->nargs; i++)
+            s->args[i] = va_arg(ap, uint32_t);
+        va_end(ap);
+
+        atomic_store_explicit(&r->head, head + 1, memory_order_release);
+        r->written++;
+    }
+    portCLEAR_INTERRUPT_MASK_FROM_ISR(irq);
+}
+
+static void put_u32(uint8_t *p, uint32_t v)
+{
+    p[0] = v & 0xFF;
+    p[1] = (v >> 8) & 0xFF;
+    p[2] = (v >> 16) & 0xFF;
+    p[3] = v >> 24;
+}
+
+// Define each format string in the stream the first time it is used
+static void file_define(const char *fmt)
+{
+    uint32_t h = ((uint32_t)(uintptr_t)fmt >> 2) & (SEEN_LEN - 1);
+
+    for (unsigned i = 0; i < SEEN_LEN; i++)
+    {
+        const char **e = &s_seen[(h + i) & (SEEN_LEN - 1)];
+        if (*e == fmt)
+            return;
+        if (!*e)
+        {
+            *e = fmt;
+            break;
+        }
+    }
+    // A full table only costs redundant definitions
+
+    size_t len = strlen(fmt);
+    if (len > UINT16_MAX)
+        len = UINT16_MAX;
+    uint8_t rec[7] = { REC_DEFINE };
+    put_u32(rec + 1, (uint32_t)(uintptr_t)fmt);
+    rec[5] = len & 0xFF;
+    rec[6] = len >> 8;
+    fwrite(rec, 1, sizeof(rec), s_file);
+    fwrite(fmt, 1, len, s_file);
+}
+
+static void emit(int core, const slot_t *s)
+{
+    const uint32_t *a = s->args;
+
+    if (s_file)
+    {
+        file_define(s->fmt);
+        uint8_t rec[11 + 4 * PST_TRACE_MAX_ARGS] = { REC_EVENT };
+        put_u32(rec + 1, (uint32_t)(uintptr_t)s->fmt);
+        put_u32(rec + 5, s->t_us);
+        rec[9] = core;
+        rec[10] = s->nargs;
+        for (int i = 0; i < s->nargs; i++)
+            put_u32(rec + 11 + 4 * i, a[i]);
+        fwrite(rec, 1, 11 + 4 * s->nargs, s_file);
+    }
+    else
+    {
+        char line[LINE_LEN];
+        // Unused trailing words are ignored by the format
+        snprintf(line, sizeof(line), s->fmt, a[0], a[1], a[2], a[3], a[4]);
+        printf("T (%lu) %s/%d: %s\n", (unsigned long)(s->t_us / 1000), TAG, core, line);
+    }
+    s_emitted++;
+}
+
+static void emit_dropped(int core, uint32_t count)
+{
+    if (s_file)
+    {
+        uint8_t rec[6] = { REC_DROPPED, (uint8_t)core };
+        put_u32(rec + 2, count);
+        fwrite(rec, 1, sizeof(rec), s_file);
+    }
+    else
+    {
+        printf("T %s/%d: %lu traces dropped (ring full)\n", TAG, core, (unsigned long)count);
+    }
+}
+
+static void drain(void)
+{
+    unsigned tail[portNUM_PROCESSORS];
+    unsigned head[portNUM_PROCESSORS];
+
+    for (int c = 0; c < portNUM_PROCESSORS; c++)
+    {
+        tail[c] = atomic_load_explicit(&s_rings[c].tail, memory_order_relaxed);
+        head[c] = atomic_load_explicit(&s_rings[c].head, memory_order_acquire);
+    }
+
+    // Merge the rings in time order
+    while (1)
+    {
+        int next = -1;
+        for (int c = 0; c < portNUM_PROCESSORS; c++)
+        {
+            if (tail[c] == head[c])
+                continue;
+            if (next < 0 || (int32_t)(s_rings[c].slots[tail[c] & RING_MASK].t_us - s_rings[next].slots[tail[next] & RING_MASK].t_us) < 0)
+                next = c;
+        }
+        if (next < 0)
+            break;
+
+        ring_t *r = &s_rings[next];
+        slot_t s = r->slots[tail[next] & RING_MASK];
+        tail[next]++;
+        atomic_store_explicit(&r->tail, tail[next], memory_order_release);
+        emit(next, &s);
+    }
+
+    for (int c = 0; c < portNUM_PROCESSORS; c++)
+    {
+        uint32_t dropped = s_rings[c].dropped;
+        if (dropped != s_rings[c].dropped_reported)
+        {
+            emit_dropped(c, dropped - s_rings[c].dropped_reported);
+            s_rings[c].dropped_reported = dropped;
+        }
+    }
+    if (s_file)
+        fflush(s_file);
+}
+
+static void trace_task(void *arg)
+{
+    while (1)
+    {
+        drain();
+        vTaskDelay(pdMS_TO_TICKS(s_cfg.drain_period_ms));
+    }
+}
+
+esp_err_t pst_trace_init(const pst_trace_cfg_t *cfg)
+{
+    const pst_trace_cfg_t def_cfg = PST_TRACE_DEFAULT_CONFIG();
+
+    if (s_task)
+        return ESP_ERR_INVALID_STATE;
+
+    s_cfg = cfg ? *cfg : def_cfg;
+    if (s_cfg.sink == PST_TRACE_SINK_FILE && s_cfg.path)
+    {
+        s_file = fopen(s_cfg.path, "ab");
+        if (s_file)
+        {
+            // Every boot appends a new session to the file
+            uint8_t hdr[6] = { 0, 0, 0, 0, FILE_VERSION, PST_TRACE_MAX_ARGS };
+            memcpy(hdr, FILE_MAGIC, 4);
+            fwrite(hdr, 1, sizeof(hdr), s_file);
+        }
+        else
+        {
+            ESP_LOGW(TAG, "Cannot open %s, tracing to the console", s_cfg.path);
+        }
+    }
+
+    if (xTaskCreate(trace_task, "PST trace", s_cfg.task_stack, NULL, s_cfg.task_priority, &s_task) != pdPASS)
+    {
+        s_task = NULL;
+        if (s_file)
+        {
+            fclose(s_file);
+            s_file = NULL;
+        }
+        return ESP_ERR_NO_MEM;
+    }
+    ESP_LOGI(TAG, "Deferred tracing to %s", s_file ? s_cfg.path : "the console");
+    return ESP_OK;
+}
+
+void pst_trace_get_stats(pst_trace_stats_t *out)
+{
+    *out = (pst_trace_stats_t) { .emitted = s_emitted };
+    for (int c = 0; c < portNUM_PROCESSORS; c++)
+    {
+        out->written += s_rings[c].written;
+        out->dropped += s_rings[c].dropped;
+    }
+}
+
+#endif
@@ -0,0 +1,122 @@
+/**
+ * Deferred trace logging for PST hot paths.
+ *
+ * Responsibilities:
+ *  - Let hot paths (LVGL task, flush, touch, ISRs) log without formatting or I/O:
+ *    PST_TRACE() stores the format string address, a timestamp and up to
+ *    PST_TRACE_MAX_ARGS raw 32-bit arguments into a ring of the current core
+ *  - Keep the write cheap and safe anywhere: no lock shared between cores, only the
+ *    local core's interrupts are masked for the few words copied
+ *  - Drain the rings from a low-priority task that either prints the lines on the
+ *    console or appends a binary stream to the SD card
+ *    (decoded on the host by tools/pst_trace_decode.py)
+ *  - Count traces dropped because a ring was full, instead of blocking
+ *
+ * Arguments are stored as 32-bit words: integers, characters and pointers only
+ * (no %s, no 64-bit or floating point values). The format must be a string literal.
+ *
+ * Requirements:
+ *  - CONFIG_PST_TRACE enabled; otherwise PST_TRACE() compiles to nothing
+ *  - pst_trace_init() called once (after the SD card is mounted for the SD sink);
+ *    traces written before are kept in the rings until then
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "sdkconfig.h"
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Arguments stored per trace.
+ */
+#define PST_TRACE_MAX_ARGS 5
+
+/**
+ * @brief Where the traces go.
+ */
+typedef enum {
+    PST_TRACE_SINK_CONSOLE = 0,     /*!< Formatted lines on stdout */
+    PST_TRACE_SINK_FILE,            /*!< Binary stream appended to a file */
+} pst_trace_sink_t;
+
+/**
+ * @brief Trace task configuration.
+ */
+typedef struct {
+    pst_trace_sink_t sink;
+    const char *path;           /*!< File of PST_TRACE_SINK_FILE */
+    int task_priority;          /*!< Below every task whose timing matters */
+    int task_stack;
+    uint32_t drain_period_ms;   /*!< Rings are drained this often */
+} pst_trace_cfg_t;
+
+#define PST_TRACE_DEFAULT_CONFIG()          \
+    {                                       \
+        .sink = PST_TRACE_SINK_CONSOLE,     \
+        .path = NULL,                       \
+        .task_priority = 1,                 \
+        .task_stack = 3072,                 \
+        .drain_period_ms = 100,             \
+    }
+
+/**
+ * @brief Counters since boot.
+ */
+typedef struct {
+    uint32_t written;           /*!< Traces stored in the rings */
+    uint32_t dropped;           /*!< Traces lost because a ring was full */
+    uint32_t emitted;           /*!< Traces printed or written to the file */
+} pst_trace_stats_t;
+
+#if CONFIG_PST_TRACE
+
+#define PST_TRACE_NARGS_(_0, _1, _2, _3, _4, _5, n, ...) n
+#define PST_TRACE_NARGS(...) PST_TRACE_NARGS_(0, ##__VA_ARGS__, 5, 4, 3, 2, 1, 0)
+
+/**
+ * @brief Log a trace; `fmt` is a printf format, without the trailing newline.
+ */
+#define PST_TRACE(fmt, ...) pst_trace_write("" fmt, PST_TRACE_NARGS(__VA_ARGS__), ##__VA_ARGS__)
+
+/**
+ * @brief Store one trace (use PST_TRACE()). Callable from tasks and ISRs, on both cores.
+ */
+void pst_trace_write(const char *fmt, int nargs, ...) __attribute__((format(printf, 1, 3)));
+
+/**
+ * @brief Start the task draining the rings.
+ *
+ * @param cfg  Configuration, NULL for PST_TRACE_DEFAULT_CONFIG().
+ *
+ * @return
+ *      - ESP_OK                 on success (a file that cannot be opened falls back to the console)
+ *      - ESP_ERR_INVALID_STATE  if already started
+ *      - ESP_ERR_NO_MEM         if the task cannot be created
+ */
+esp_err_t pst_trace_init(const pst_trace_cfg_t *cfg);
+
+/**
+ * @brief Copy the current counters.
+ */
+void pst_trace_get_stats(pst_trace_stats_t *out);
+
+#else
+
+#include <stdio.h>
+
+#define PST_TRACE(fmt, ...) do { if (0) { printf("" fmt, ##__VA_ARGS__); } } while (0)
+
+static inline esp_err_t pst_trace_init(const pst_trace_cfg_t *cfg) { return ESP_ERR_NOT_SUPPORTED; }
+static inline void pst_trace_get_stats(pst_trace_stats_t *out) { *out = (pst_trace_stats_t) { 0 }; }
+
+#endif
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,238 @@
+#include <lvgl.h>
+#include <string.h>
+#include "pst_vlist.h"
+#include "pst_vlist_map.h"
+
+#define UNBOUND UINT32_MAX
+// Spacer height kept clear of LV_COORD_MAX, where LV_PCT() values begin
+#define SPACER_MAX (LV_COORD_MAX - LV_COORD_MAX / 32)
+
+typedef struct {
+    pst_vlist_cfg_t cfg;
+    lv_obj_t *spacer;                       // gives the scroll range (pst_vlist_map)
+    pst_vlist_map_t map;
+    lv_obj_t *rows[PST_VLIST_MAX_ROWS];
+    uint32_t bound[PST_VLIST_MAX_ROWS];     // entry shown by each row, UNBOUND if hidden
+    uint16_t rows_n;
+    uint32_t count;
+} vlist_t;
+
+static vlist_t *get_vlist(const lv_obj_t *list)
+{
+    return lv_obj_get_user_data((lv_obj_t *)list);
+}
+
+static void row_click_cb(lv_event_t *e)
+{
+    vlist_t *v = lv_event_get_user_data(e);
+    uintptr_t slot = (uintptr_t)lv_obj_get_user_data(lv_event_get_target(e));
+
+    if (v->bound[slot] == UNBOUND)
+        return;
+    if (lv_event_get_code(e) == LV_EVENT_PRESSED)
+    {
+        if (v->cfg.press_cb)
+            v->cfg.press_cb(v->bound[slot], v->cfg.user_arg);
+    }
+    else if (v->cfg.click_cb)
+    {
+        v->cfg.click_cb(v->bound[slot], v->cfg.user_arg);
+    }
+}
+
+// Pool large enough for the viewport, created on the first layout and on resize
+static void ensure_rows(lv_obj_t *list, vlist_t *v)
+{
+    lv_coord_t view_h = lv_obj_get_content_height(list);
+    uint32_t need = (view_h + v->cfg.row_height - 1) / v->cfg.row_height + 1 + 2 * v->cfg.overscan;
+    if (need > PST_VLIST_MAX_ROWS)
+        need = PST_VLIST_MAX_ROWS;
+
+    // Recycling is modulo the pool size: a new size rebinds everything
+    if (need > v->rows_n)
+    {
+        for (uint16_t i = 0; i < v->rows_n; i++)
+            v->bound[i] = UNBOUND;
+    }
+    while (v->rows_n < need)
+    {
+        lv_obj_t *row = lv_list_add_btn(list, LV_SYMBOL_FILE, "");
+        // Detail column: after the label, which grows to fill the row
+        lv_obj_t *detail = lv_label_create(row);
+        lv_obj_set_style_text_color(detail, lv_palette_main(LV_PALETTE_GREY), 0);
+        lv_obj_add_flag(detail, LV_OBJ_FLAG_HIDDEN);
+        // Floating: placed in viewport coordinates by update(), not scrolled by LVGL
+        lv_obj_add_flag(row, LV_OBJ_FLAG_HIDDEN | LV_OBJ_FLAG_FLOATING);
+        lv_obj_set_size(row, LV_PCT(100), v->cfg.row_height);
+        lv_obj_set_user_data(row, (void *)(uintptr_t)v->rows_n);
+        lv_obj_add_event_cb(row, row_click_cb, LV_EVENT_CLICKED, v);
+        lv_obj_add_event_cb(row, row_click_cb, LV_EVENT_PRESSED, v);
+        v->bound[v->rows_n] = UNBOUND;
+        v->rows[v->rows_n++] = row;
+    }
+}
+
+static void remap(lv_obj_t *list, vlist_t *v)
+{
+    pst_vlist_map_set(&v->map, v->count, v->cfg.row_height, lv_obj_get_content_height(list), SPACER_MAX);
+    lv_obj_set_height(v->spacer, (lv_coord_t)v->map.spacer_h);
+}
+
+static void update(lv_obj_t *list, vlist_t *v, bool rebind)
+{
+    if (!v->rows_n)
+        return;
+
+    uint64_t top = pst_vlist_map_virtual(&v->map, lv_obj_get_scroll_y(list));
+    uint32_t first = pst_vlist_map_first(&v->map, top, v->cfg.overscan);
+
+    for (uint16_t i = 0; i < v->rows_n; i++)
+    {
+        uint32_t index = first + i;
+        uint16_t slot = index % v->rows_n;
+        lv_obj_t *row = v->rows[slot];
+
+        if (index >= v->count)
+        {
+            if (v->bound[slot] != UNBOUND)
+            {
+                lv_obj_add_flag(row, LV_OBJ_FLAG_HIDDEN);
+                v->bound[slot] = UNBOUND;
+            }
+            continue;
+        }
+        // Within a few rows of the viewport: small whatever the index
+        lv_obj_set_pos(row, 0, (lv_coord_t)pst_vlist_map_row_y(&v->map, top, index));
+        if (v->bound[slot] == index && !rebind)
+            continue;
+
+        if (v->cfg.bind_cb)
+            v->cfg.bind_cb(row, index, v->cfg.user_arg);
+        if (v->bound[slot] == UNBOUND)
+            lv_obj_clear_flag(row, LV_OBJ_FLAG_HIDDEN);
+        v->bound[slot] = index;
+    }
+}
+
+static void list_event_cb(lv_event_t *e)
+{
+    lv_obj_t *list = lv_event_get_target(e);
+    vlist_t *v = lv_event_get_user_data(e);
+
+    switch (lv_event_get_code(e))
+    {
+    case LV_EVENT_SCROLL:
+        update(list, v, false);
+        break;
+    case LV_EVENT_SIZE_CHANGED:
+        remap(list, v);
+        ensure_rows(list, v);
+        update(list, v, false);
+        break;
+    case LV_EVENT_DELETE:
+        lv_mem_free(v);
+        break;
+    default:
+        break;
+    }
+}
+
+lv_obj_t *pst_vlist_create(lv_obj_t *parent, const pst_vlist_cfg_t *cfg)
+{
+    const pst_vlist_cfg_t def_cfg = PST_VLIST_DEFAULT_CONFIG();
+    vlist_t *v = lv_mem_alloc(sizeof(vlist_t));
+    if (!v)
+        return NULL;
+    memset(v, 0, sizeof(*v));
+    v->cfg = cfg ? *cfg : def_cfg;
+    if (v->cfg.row_height <= 0)
+        v->cfg.row_height = def_cfg.row_height;
+
+    // lv_list for its theme; rows are placed by hand, not by the flex layout
+    lv_obj_t *list = lv_list_create(parent);
+    lv_obj_set_layout(list, 0);
+    lv_obj_set_scroll_dir(list, LV_DIR_VER);
+    lv_obj_set_user_data(list, v);
+    lv_obj_add_event_cb(list, list_event_cb, LV_EVENT_ALL, v);
+
+    v->spacer = lv_obj_create(list);
+    lv_obj_remove_style_all(v->spacer);
+    lv_obj_clear_flag(v->spacer, LV_OBJ_FLAG_CLICKABLE);
+    lv_obj_add_flag(v->spacer, LV_OBJ_FLAG_IGNORE_LAYOUT);
+    lv_obj_set_size(v->spacer, 1, 0);
+    return list;
+}
+
+void pst_vlist_set_count(lv_obj_t *list, uint32_t count)
+{
+    vlist_t *v = get_vlist(list);
+    uint64_t top = pst_vlist_map_virtual(&v->map, lv_obj_get_scroll_y(list));
+
+    v->count = count;
+    remap(list, v);
+    lv_obj_update_layout(list);
+    // The same entries stay at the top, though the scale may have changed;
+    // shrinking may have moved the scroll position past the end
+    lv_obj_scroll_to_y(list, pst_vlist_map_scroll(&v->map, top), LV_ANIM_OFF);
+    lv_obj_scroll_by_bounded(list, 0, 0, LV_ANIM_OFF);
+    ensure_rows(list, v);
+    update(list, v, false);
+}
+
+uint32_t pst_vlist_get_count(const lv_obj_t *list)
+{
+    return get_vlist(list)->count;
+}
+
+void pst_vlist_refresh(lv_obj_t *list)
+{
+    update(list, get_vlist(list), true);
+}
+
+uint32_t pst_vlist_get_top(lv_obj_t *list)
+{
+    vlist_t *v = get_vlist(list);
+
+    return (uint32_t)(pst_vlist_map_virtual(&v->map, lv_obj_get_scroll_y(list)) / v->cfg.row_height);
+}
+
+void pst_vlist_scroll_to(lv_obj_t *list, uint32_t index, lv_anim_enable_t anim)
+{
+    vlist_t *v = get_vlist(list);
+
+    lv_obj_scroll_to_y(list, pst_vlist_map_scroll(&v->map, (uint64_t)index * v->cfg.row_height), anim);
+    lv_obj_scroll_by_bounded(list, 0, 0, anim);
+    update(list, v, false);
+}
+
+void pst_vlist_row_set(lv_obj_t *row, const void *icon, const char *text)
+{
+    lv_obj_t *img = lv_obj_get_child(row, 0);
+    lv_obj_t *label = lv_obj_get_child(row, 1);
+
+    if (icon)
+    {
+        lv_img_set_src(img, icon);
+        lv_obj_clear_flag(img, LV_OBJ_FLAG_HIDDEN);
+    }
+    else
+    {
+        lv_obj_add_flag(img, LV_OBJ_FLAG_HIDDEN);
+    }
+    lv_label_set_text(label, text);
+}
+
+void pst_vlist_row_set_detail(lv_obj_t *row, const char *text)
+{
+    lv_obj_t *detail = lv_obj_get_child(row, 2);
+
+    if (text && text[0] != '\0')
+    {
+        lv_label_set_text(detail, text);
+        lv_obj_clear_flag(detail, LV_OBJ_FLAG_HIDDEN);
+    }
+    else
+    {
+        lv_obj_add_flag(detail, LV_OBJ_FLAG_HIDDEN);
+    }
+}
@@ -0,0 +1,118 @@
+/**
+ * Virtualized list widget for PST.
+ *
+ * Responsibilities:
+ *  - Show lists of any length with a fixed pool of row objects, sized to the
+ *    viewport: rows are recycled on scroll and rebound to the entries that come
+ *    into view, so memory and build time do not depend on the entry count
+ *  - Keep the scroll range and scrollbar right with an invisible spacer as tall
+ *    as all the rows together, up to what lv_coord_t holds; longer lists scroll
+ *    proportionally faster over the same range (pst_vlist_map)
+ *  - Leave the data to the caller: a bind callback fills a row for an entry index,
+ *    a click callback reports the index of a tapped row, a press callback the
+ *    index of a row touched (before the click, e.g. to prefetch its data)
+ *
+ * Rows are lv_list buttons (icon + label, list theme, and a detail label on the
+ * right), all row_height tall.
+ * Recycling is by index modulo the pool size, so scrolling by one row rebinds one row.
+ *
+ * Requirements:
+ *  - All functions must be called with the LVGL lock held
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "lvgl.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Largest row pool (viewport rows plus overscan).
+ */
+#define PST_VLIST_MAX_ROWS 48
+
+/**
+ * @brief Fill `row` for entry `index` (use pst_vlist_row_set()).
+ */
+typedef void (*pst_vlist_bind_cb_t)(lv_obj_t *row, uint32_t index, void *arg);
+
+/**
+ * @brief Entry `index` was tapped.
+ */
+typedef void (*pst_vlist_click_cb_t)(uint32_t index, void *arg);
+
+/**
+ * @brief List configuration.
+ */
+typedef struct {
+    lv_coord_t row_height;      /*!< Height of every row, px */
+    uint8_t overscan;           /*!< Rows kept bound above and below the viewport */
+    pst_vlist_bind_cb_t bind_cb;
+    pst_vlist_click_cb_t click_cb;
+    pst_vlist_click_cb_t press_cb;  /*!< Optional: a row was pressed, a click may follow */
+    void *user_arg;             /*!< Argument of the callbacks */
+} pst_vlist_cfg_t;
+
+#define PST_VLIST_DEFAULT_CONFIG()  \
+    {                               \
+        .row_height = 40,           \
+        .overscan = 2,              \
+        .bind_cb = NULL,            \
+        .click_cb = NULL,           \
+        .press_cb = NULL,           \
+        .user_arg = NULL,           \
+    }
+
+/**
+ * @brief Create an empty list.
+ *
+ * @return the list object, NULL if out of memory.
+ */
+lv_obj_t *pst_vlist_create(lv_obj_t *parent, const pst_vlist_cfg_t *cfg);
+
+/**
+ * @brief Set the number of entries; the scroll position is kept (clamped).
+ *
+ * Visible rows are rebound only if their index changes meaning: call
+ * pst_vlist_refresh() when existing entries changed.
+ */
+void pst_vlist_set_count(lv_obj_t *list, uint32_t count);
+
+/**
+ * @brief Number of entries.
+ */
+uint32_t pst_vlist_get_count(const lv_obj_t *list);
+
+/**
+ * @brief Rebind every visible row (the entries changed).
+ */
+void pst_vlist_refresh(lv_obj_t *list);
+
+/**
+ * @brief Entry at the top of the viewport.
+ */
+uint32_t pst_vlist_get_top(lv_obj_t *list);
+
+/**
+ * @brief Scroll so that entry `index` is at the top (clamped).
+ */
+void pst_vlist_scroll_to(lv_obj_t *list, uint32_t index, lv_anim_enable_t anim);
+
+/**
+ * @brief Bind helper: set the icon (LV_SYMBOL_*, an image descriptor or NULL) and
+ *        text of a row.
+ */
+void pst_vlist_row_set(lv_obj_t *row, const void *icon, const char *text);
+
+/**
+ * @brief Bind helper: set the detail text at the right of a row (NULL or "" hides it).
+ */
+void pst_vlist_row_set_detail(lv_obj_t *row, const char *text);
+
+#ifdef __cplusplus
+}
+#endif
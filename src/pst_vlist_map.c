@@ -0,0 +1,60 @@
+#include <stdbool.h>
+#include "pst_vlist_map.h"
+
+void pst_vlist_map_set(pst_vlist_map_t *m, uint32_t count, uint16_t row_height, int32_t view_h, int32_t spacer_max)
+{
+    m->virt_h = (uint64_t)count * row_height;
+    m->spacer_h = m->virt_h > (uint64_t)spacer_max ? spacer_max : (int32_t)m->virt_h;
+    m->view_h = view_h > 0 ? view_h : 0;
+    m->row_height = row_height ? row_height : 1;
+}
+
+// Scaled: the rows are taller than the scroll range, and the viewport is smaller than both
+static bool scaled(const pst_vlist_map_t *m)
+{
+    return m->virt_h > (uint64_t)m->spacer_h && m->spacer_h > m->view_h;
+}
+
+uint64_t pst_vlist_map_virtual(const pst_vlist_map_t *m, int32_t scroll_y)
+{
+    if (scroll_y <= 0)
+        return 0;
+    if (!scaled(m))
+        return (uint64_t)scroll_y;
+
+    // Both ranges end with the last row at the bottom of the viewport
+    uint64_t range = (uint64_t)(m->spacer_h - m->view_h);
+    uint64_t virt_range = m->virt_h - (uint64_t)m->view_h;
+    if ((uint64_t)scroll_y >= range)
+        return virt_range;
+    return (uint64_t)scroll_y * virt_range / range;
+}
+
+int32_t pst_vlist_map_scroll(const pst_vlist_map_t *m, uint64_t virt)
+{
+    if (!scaled(m))
+    {
+        int32_t range = m->spacer_h - m->view_h;
+        if (range <= 0)
+            return 0;
+        return virt > (uint64_t)range ? range : (int32_t)virt;
+    }
+
+    uint64_t range = (uint64_t)(m->spacer_h - m->view_h);
+    uint64_t virt_range = m->virt_h - (uint64_t)m->view_h;
+    if (virt >= virt_range)
+        return (int32_t)range;
+    // Rounded down: the row asked for lands at most a scroll step below the top
+    return (int32_t)(virt * range / virt_range);
+}
+
+uint32_t pst_vlist_map_first(const pst_vlist_map_t *m, uint64_t top, uint8_t overscan)
+{
+    uint64_t first = top / m->row_height;
+    return first > overscan ? (uint32_t)(first - overscan) : 0;
+}
+
+int32_t pst_vlist_map_row_y(const pst_vlist_map_t *m, uint64_t top, uint32_t index)
+{
+    return (int32_t)((int64_t)index * m->row_height - (int64_t)top);
+}
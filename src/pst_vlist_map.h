@@ -0,0 +1,62 @@
+/**
+ * Scroll mapping of the virtualized list for PST.
+ *
+ * Responsibilities:
+ *  - Map the scroll position of pst_vlist to the virtual position of the rows,
+ *    so lists of any length fit a scroll range LVGL can hold: lv_coord_t is 16
+ *    bits (LV_USE_LARGE_COORD 0), sizes and positions stop at LV_COORD_MAX (8191)
+ *  - One to one while all rows fit within spacer_max; past that the scroll range is
+ *    spacer_max and each scrolled pixel moves the rows proportionally further,
+ *    with the first and the last row exactly at the ends
+ *  - Give the first row to bind and the place of each row in the viewport
+ *
+ * Like pst_touch_filter, this only depends on the C library, so
+ * tools/pst_vlist_check.c runs it on the host.
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Mapping of one list.
+ */
+typedef struct {
+    uint64_t virt_h;            /*!< All rows together, px */
+    int32_t spacer_h;           /*!< Scrolled height: virt_h, at most spacer_max */
+    int32_t view_h;             /*!< Viewport (content) height */
+    uint16_t row_height;
+} pst_vlist_map_t;
+
+/**
+ * @brief Set up the mapping for `count` rows in a `view_h` tall viewport.
+ */
+void pst_vlist_map_set(pst_vlist_map_t *m, uint32_t count, uint16_t row_height, int32_t view_h, int32_t spacer_max);
+
+/**
+ * @brief Virtual position shown at the top of the viewport for a scroll position.
+ */
+uint64_t pst_vlist_map_virtual(const pst_vlist_map_t *m, int32_t scroll_y);
+
+/**
+ * @brief Scroll position that shows virtual position `virt` at the top (clamped to the range).
+ */
+int32_t pst_vlist_map_scroll(const pst_vlist_map_t *m, uint64_t virt);
+
+/**
+ * @brief First row to bind with `overscan` rows above the viewport.
+ */
+uint32_t pst_vlist_map_first(const pst_vlist_map_t *m, uint64_t top, uint8_t overscan);
+
+/**
+ * @brief Y of row `index` in the viewport (negative above it).
+ */
+int32_t pst_vlist_map_row_y(const pst_vlist_map_t *m, uint64_t top, uint32_t index);
+
+#ifdef __cplusplus
+}
+#endif
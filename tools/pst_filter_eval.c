@@ -0,0 +1,216 @@
+/**
+ * Offline evaluation of the touch jitter filter (src/pst_touch_filter.c).
+ *
+ * Replays a recorded touch trace through the filter, as the touch task does, and
+ * reports how many samples would still reach LVGL and how far the reported point
+ * strays from the sampled one.
+ *
+ * Build and run on the host:
+ *   gcc -O2 -Isrc tools/pst_filter_eval.c src/pst_touch_filter.c src/pst_touch_rec_fmt.c -lm -o pst_filter_eval
+ *   ./pst_filter_eval [-z dead_zone_px] [-p hold_px] [-t hold_ms] [-c min_cutoff] [-b beta] [-n noise_px] [-d] trace
+ *
+ * Trace: one sample per line, "t_us,x,y,points"; lines starting with '#' are ignored
+ * (pst_predict_eval -d writes this format). A pst_touch_rec recording (.ptr) is read
+ * as well, but holds what LVGL read, already filtered: -n adds uniform noise of up to
+ * noise_px to every pressed sample. -d prints the filtered trace as CSV.
+ */
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "pst_touch_filter.h"
+#include "pst_touch_rec_fmt.h"
+
+typedef struct {
+    int64_t t_us;
+    float x;
+    float y;
+    int points;
+} sample_t;
+
+static int cmp_float(const void *a, const void *b)
+{
+    float fa = *(const float *)a;
+    float fb = *(const float *)b;
+    return (fa > fb) - (fa < fb);
+}
+
+static sample_t *load_rec(FILE *f, const pst_touch_rec_header_t *hdr, size_t *count)
+{
+    size_t len = (size_t)hdr->records * PST_TOUCH_REC_RECORD_SIZE;
+    uint8_t *raw = malloc(len ? len : 1);
+    sample_t *s = malloc((hdr->records ? hdr->records : 1) * sizeof(*s));
+    size_t n = 0;
+
+    if (raw && s && fread(raw, 1, len, f) == len)
+    {
+        pst_touch_rec_cursor_t c;
+        pst_touch_rec_event_t ev;
+        pst_touch_rec_decode_begin(&c, raw, hdr->records);
+        while (pst_touch_rec_decode_next(&c, &ev))
+            s[n++] = (sample_t) { (int64_t)ev.t_ms * 1000, ev.x, ev.y, ev.pressed };
+    }
+    else
+    {
+        fprintf(stderr, "truncated recording\n");
+        free(s);
+        s = NULL;
+    }
+    free(raw);
+    fclose(f);
+    *count = n;
+    return s;
+}
+
+static sample_t *load(const char *path, size_t *count)
+{
+    FILE *f = fopen(path, "rb");
+    if (!f)
+    {
+        perror(path);
+        return NULL;
+    }
+
+    uint8_t raw[PST_TOUCH_REC_HEADER_SIZE];
+    pst_touch_rec_header_t hdr;
+    if (fread(raw, 1, sizeof(raw), f) == sizeof(raw) && pst_touch_rec_header_decode(raw, &hdr))
+        return load_rec(f, &hdr, count);
+    rewind(f);
+
+    size_t cap = 1024;
+    size_t n = 0;
+    sample_t *s = malloc(cap * sizeof(*s));
+    char line[128];
+    while (s && fgets(line, sizeof(line), f))
+    {
+        long long t;
+        float x;
+        float y;
+        int points;
+        if (line[0] == '#' || sscanf(line, "%lld,%f,%f,%d", &t, &x, &y, &points) != 4)
+            continue;
+        if (n == cap)
+        {
+            cap *= 2;
+            s = realloc(s, cap * sizeof(*s));
+            if (!s)
+                break;
+        }
+        s[n++] = (sample_t) { t, x, y, points };
+    }
+    fclose(f);
+    *count = n;
+    return s;
+}
+
+int main(int argc, char **argv)
+{
+    pst_touch_filter_cfg_t cfg = PST_TOUCH_FILTER_DEFAULT_CONFIG();
+    int opt;
+    int dump = 0;
+    float noise = 0;
+
+    while ((opt = getopt(argc, argv, "z:p:t:c:b:n:d")) != -1)
+    {
+        switch (opt)
+        {
+        case 'z': cfg.dead_zone_px = atoi(optarg); break;
+        case 'p': cfg.hold_px = atoi(optarg); break;
+        case 't': cfg.hold_ms = atoi(optarg); break;
+        case 'c': cfg.euro_min_cutoff = atof(optarg); break;
+        case 'b': cfg.euro_beta = atof(optarg); break;
+        case 'n': noise = atof(optarg); break;
+        case 'd': dump = 1; break;
+        default:
+            fprintf(stderr, "usage: %s [-z dead_zone_px] [-p hold_px] [-t hold_ms] [-c min_cutoff] [-b beta] [-n noise_px] [-d] trace\n", argv[0]);
+            return 2;
+        }
+    }
+    if (optind >= argc)
+    {
+        fprintf(stderr, "missing trace file\n");
+        return 2;
+    }
+
+    size_t n = 0;
+    sample_t *s = load(argv[optind], &n);
+    if (!s)
+        return 1;
+
+    // Reproducible noise
+    srand(1);
+    for (size_t i = 0; i < n && noise > 0; i++)
+    {
+        if (!s[i].points)
+            continue;
+        s[i].x = fmaxf(0, s[i].x + noise * (2.0f * rand() / RAND_MAX - 1.0f));
+        s[i].y = fmaxf(0, s[i].y + noise * (2.0f * rand() / RAND_MAX - 1.0f));
+    }
+
+    float *err = malloc((n ? n : 1) * sizeof(float));
+    size_t n_err = 0;
+    double err_sum = 0;
+    size_t pressed = 0;
+    size_t reported = 0;
+    int64_t press_us = 0;
+    pst_touch_filter_t f;
+    pst_touch_filter_reset(&f);
+
+    if (dump)
+        printf("# t_us,x,y,points,reported\n");
+    for (size_t i = 0; i < n; i++)
+    {
+        // Same rule as the touch task: only single-finger presses are filtered
+        if (s[i].points != 1)
+        {
+            pst_touch_filter_reset(&f);
+            if (dump)
+                printf("%lld,%.0f,%.0f,%d,1\n", (long long)s[i].t_us, s[i].x, s[i].y, s[i].points);
+            continue;
+        }
+        if (i + 1 < n)
+            press_us += s[i + 1].t_us - s[i].t_us;
+
+        uint16_t x = (uint16_t)lroundf(s[i].x);
+        uint16_t y = (uint16_t)lroundf(s[i].y);
+        bool changed = pst_touch_filter_update(&f, &cfg, s[i].t_us, &x, &y);
+        pressed++;
+        reported += changed;
+
+        float e = hypotf(x - s[i].x, y - s[i].y);
+        err[n_err++] = e;
+        err_sum += e;
+        if (dump)
+            printf("%lld,%u,%u,1,%d\n", (long long)s[i].t_us, x, y, changed);
+    }
+    if (dump)
+    {
+        free(err);
+        free(s);
+        return 0;
+    }
+
+    printf("%zu samples, dead zone %u px, hold %u px / %u ms, 1-euro %s (min cutoff %.2f Hz, beta %.3f), noise %.1f px\n",
+           n, cfg.dead_zone_px, cfg.hold_px, cfg.hold_ms, cfg.euro_min_cutoff > 0 ? "on" : "off",
+           cfg.euro_min_cutoff, cfg.euro_beta, noise);
+    if (!pressed)
+    {
+        printf("no pressed samples\n");
+    }
+    else
+    {
+        printf("pressed      %zu samples over %.2f s\n", pressed, press_us / 1e6);
+        printf("reported     %zu (%.1f%%, %.1f/s)\n", reported, 100.0 * reported / pressed,
+               press_us ? reported * 1e6 / press_us : 0.0);
+        printf("suppressed   %zu\n", pressed - reported);
+        qsort(err, n_err, sizeof(float), cmp_float);
+        printf("offset       mean %6.2f px  p50 %6.2f  p95 %6.2f  max %6.2f\n", err_sum / n_err,
+               err[n_err / 2], err[(n_err * 95) / 100], err[n_err - 1]);
+    }
+
+    free(err);
+    free(s);
+    return 0;
+}
@@ -0,0 +1,344 @@
+/**
+ * Host check of the block cache behind the PST SD drive (src/pst_fs_cache.c).
+ *
+ * Stands in for the card with a folder of files: the cache reads them with
+ * pread(), every byte it returns is checked against a direct read of the file,
+ * and writes go through pwrite() as pst_fs writes through FatFs. The workloads
+ * mimic the device's callers:
+ *  - font:   lv_font_load()-like small sequential reads with the odd seek back
+ *  - image:  header reads, then the rest in 4 KB pieces (LVGL BMP decoder style)
+ *  - whole:  one read of a whole file (lodepng)
+ *  - random: small reads anywhere, files reopened in between
+ *  - write:  random reads mixed with writes, some growing the file
+ *
+ * Card time is estimated with a per-command latency and a bus rate (1-bit SDMMC
+ * defaults), for the cache and for the same reads made uncached.
+ *
+ * Build and run on the host:
+ *   gcc -O2 -Isrc tools/pst_fs_check.c src/pst_fs_cache.c -o pst_fs_check
+ *   ./pst_fs_check [-d dir] [-b budget_kb] [-k block] [-a readahead] [-r rounds]
+ *
+ * Without -d, a temporary folder of generated files is used and removed.
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <sys/stat.h>
+#include "pst_fs_cache.h"
+
+#define MAX_FILES 64
+#define LATENCY_US 800.0        // per card command: seek in FatFs + SD command round trip
+#define BUS_BYTES_PER_US 2.5    // 1-bit bus at 20 MHz, about 2.5 MB/s
+
+typedef struct {
+    char path[512];
+    int fd;
+} file_io_t;
+
+static char s_paths[MAX_FILES][512];
+static int s_count;
+static uint64_t s_checked;
+static uint32_t s_errors;
+static uint32_t s_raw_reads;
+static uint64_t s_raw_bytes;
+
+static bool read_cb(void *io, uint32_t pos, void *buf, uint32_t len, uint32_t *got)
+{
+    file_io_t *f = io;
+
+    ssize_t n = pread(f->fd, buf, len, pos);
+    if (n < 0)
+        return false;
+    *got = (uint32_t)n;
+    return true;
+}
+
+static uint32_t file_size(int fd)
+{
+    struct stat st;
+    return fstat(fd, &st) == 0 ? (uint32_t)st.st_size : 0;
+}
+
+static bool open_file(const char *path, file_io_t *io, pst_fs_cache_file_t *f, bool write)
+{
+    snprintf(io->path, sizeof(io->path), "%s", path);
+    io->fd = open(path, write ? O_RDWR : O_RDONLY);
+    if (io->fd < 0)
+        return false;
+    pst_fs_cache_open(f, path, file_size(io->fd), io);
+    return true;
+}
+
+// Read through the cache and check against the file
+static void check_read(pst_fs_cache_t *c, pst_fs_cache_file_t *f, file_io_t *io, uint32_t pos, uint32_t len)
+{
+    static uint8_t got_buf[1 << 20], want_buf[1 << 20];
+    uint32_t got;
+
+    if (len > sizeof(got_buf))
+        len = sizeof(got_buf);
+    if (!pst_fs_cache_read(c, f, pos, got_buf, len, &got))
+    {
+        fprintf(stderr, "%s: read of %u at %u failed\n", io->path, len, pos);
+        s_errors++;
+        return;
+    }
+    ssize_t want = pread(io->fd, want_buf, len, pos);
+    if (want < 0 || (uint32_t)want != got || memcmp(got_buf, want_buf, got) != 0)
+    {
+        fprintf(stderr, "%s: %u bytes at %u differ (got %u, want %zd)\n", io->path, len, pos, got, want);
+        s_errors++;
+    }
+    s_checked += got;
+    // The same read made without a cache
+    s_raw_reads++;
+    s_raw_bytes += got;
+}
+
+static void check_write(pst_fs_cache_t *c, pst_fs_cache_file_t *f, file_io_t *io, uint32_t pos, uint32_t len)
+{
+    uint8_t buf[3000];
+
+    if (len > sizeof(buf))
+        len = sizeof(buf);
+    for (uint32_t i = 0; i < len; i++)
+        buf[i] = (uint8_t)rand();
+    ssize_t put = pwrite(io->fd, buf, len, pos);
+    if (put > 0)
+        pst_fs_cache_wrote(c, f, pos, buf, (uint32_t)put, file_size(io->fd));
+}
+
+static void run_font(pst_fs_cache_t *c, const char *path)
+{
+    file_io_t io;
+    pst_fs_cache_file_t f;
+
+    if (!open_file(path, &io, &f, false))
+        return;
+    uint32_t pos = 0;
+    while (pos < f.size)
+    {
+        uint32_t len = 4 + rand() % 60;
+        check_read(c, &f, &io, pos, len);
+        pos += len;
+        // Tables are found through offsets read earlier
+        if (rand() % 50 == 0 && pos > 1024)
+            pos -= rand() % 1024;
+    }
+    close(io.fd);
+}
+
+static void run_image(pst_fs_cache_t *c, const char *path)
+{
+    file_io_t io;
+    pst_fs_cache_file_t f;
+
+    if (!open_file(path, &io, &f, false))
+        return;
+    check_read(c, &f, &io, 0, 14);
+    check_read(c, &f, &io, 14, 40);
+    for (uint32_t pos = 54; pos < f.size; pos += 4096)
+        check_read(c, &f, &io, pos, 4096);
+    close(io.fd);
+}
+
+static void run_whole(pst_fs_cache_t *c, const char *path)
+{
+    file_io_t io;
+    pst_fs_cache_file_t f;
+
+    if (!open_file(path, &io, &f, false))
+        return;
+    check_read(c, &f, &io, 0, f.size);
+    close(io.fd);
+}
+
+static void run_random(pst_fs_cache_t *c, int reads)
+{
+    for (int i = 0; i < reads; i++)
+    {
+        file_io_t io;
+        pst_fs_cache_file_t f;
+        if (!open_file(s_paths[rand() % s_count], &io, &f, false))
+            continue;
+        for (int j = 0; j < 8 && f.size; j++)
+            check_read(c, &f, &io, rand() % f.size, 1 + rand() % 700);
+        close(io.fd);
+    }
+}
+
+static void run_write(pst_fs_cache_t *c, const char *path, int ops)
+{
+    file_io_t io;
+    pst_fs_cache_file_t f;
+
+    if (!open_file(path, &io, &f, true))
+        return;
+    for (int i = 0; i < ops; i++)
+    {
+        uint32_t size = f.size ? f.size : 1;
+        switch (rand() % 4)
+        {
+        case 0:
+            check_write(c, &f, &io, rand() % size, 1 + rand() % 3000);
+            break;
+        case 1:
+            // Grow, sometimes past the end
+            check_write(c, &f, &io, size + rand() % 5000 * (rand() % 2), 1 + rand() % 3000);
+            break;
+        default:
+            check_read(c, &f, &io, rand() % size, 1 + rand() % 9000);
+            break;
+        }
+    }
+    close(io.fd);
+    // Reopened, the grown file is seen at its new size
+    if (open_file(path, &io, &f, false))
+    {
+        check_read(c, &f, &io, 0, f.size);
+        close(io.fd);
+    }
+}
+
+static bool make_files(const char *dir)
+{
+    static const uint32_t sizes[] = { 300, 4096, 5000, 20000, 65536, 150000, 700000, 12345 };
+
+    for (size_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++)
+    {
+        snprintf(s_paths[s_count], sizeof(s_paths[0]), "%s/file%zu.bin", dir, i);
+        FILE *fp = fopen(s_paths[s_count], "wb");
+        if (!fp)
+            return false;
+        for (uint32_t j = 0; j < sizes[i]; j++)
+            fputc((int)((j * 131 + i * 7) ^ (j >> 8)), fp);
+        fclose(fp);
+        s_count++;
+    }
+    return true;
+}
+
+static void list_files(const char *dir)
+{
+    DIR *d = opendir(dir);
+    struct dirent *de;
+
+    while (d && (de = readdir(d)) && s_count < MAX_FILES)
+    {
+        struct stat st;
+        snprintf(s_paths[s_count], sizeof(s_paths[0]), "%s/%s", dir, de->d_name);
+        if (stat(s_paths[s_count], &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0)
+            s_count++;
+    }
+    if (d)
+        closedir(d);
+}
+
+static double card_ms(uint32_t reads, uint64_t bytes)
+{
+    return (reads * LATENCY_US + bytes / BUS_BYTES_PER_US) / 1000.0;
+}
+
+int main(int argc, char **argv)
+{
+    pst_fs_cache_cfg_t cfg = PST_FS_CACHE_DEFAULT_CONFIG();
+    const char *dir = NULL;
+    char tmp[] = "/tmp/pst_fs_check.XXXXXX";
+    int rounds = 3;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "d:b:k:a:r:")) != -1)
+    {
+        switch (opt)
+        {
+        case 'd': dir = optarg; break;
+        case 'b': cfg.budget_bytes = atoi(optarg) * 1024; break;
+        case 'k': cfg.block_size = atoi(optarg); break;
+        case 'a': cfg.readahead_max = atoi(optarg); break;
+        case 'r': rounds = atoi(optarg); break;
+        default:
+            fprintf(stderr, "usage: %s [-d dir] [-b budget_kb] [-k block] [-a readahead] [-r rounds]\n", argv[0]);
+            return 2;
+        }
+    }
+
+    pst_fs_cache_t *c = pst_fs_cache_new(&cfg, read_cb);
+    if (!c)
+    {
+        fprintf(stderr, "cannot create the cache (block size a multiple of 512?)\n");
+        return 1;
+    }
+    bool own_dir = !dir;
+    if (own_dir)
+    {
+        if (!mkdtemp(tmp) || !make_files(tmp))
+        {
+            fprintf(stderr, "cannot create test files: %s\n", strerror(errno));
+            return 1;
+        }
+        dir = tmp;
+    }
+    else
+    {
+        list_files(dir);
+    }
+    if (!s_count)
+    {
+        fprintf(stderr, "%s: no files\n", dir);
+        return 1;
+    }
+
+    srand(42);
+    for (int r = 0; r < rounds; r++)
+    {
+        for (int i = 0; i < s_count; i++)
+        {
+            run_font(c, s_paths[i]);
+            run_image(c, s_paths[i]);
+            run_whole(c, s_paths[i]);
+        }
+        run_random(c, 200);
+    }
+    // Writes change the files: only on our own
+    if (own_dir)
+    {
+        for (int i = 0; i < s_count; i++)
+            run_write(c, s_paths[i], 300);
+    }
+
+    pst_fs_cache_stats_t st;
+    pst_fs_cache_get_stats(c, &st);
+    uint32_t blocks = st.hits + st.misses;
+    printf("files %d, budget %u KB, block %u, read-ahead %u, rounds %d\n", s_count, cfg.budget_bytes / 1024,
+           cfg.block_size, cfg.readahead_max, rounds);
+    printf("reads %u (%llu bytes, %llu checked), writes %u\n", st.reads, (unsigned long long)st.bytes,
+           (unsigned long long)s_checked, st.writes);
+    printf("blocks: hits %u, misses %u (hit rate %.1f%%), evictions %u\n", st.hits, st.misses,
+           blocks ? 100.0 * st.hits / blocks : 0.0, st.evictions);
+    printf("read-ahead: %u blocks, %u dropped unused (%.1f%% wasted)\n", st.readahead, st.readahead_wasted,
+           st.readahead ? 100.0 * st.readahead_wasted / st.readahead : 0.0);
+    printf("card: %u reads, %llu bytes (%u bypassed); uncached: %u reads, %llu bytes\n", st.card_reads,
+           (unsigned long long)st.card_bytes, st.bypassed, s_raw_reads, (unsigned long long)s_raw_bytes);
+    printf("estimated card time: %.0f ms cached, %.0f ms uncached\n", card_ms(st.card_reads, st.card_bytes),
+           card_ms(s_raw_reads, s_raw_bytes));
+    pst_fs_cache_free(c);
+
+    if (own_dir)
+    {
+        for (int i = 0; i < s_count; i++)
+            unlink(s_paths[i]);
+        rmdir(tmp);
+    }
+    if (s_errors)
+    {
+        printf("FAILED: %u mismatches\n", s_errors);
+        return 1;
+    }
+    printf("OK\n");
+    return 0;
+}
@@ -0,0 +1,360 @@
+/**
+ * Host replay of the gesture recognizer (src/pst_gesture_rec.c).
+ *
+ * Gestures are carried as pst_touch_rec recordings, one per finger (the format
+ * holds one point): the recordings are decoded, merged by time into one- and
+ * two-point samples as the touch task reads them, and fed to the recognizer.
+ *
+ * Without arguments, built-in strokes are encoded into recordings, replayed and
+ * the events checked:
+ *  - pinch:  two fingers spread apart: begin, updates, end at twice the scale
+ *  - pan:    two fingers moved together: the centroid follows, the scale stays 1
+ *  - flick:  one finger lifted while moving fast: a flick at its speed
+ *  - drag:   one finger lifted while moving slowly: nothing
+ *  - lift:   two fingers, one lifted, the other flicked away: begin and end, no flick
+ *
+ * With recordings (.ptr, as written by pst_touch_rec), they are replayed as the
+ * first and the second finger and the events printed.
+ *
+ * Build and run on the host:
+ *   gcc -O2 -Wall -Wextra -Isrc tools/pst_gesture_replay.c src/pst_gesture_rec.c src/pst_touch_rec_fmt.c -lm -o pst_gesture_replay
+ *   ./pst_gesture_replay [-s flick_min_speed] [-w flick_window_ms] [-u update_min_px] [finger1.ptr [finger2.ptr]]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "pst_gesture_rec.h"
+#include "pst_touch_rec_fmt.h"
+
+#define MAX_EVENTS 512
+#define STEP_MS 10              // LVGL read period of the built-in strokes
+
+typedef struct {
+    uint8_t *raw;               // records, after the header
+    uint32_t records;
+    pst_touch_rec_cursor_t c;
+    pst_touch_rec_event_t next; // next event, valid while `more`
+    bool more;
+    pst_touch_rec_event_t cur;  // state as of the last merged time
+} finger_t;
+
+typedef struct {
+    const char *name;
+    const char *expect;         // event types in order, "U" standing for one or more updates
+    pst_touch_rec_event_t f1[64];
+    unsigned n1;
+    pst_touch_rec_event_t f2[64];
+    unsigned n2;
+} stroke_t;
+
+static pst_gesture_rec_cfg_t s_cfg = {
+    .flick_min_speed = 600,
+    .flick_window_ms = 60,
+    .update_min_px = 2,
+};
+static pst_gesture_t s_events[MAX_EVENTS];
+static unsigned s_event_cnt;
+static uint32_t s_errors;
+
+static const char s_type_chars[] = "BUEF";
+
+static void finger_begin(finger_t *f, uint8_t *raw, uint32_t records)
+{
+    memset(f, 0, sizeof(*f));
+    f->raw = raw;
+    f->records = records;
+    pst_touch_rec_decode_begin(&f->c, raw, records);
+    f->more = pst_touch_rec_decode_next(&f->c, &f->next);
+}
+
+// Replay one or two fingers; the events go to s_events
+static void replay(finger_t *f1, finger_t *f2)
+{
+    pst_gesture_rec_t r;
+    finger_t *fingers[2] = { f1, f2 };
+
+    pst_gesture_rec_reset(&r);
+    s_event_cnt = 0;
+    while (f1->more || (f2 && f2->more))
+    {
+        // Both fingers as they are at the next recorded time
+        uint32_t t = UINT32_MAX;
+        for (int i = 0; i < 2; i++)
+        {
+            if (fingers[i] && fingers[i]->more && fingers[i]->next.t_ms < t)
+                t = fingers[i]->next.t_ms;
+        }
+        for (int i = 0; i < 2; i++)
+        {
+            finger_t *f = fingers[i];
+            while (f && f->more && f->next.t_ms == t)
+            {
+                f->cur = f->next;
+                f->more = pst_touch_rec_decode_next(&f->c, &f->next);
+            }
+        }
+
+        // The controller reports the fingers down first, in order
+        pst_gesture_input_t in = { .t_us = (int64_t)t * 1000 };
+        const pst_touch_rec_event_t *down[2];
+        for (int i = 0; i < 2; i++)
+        {
+            if (fingers[i] && fingers[i]->cur.pressed)
+                down[in.points++] = &fingers[i]->cur;
+        }
+        const pst_touch_rec_event_t *first = in.points ? down[0] : &f1->cur;
+        in.x = first->x;
+        in.y = first->y;
+        if (in.points == 2)
+        {
+            in.x2 = down[1]->x;
+            in.y2 = down[1]->y;
+        }
+
+        pst_gesture_t g;
+        if (pst_gesture_rec_feed(&r, &s_cfg, &in, &g) && s_event_cnt < MAX_EVENTS)
+            s_events[s_event_cnt++] = g;
+    }
+}
+
+static void print_events(void)
+{
+    for (unsigned i = 0; i < s_event_cnt; i++)
+    {
+        const pst_gesture_t *g = &s_events[i];
+        printf("  %6u ms %c  at %4d,%4d  from %4d,%4d  scale %.3f  v %d,%d px/s\n", g->t_ms,
+               s_type_chars[g->type], g->x, g->y, g->start_x, g->start_y, g->scale_q8 / 256.0, g->vx, g->vy);
+    }
+}
+
+// Encode a finger's events as a recording and decode it for the replay
+static uint8_t *encode(const pst_touch_rec_event_t *ev, unsigned n, uint32_t *records)
+{
+    // Gaps only come after 65 s: a few records per event are plenty
+    uint8_t *raw = malloc((n * 4 + 1) * PST_TOUCH_REC_RECORD_SIZE);
+    pst_touch_rec_cursor_t c = { 0 };
+
+    *records = 0;
+    for (unsigned i = 0; raw && i < n; i++)
+        *records += pst_touch_rec_encode(&c, &ev[i], raw + *records * PST_TOUCH_REC_RECORD_SIZE, 4);
+    return raw;
+}
+
+// A finger moving in a straight line from (x0, y0) to (x1, y1), then lifted
+static unsigned stroke(pst_touch_rec_event_t *ev, uint32_t t0, uint32_t ms, int x0, int y0, int x1, int y1)
+{
+    unsigned n = 0;
+    unsigned steps = ms / STEP_MS;
+
+    for (unsigned i = 0; i <= steps; i++)
+    {
+        ev[n++] = (pst_touch_rec_event_t) {
+            .t_ms = t0 + i * STEP_MS,
+            .x = (uint16_t)(x0 + (x1 - x0) * (int)i / (int)steps),
+            .y = (uint16_t)(y0 + (y1 - y0) * (int)i / (int)steps),
+            .pressed = true,
+        };
+    }
+    ev[n] = ev[n - 1];
+    ev[n].t_ms += STEP_MS;
+    ev[n++].pressed = false;
+    return n;
+}
+
+// Event types with runs of updates folded into one "U"
+static void types_of(char *out, size_t len)
+{
+    size_t n = 0;
+
+    for (unsigned i = 0; i < s_event_cnt && n + 1 < len; i++)
+    {
+        char c = s_type_chars[s_events[i].type];
+        if (c == 'U' && n && out[n - 1] == 'U')
+            continue;
+        out[n++] = c;
+    }
+    out[n] = '\0';
+}
+
+static const pst_gesture_t *last_of(uint8_t type)
+{
+    for (unsigned i = s_event_cnt; i > 0; i--)
+    {
+        if (s_events[i - 1].type == type)
+            return &s_events[i - 1];
+    }
+    return NULL;
+}
+
+static void fail(const stroke_t *s, const char *what)
+{
+    printf("%s: %s\n", s->name, what);
+    print_events();
+    s_errors++;
+}
+
+static void check_near(const stroke_t *s, const char *what, int got, int want, int tolerance)
+{
+    if (abs(got - want) > tolerance)
+    {
+        char msg[128];
+        snprintf(msg, sizeof(msg), "%s %d, want %d +- %d", what, got, want, tolerance);
+        fail(s, msg);
+    }
+}
+
+static void run_stroke(const stroke_t *s)
+{
+    finger_t f1, f2;
+    uint32_t n1, n2 = 0;
+    uint8_t *raw1 = encode(s->f1, s->n1, &n1);
+    uint8_t *raw2 = s->n2 ? encode(s->f2, s->n2, &n2) : NULL;
+    char types[64];
+
+    finger_begin(&f1, raw1, n1);
+    if (raw2)
+        finger_begin(&f2, raw2, n2);
+    replay(&f1, raw2 ? &f2 : NULL);
+    free(raw1);
+    free(raw2);
+
+    types_of(types, sizeof(types));
+    if (strcmp(types, s->expect) != 0)
+    {
+        char msg[128];
+        snprintf(msg, sizeof(msg), "events \"%s\", want \"%s\"", types, s->expect);
+        fail(s, msg);
+        return;
+    }
+    printf("%-6s %-6s ok\n", s->name, types);
+}
+
+static void builtin(void)
+{
+    stroke_t s;
+    const pst_gesture_t *g;
+
+    // Pinch: 100 px apart to 200 px apart around (160, 240)
+    s = (stroke_t) { .name = "pinch", .expect = "BUE" };
+    s.n1 = stroke(s.f1, 0, 300, 110, 240, 60, 240);
+    s.n2 = stroke(s.f2, 0, 300, 210, 240, 260, 240);
+    run_stroke(&s);
+    if ((g = last_of(PST_GESTURE_END)) != NULL)
+    {
+        check_near(&s, "end scale_q8", g->scale_q8, 512, 4);
+        check_near(&s, "end x", g->x, 160, 1);
+        check_near(&s, "end y", g->y, 240, 1);
+    }
+
+    // Pan: both fingers 80 px right and 40 px down
+    s = (stroke_t) { .name = "pan", .expect = "BUE" };
+    s.n1 = stroke(s.f1, 0, 200, 100, 200, 180, 240);
+    s.n2 = stroke(s.f2, 0, 200, 200, 200, 280, 240);
+    run_stroke(&s);
+    if ((g = last_of(PST_GESTURE_END)) != NULL)
+    {
+        check_near(&s, "end scale_q8", g->scale_q8, 256, 2);
+        check_near(&s, "centroid dx", g->x - g->start_x, 80, 1);
+        check_near(&s, "centroid dy", g->y - g->start_y, 40, 1);
+    }
+
+    // Flick: 3000 px/s to the left
+    s = (stroke_t) { .name = "flick", .expect = "F" };
+    s.n1 = stroke(s.f1, 0, 100, 300, 300, 0, 300);
+    run_stroke(&s);
+    if ((g = last_of(PST_GESTURE_FLICK)) != NULL)
+    {
+        check_near(&s, "flick vx", g->vx, -3000, 100);
+        check_near(&s, "flick vy", g->vy, 0, 50);
+        check_near(&s, "flick start_x", g->start_x, 300, 0);
+    }
+
+    // Drag: 200 px/s, below flick_min_speed
+    s = (stroke_t) { .name = "drag", .expect = "" };
+    s.n1 = stroke(s.f1, 0, 500, 100, 100, 100, 200);
+    run_stroke(&s);
+
+    // Lift: second finger lifted at 150 ms, the first flicked away afterwards
+    s = (stroke_t) { .name = "lift", .expect = "BUE" };
+    s.n1 = stroke(s.f1, 0, 150, 100, 200, 110, 200);
+    s.n1--;
+    s.n1 += stroke(s.f1 + s.n1, 150 + STEP_MS, 100, 110, 200, 310, 200);
+    s.n2 = stroke(s.f2, 0, 140, 200, 200, 230, 200);
+    run_stroke(&s);
+}
+
+static bool load(const char *path, finger_t *f)
+{
+    FILE *fp = fopen(path, "rb");
+    uint8_t hdr_raw[PST_TOUCH_REC_HEADER_SIZE];
+    pst_touch_rec_header_t hdr;
+
+    if (!fp)
+    {
+        perror(path);
+        return false;
+    }
+    if (fread(hdr_raw, 1, sizeof(hdr_raw), fp) != sizeof(hdr_raw) || !pst_touch_rec_header_decode(hdr_raw, &hdr))
+    {
+        fprintf(stderr, "%s: not a touch recording\n", path);
+        fclose(fp);
+        return false;
+    }
+    size_t len = (size_t)hdr.records * PST_TOUCH_REC_RECORD_SIZE;
+    uint8_t *raw = malloc(len ? len : 1);
+    if (!raw || fread(raw, 1, len, fp) != len)
+    {
+        fprintf(stderr, "%s: truncated\n", path);
+        free(raw);
+        fclose(fp);
+        return false;
+    }
+    fclose(fp);
+    finger_begin(f, raw, hdr.records);
+    return true;
+}
+
+int main(int argc, char **argv)
+{
+    int opt;
+
+    while ((opt = getopt(argc, argv, "s:w:u:")) != -1)
+    {
+        switch (opt)
+        {
+        case 's': s_cfg.flick_min_speed = atoi(optarg); break;
+        case 'w': s_cfg.flick_window_ms = atoi(optarg); break;
+        case 'u': s_cfg.update_min_px = atoi(optarg); break;
+        default:
+            fprintf(stderr, "usage: %s [-s flick_min_speed] [-w flick_window_ms] [-u update_min_px] "
+                    "[finger1.ptr [finger2.ptr]]\n", argv[0]);
+            return 2;
+        }
+    }
+
+    if (optind < argc)
+    {
+        finger_t f1, f2;
+        bool two = optind + 1 < argc;
+        if (!load(argv[optind], &f1) || (two && !load(argv[optind + 1], &f2)))
+            return 1;
+        replay(&f1, two ? &f2 : NULL);
+        printf("%u events\n", s_event_cnt);
+        print_events();
+        free(f1.raw);
+        if (two)
+            free(f2.raw);
+        return 0;
+    }
+
+    builtin();
+    if (s_errors)
+    {
+        printf("FAILED: %u checks\n", s_errors);
+        return 1;
+    }
+    printf("OK\n");
+    return 0;
+}
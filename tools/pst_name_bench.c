@@ -0,0 +1,198 @@
+/**
+ * Host benchmark of the file name filter index (src/pst_name_index.c).
+ *
+ * Builds an index over a synthetic folder (data logs, photos, and names in
+ * Latin-1, Greek and Cyrillic), checks every query against a plain fold + strstr
+ * scan and times the build, standalone queries and a query typed one character
+ * at a time (each keystroke narrowing the previous result), next to the
+ * strcasestr() scan the browser used to run.
+ *
+ * Build and run on the host:
+ *   gcc -O2 -D_GNU_SOURCE -Isrc tools/pst_name_bench.c src/pst_name_index.c -o pst_name_bench
+ *   ./pst_name_bench [-n names] [-r rounds] [query...]
+ *
+ * The device is roughly an order of magnitude slower than a desktop core, and
+ * reads the names from PSRAM: compare the per-query times with a 16 ms frame
+ * accordingly.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <time.h>
+#include <unistd.h>
+#include "pst_name_index.h"
+
+static char **s_names;
+
+static const char *get_name(uint32_t i, void *arg)
+{
+    (void)arg;
+    return s_names[i];
+}
+
+static double now_us(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+static void make_names(uint32_t n)
+{
+    static const char *words[] = { "Ärger", "Über", "Москва", "Ωmega", "Straße", "Łódź", "café", "ДАННЫЕ", "ΣΟΦΙΑ", "report" };
+    static const char *exts[] = { "csv", "log", "bin", "jpg", "txt" };
+
+    s_names = malloc(n * sizeof(char *));
+    srand(42);
+    for (uint32_t i = 0; i < n; i++)
+    {
+        char buf[96];
+        switch (i % 4)
+        {
+        case 0:
+        case 1:
+            snprintf(buf, sizeof(buf), "LOG_%04u-%02u-%02u_%05u.%s", 2020 + rand() % 6, 1 + rand() % 12, 1 + rand() % 28, i,
+                     exts[rand() % 2]);
+            break;
+        case 2:
+            snprintf(buf, sizeof(buf), "IMG_%05u.%s", i, exts[3]);
+            break;
+        default:
+            snprintf(buf, sizeof(buf), "%s %s %u.%s", words[rand() % 10], words[rand() % 10], i, exts[rand() % 5]);
+            break;
+        }
+        s_names[i] = strdup(buf);
+    }
+}
+
+// Reference: fold every name and search it
+static uint32_t naive(uint32_t n, const char *query, uint32_t *out)
+{
+    char q[PST_NAME_QUERY_MAX];
+    uint32_t m = 0;
+
+    pst_name_fold(query, q, sizeof(q));
+    for (uint32_t i = 0; i < n; i++)
+    {
+        if (pst_name_match(s_names[i], q))
+            out[m++] = i;
+    }
+    return m;
+}
+
+static uint32_t ascii_scan(uint32_t n, const char *query)
+{
+    uint32_t m = 0;
+    for (uint32_t i = 0; i < n; i++)
+        m += strcasestr(s_names[i], query) != NULL;
+    return m;
+}
+
+static int check(pst_name_index_t *idx, uint32_t n, const char *query, uint32_t *ref)
+{
+    const uint32_t *ids;
+    uint32_t got = pst_name_index_query(idx, query, &ids);
+    uint32_t want = naive(n, query, ref);
+
+    if (got != want || memcmp(ids, ref, got * sizeof(uint32_t)) != 0)
+    {
+        fprintf(stderr, "MISMATCH \"%s\": index %u, reference %u\n", query, got, want);
+        return 1;
+    }
+    return 0;
+}
+
+int main(int argc, char **argv)
+{
+    static const char *def_queries[] = { "l", "log", "2024-05", "_0421", "москва", "ÄRGER", "ωMEGA", "σοφια", ".JPG", "zzz" };
+    uint32_t n = 20000;
+    int rounds = 20;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "n:r:")) != -1)
+    {
+        switch (opt)
+        {
+        case 'n':
+            n = strtoul(optarg, NULL, 0);
+            break;
+        case 'r':
+            rounds = atoi(optarg);
+            break;
+        default:
+            fprintf(stderr, "usage: %s [-n names] [-r rounds] [query...]\n", argv[0]);
+            return 2;
+        }
+    }
+    const char **queries = optind < argc ? (const char **)&argv[optind] : def_queries;
+    int nq = optind < argc ? argc - optind : (int)(sizeof(def_queries) / sizeof(def_queries[0]));
+
+    make_names(n);
+    uint32_t *ref = malloc(n * sizeof(uint32_t));
+
+    double t0 = now_us();
+    pst_name_index_t *idx = pst_name_index_build(n, get_name, NULL);
+    double build_us = now_us() - t0;
+    if (!idx)
+    {
+        fprintf(stderr, "build failed (%u names)\n", n);
+        return 1;
+    }
+    printf("%u names: build %.0f us, %zu KB\n\n", n, build_us, pst_name_index_bytes(idx) / 1024);
+
+    int bad = 0;
+    printf("%-12s %8s %12s %12s %14s\n", "query", "matches", "index (us)", "fold scan", "strcasestr");
+    for (int i = 0; i < nq; i++)
+    {
+        const uint32_t *ids;
+        uint32_t m = 0;
+
+        bad += check(idx, n, queries[i], ref);
+        t0 = now_us();
+        for (int r = 0; r < rounds; r++)
+        {
+            pst_name_index_query(idx, "", &ids);    // no narrowing from the previous round
+            m = pst_name_index_query(idx, queries[i], &ids);
+        }
+        double idx_us = (now_us() - t0) / rounds;
+        t0 = now_us();
+        for (int r = 0; r < rounds; r++)
+            naive(n, queries[i], ref);
+        double naive_us = (now_us() - t0) / rounds;
+        t0 = now_us();
+        uint32_t am = 0;
+        for (int r = 0; r < rounds; r++)
+            am = ascii_scan(n, queries[i]);
+        double ascii_us = (now_us() - t0) / rounds;
+        printf("%-12s %8u %12.1f %12.1f %8.1f (%u)\n", queries[i], m, idx_us, naive_us, ascii_us, am);
+    }
+
+    // Typing a query: every keystroke narrows the previous result
+    const char *typed = nq && optind < argc ? queries[0] : "log_2024-05-1";
+    char prefix[PST_NAME_QUERY_MAX];
+    double worst = 0, total = 0;
+    size_t len = strlen(typed);
+    pst_name_index_query(idx, "", &(const uint32_t *) { NULL });
+    for (size_t k = 1; k <= len && k < sizeof(prefix); k++)
+    {
+        const uint32_t *ids;
+        memcpy(prefix, typed, k);
+        prefix[k] = '\0';
+        t0 = now_us();
+        uint32_t m = pst_name_index_query(idx, prefix, &ids);
+        double us = now_us() - t0;
+        total += us;
+        worst = us > worst ? us : worst;
+        if (k == len)
+            printf("\ntyped \"%s\": %u matches, %.1f us per keystroke on average, %.1f us worst\n", typed, m, total / len, worst);
+        bad += check(idx, n, prefix, ref);
+        pst_name_index_query(idx, prefix, &ids);    // restore the narrowing state check() reset
+    }
+
+    pst_name_index_free(idx);
+    if (bad)
+        fprintf(stderr, "%d mismatches\n", bad);
+    return bad != 0;
+}
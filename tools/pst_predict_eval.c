@@ -0,0 +1,228 @@
+/**
+ * Offline evaluation of the touch predictor (src/pst_touch_predict.c).
+ *
+ * Replays a recorded touch trace through the predictor and compares, for every
+ * sample, the position reported to LVGL with and without prediction against where
+ * the finger really was `lead` later (interpolated from the trace).
+ *
+ * Build and run on the host:
+ *   gcc -O2 -Isrc tools/pst_predict_eval.c src/pst_touch_predict.c src/pst_touch_rec_fmt.c -lm -o pst_predict_eval
+ *   ./pst_predict_eval [-l lead_us] [-g aggressiveness] [-a alpha] [-b beta] [-m max_px] [-d] trace
+ *
+ * Trace: one sample per line, "t_us,x,y,points"; lines starting with '#' are ignored.
+ * A pst_touch_rec recording (.ptr) is read as well: it holds what LVGL read, one
+ * sample per change. -d prints the trace as CSV instead of evaluating it.
+ */
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "pst_touch_predict.h"
+#include "pst_touch_rec_fmt.h"
+
+typedef struct {
+    int64_t t_us;
+    float x;
+    float y;
+    int points;
+} sample_t;
+
+typedef struct {
+    double sum;
+    float *err;
+    size_t n;
+} err_acc_t;
+
+static int cmp_float(const void *a, const void *b)
+{
+    float fa = *(const float *)a;
+    float fb = *(const float *)b;
+    return (fa > fb) - (fa < fb);
+}
+
+static void acc_add(err_acc_t *acc, float e)
+{
+    acc->err[acc->n++] = e;
+    acc->sum += e;
+}
+
+static void acc_print(const char *name, err_acc_t *acc)
+{
+    if (!acc->n)
+    {
+        printf("%-12s no samples\n", name);
+        return;
+    }
+    qsort(acc->err, acc->n, sizeof(float), cmp_float);
+    printf("%-12s mean %6.2f px  p50 %6.2f  p95 %6.2f  max %6.2f\n", name, acc->sum / acc->n,
+           acc->err[acc->n / 2], acc->err[(acc->n * 95) / 100], acc->err[acc->n - 1]);
+}
+
+/**
+ * Finger position at `t`, if the press of sample `from` still lasts then.
+ */
+static int truth_at(const sample_t *s, size_t n, size_t from, int64_t t, float *x, float *y)
+{
+    for (size_t i = from; i + 1 < n; i++)
+    {
+        if (!s[i + 1].points)
+            return 0;
+        if (s[i + 1].t_us >= t)
+        {
+            float k = (float)(t - s[i].t_us) / (float)(s[i + 1].t_us - s[i].t_us);
+            *x = s[i].x + k * (s[i + 1].x - s[i].x);
+            *y = s[i].y + k * (s[i + 1].y - s[i].y);
+            return 1;
+        }
+    }
+    return 0;
+}
+
+static sample_t *load_rec(FILE *f, const pst_touch_rec_header_t *hdr, size_t *count)
+{
+    size_t len = (size_t)hdr->records * PST_TOUCH_REC_RECORD_SIZE;
+    uint8_t *raw = malloc(len ? len : 1);
+    sample_t *s = malloc((hdr->records ? hdr->records : 1) * sizeof(*s));
+    size_t n = 0;
+
+    if (raw && s && fread(raw, 1, len, f) == len)
+    {
+        pst_touch_rec_cursor_t c;
+        pst_touch_rec_event_t ev;
+        pst_touch_rec_decode_begin(&c, raw, hdr->records);
+        while (pst_touch_rec_decode_next(&c, &ev))
+            s[n++] = (sample_t) { (int64_t)ev.t_ms * 1000, ev.x, ev.y, ev.pressed };
+    }
+    else
+    {
+        fprintf(stderr, "truncated recording\n");
+        free(s);
+        s = NULL;
+    }
+    free(raw);
+    fclose(f);
+    *count = n;
+    return s;
+}
+
+static sample_t *load(const char *path, size_t *count)
+{
+    FILE *f = fopen(path, "rb");
+    if (!f)
+    {
+        perror(path);
+        return NULL;
+    }
+
+    uint8_t raw[PST_TOUCH_REC_HEADER_SIZE];
+    pst_touch_rec_header_t hdr;
+    if (fread(raw, 1, sizeof(raw), f) == sizeof(raw) && pst_touch_rec_header_decode(raw, &hdr))
+        return load_rec(f, &hdr, count);
+    rewind(f);
+
+    size_t cap = 1024;
+    size_t n = 0;
+    sample_t *s = malloc(cap * sizeof(*s));
+    char line[128];
+    while (s && fgets(line, sizeof(line), f))
+    {
+        long long t;
+        float x;
+        float y;
+        int points;
+        if (line[0] == '#' || sscanf(line, "%lld,%f,%f,%d", &t, &x, &y, &points) != 4)
+            continue;
+        if (n == cap)
+        {
+            cap *= 2;
+            s = realloc(s, cap * sizeof(*s));
+            if (!s)
+                break;
+        }
+        s[n++] = (sample_t) { t, x, y, points };
+    }
+    fclose(f);
+    *count = n;
+    return s;
+}
+
+int main(int argc, char **argv)
+{
+    pst_touch_predict_cfg_t cfg = PST_TOUCH_PREDICT_DEFAULT_CONFIG();
+    int opt;
+    int dump = 0;
+
+    while ((opt = getopt(argc, argv, "l:g:a:b:m:d")) != -1)
+    {
+        switch (opt)
+        {
+        case 'l': cfg.lead_us = atoi(optarg); break;
+        case 'g': cfg.aggressiveness = atoi(optarg); break;
+        case 'a': cfg.alpha = atof(optarg); break;
+        case 'b': cfg.beta = atof(optarg); break;
+        case 'm': cfg.max_lead_px = atoi(optarg); break;
+        case 'd': dump = 1; break;
+        default:
+            fprintf(stderr, "usage: %s [-l lead_us] [-g aggressiveness] [-a alpha] [-b beta] [-m max_px] [-d] trace\n", argv[0]);
+            return 2;
+        }
+    }
+    if (optind >= argc)
+    {
+        fprintf(stderr, "missing trace file\n");
+        return 2;
+    }
+
+    size_t n = 0;
+    sample_t *s = load(argv[optind], &n);
+    if (!s)
+        return 1;
+    if (dump)
+    {
+        printf("# t_us,x,y,points\n");
+        for (size_t i = 0; i < n; i++)
+            printf("%lld,%.0f,%.0f,%d\n", (long long)s[i].t_us, s[i].x, s[i].y, s[i].points);
+        free(s);
+        return 0;
+    }
+
+    err_acc_t raw = { .err = malloc(n * sizeof(float)) };
+    err_acc_t pred = { .err = malloc(n * sizeof(float)) };
+    pst_touch_predict_t p;
+    pst_touch_predict_reset(&p);
+
+    for (size_t i = 0; i < n; i++)
+    {
+        if (s[i].points != 1)
+        {
+            pst_touch_predict_reset(&p);
+            continue;
+        }
+        pst_touch_predict_update(&p, &cfg, s[i].t_us, s[i].x, s[i].y);
+
+        // The frame drawn from this sample reaches the panel lead_us later
+        int64_t t_photon = s[i].t_us + cfg.lead_us;
+        float tx;
+        float ty;
+        if (!truth_at(s, n, i, t_photon, &tx, &ty))
+            continue;
+
+        float px;
+        float py;
+        pst_touch_predict_at(&p, &cfg, t_photon, &px, &py);
+        acc_add(&raw, hypotf(s[i].x - tx, s[i].y - ty));
+        acc_add(&pred, hypotf(px - tx, py - ty));
+    }
+
+    printf("%zu samples, lead %u us, aggressiveness %u%%, alpha %.2f, beta %.2f, max %u px\n",
+           n, (unsigned)cfg.lead_us, cfg.aggressiveness, cfg.alpha, cfg.beta, cfg.max_lead_px);
+    acc_print("sampled", &raw);
+    acc_print("predicted", &pred);
+
+    free(raw.err);
+    free(pred.err);
+    free(s);
+    return 0;
+}
@@ -0,0 +1,135 @@
+#!/usr/bin/env python3
+"""
+Decode a PST trace file (src/pst_trace.c, CONFIG_PST_TRACE_TO_FILE) into text.
+
+Usage:
+  tools/pst_trace_decode.py [-u] trace.pstt
+
+Each boot appends a session to the file; sessions are separated by a line.
+Timestamps are esp_timer milliseconds since boot (-u: microseconds).
+"""
+
+import argparse
+import re
+import struct
+import sys
+
+MAGIC = b"PSTT"
+VERSION = 1
+
+# printf conversion: flags, width, precision, length modifier, conversion
+SPEC = re.compile(r"%([-+ #0]*)(\d+|\*)?(?:\.(\d+|\*))?(hh|h|ll|l|j|z|t)?([diouxXcpsfeEgGaA%])")
+
+
+def c_format(fmt, args):
+    """Render a C format string with 32-bit argument words."""
+    out = []
+    pos = 0
+    it = iter(args)
+
+    def arg():
+        return next(it, 0)
+
+    for m in SPEC.finditer(fmt):
+        out.append(fmt[pos:m.start()])
+        pos = m.end()
+        flags, width, prec, _length, conv = m.groups()
+        if conv == "%":
+            out.append("%")
+            continue
+        if width == "*":
+            width = str(arg())
+        if prec == "*":
+            prec = str(arg())
+        v = arg()
+        if conv in "di":
+            v = v - (1 << 32) if v & 0x80000000 else v
+            conv = "d"
+        elif conv == "u":
+            conv = "d"
+        elif conv == "p":
+            out.append("0x%08x" % v)
+            continue
+        elif conv == "c":
+            v = chr(v & 0xFF)
+        elif conv not in "oxX":
+            # Not representable in a 32-bit word (strings, floating point)
+            out.append("<%%%s>" % conv)
+            continue
+        spec = "%" + (flags or "") + (width or "") + ("." + prec if prec else "") + conv
+        out.append(spec % v)
+    out.append(fmt[pos:])
+    return "".join(out)
+
+
+def decode(data, out, micro):
+    formats = {}
+    t_high = 0
+    t_last = None
+    p = 0
+    n = len(data)
+
+    while p < n:
+        tag = data[p:p + 1]
+        if data[p:p + 4] == MAGIC:
+            if p + 6 > n:
+                break
+            if data[p + 4] != VERSION:
+                sys.exit("unsupported trace version %d" % data[p + 4])
+            if p:
+                out.write("---- new session ----\n")
+            formats.clear()
+            t_high = 0
+            t_last = None
+            p += 6
+        elif tag == b"D":
+            if p + 7 > n:
+                break
+            fid, length = struct.unpack_from("<IH", data, p + 1)
+            formats[fid] = data[p + 7:p + 7 + length].decode("utf-8", "replace")
+            p += 7 + length
+        elif tag == b"E":
+            if p + 11 > n:
+                break
+            fid, t_us, core, nargs = struct.unpack_from("<IIBB", data, p + 1)
+            if p + 11 + 4 * nargs > n:
+                break
+            args = struct.unpack_from("<%dI" % nargs, data, p + 11)
+            p += 11 + 4 * nargs
+            # esp_timer time is stored on 32 bits
+            if t_last is not None and t_us < t_last and t_last - t_us > 0x80000000:
+                t_high += 1 << 32
+            t_last = t_us
+            t = t_high + t_us
+            fmt = formats.get(fid)
+            text = c_format(fmt, args) if fmt is not None else "<unknown format 0x%08x> %s" % (fid, list(args))
+            stamp = "%d" % t if micro else "%d" % (t // 1000)
+            out.write("T (%s) %d: %s\n" % (stamp, core, text))
+        elif tag == b"X":
+            if p + 6 > n:
+                break
+            core, count = struct.unpack_from("<BI", data, p + 1)
+            out.write("T %d: %d traces dropped (ring full)\n" % (core, count))
+            p += 6
+        else:
+            sys.exit("corrupt trace at offset %d" % p)
+
+    if p < n:
+        sys.stderr.write("truncated record at offset %d\n" % p)
+
+
+def main():
+    ap = argparse.ArgumentParser(description="Decode a PST trace file")
+    ap.add_argument("-u", action="store_true", help="timestamps in microseconds")
+    ap.add_argument("file")
+    args = ap.parse_args()
+
+    with open(args.file, "rb") as f:
+        data = f.read()
+    if data[:4] != MAGIC:
+        sys.exit("%s is not a PST trace" % args.file)
+    decode(data, sys.stdout, args.u)
+
+
+if __name__ == "__main__":
+    main()
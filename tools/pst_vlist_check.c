@@ -0,0 +1,158 @@
+/**
+ * Host check of the virtualized list scroll mapping (src/pst_vlist_map.c).
+ *
+ * Replays what pst_vlist does on scroll (first row to bind, row positions in the
+ * viewport) for lists from empty to far past what a 16-bit lv_coord_t holds, and
+ * checks that:
+ *  - the spacer stays within LV_COORD_MAX (8191 with LV_USE_LARGE_COORD 0)
+ *  - scrolled to the end, the last row is bound and sits at the bottom of the
+ *    viewport (e.g. row 4999 of a 5000-entry folder)
+ *  - every row scrolled to is bound and fully in view, where one scroll step is
+ *    shorter than the viewport (40 px rows in a 424 px view: any FAT folder)
+ *  - the rows move monotonically, at most one scale step per scrolled pixel, and
+ *    their positions stay small enough for lv_coord_t
+ *
+ * Build and run on the host:
+ *   gcc -O2 -Wall -Wextra -Isrc tools/pst_vlist_check.c src/pst_vlist_map.c -o pst_vlist_check
+ *   ./pst_vlist_check [-r row_height] [-v view_height]
+ */
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include "pst_vlist_map.h"
+
+#define COORD_MAX 8191                              // LV_COORD_MAX, 16-bit lv_coord_t
+#define SPACER_MAX (COORD_MAX - COORD_MAX / 32)     // as in pst_vlist.c
+#define OVERSCAN 2
+#define MAX_ROWS 48                                 // PST_VLIST_MAX_ROWS
+
+static uint16_t s_row_h = 40;
+static int32_t s_view_h = 424;
+static uint32_t s_rows_n;
+static uint32_t s_errors;
+
+static void fail(uint32_t count, const char *what, long a, long b)
+{
+    printf("%u entries: %s (%ld, %ld)\n", count, what, a, b);
+    s_errors++;
+}
+
+// As update() in pst_vlist.c: is `index` bound at this scroll position, and where
+static bool bound_at(const pst_vlist_map_t *m, uint32_t count, int32_t scroll_y, uint32_t index, int32_t *y)
+{
+    uint64_t top = pst_vlist_map_virtual(m, scroll_y);
+    uint32_t first = pst_vlist_map_first(m, top, OVERSCAN);
+
+    if (index < first || index >= first + s_rows_n || index >= count)
+        return false;
+    *y = pst_vlist_map_row_y(m, top, index);
+    return true;
+}
+
+static void check_count(uint32_t count)
+{
+    pst_vlist_map_t m;
+    int32_t y;
+
+    pst_vlist_map_set(&m, count, s_row_h, s_view_h, SPACER_MAX);
+    if (m.spacer_h > COORD_MAX || m.spacer_h < 0)
+        fail(count, "spacer out of lv_coord_t range", m.spacer_h, COORD_MAX);
+    int32_t range = m.spacer_h > s_view_h ? m.spacer_h - s_view_h : 0;
+
+    // Top and bottom
+    if (count && (!bound_at(&m, count, 0, 0, &y) || y != 0))
+        fail(count, "first row not at the top", y, 0);
+    if (count && (uint64_t)count * s_row_h > (uint64_t)s_view_h)
+    {
+        if (!bound_at(&m, count, range, count - 1, &y))
+            fail(count, "last row not bound at the end", range, count - 1);
+        else if (y + s_row_h != s_view_h)
+            fail(count, "last row not at the bottom", y + s_row_h, s_view_h);
+    }
+
+    // Every scroll position: monotonic, bounded steps, small positions
+    uint64_t step_max = m.virt_h > (uint64_t)m.spacer_h && range ? (m.virt_h - s_view_h) / range + 1 : 1;
+    uint64_t prev = 0;
+    for (int32_t s = 0; s <= range; s++)
+    {
+        uint64_t top = pst_vlist_map_virtual(&m, s);
+        if (top < prev || top - prev > step_max)
+            fail(count, "scroll step", (long)prev, (long)top);
+        prev = top;
+        uint32_t first = pst_vlist_map_first(&m, top, OVERSCAN);
+        for (uint32_t i = first; i < first + s_rows_n && i < count; i++)
+        {
+            y = pst_vlist_map_row_y(&m, top, i);
+            if (y < -(OVERSCAN + 1) * s_row_h || y > (int32_t)(s_rows_n + 1) * s_row_h)
+            {
+                fail(count, "row placed far from the viewport", i, y);
+                break;
+            }
+        }
+    }
+
+    // Every row scrolled to is bound and fully visible, if a scroll step leaves room for it
+    if (step_max + s_row_h > (uint64_t)s_view_h)
+        printf("%7u entries: a scroll step passes a whole viewport, not every row can be scrolled to\n", count);
+    else
+        for (uint32_t i = 0; i < count; i++)
+        {
+            int32_t s = pst_vlist_map_scroll(&m, (uint64_t)i * s_row_h);
+            if (!bound_at(&m, count, s, i, &y) || y < 0 || y + s_row_h > s_view_h)
+            {
+                fail(count, "row scrolled to not in view", i, y);
+                break;
+            }
+        }
+
+    printf("%7u entries: spacer %4d px, %5.1f px of rows per scrolled px\n", count, m.spacer_h,
+           range ? (double)(m.virt_h > (uint64_t)s_view_h ? m.virt_h - s_view_h : 0) / range : 1.0);
+}
+
+int main(int argc, char **argv)
+{
+    // Up to the most a FAT directory holds (65536 entries, '.' and '..' included)
+    static const uint32_t counts[] = { 0, 1, 10, 11, 204, 205, 254, 255, 256, 819, 820, 5000, 65534 };
+    int opt;
+
+    while ((opt = getopt(argc, argv, "r:v:")) != -1)
+    {
+        switch (opt)
+        {
+        case 'r': s_row_h = atoi(optarg); break;
+        case 'v': s_view_h = atoi(optarg); break;
+        default:
+            fprintf(stderr, "usage: %s [-r row_height] [-v view_height]\n", argv[0]);
+            return 2;
+        }
+    }
+    if (!s_row_h || s_view_h <= 0)
+        return 2;
+
+    // As ensure_rows() in pst_vlist.c
+    s_rows_n = (s_view_h + s_row_h - 1) / s_row_h + 1 + 2 * OVERSCAN;
+    if (s_rows_n > MAX_ROWS)
+        s_rows_n = MAX_ROWS;
+
+    for (size_t i = 0; i < sizeof(counts) / sizeof(counts[0]); i++)
+        check_count(counts[i]);
+
+    // The case that broke: row 4999 of 5000, scrolled to the end
+    pst_vlist_map_t m;
+    int32_t y;
+    pst_vlist_map_set(&m, 5000, s_row_h, s_view_h, SPACER_MAX);
+    if (bound_at(&m, 5000, m.spacer_h - s_view_h, 4999, &y))
+        printf("row 4999 of 5000 bound at y %d\n", y);
+    else
+        fail(5000, "row 4999 not bound", 4999, 0);
+
+    if (s_errors)
+    {
+        printf("FAILED: %u checks\n", s_errors);
+        return 1;
+    }
+    printf("OK\n");
+    return 0;
+}
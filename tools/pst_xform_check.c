@@ -0,0 +1,249 @@
+/**
+ * Host check of the touch coordinate transform (src/pst_touch_xform.c).
+ *
+ * For every rotation with every combination of mirror_x, mirror_y and swap_xy,
+ * the corners and the center of the controller are mapped through the Q16.16
+ * matrix and compared with the same steps applied one at a time (rotate, mirror,
+ * swap), exactly. The plain rotations are also checked against fixed corners.
+ * Then the same with a calibration that scales, shears and shifts (within a pixel
+ * of the exact value), and a calibration is computed back from three targets.
+ *
+ * Build and run on the host:
+ *   gcc -O2 -Wall -Wextra -Isrc tools/pst_xform_check.c src/pst_touch_xform.c -lm -o pst_xform_check
+ *   ./pst_xform_check
+ */
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include "pst_touch_xform.h"
+
+#define X_MAX 320
+#define Y_MAX 480
+
+static uint32_t s_checks;
+static uint32_t s_errors;
+
+static const char *const s_rot_names[] = { "0", "90", "180", "270" };
+
+// One step at a time, as the controller driver would do it per point
+static void reference(const pst_touch_orient_t *o, const pst_touch_cal_t *cal, int x, int y, int *rx, int *ry)
+{
+    int xm = o->x_max - 1, ym = o->y_max - 1;
+    int w = o->x_max, h = o->y_max;
+    int nx = x, ny = y;
+
+    switch (o->rotate)
+    {
+    case PST_TOUCH_ROT_90:
+        nx = y;
+        ny = xm - x;
+        w = o->y_max;
+        h = o->x_max;
+        break;
+    case PST_TOUCH_ROT_180:
+        nx = xm - x;
+        ny = ym - y;
+        break;
+    case PST_TOUCH_ROT_270:
+        nx = ym - y;
+        ny = x;
+        w = o->y_max;
+        h = o->x_max;
+        break;
+    default:
+        break;
+    }
+    if (o->mirror_x)
+        nx = w - 1 - nx;
+    if (o->mirror_y)
+        ny = h - 1 - ny;
+    if (o->swap_xy)
+    {
+        int t = nx;
+        nx = ny;
+        ny = t;
+        t = w;
+        w = h;
+        h = t;
+    }
+    if (cal)
+    {
+        const double one = PST_TOUCH_XFORM_ONE;
+        double cx = (cal->a * (double)nx + cal->b * (double)ny + cal->c) / one;
+        double cy = (cal->d * (double)nx + cal->e * (double)ny + cal->f) / one;
+        nx = (int)floor(cx + 0.5);
+        ny = (int)floor(cy + 0.5);
+    }
+    *rx = nx < 0 ? 0 : (nx >= w ? w - 1 : nx);
+    *ry = ny < 0 ? 0 : (ny >= h ? h - 1 : ny);
+}
+
+static void check_point(const pst_touch_orient_t *o, const pst_touch_cal_t *cal, const pst_touch_xform_t *xf,
+                        int x, int y, int tolerance)
+{
+    uint16_t px = x, py = y;
+    int want_x, want_y;
+
+    pst_touch_xform_apply(xf, &px, &py, 1);
+    reference(o, cal, x, y, &want_x, &want_y);
+    s_checks++;
+    if (abs(px - want_x) > tolerance || abs(py - want_y) > tolerance)
+    {
+        fprintf(stderr, "rot %s%s%s%s%s: (%d, %d) -> (%u, %u), want (%d, %d)\n", s_rot_names[o->rotate],
+                o->mirror_x ? " mirror_x" : "", o->mirror_y ? " mirror_y" : "", o->swap_xy ? " swap_xy" : "",
+                cal ? " cal" : "", x, y, px, py, want_x, want_y);
+        s_errors++;
+    }
+}
+
+static void check_orient(const pst_touch_orient_t *o, const pst_touch_cal_t *cal, int tolerance)
+{
+    static const int corners[][2] = {
+        { 0, 0 }, { X_MAX - 1, 0 }, { 0, Y_MAX - 1 }, { X_MAX - 1, Y_MAX - 1 }, { X_MAX / 2, Y_MAX / 2 },
+    };
+    pst_touch_xform_t xf;
+
+    pst_touch_xform_build(&xf, o, cal);
+    bool tall = (o->rotate == PST_TOUCH_ROT_90 || o->rotate == PST_TOUCH_ROT_270) == o->swap_xy;
+    s_checks++;
+    if (xf.w != (tall ? X_MAX : Y_MAX) || xf.h != (tall ? Y_MAX : X_MAX))
+    {
+        fprintf(stderr, "rot %s: display %ux%u\n", s_rot_names[o->rotate], xf.w, xf.h);
+        s_errors++;
+    }
+    for (size_t i = 0; i < sizeof(corners) / sizeof(corners[0]); i++)
+        check_point(o, cal, &xf, corners[i][0], corners[i][1], tolerance);
+    // A few points inside, and past the controller's range (clamped)
+    for (int i = 0; i < 50; i++)
+        check_point(o, cal, &xf, rand() % X_MAX, rand() % Y_MAX, tolerance);
+    check_point(o, cal, &xf, X_MAX + 20, Y_MAX + 20, tolerance);
+}
+
+// Where the corners of the controller land with no mirror or swap
+static void check_fixed(void)
+{
+    static const struct {
+        pst_touch_rot_t rot;
+        int x, y, want_x, want_y;
+    } cases[] = {
+        { PST_TOUCH_ROT_0, 0, 0, 0, 0 },
+        { PST_TOUCH_ROT_0, X_MAX - 1, 0, X_MAX - 1, 0 },
+        { PST_TOUCH_ROT_90, 0, 0, 0, X_MAX - 1 },
+        { PST_TOUCH_ROT_90, X_MAX - 1, Y_MAX - 1, Y_MAX - 1, 0 },
+        { PST_TOUCH_ROT_180, 0, 0, X_MAX - 1, Y_MAX - 1 },
+        { PST_TOUCH_ROT_180, X_MAX / 2, Y_MAX / 2, X_MAX - 1 - X_MAX / 2, Y_MAX - 1 - Y_MAX / 2 },
+        { PST_TOUCH_ROT_270, 0, 0, Y_MAX - 1, 0 },
+        { PST_TOUCH_ROT_270, X_MAX - 1, Y_MAX - 1, 0, X_MAX - 1 },
+    };
+
+    for (size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); i++)
+    {
+        pst_touch_orient_t o = { .x_max = X_MAX, .y_max = Y_MAX, .rotate = cases[i].rot };
+        pst_touch_xform_t xf;
+        uint16_t x = cases[i].x, y = cases[i].y;
+
+        pst_touch_xform_build(&xf, &o, NULL);
+        pst_touch_xform_apply(&xf, &x, &y, 1);
+        s_checks++;
+        if (x != cases[i].want_x || y != cases[i].want_y)
+        {
+            fprintf(stderr, "rot %s: (%d, %d) -> (%u, %u), want (%d, %d)\n", s_rot_names[cases[i].rot], cases[i].x,
+                    cases[i].y, x, y, cases[i].want_x, cases[i].want_y);
+            s_errors++;
+        }
+    }
+}
+
+static void check_compute(const pst_touch_cal_t *cal)
+{
+    const double one = PST_TOUCH_XFORM_ONE;
+    const pst_touch_point_t target[3] = { { 30, 30 }, { 290, 240 }, { 60, 450 } };
+    pst_touch_point_t measured[3];
+    pst_touch_cal_t got;
+
+    // Measured points the inverse of `cal` would report at the targets
+    double det = (double)cal->a * cal->e - (double)cal->b * cal->d;
+    for (int i = 0; i < 3; i++)
+    {
+        double tx = target[i].x - cal->c / one, ty = target[i].y - cal->f / one;
+        measured[i].x = (int16_t)lround((cal->e * tx - cal->b * ty) * one / det);
+        measured[i].y = (int16_t)lround((cal->a * ty - cal->d * tx) * one / det);
+    }
+    s_checks++;
+    if (!pst_touch_cal_compute(measured, target, &got))
+    {
+        fprintf(stderr, "calibration from three targets rejected\n");
+        s_errors++;
+        return;
+    }
+    // The computed calibration takes each measured point back to its target
+    for (int i = 0; i < 3; i++)
+    {
+        double x = (got.a * (double)measured[i].x + got.b * (double)measured[i].y + got.c) / one;
+        double y = (got.d * (double)measured[i].x + got.e * (double)measured[i].y + got.f) / one;
+        s_checks++;
+        if (fabs(x - target[i].x) > 0.5 || fabs(y - target[i].y) > 0.5)
+        {
+            fprintf(stderr, "computed calibration: target %d at (%.2f, %.2f), want (%d, %d)\n", i, x, y,
+                    target[i].x, target[i].y);
+            s_errors++;
+        }
+    }
+
+    // Collinear targets and a correction far too large are refused
+    const pst_touch_point_t line[3] = { { 10, 10 }, { 100, 100 }, { 200, 200 } };
+    const pst_touch_point_t far[3] = { { 230, 230 }, { 490, 440 }, { 260, 650 } };
+    s_checks += 2;
+    if (pst_touch_cal_compute(line, target, &got))
+    {
+        fprintf(stderr, "collinear points accepted\n");
+        s_errors++;
+    }
+    if (pst_touch_cal_compute(far, target, &got))
+    {
+        fprintf(stderr, "200 px offset accepted\n");
+        s_errors++;
+    }
+}
+
+int main(void)
+{
+    // Panel a little off: 2% larger in X, 1.5% smaller in Y, slightly sheared, shifted
+    const pst_touch_cal_t cal = {
+        .a = (int32_t)(1.02 * PST_TOUCH_XFORM_ONE), .b = (int32_t)(0.01 * PST_TOUCH_XFORM_ONE),
+        .c = 5 * PST_TOUCH_XFORM_ONE,
+        .d = (int32_t)(-0.008 * PST_TOUCH_XFORM_ONE), .e = (int32_t)(0.985 * PST_TOUCH_XFORM_ONE),
+        .f = -3 * PST_TOUCH_XFORM_ONE,
+    };
+
+    srand(42);
+    check_fixed();
+    for (int rot = PST_TOUCH_ROT_0; rot <= PST_TOUCH_ROT_270; rot++)
+    {
+        for (int flags = 0; flags < 8; flags++)
+        {
+            pst_touch_orient_t o = {
+                .x_max = X_MAX,
+                .y_max = Y_MAX,
+                .rotate = (pst_touch_rot_t)rot,
+                .mirror_x = flags & 1,
+                .mirror_y = (flags & 2) != 0,
+                .swap_xy = (flags & 4) != 0,
+            };
+            check_orient(&o, NULL, 0);
+            // Q16.16 rounding of the folded matrix may differ from the reference by a pixel
+            check_orient(&o, &cal, 1);
+        }
+    }
+    check_compute(&cal);
+
+    printf("%u checks, %u failed\n", s_checks, s_errors);
+    if (s_errors)
+    {
+        printf("FAILED\n");
+        return 1;
+    }
+    printf("OK\n");
+    return 0;
+}